@@ -0,0 +1,52 @@
+import ctypes
+from ctypes import c_char, c_char_p, c_int, c_double, c_ulonglong, POINTER
+import sys
+
+# Использование: python bench_codecs.py <image> [форматы через запятую] [iterations] [путь к DLL/so]
+# Например, сравнение QOI и PNG для промежуточных файлов: python bench_codecs.py big.png png,qoi
+image_path = sys.argv[1] if len(sys.argv) > 1 else r"D:\LT\test.jpg"
+formats = (sys.argv[2] if len(sys.argv) > 2 else "jpg").split(",")
+iterations = int(sys.argv[3]) if len(sys.argv) > 3 else 5
+dll_path = sys.argv[4] if len(sys.argv) > 4 else r"D:\LT\LUToolsLite.dll"
+
+try:
+    lutools = ctypes.CDLL(dll_path)
+except OSError as e:
+    print(f"Ошибка загрузки DLL: {e}")
+    exit(1)
+
+
+class CodecBenchResult(ctypes.Structure):
+    _fields_ = [
+        ("codec", c_char * 32),
+        ("decodeMBps", c_double),
+        ("encodeMBps", c_double),
+        ("encodedBytes", c_ulonglong),
+    ]
+
+
+lutools.LUTools_Init.restype = c_int
+lutools.LUTools_BenchmarkCodecs.argtypes = [c_char_p, c_char_p, c_int, POINTER(CodecBenchResult), c_int, POINTER(c_int)]
+lutools.LUTools_BenchmarkCodecs.restype = c_int
+lutools.LUTools_GetLastErrorMessage.argtypes = [POINTER(c_char_p)]
+lutools.LUTools_GetLastErrorMessage.restype = None
+
+lutools.LUTools_Init()
+
+MAX_RESULTS = 16
+print(f"{'format':<8} {'backend':<16} {'decode MB/s':>12} {'encode MB/s':>12} {'size, bytes':>14}")
+for fmt in formats:
+    results = (CodecBenchResult * MAX_RESULTS)()
+    count = c_int()
+    res = lutools.LUTools_BenchmarkCodecs(image_path.encode("utf-8"), fmt.encode("utf-8"), iterations,
+                                          results, MAX_RESULTS, ctypes.byref(count))
+    if res != 0:
+        err = c_char_p()
+        lutools.LUTools_GetLastErrorMessage(ctypes.byref(err))
+        print(f"{fmt:<8} ошибка: {err.value.decode('utf-8')}")
+        continue
+
+    for r in results[:count.value]:
+        dec = f"{r.decodeMBps:.1f}" if r.decodeMBps > 0 else "-"
+        enc = f"{r.encodeMBps:.1f}" if r.encodeMBps > 0 else "-"
+        print(f"{fmt:<8} {r.codec.decode('utf-8'):<16} {dec:>12} {enc:>12} {r.encodedBytes:>14}")
@@ -1,6 +1,8 @@
 #ifndef LUTOOLSLITE_H
 #define LUTOOLSLITE_H
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -12,6 +14,8 @@ extern "C" {
 #  else
 #    define LTL_API __declspec(dllimport)
 #  endif
+#elif defined(__GNUC__)
+#  define LTL_API __attribute__((visibility("default")))
 #else
 #  define LTL_API
 #endif
@@ -23,19 +27,80 @@ extern "C" {
 #define MEMORY_ALLOCATION_FAILED 3
 #define CANCELLED 4
 #define INITIALIZATION_FAILED 5
+#define INVALID_CODEC 6
+#define UNSUPPORTED_FORMAT 7
+#define WRITE_FAILED 8
 
 // === КОЛБЭКИ ===
 typedef void (*LogCallback)(const char* message, int is_error, void* user_data);
 typedef void (*ProgressCallback)(float progress, void* user_data);
+// Приёмник байтов: закодированные изображения, текстовые снимки метрик
+typedef void (*LUTools_WriteFn)(void* context, const void* data, int size);
+
+// Подробный прогресс: единицы работы — строки изображения, узлы решётки LUT или файлы пакета
+typedef struct LUTools_Progress {
+    float progress;                 // 0..1
+    unsigned long long done;
+    unsigned long long total;
+    double elapsedSeconds;
+    double etaSeconds;              // оценка оставшегося времени; -1 — пока неизвестно
+    const char* stage;              // "Decoding", "Applying LUTs", "Encoding", "Building LUT"…; действителен во время вызова
+} LUTools_Progress;
+typedef void (*ProgressCallbackEx)(const LUTools_Progress* progress, void* user_data);
 
 // === ИНИЦИАЛИЗАЦИЯ / ОСВОБОЖДЕНИЕ ===
 LTL_API int  LUTools_Init();
+// Освобождает LUT и колбэки контекста по умолчанию, выводит журнал и останавливает фоновые
+// потоки (журнал, прогресс, пул); следующий вызов API запустит их снова. Вызывать, когда других
+// вызовов нет, и обязательно перед выгрузкой DLL: при выходе потоки библиотеки не ожидаются.
 LTL_API void LUTools_Cleanup();
 
 // === LUT ===
 LTL_API int  LUTools_LoadLUT(const char* filePath, float blend, int* lutId);
+// Безопасно во время обработки: начатые вызовы дорабатывают со своей ссылкой на таблицу
 LTL_API void LUTools_UnloadLUT(int lutId);
 LTL_API void LUTools_ClearLUTs();
+// Бинарный кэш рядом с .cube (<файл>.cube.ltlc), проверяется по хэшу содержимого;
+// повторная загрузка не разбирает текст. По умолчанию включён.
+LTL_API void LUTools_SetLUTCacheEnabled(int enabled);
+
+// Бюджет памяти данных LUT в байтах (0 — без ограничения, по умолчанию). При превышении
+// данные давно не использованных LUT выгружаются, id остаются действительными: таблица
+// перечитывается из исходного .cube (через бинарный кэш) при следующем использовании.
+typedef struct LUTools_LUTStats {
+    unsigned long long budget;
+    unsigned long long bytesLoaded;    // данные LUT в памяти
+    int registered;                    // всего id
+    int loaded;                        // из них с данными в памяти
+    unsigned long long hits;           // обращений к загруженным LUT
+    unsigned long long misses;         // обращений с загрузкой
+    unsigned long long evictions;      // выгрузок по бюджету
+} LUTools_LUTStats;
+
+LTL_API void LUTools_SetLUTBudget(unsigned long long bytes);
+LTL_API void LUTools_GetLUTStats(LUTools_LUTStats* stats);
+
+// === БИБЛИОТЕКА LUT ===
+// Массовая регистрация: id возвращаются сразу, заголовки .cube читаются в фоне на пуле
+// потоков (прогресс — через ProgressCallback), таблица загружается при первом
+// использовании в обработке или превью. Ошибка чтения файла всплывает при первом использовании.
+#define LTL_LUT_PENDING    0   // заголовок ещё не прочитан
+#define LTL_LUT_REGISTERED 1   // заголовок прочитан, данные не загружены
+#define LTL_LUT_LOADED     2
+#define LTL_LUT_FAILED     3   // файл не читается или повреждён
+
+typedef struct LUTools_LUTInfo {
+    int state;            // LTL_LUT_*
+    int size;             // LUT_3D_SIZE; 0 — ещё неизвестен
+    float blend;
+    char title[128];      // TITLE из файла, обрезается
+} LUTools_LUTInfo;
+
+// lutIds — массив на count элементов
+LTL_API int LUTools_RegisterLUTs(const char** filePaths, int count, float blend, int* lutIds);
+// Все *.cube каталога (без подкаталогов) в порядке имён. lutIds == NULL — только *count.
+LTL_API int LUTools_RegisterLUTDirectory(const char* directory, float blend, int* lutIds, int maxIds, int* count);
+LTL_API int LUTools_GetLUTInfo(int lutId, LUTools_LUTInfo* info);
 
 // === ОБРАБОТКА ФАЙЛОВ ===
 LTL_API int LUTools_ProcessFile(
@@ -55,6 +120,45 @@ LTL_API int LUTools_ProcessFiles(
     float whiteBalance, float tint, float brightness, float contrast, float saturation,
     LogCallback logCallback, void* userData);
 
+// === ФОРМАТ ВЫВОДА ===
+#define LTL_FORMAT_JPEG 0
+#define LTL_FORMAT_PNG  1
+#define LTL_FORMAT_BMP  2
+#define LTL_FORMAT_TGA  3
+#define LTL_FORMAT_QOI  4
+
+typedef struct LUTools_OutputOptions {
+    int format;            // LTL_FORMAT_*
+    int jpegQuality;       // 1..100
+    int jpegSubsampling;   // 444, 422, 420; 0 — 4:4:4 при quality >= 90, иначе 4:2:0
+    int jpegRestartRows;   // MCU-строк в restart-интервале; -1 — авто, 0 — без маркеров
+    int pngCompression;    // 0..9
+} LUTools_OutputOptions;
+
+// JPEG, quality 95 — то же, что пишут LUTools_ProcessFile / LUTools_ProcessFiles
+LTL_API void LUTools_GetDefaultOutputOptions(LUTools_OutputOptions* options);
+
+// output == NULL — настройки по умолчанию. Сообщения журнала вызова (и задач пакета) уходят
+// в logCallback из фонового потока журнала; NULL — в колбэк LUTools_SetLogCallback.
+LTL_API int LUTools_ProcessFileEx(
+    const char* inputPath,
+    const char* outputPath,
+    const int* lutIds,
+    int lutCount,
+    float whiteBalance, float tint, float brightness, float contrast, float saturation,
+    const LUTools_OutputOptions* output,
+    LogCallback logCallback, void* userData);
+
+LTL_API int LUTools_ProcessFilesEx(
+    const char** inputPaths,
+    const char** outputPaths,
+    int fileCount,
+    const int* lutIds,
+    int lutCount,
+    float whiteBalance, float tint, float brightness, float contrast, float saturation,
+    const LUTools_OutputOptions* output,
+    LogCallback logCallback, void* userData);
+
 // === ОБРАБОТКА ИЗОБРАЖЕНИЙ ===
 LTL_API int LUTools_ProcessImage(
     unsigned char* inputData,
@@ -95,17 +199,143 @@ LTL_API int LUTools_ResizeImage(
     int* outWidth, int* outHeight, int* outChannels);
 
 // === ОСВОБОЖДЕНИЕ ПАМЯТИ ===
+// Буферы изображений возвращаются в пул и переиспользуются следующими вызовами
 LTL_API void LUTools_FreeMemory(unsigned char* data);
 
+// === ПУЛ БУФЕРОВ ===
+typedef struct LUTools_PoolStats {
+    unsigned long long bytesInUse;     // выдано и не возвращено
+    unsigned long long bytesCached;    // свободные буферы в пуле
+    unsigned long long peakBytes;      // максимум bytesInUse + bytesCached
+    unsigned long long acquires;       // запросов буфера
+    unsigned long long reuses;         // из них обслужено из пула
+    unsigned long long systemAllocs;   // выделений у ОС
+    unsigned long long systemFrees;    // возвратов ОС
+} LUTools_PoolStats;
+
+// Сколько байт свободных буферов держать в пуле (по умолчанию 1 ГБ); 0 — не кешировать
+LTL_API void LUTools_SetPoolLimit(unsigned long long bytes);
+LTL_API void LUTools_GetPoolStats(LUTools_PoolStats* stats);
+// Возвращает ОС все свободные буферы пула
+LTL_API void LUTools_TrimPool(void);
+
+// === СТАТИСТИКА ===
+// Счётчики по этапам за всё время процесса (общие для всех контекстов). Каждый поток
+// считает в свои счётчики без блокировок, LUTools_GetStats суммирует их.
+#define LTL_STAT_DECODE      0   // bytes — сжатые входные данные
+#define LTL_STAT_RESIZE      1
+#define LTL_STAT_APPLY       2   // LUT и коррекции (один проход по пикселям)
+#define LTL_STAT_ENCODE      3   // bytes — сжатые выходные данные
+#define LTL_STAT_LUT_LOOKUP  4   // поиск цепочки LUT по id
+#define LTL_STAT_LUT_LOAD    5   // чтение .cube; bytes — размер таблицы
+#define LTL_STAT_LUT_BUILD   6   // k-NN в CreateLUTFromImages; pixels — узлы решётки
+#define LTL_STAT_QUEUE_WAIT  7   // ожидание в очереди пула потоков и места в пакете
+#define LTL_STAT_COUNT       8
+
+typedef struct LUTools_StageStats {
+    unsigned long long calls;
+    unsigned long long pixels;
+    unsigned long long bytes;
+    unsigned long long nanoseconds;    // суммарное время всех вызовов
+} LUTools_StageStats;
+
+typedef struct LUTools_Stats {
+    LUTools_StageStats stages[LTL_STAT_COUNT];   // индекс — LTL_STAT_*
+} LUTools_Stats;
+
+LTL_API void LUTools_GetStats(LUTools_Stats* stats);
+// Обнуляет и счётчики этапов, и гистограммы задержек
+LTL_API void LUTools_ResetStats(void);
+
+// Задержки успешных вызовов API по размеру входного изображения: лог-линейные гистограммы
+// (погрешность квантилей не больше 1/32), каждый поток пишет в свои без блокировок
+#define LTL_LATENCY_PROCESS_FILE      0   // ProcessFile и ProcessFileEx
+#define LTL_LATENCY_PROCESS_IMAGE     1
+#define LTL_LATENCY_PREVIEW           2
+#define LTL_LATENCY_PREVIEW_FIT       3
+#define LTL_LATENCY_OP_COUNT          4
+
+#define LTL_SIZE_UNDER_025MP          0
+#define LTL_SIZE_025_1MP              1
+#define LTL_SIZE_1_4MP                2
+#define LTL_SIZE_4_16MP               3
+#define LTL_SIZE_16MP_AND_UP          4
+#define LTL_SIZE_COUNT                5
+
+typedef struct LUTools_LatencyStats {
+    unsigned long long count;
+    double p50, p95, p99, max;         // секунды; верхняя граница корзины гистограммы
+    double mean;
+} LUTools_LatencyStats;
+
+// sizeBucket = -1 — все размеры вместе
+LTL_API void LUTools_GetLatency(int op, int sizeBucket, LUTools_LatencyStats* stats);
+// Текстовый снимок в формате Prometheus: lutools_latency_seconds{op,size,quantile}, _sum, _count
+LTL_API void LUTools_WriteLatencyMetrics(LUTools_WriteFn write, void* writeContext);
+// Тот же снимок в файл; файл заменяется целиком (через временный)
+LTL_API int LUTools_SaveLatencyMetrics(const char* path);
+
+// === ТРАССИРОВКА ===
+// Временная шкала в формате Chrome Trace Event JSON (chrome://tracing, ui.perfetto.dev):
+// вызовы API, файлы пакета, декодирование и кодирование, тайлы применения LUT, блоки k-NN
+// в CreateLUTFromImages. Каждый поток пишет в свой буфер (до 262144 событий). Выключенная
+// трассировка ничего не записывает и почти ничего не стоит.
+// Очищает записанные события и включает запись
+LTL_API void LUTools_StartTrace(void);
+LTL_API void LUTools_StopTrace(void);
+// События с последнего LUTools_StartTrace; можно вызывать и во время записи
+LTL_API int  LUTools_SaveTrace(const char* path);
+LTL_API void LUTools_WriteTrace(LUTools_WriteFn write, void* writeContext);
+
 // === КОЛБЭКИ ===
 LTL_API void LUTools_SetLogCallback(LogCallback callback, void* userData);
 LTL_API void LUTools_SetProgressCallback(ProgressCallback callback, void* userData);
+// Прогресс считается рабочими потоками без блокировок, а колбэки (обычный и Ex) вызывает
+// один фоновый поток не чаще LUTools_SetProgressRate раз в секунду на операцию (по умолчанию
+// 10; 0 — без ограничения). Последний отчёт (1.0) приходит до возврата из функции в её потоке,
+// после возврата колбэки операции больше не вызываются. Колбэки снимаются при старте операции.
+// Исключение — RegisterLUTs/RegisterLUTDirectory: заголовки читаются после возврата, и весь
+// их прогресс, включая последний отчёт, приходит из фонового потока.
+LTL_API void LUTools_SetProgressCallbackEx(ProgressCallbackEx callback, void* userData);
+LTL_API void LUTools_SetProgressRate(unsigned maxPerSecond);
+
+// === ЖУРНАЛ ===
+// Сообщения выводятся фоновым потоком: вызывающие потоки не ждут ни файла, ни колбэка,
+// колбэк LUTools_SetLogCallback вызывается из фонового потока. После возврата из
+// LUTools_SetLogCallback старый колбэк больше не вызывается. При переполнении очереди
+// или лимите сообщения отбрасываются (см. LUTools_GetLogStats).
+#define LTL_LOG_ERROR   0
+#define LTL_LOG_WARNING 1
+#define LTL_LOG_INFO    2   // по умолчанию
+#define LTL_LOG_DEBUG   3   // подробные; при сборке с LTL_LOG_COMPILE_LEVEL < 3 не компилируются
+
+typedef struct LUTools_LogStats {
+    unsigned long long written;        // выведено
+    unsigned long long droppedFull;    // очередь переполнена
+    unsigned long long droppedRate;    // сверх лимита в секунду
+} LUTools_LogStats;
+
+LTL_API void LUTools_SetLogLevel(int level);
+// Дописывать журнал в файл; NULL — без файла (по умолчанию)
+LTL_API void LUTools_SetLogFile(const char* path);
+// Не больше perSecond сообщений в секунду, ошибки не ограничиваются; 0 — без лимита
+LTL_API void LUTools_SetLogRateLimit(unsigned perSecond);
+// Дожидается вывода всех уже поставленных сообщений
+LTL_API void LUTools_FlushLog(void);
+LTL_API void LUTools_GetLogStats(LUTools_LogStats* stats);
 
 // === ОТМЕНА ===
+// Операции проверяют отмену между тайлами изображения, узлами при построении LUT,
+// полосами кодека и файлами пакета и возвращают CANCELLED в пределах миллисекунд.
+// Флаг *cancelFlag != 0 отменяет все операции, пока его не сбросят; чтение без блокировок.
 LTL_API void LUTools_SetCancelFlag(int* cancelFlag);
 LTL_API int  LUTools_IsCancelled();
+// Отменяет операции, уже идущие в контексте; следующие вызовы работают как обычно
+LTL_API void LUTools_Cancel(void);
 
 // === ПОЛУЧЕНИЕ ОШИБКИ ===
+// Сообщение последней ошибки в вызывающем потоке (своё у каждого потока); указатель
+// действителен до следующей ошибки в этом же потоке
 LTL_API void LUTools_GetLastErrorMessage(const char** message);
 
 // === СОЗДАНИЕ LUT ИЗ ИЗОБРАЖЕНИЙ ===
@@ -116,6 +346,259 @@ LTL_API int LUTools_CreateLUTFromImages(
     const int* lut_sizes,
     int num_sizes);
 
+// === КОДЕКИ ===
+#define LTL_CODEC_CAP_DECODE        1
+#define LTL_CODEC_CAP_ENCODE        2
+#define LTL_CODEC_CAP_SCALED_DECODE 4
+#define LTL_CODEC_CAP_16BIT         8
+#define LTL_CODEC_CAP_STREAMING     16
+
+// Результат внешнего декодера: RGB, width*height*3 байт; release освобождает pixels
+typedef struct LUTools_DecodedImage {
+    unsigned char* pixels;
+    int width;
+    int height;
+    void (*release)(unsigned char* pixels, void* userData);
+} LUTools_DecodedImage;
+
+// Возвращают 0 при успехе
+typedef int (*LUTools_DecodeFn)(const unsigned char* data, size_t size, LUTools_DecodedImage* out, void* userData);
+typedef int (*LUTools_EncodeFn)(const unsigned char* rgb, int width, int height, const char* format, int quality,
+                                LUTools_WriteFn write, void* writeContext, void* userData);
+
+typedef struct LUTools_CodecDesc {
+    const char* name;          // уникальное имя; повторная регистрация заменяет кодек
+    const char* formats;       // через запятую: "jpg,png"
+    unsigned capabilities;     // LTL_CODEC_CAP_*
+    int priority;              // stb = 0, встроенные libjpeg-turbo/libpng = 10
+    LUTools_DecodeFn decode;   // может быть NULL, если нет LTL_CODEC_CAP_DECODE
+    LUTools_EncodeFn encode;   // может быть NULL, если нет LTL_CODEC_CAP_ENCODE
+    void* userData;
+} LUTools_CodecDesc;
+
+typedef struct LUTools_CodecBenchResult {
+    char codec[32];
+    double decodeMBps;
+    double encodeMBps;
+    unsigned long long encodedBytes;
+} LUTools_CodecBenchResult;
+
+LTL_API int LUTools_RegisterCodec(const LUTools_CodecDesc* desc);
+LTL_API int LUTools_UnregisterCodec(const char* name);
+LTL_API int LUTools_BenchmarkCodecs(
+    const char* imagePath,
+    const char* format,
+    int iterations,
+    LUTools_CodecBenchResult* results,
+    int maxResults,
+    int* resultCount);
+
+// === ОБРАБОТКА В ПАМЯТИ ===
+// Вход — закодированное изображение любого поддерживаемого формата (сигнатура определяется
+// автоматически), выход — закодированный по output (NULL — JPEG, quality 95). Без временных файлов.
+
+// *outputData освобождать через LUTools_FreeMemory
+LTL_API int LUTools_ProcessEncoded(
+    const unsigned char* inputData,
+    size_t inputSize,
+    const int* lutIds,
+    int lutCount,
+    float whiteBalance, float tint, float brightness, float contrast, float saturation,
+    const LUTools_OutputOptions* output,
+    unsigned char** outputData,
+    size_t* outputSize);
+
+// Закодированные байты отдаются write(writeContext, ...) кусками по мере готовности
+LTL_API int LUTools_ProcessEncodedToSink(
+    const unsigned char* inputData,
+    size_t inputSize,
+    const int* lutIds,
+    int lutCount,
+    float whiteBalance, float tint, float brightness, float contrast, float saturation,
+    const LUTools_OutputOptions* output,
+    LUTools_WriteFn write,
+    void* writeContext);
+
+// === ПОТОКОВАЯ ОБРАБОТКА ===
+// Для файлов, которые не помещаются в память (панорамы, сканы > 1 ГП): изображение
+// читается, обрабатывается и записывается полосами по stripRows строк (<= 0 — 256),
+// в памяти одновременно только полоса и буферы кодеков. Построчно читаются JPEG
+// (libjpeg-turbo) и PNG без interlace (libpng), пишутся JPEG и PNG; остальные форматы
+// декодируются/кодируются целиком. Прогресс — по полосам, отмена проверяется перед каждой.
+// При ошибке недописанный outputPath удаляется. Сообщения журнала вызова уходят в logCallback
+// (из фонового потока журнала); NULL — в колбэк LUTools_SetLogCallback.
+LTL_API int LUTools_ProcessFileStreaming(
+    const char* inputPath,
+    const char* outputPath,
+    const int* lutIds,
+    int lutCount,
+    float whiteBalance, float tint, float brightness, float contrast, float saturation,
+    const LUTools_OutputOptions* output,
+    int stripRows,
+    LogCallback logCallback, void* userData);
+
+
+// === КОНТЕКСТЫ ===
+// Независимые конвейеры в одном процессе: у каждого контекста свой реестр LUT, колбэки,
+// флаг отмены и доля потоков. Функции без Ctx работают с контекстом
+// по умолчанию, как и ctx = NULL в *Ctx-функциях. Кодеки, пул буферов и пул потоков
+// общие для процесса.
+typedef struct LUTools_Context LUTools_Context;
+
+// maxThreads — сколько файлов пакета обрабатывается одновременно и сколько потоков общего
+// пула (вместе с вызывающим) берёт обработка одного изображения; 0 — по числу ядер
+LTL_API LUTools_Context* LUTools_CreateContext(int maxThreads);
+// Дожидается фонового чтения заголовков LUT; вызовы с этим контекстом должны быть завершены
+LTL_API void LUTools_DestroyContext(LUTools_Context* ctx);
+
+LTL_API int LUTools_LoadLUTCtx(LUTools_Context* ctx, const char* filePath, float blend, int* lutId);
+LTL_API void LUTools_UnloadLUTCtx(LUTools_Context* ctx, int lutId);
+LTL_API void LUTools_ClearLUTsCtx(LUTools_Context* ctx);
+LTL_API void LUTools_SetLUTCacheEnabledCtx(LUTools_Context* ctx, int enabled);
+LTL_API void LUTools_SetLUTBudgetCtx(LUTools_Context* ctx, unsigned long long bytes);
+LTL_API void LUTools_GetLUTStatsCtx(LUTools_Context* ctx, LUTools_LUTStats* stats);
+LTL_API int LUTools_RegisterLUTsCtx(
+    LUTools_Context* ctx,
+    const char** filePaths,
+    int count,
+    float blend,
+    int* lutIds);
+LTL_API int LUTools_RegisterLUTDirectoryCtx(
+    LUTools_Context* ctx,
+    const char* directory,
+    float blend,
+    int* lutIds,
+    int maxIds,
+    int* count);
+LTL_API int LUTools_GetLUTInfoCtx(LUTools_Context* ctx, int lutId, LUTools_LUTInfo* info);
+
+LTL_API int LUTools_ProcessFileExCtx(
+    LUTools_Context* ctx,
+    const char* inputPath,
+    const char* outputPath,
+    const int* lutIds,
+    int lutCount,
+    float whiteBalance, float tint, float brightness, float contrast, float saturation,
+    const LUTools_OutputOptions* output,
+    LogCallback logCallback,
+    void* userData);
+LTL_API int LUTools_ProcessFilesExCtx(
+    LUTools_Context* ctx,
+    const char** inputPaths,
+    const char** outputPaths,
+    int fileCount,
+    const int* lutIds,
+    int lutCount,
+    float whiteBalance, float tint, float brightness, float contrast, float saturation,
+    const LUTools_OutputOptions* output,
+    LogCallback logCallback,
+    void* userData);
+LTL_API int LUTools_ProcessImageCtx(
+    LUTools_Context* ctx,
+    unsigned char* inputData,
+    int width,
+    int height,
+    int channels,
+    const int* lutIds,
+    int lutCount,
+    float whiteBalance, float tint, float brightness, float contrast, float saturation,
+    unsigned char** outputData,
+    int* outWidth,
+    int* outHeight,
+    int* outChannels);
+LTL_API int LUTools_GeneratePreviewCtx(
+    LUTools_Context* ctx,
+    unsigned char* inputData,
+    int width,
+    int height,
+    int channels,
+    const int* lutIds,
+    int lutCount,
+    float whiteBalance, float tint, float brightness, float contrast, float saturation,
+    int previewWidth,
+    int previewHeight,
+    unsigned char** outputData,
+    int* outWidth,
+    int* outHeight,
+    int* outChannels);
+LTL_API int LUTools_GeneratePreviewFitCtx(
+    LUTools_Context* ctx,
+    unsigned char* inputData,
+    int width,
+    int height,
+    int channels,
+    const int* lutIds,
+    int lutCount,
+    float whiteBalance, float tint, float brightness, float contrast, float saturation,
+    int maxWidth,
+    int maxHeight,
+    unsigned char** outputData,
+    int* outWidth,
+    int* outHeight,
+    int* outChannels);
+LTL_API int LUTools_ResizeImageCtx(
+    LUTools_Context* ctx,
+    unsigned char* inputData,
+    int width,
+    int height,
+    int channels,
+    int newWidth,
+    int newHeight,
+    unsigned char** outputData,
+    int* outWidth,
+    int* outHeight,
+    int* outChannels);
+
+LTL_API void LUTools_SetLogCallbackCtx(LUTools_Context* ctx, LogCallback callback, void* userData);
+LTL_API void LUTools_SetProgressCallbackCtx(LUTools_Context* ctx, ProgressCallback callback, void* userData);
+LTL_API void LUTools_SetProgressCallbackExCtx(LUTools_Context* ctx, ProgressCallbackEx callback, void* userData);
+LTL_API void LUTools_SetProgressRateCtx(LUTools_Context* ctx, unsigned maxPerSecond);
+LTL_API void LUTools_SetCancelFlagCtx(LUTools_Context* ctx, int* cancelFlag);
+LTL_API int LUTools_IsCancelledCtx(LUTools_Context* ctx);
+LTL_API void LUTools_CancelCtx(LUTools_Context* ctx);
+// Псевдоним LUTools_GetLastErrorMessage для единообразия *Ctx-API: ошибка хранится у потока,
+// а не у контекста, поэтому ctx не используется — возвращается ошибка вызывающего потока.
+LTL_API void LUTools_GetLastErrorMessageCtx(LUTools_Context* ctx, const char** message);
+
+LTL_API int LUTools_CreateLUTFromImagesCtx(
+    LUTools_Context* ctx,
+    const char* before_path,
+    const char* after_path,
+    const char* output_path_prefix,
+    const int* lut_sizes,
+    int num_sizes);
+LTL_API int LUTools_ProcessEncodedCtx(
+    LUTools_Context* ctx,
+    const unsigned char* inputData,
+    size_t inputSize,
+    const int* lutIds,
+    int lutCount,
+    float whiteBalance, float tint, float brightness, float contrast, float saturation,
+    const LUTools_OutputOptions* output,
+    unsigned char** outputData,
+    size_t* outputSize);
+LTL_API int LUTools_ProcessEncodedToSinkCtx(
+    LUTools_Context* ctx,
+    const unsigned char* inputData,
+    size_t inputSize,
+    const int* lutIds,
+    int lutCount,
+    float whiteBalance, float tint, float brightness, float contrast, float saturation,
+    const LUTools_OutputOptions* output,
+    LUTools_WriteFn write,
+    void* writeContext);
+LTL_API int LUTools_ProcessFileStreamingCtx(
+    LUTools_Context* ctx,
+    const char* inputPath,
+    const char* outputPath,
+    const int* lutIds,
+    int lutCount,
+    float whiteBalance, float tint, float brightness, float contrast, float saturation,
+    const LUTools_OutputOptions* output,
+    int stripRows,
+    LogCallback logCallback,
+    void* userData);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,140 @@
+#include "buffer_pool.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+BufferPool& BufferPool::instance() {
+    // Не разрушается при выходе: буферы могут освобождаться из деструкторов других статиков
+    static BufferPool* pool = new BufferPool();
+    return *pool;
+}
+
+// Классы с шагом в четверть степени двойки: потеря не больше 25%.
+// Большие буферы дополнительно кратны 2 МБ (целые huge pages).
+size_t BufferPool::sizeClass(size_t size) {
+    size = std::max(size, kAlignment);
+    size_t pow = kAlignment;
+    while (pow * 2 <= size) pow *= 2;
+    size_t step = std::max(pow / 4, kAlignment);
+    size_t cls = (size + step - 1) / step * step;
+    if (cls >= kHugePageSize) cls = (cls + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+    return cls;
+}
+
+unsigned char* BufferPool::systemAlloc(size_t size) {
+#ifdef _WIN32
+    void* p = _aligned_malloc(size, kAlignment);
+#else
+    void* p = nullptr;
+    const size_t alignment = size >= kHugePageSize ? kHugePageSize : kAlignment;
+    if (posix_memalign(&p, alignment, size) != 0) p = nullptr;
+#ifdef MADV_HUGEPAGE
+    // Меньше промахов TLB и page fault на многомегабайтных изображениях
+    if (p && size >= kHugePageSize) madvise(p, size, MADV_HUGEPAGE);
+#endif
+#endif
+    if (!p) throw std::bad_alloc();
+    return static_cast<unsigned char*>(p);
+}
+
+void BufferPool::systemFree(void* p) {
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+void BufferPool::updatePeak() {
+    stats_.peakBytes = std::max(stats_.peakBytes, stats_.bytesInUse + stats_.bytesCached);
+}
+
+unsigned char* BufferPool::acquire(size_t size) {
+    const size_t cls = sizeClass(size);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++stats_.acquires;
+        auto it = free_.find(cls);
+        if (it != free_.end() && !it->second.empty()) {
+            unsigned char* p = it->second.back();
+            it->second.pop_back();
+            inUse_[p] = cls;
+            stats_.bytesCached -= cls;
+            stats_.bytesInUse += cls;
+            ++stats_.reuses;
+            return p;
+        }
+    }
+    unsigned char* p = systemAlloc(cls);   // вне блокировки: выделение может быть долгим
+    std::lock_guard<std::mutex> lock(mutex_);
+    inUse_[p] = cls;
+    stats_.bytesInUse += cls;
+    ++stats_.systemAllocs;
+    updatePeak();
+    return p;
+}
+
+bool BufferPool::release(void* p) {
+    if (!p) return false;
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = inUse_.find(p);
+    if (it == inUse_.end()) return false;
+    const size_t cls = it->second;
+    inUse_.erase(it);
+    stats_.bytesInUse -= cls;
+    if (stats_.bytesCached + cls <= limit_) {
+        free_[cls].push_back(static_cast<unsigned char*>(p));
+        stats_.bytesCached += cls;
+        return true;
+    }
+    ++stats_.systemFrees;
+    lock.unlock();
+    systemFree(p);
+    return true;
+}
+
+void BufferPool::setCacheLimit(uint64_t bytes) {
+    std::vector<unsigned char*> drop;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        limit_ = bytes;
+        // Сначала отпускаем самые крупные классы
+        for (auto it = free_.rbegin(); it != free_.rend() && stats_.bytesCached > limit_; ++it) {
+            while (!it->second.empty() && stats_.bytesCached > limit_) {
+                drop.push_back(it->second.back());
+                it->second.pop_back();
+                stats_.bytesCached -= it->first;
+                ++stats_.systemFrees;
+            }
+        }
+    }
+    for (unsigned char* p : drop) systemFree(p);
+}
+
+uint64_t BufferPool::cacheLimit() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return limit_;
+}
+
+void BufferPool::trim() {
+    std::map<size_t, std::vector<unsigned char*>> drop;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        drop.swap(free_);
+        for (const auto& cls : drop) stats_.systemFrees += cls.second.size();
+        stats_.bytesCached = 0;
+    }
+    for (auto& cls : drop)
+        for (unsigned char* p : cls.second) systemFree(p);
+}
+
+BufferPoolStats BufferPool::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
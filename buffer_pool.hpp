@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// ─────────────────────────────────────────────────────────────
+//  Пул буферов пикселей: размерные классы, выравнивание 64 байта,
+//  без обнуления. Освобождённые буферы остаются в пуле и отдаются
+//  следующим изображениям (стадии конвейера, элементы пакета).
+//  Большие буферы выравниваются на 2 МБ и просят у ОС huge pages.
+// ─────────────────────────────────────────────────────────────
+
+struct BufferPoolStats {
+    uint64_t bytesInUse = 0;      // выдано и не возвращено
+    uint64_t bytesCached = 0;     // лежит в пуле
+    uint64_t peakBytes = 0;       // максимум bytesInUse + bytesCached
+    uint64_t acquires = 0;        // запросов
+    uint64_t reuses = 0;          // из них обслужено из пула
+    uint64_t systemAllocs = 0;    // выделено у ОС
+    uint64_t systemFrees = 0;     // возвращено ОС (лимит, Trim)
+};
+
+class BufferPool {
+public:
+    static BufferPool& instance();
+
+    static constexpr size_t kAlignment = 64;
+    static constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+    // Неинициализированный буфер не меньше size байт
+    unsigned char* acquire(size_t size);
+    // false — указатель не из пула
+    bool release(void* p);
+
+    // Сколько байт свободных буферов держать в пуле; лишнее сразу возвращается ОС
+    void setCacheLimit(uint64_t bytes);
+    uint64_t cacheLimit() const;
+    void trim();
+    BufferPoolStats stats() const;
+
+private:
+    BufferPool() = default;
+    static size_t sizeClass(size_t size);
+    static unsigned char* systemAlloc(size_t size);
+    static void systemFree(void* p);
+    void updatePeak();
+
+    mutable std::mutex mutex_;
+    std::map<size_t, std::vector<unsigned char*>> free_;   // класс → свободные буферы
+    std::unordered_map<void*, size_t> inUse_;               // выданные буферы → класс
+    uint64_t limit_ = 1024ull * 1024 * 1024;
+    BufferPoolStats stats_;
+};
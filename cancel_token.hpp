@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// ─────────────────────────────────────────────────────────────
+//  Токен отмены одной операции (файл, пакет, построение LUT).
+//  Проверка — несколько атомарных чтений без блокировок, поэтому
+//  ядра вызывают её между тайлами, узлами k-NN и полосами кодека.
+//  Токен видит флаг вызывающего (LUTools_SetCancelFlag) и счётчик
+//  LUTools_Cancel своего контекста; увидев отмену, запоминает её.
+// ─────────────────────────────────────────────────────────────
+class CancelToken {
+public:
+    // Без источников: отменяется только через cancel()
+    CancelToken() = default;
+
+    CancelToken(const std::atomic<int*>* flag, const std::atomic<uint64_t>* epoch)
+        : flag_(flag), epoch_(epoch), startEpoch_(epoch ? epoch->load(std::memory_order_acquire) : 0) {}
+
+    CancelToken(const CancelToken&) = delete;
+    CancelToken& operator=(const CancelToken&) = delete;
+
+    void cancel() { cancelled_.store(true, std::memory_order_relaxed); }
+
+    bool cancelled() const {
+        if (cancelled_.load(std::memory_order_relaxed)) return true;
+        bool hit = epoch_ && epoch_->load(std::memory_order_relaxed) != startEpoch_;
+        if (!hit && flag_) {
+            // Флаг вызывающего — обычный int, который меняет другой поток
+            const int* flag = flag_->load(std::memory_order_acquire);
+            hit = flag && *static_cast<const volatile int*>(flag) != 0;
+        }
+        if (hit) cancelled_.store(true, std::memory_order_relaxed);
+        return hit;
+    }
+
+private:
+    const std::atomic<int*>* flag_ = nullptr;
+    const std::atomic<uint64_t>* epoch_ = nullptr;
+    uint64_t startEpoch_ = 0;
+    mutable std::atomic<bool> cancelled_{false};
+};
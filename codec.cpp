@@ -0,0 +1,549 @@
+#include "codec.hpp"
+#include "cancel_token.hpp"
+#include "stats.hpp"
+#include "trace.hpp"
+#include "jpeg_codec.hpp"
+#include "png_codec.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+
+// ─────────────────────────────────────────────────────────────
+//  Приёмники байт
+// ─────────────────────────────────────────────────────────────
+FileSink::FileSink(const std::string& path) {
+    file_ = std::fopen(path.c_str(), "wb");
+}
+
+FileSink::~FileSink() {
+    close();
+}
+
+bool FileSink::write(const void* data, size_t size) {
+    if (!file_) return false;
+    if (size && std::fwrite(data, 1, size, file_) != size) ok_ = false;
+    return ok_;
+}
+
+bool FileSink::close() {
+    if (file_) {
+        if (std::fclose(file_) != 0) ok_ = false;
+        file_ = nullptr;
+    }
+    return ok_;
+}
+
+bool VectorSink::write(const void* data, size_t size) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    bytes.insert(bytes.end(), p, p + size);
+    return true;
+}
+
+int jpegSubsampling(const EncodeOptions& options) {
+    if (options.subsampling) return options.subsampling;
+    return std::clamp(options.quality, 1, 100) >= 90 ? 444 : 420;
+}
+
+namespace {
+
+// Приёмник encodeImage и построчных writer: считает байты для статистики и после отмены отказывает в записи —
+// кодеки проверяют результат write после каждой полосы и прекращают кодирование,
+// поэтому отмену видят все бэкенды без своих проверок
+class EncodeSink : public ByteSink {
+public:
+    EncodeSink(ByteSink& sink, const CancelToken* cancel) : sink_(sink), cancel_(cancel) {}
+    bool write(const void* data, size_t size) override {
+        if (cancel_ && cancel_->cancelled()) return false;
+        written_ += size;
+        return sink_.write(data, size);
+    }
+    uint64_t written() const { return written_; }
+private:
+    ByteSink& sink_;
+    const CancelToken* cancel_;
+    uint64_t written_ = 0;
+};
+
+} // namespace
+
+// ─────────────────────────────────────────────────────────────
+//  stb: всегда доступный бэкенд
+// ─────────────────────────────────────────────────────────────
+namespace {
+
+void stbWriteToSink(void* context, void* data, int size) {
+    static_cast<ByteSink*>(context)->write(data, static_cast<size_t>(size));
+}
+
+// Уровень сжатия PNG в stb — глобальная переменная, поэтому запись PNG сериализуется
+std::mutex g_stbPngMutex;
+
+class StbCodec : public ImageCodec {
+public:
+    const char* name() const override { return "stb"; }
+
+    unsigned capabilities(const std::string& format) const override {
+        if (format == "jpg" || format == "png" || format == "bmp" || format == "tga")
+            return CODEC_CAP_DECODE | CODEC_CAP_ENCODE | (format == "png" ? CODEC_CAP_16BIT : 0u);
+        if (format == "gif" || format == "psd" || format == "hdr" || format == "pic" || format == "pnm")
+            return CODEC_CAP_DECODE;
+        return 0;
+    }
+
+    bool decode(const unsigned char* data, size_t size, const DecodeOptions&, Image& out) const override {
+        int width, height, channels;
+        unsigned char* raw = stbi_load_from_memory(data, static_cast<int>(size), &width, &height, &channels, 3);
+        if (!raw) return false;
+        out.width = width;
+        out.height = height;
+        out.channels = 3;
+        // Буфер stb переходит в Image без копии
+        out.data = PixelBuffer::adopt(raw, size_t(width) * height * 3, [](unsigned char* p) { stbi_image_free(p); });
+        return true;
+    }
+
+    bool encode(const Image& img, const std::string& format, const EncodeOptions& options, ByteSink& sink) const override {
+        const int stride = img.width * img.channels;
+        int ok = 0;
+        if (format == "jpg") {
+            // stb сам выбирает прореживание: 4:2:0 при quality <= 90, иначе 4:4:4; 4:2:2 не умеет
+            if (jpegSubsampling(options) != (options.quality > 90 ? 444 : 420)) return false;
+            ok = stbi_write_jpg_to_func(stbWriteToSink, &sink, img.width, img.height, img.channels, img.data.data(), options.quality);
+        }
+        else if (format == "png") {
+            std::lock_guard<std::mutex> lock(g_stbPngMutex);
+            stbi_write_png_compression_level = std::clamp(options.compressionLevel, 0, 9);
+            ok = stbi_write_png_to_func(stbWriteToSink, &sink, img.width, img.height, img.channels, img.data.data(), stride);
+        }
+        else if (format == "bmp")
+            ok = stbi_write_bmp_to_func(stbWriteToSink, &sink, img.width, img.height, img.channels, img.data.data());
+        else if (format == "tga")
+            ok = stbi_write_tga_to_func(stbWriteToSink, &sink, img.width, img.height, img.channels, img.data.data());
+        return ok != 0;
+    }
+};
+
+// Собственный JPEG: параллельное кодирование полосами с restart-маркерами
+// и параллельное декодирование файлов, в которых есть DRI
+class LtlJpegCodec : public ImageCodec {
+public:
+    const char* name() const override { return "ltl-jpeg"; }
+    int priority() const override { return 5; }
+
+    unsigned capabilities(const std::string& format) const override {
+        return format == "jpg" ? (CODEC_CAP_DECODE | CODEC_CAP_ENCODE | CODEC_CAP_PARALLEL | CODEC_CAP_STREAMING) : 0u;
+    }
+
+    // Без restart-маркеров параллелить нечего — уступаем последовательным декодерам
+    bool decode(const unsigned char* data, size_t size, const DecodeOptions& options, Image& out) const override {
+        return options.scaleDenom <= 1 && jpegHasRestartMarkers(data, size) && decodeJpeg(data, size, out, options.cancel);
+    }
+
+    bool encode(const Image& img, const std::string& format, const EncodeOptions& options, ByteSink& sink) const override {
+        return format == "jpg" && encodeJpeg(img, options, sink);
+    }
+
+    // Потоковое только кодирование; чтение — через libjpeg-turbo или целиком
+    std::unique_ptr<RowWriter> openWriter(int width, int height, const std::string& format,
+                                          const EncodeOptions& options, ByteSink& sink) const override {
+        return format == "jpg" ? openJpegWriter(width, height, options, sink) : nullptr;
+    }
+};
+
+// Только кодирование: полосы строк сжимаются deflate на нескольких потоках
+class LtlPngCodec : public ImageCodec {
+public:
+    const char* name() const override { return "ltl-png"; }
+    int priority() const override { return 5; }
+
+    unsigned capabilities(const std::string& format) const override {
+        return format == "png" ? (CODEC_CAP_ENCODE | CODEC_CAP_PARALLEL | CODEC_CAP_STREAMING) : 0u;
+    }
+
+    bool decode(const unsigned char*, size_t, const DecodeOptions&, Image&) const override {
+        return false;
+    }
+
+    bool encode(const Image& img, const std::string& format, const EncodeOptions& options, ByteSink& sink) const override {
+        return format == "png" && encodePng(img, options, sink);
+    }
+
+    std::unique_ptr<RowWriter> openWriter(int width, int height, const std::string& format,
+                                          const EncodeOptions& options, ByteSink& sink) const override {
+        return format == "png" ? openPngWriter(width, height, options, sink) : nullptr;
+    }
+};
+
+class QoiCodec : public ImageCodec {
+public:
+    const char* name() const override { return "qoi"; }
+    int priority() const override { return 5; }
+
+    unsigned capabilities(const std::string& format) const override {
+        return format == "qoi" ? (CODEC_CAP_DECODE | CODEC_CAP_ENCODE) : 0u;
+    }
+
+    bool decode(const unsigned char* data, size_t size, const DecodeOptions&, Image& out) const override {
+        return decodeQoi(data, size, out, 3);
+    }
+
+    bool encode(const Image& img, const std::string& format, const EncodeOptions&, ByteSink& sink) const override {
+        return format == "qoi" && encodeQoi(img, sink);
+    }
+};
+
+// Запасные reader/writer для кодеков без построчного режима
+class ImageRowReader : public RowReader {
+public:
+    explicit ImageRowReader(Image img) : img_(std::move(img)) {}
+    int width() const override { return img_.width; }
+    int height() const override { return img_.height; }
+
+    bool read(unsigned char* rows, int count) override {
+        if (count < 0 || count > img_.height - next_) return false;
+        const size_t stride = size_t(img_.width) * 3;
+        std::memcpy(rows, img_.data.data() + size_t(next_) * stride, size_t(count) * stride);
+        next_ += count;
+        return true;
+    }
+
+private:
+    Image img_;
+    int next_ = 0;
+};
+
+class BufferedRowWriter : public RowWriter {
+public:
+    BufferedRowWriter(int width, int height, const std::string& format, const EncodeOptions& options, ByteSink& sink)
+        : format_(format), options_(options), sink_(sink) {
+        img_.width = width;
+        img_.height = height;
+        img_.channels = 3;
+        img_.data.allocate(size_t(width) * height * 3);
+    }
+
+    bool write(const unsigned char* rows, int count) override {
+        if (count < 0 || count > img_.height - next_) return false;
+        const size_t stride = size_t(img_.width) * 3;
+        std::memcpy(img_.data.data() + size_t(next_) * stride, rows, size_t(count) * stride);
+        next_ += count;
+        return true;
+    }
+
+    bool finish() override {
+        return next_ == img_.height && encodeImage(img_, format_, options_, sink_);
+    }
+
+private:
+    Image img_;
+    std::string format_;
+    EncodeOptions options_;
+    ByteSink& sink_;
+    int next_ = 0;
+};
+
+// Замер построчных кодеков (запасные reader/writer уже учтены в decodeImage/encodeImage).
+// Сжатый вход распределяется по полосам пропорционально числу строк
+class TimedRowReader : public RowReader {
+public:
+    TimedRowReader(std::unique_ptr<RowReader> reader, size_t inputSize)
+        : reader_(std::move(reader)), inputSize_(inputSize) {}
+    int width() const override { return reader_->width(); }
+    int height() const override { return reader_->height(); }
+
+    bool read(unsigned char* rows, int count) override {
+        StatTimer timer(kStatDecode);
+        TraceScope trace("Decode rows", "codec", "rows", count);
+        timer.pixels(uint64_t(width()) * count);
+        if (height() > 0) timer.bytes(uint64_t(inputSize_) * count / height());
+        return reader_->read(rows, count);
+    }
+
+private:
+    std::unique_ptr<RowReader> reader_;
+    size_t inputSize_;
+};
+
+class TimedRowWriter : public RowWriter {
+public:
+    TimedRowWriter(int width, ByteSink& sink, const CancelToken* cancel) : width_(width), sink_(sink, cancel) {}
+
+    bool open(const ImageCodec& codec, int height, const std::string& format, const EncodeOptions& options) {
+        writer_ = codec.openWriter(width_, height, format, options, sink_);
+        return writer_ != nullptr;
+    }
+
+    bool write(const unsigned char* rows, int count) override {
+        StatTimer timer(kStatEncode);
+        TraceScope trace("Encode rows", "codec", "rows", count);
+        timer.pixels(uint64_t(width_) * count);
+        const uint64_t before = sink_.written();
+        const bool ok = writer_->write(rows, count);
+        timer.bytes(sink_.written() - before);
+        return ok;
+    }
+
+    bool finish() override {
+        StatTimer timer(kStatEncode);
+        TraceScope trace("Encode finish", "codec");
+        const uint64_t before = sink_.written();
+        const bool ok = writer_->finish();
+        timer.bytes(sink_.written() - before);
+        return ok;
+    }
+
+private:
+    int width_;
+    EncodeSink sink_;
+    std::unique_ptr<RowWriter> writer_;
+};
+
+} // namespace
+
+// ─────────────────────────────────────────────────────────────
+//  Реестр
+// ─────────────────────────────────────────────────────────────
+CodecRegistry& CodecRegistry::instance() {
+    static CodecRegistry registry;
+    return registry;
+}
+
+CodecRegistry::CodecRegistry() {
+    codecs_.push_back(std::make_shared<StbCodec>());
+    codecs_.push_back(std::make_shared<LtlJpegCodec>());
+    codecs_.push_back(std::make_shared<LtlPngCodec>());
+    codecs_.push_back(std::make_shared<QoiCodec>());
+#ifdef LTL_WITH_LIBJPEG
+    codecs_.push_back(makeLibJpegCodec());
+#endif
+#ifdef LTL_WITH_LIBPNG
+    codecs_.push_back(makeLibPngCodec());
+#endif
+}
+
+void CodecRegistry::add(CodecPtr codec) {
+    if (!codec) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::find_if(codecs_.begin(), codecs_.end(),
+        [&](const CodecPtr& c) { return std::strcmp(c->name(), codec->name()) == 0; });
+    if (it != codecs_.end()) *it = std::move(codec);
+    else codecs_.push_back(std::move(codec));
+}
+
+bool CodecRegistry::remove(const std::string& name) {
+    if (name == "stb") return false;   // запасной вариант удалять нельзя
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::find_if(codecs_.begin(), codecs_.end(),
+        [&](const CodecPtr& c) { return name == c->name(); });
+    if (it == codecs_.end()) return false;
+    codecs_.erase(it);
+    return true;
+}
+
+std::vector<CodecPtr> CodecRegistry::list() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return codecs_;
+}
+
+CodecPtr CodecRegistry::byName(const std::string& name) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& c : codecs_)
+        if (name == c->name()) return c;
+    return nullptr;
+}
+
+CodecPtr CodecRegistry::find(const std::string& format, unsigned requiredCaps) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    CodecPtr best;
+    for (const auto& c : codecs_) {
+        unsigned caps = c->capabilities(format);
+        if (!caps || (caps & requiredCaps) != requiredCaps) continue;
+        if (!best || c->priority() > best->priority()) best = c;
+    }
+    return best;
+}
+
+std::vector<CodecPtr> CodecRegistry::findAll(const std::string& format, unsigned requiredCaps) const {
+    std::vector<CodecPtr> found;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& c : codecs_) {
+            unsigned caps = c->capabilities(format);
+            if (caps && (caps & requiredCaps) == requiredCaps) found.push_back(c);
+        }
+    }
+    std::stable_sort(found.begin(), found.end(),
+        [](const CodecPtr& a, const CodecPtr& b) { return a->priority() > b->priority(); });
+    return found;
+}
+
+// ─────────────────────────────────────────────────────────────
+//  Форматы
+// ─────────────────────────────────────────────────────────────
+std::string normalizeFormat(const std::string& format) {
+    std::string f = format;
+    if (!f.empty() && f[0] == '.') f.erase(0, 1);
+    std::transform(f.begin(), f.end(), f.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (f == "jpeg" || f == "jpe" || f == "jfif") return "jpg";
+    if (f == "ppm" || f == "pgm") return "pnm";
+    return f;
+}
+
+std::string detectFormat(const unsigned char* data, size_t size) {
+    auto starts = [&](const char* magic, size_t n) { return size >= n && std::memcmp(data, magic, n) == 0; };
+    if (starts("\xFF\xD8\xFF", 3)) return "jpg";
+    if (starts("\x89PNG\r\n\x1A\n", 8)) return "png";
+    if (starts("BM", 2)) return "bmp";
+    if (starts("qoif", 4)) return "qoi";
+    if (starts("GIF8", 4)) return "gif";
+    if (starts("8BPS", 4)) return "psd";
+    if (starts("#?RADIANCE", 10) || starts("#?RGBE", 6)) return "hdr";
+    if (starts("\x53\x80\xF6\x34", 4)) return "pic";
+    if (size >= 2 && data[0] == 'P' && (data[1] == '5' || data[1] == '6')) return "pnm";
+    return "";   // TGA сигнатуры не имеет
+}
+
+static bool decodeWithCodecs(const unsigned char* data, size_t size, Image& out, const DecodeOptions& options) {
+    if (!data || size == 0) return false;
+    auto& registry = CodecRegistry::instance();
+    unsigned required = CODEC_CAP_DECODE | (options.scaleDenom > 1 ? CODEC_CAP_SCALED_DECODE : 0u);
+    std::string format = detectFormat(data, size);
+    if (ThreadPool::instance().size() > 0) {
+        if (CodecPtr codec = registry.find(format, required | CODEC_CAP_PARALLEL)) {
+            if (codec->decode(data, size, options, out) && out.valid()) return true;
+            out = Image();
+        }
+    }
+    if (CodecPtr codec = registry.find(format.empty() ? "tga" : format, required)) {
+        if (codec->decode(data, size, options, out) && out.valid()) return true;
+    }
+    if (options.cancel && options.cancel->cancelled()) return false;
+    // Запасной путь: stb сам разберётся с сигнатурой
+    CodecPtr stb = registry.byName("stb");
+    out = Image();
+    return stb && stb->decode(data, size, options, out) && out.valid();
+}
+
+bool decodeImage(const unsigned char* data, size_t size, Image& out, const DecodeOptions& options) {
+    StatTimer timer(kStatDecode);
+    timer.bytes(size);
+    TraceScope trace("Decode", "codec", "bytes", int64_t(size));
+    const bool ok = decodeWithCodecs(data, size, out, options);
+    if (ok) timer.pixels(uint64_t(out.width) * out.height);
+    return ok;
+}
+
+bool encodeImage(const Image& img, const std::string& format, const EncodeOptions& options, ByteSink& sink) {
+    auto& registry = CodecRegistry::instance();
+    const std::string fmt = normalizeFormat(format);
+    CodecPtr codec;
+    // Большие изображения (> 1 МП) — многопоточному кодеку, если он есть;
+    // для JPEG restartRows = 0 его запрещает, restartRows > 0 — требует
+    bool big = static_cast<long long>(img.width) * img.height > 1000000;
+    bool parallel = big && ThreadPool::instance().size() > 0;
+    if (fmt == "jpg") parallel = (parallel && options.restartRows != 0) || options.restartRows > 0;
+    if (parallel)
+        codec = registry.find(fmt, CODEC_CAP_ENCODE | CODEC_CAP_PARALLEL);
+    if (!codec) codec = registry.find(fmt, CODEC_CAP_ENCODE);
+    if (!codec) return false;
+    StatTimer timer(kStatEncode);
+    timer.pixels(uint64_t(img.width) * img.height);
+    TraceScope trace("Encode", "codec", "height", img.height);
+    EncodeSink counted(sink, options.cancel);
+    const bool ok = codec->encode(img, fmt, options, counted);
+    timer.bytes(counted.written());
+    // Кодек мог не проверить результат записи — отмену проверяем и после него
+    return ok && !(options.cancel && options.cancel->cancelled());
+}
+
+std::unique_ptr<RowReader> openRowReader(const unsigned char* data, size_t size) {
+    if (!data || size == 0) return nullptr;
+    const std::string format = detectFormat(data, size);
+    for (const auto& codec : CodecRegistry::instance().findAll(format, CODEC_CAP_DECODE | CODEC_CAP_STREAMING))
+        if (auto reader = codec->openReader(data, size)) return std::make_unique<TimedRowReader>(std::move(reader), size);
+    Image img;
+    if (!decodeImage(data, size, img)) return nullptr;
+    return std::make_unique<ImageRowReader>(std::move(img));
+}
+
+std::unique_ptr<RowWriter> openRowWriter(int width, int height, const std::string& format,
+                                         const EncodeOptions& options, ByteSink& sink) {
+    if (width <= 0 || height <= 0) return nullptr;
+    auto& registry = CodecRegistry::instance();
+    const std::string fmt = normalizeFormat(format);
+    // Выбор многопоточного кодека — как в encodeImage
+    bool big = static_cast<long long>(width) * height > 1000000;
+    bool parallel = big && ThreadPool::instance().size() > 0;
+    if (fmt == "jpg") parallel = (parallel && options.restartRows != 0) || options.restartRows > 0;
+    std::vector<CodecPtr> codecs;
+    if (parallel) codecs = registry.findAll(fmt, CODEC_CAP_ENCODE | CODEC_CAP_STREAMING | CODEC_CAP_PARALLEL);
+    for (const auto& codec : registry.findAll(fmt, CODEC_CAP_ENCODE | CODEC_CAP_STREAMING))
+        codecs.push_back(codec);
+    for (const auto& codec : codecs) {
+        auto writer = std::make_unique<TimedRowWriter>(width, sink, options.cancel);
+        if (writer->open(*codec, height, fmt, options)) return writer;
+    }
+    if (!registry.find(fmt, CODEC_CAP_ENCODE)) return nullptr;
+    return std::make_unique<BufferedRowWriter>(width, height, fmt, options, sink);
+}
+
+// ─────────────────────────────────────────────────────────────
+//  Бенчмарк
+// ─────────────────────────────────────────────────────────────
+std::vector<CodecBenchResult> benchmarkCodecs(const Image& sample, const std::string& format, int iterations) {
+    using Clock = std::chrono::steady_clock;
+    std::vector<CodecBenchResult> results;
+    if (!sample.valid()) return results;
+    const std::string fmt = normalizeFormat(format);
+    const double megabytes = double(sample.width) * sample.height * sample.channels / (1024.0 * 1024.0);
+    iterations = std::max(1, iterations);
+    auto mbps = [&](Clock::duration d) {
+        double sec = std::chrono::duration<double>(d).count();
+        return sec > 0.0 ? megabytes * iterations / sec : 0.0;
+    };
+
+    // Эталонный поток для декодеров без собственного кодировщика
+    std::vector<unsigned char> reference;
+    auto codecs = CodecRegistry::instance().list();
+    for (const auto& c : codecs) {
+        VectorSink sink;
+        if ((c->capabilities(fmt) & CODEC_CAP_ENCODE) && c->encode(sample, fmt, EncodeOptions(), sink)) {
+            reference = std::move(sink.bytes);
+            break;
+        }
+    }
+
+    for (const auto& c : codecs) {
+        unsigned caps = c->capabilities(fmt);
+        if (!caps) continue;
+        CodecBenchResult r;
+        r.codec = c->name();
+        std::vector<unsigned char> encoded = reference;
+        if (caps & CODEC_CAP_ENCODE) {
+            VectorSink sink;
+            auto t0 = Clock::now();
+            bool ok = true;
+            for (int i = 0; i < iterations && ok; ++i) {
+                sink.bytes.clear();
+                ok = c->encode(sample, fmt, EncodeOptions(), sink);
+            }
+            if (ok) {
+                r.encodeMBps = mbps(Clock::now() - t0);
+                r.encodedBytes = sink.bytes.size();
+                encoded = std::move(sink.bytes);
+            }
+        }
+        if ((caps & CODEC_CAP_DECODE) && !encoded.empty()) {
+            Image out;
+            auto t0 = Clock::now();
+            bool ok = true;
+            for (int i = 0; i < iterations && ok; ++i)
+                ok = c->decode(encoded.data(), encoded.size(), DecodeOptions(), out);
+            if (ok) r.decodeMBps = mbps(Clock::now() - t0);
+        }
+        results.push_back(r);
+    }
+    return results;
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "image_io.hpp"
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// ─────────────────────────────────────────────────────────────
+//  Реестр кодеков: бэкенды декодирования/кодирования подключаются
+//  при сборке (libjpeg-turbo, libpng) или в рантайме через C API.
+//  stb всегда зарегистрирован и служит запасным вариантом.
+// ─────────────────────────────────────────────────────────────
+
+enum CodecCaps : unsigned {
+    CODEC_CAP_DECODE        = 1u << 0,
+    CODEC_CAP_ENCODE        = 1u << 1,
+    CODEC_CAP_SCALED_DECODE = 1u << 2,   // декодирование сразу в 1/2, 1/4, 1/8
+    CODEC_CAP_16BIT         = 1u << 3,   // 16 бит на канал
+    CODEC_CAP_STREAMING     = 1u << 4,   // построчная обработка без полного буфера
+    CODEC_CAP_PARALLEL      = 1u << 5,   // одно изображение кодируется/декодируется на нескольких потоках
+};
+
+struct DecodeOptions {
+    int scaleDenom = 1;    // 1, 2, 4, 8 — учитывается только при CODEC_CAP_SCALED_DECODE
+    const CancelToken* cancel = nullptr;   // проверяется между полосами строк, если кодек умеет
+};
+
+struct EncodeOptions {
+    int quality = 95;      // JPEG, 1..100
+    int subsampling = 0;   // JPEG: 444, 422, 420; 0 — 4:4:4 при quality >= 90, иначе 4:2:0
+    int restartRows = -1;  // JPEG: MCU-строк в restart-интервале; -1 — авто, 0 — без маркеров
+    int compressionLevel = 8; // PNG, 0..9
+    const CancelToken* cancel = nullptr;   // проверяется перед каждой полосой; прочие кодеки — на следующей записи
+};
+
+// Прореживание цветности JPEG с учётом значения по умолчанию: 444, 422 или 420.
+// Все JPEG-кодеки обязаны писать именно его или отказываться от кодирования
+int jpegSubsampling(const EncodeOptions& options);
+
+// Приёмник закодированных байт
+class ByteSink {
+public:
+    virtual ~ByteSink() = default;
+    virtual bool write(const void* data, size_t size) = 0;
+};
+
+class FileSink : public ByteSink {
+public:
+    explicit FileSink(const std::string& path);
+    ~FileSink() override;
+    bool isOpen() const { return file_ != nullptr; }
+    bool write(const void* data, size_t size) override;
+    bool close();
+private:
+    FILE* file_ = nullptr;
+    bool ok_ = true;
+};
+
+class VectorSink : public ByteSink {
+public:
+    bool write(const void* data, size_t size) override;
+    std::vector<unsigned char> bytes;
+};
+
+// Построчное чтение для обработки изображений, не помещающихся в память.
+// Строки RGB, 3 байта на пиксель, сверху вниз.
+class RowReader {
+public:
+    virtual ~RowReader() = default;
+    virtual int width() const = 0;
+    virtual int height() const = 0;
+    // Следующие count строк подряд в rows; false — ошибка данных
+    virtual bool read(unsigned char* rows, int count) = 0;
+};
+
+// Построчная запись: строки RGB, ровно height штук, затем finish()
+class RowWriter {
+public:
+    virtual ~RowWriter() = default;
+    virtual bool write(const unsigned char* rows, int count) = 0;
+    virtual bool finish() = 0;
+};
+
+class ImageCodec {
+public:
+    virtual ~ImageCodec() = default;
+    virtual const char* name() const = 0;
+    // Чем больше, тем предпочтительнее при равных возможностях; stb = 0
+    virtual int priority() const { return 0; }
+    // 0 — формат не поддерживается
+    virtual unsigned capabilities(const std::string& format) const = 0;
+    virtual bool decode(const unsigned char* data, size_t size, const DecodeOptions& options, Image& out) const = 0;
+    virtual bool encode(const Image& img, const std::string& format, const EncodeOptions& options, ByteSink& sink) const = 0;
+    // Построчный режим (CODEC_CAP_STREAMING); nullptr — эти данные/формат так не обрабатываются.
+    // data и sink должны жить, пока жив reader/writer.
+    virtual std::unique_ptr<RowReader> openReader(const unsigned char*, size_t) const { return nullptr; }
+    virtual std::unique_ptr<RowWriter> openWriter(int, int, const std::string&, const EncodeOptions&, ByteSink&) const { return nullptr; }
+};
+
+using CodecPtr = std::shared_ptr<const ImageCodec>;
+
+class CodecRegistry {
+public:
+    static CodecRegistry& instance();
+
+    // Кодек с тем же именем заменяется
+    void add(CodecPtr codec);
+    bool remove(const std::string& name);
+    std::vector<CodecPtr> list() const;
+    CodecPtr byName(const std::string& name) const;
+
+    // Лучший кодек для формата, обладающий всеми requiredCaps
+    CodecPtr find(const std::string& format, unsigned requiredCaps) const;
+    // Все такие кодеки, лучшие первыми
+    std::vector<CodecPtr> findAll(const std::string& format, unsigned requiredCaps) const;
+
+private:
+    CodecRegistry();
+    mutable std::mutex mutex_;
+    std::vector<CodecPtr> codecs_;
+};
+
+// Нормализация имени формата: "JPEG", ".jpeg" → "jpg"
+std::string normalizeFormat(const std::string& format);
+// Определение формата по сигнатуре; пустая строка — неизвестно
+std::string detectFormat(const unsigned char* data, size_t size);
+
+bool decodeImage(const unsigned char* data, size_t size, Image& out, const DecodeOptions& options = {});
+bool encodeImage(const Image& img, const std::string& format, const EncodeOptions& options, ByteSink& sink);
+
+// Построчные reader/writer лучшего потокового кодека. Если потокового нет, reader
+// декодирует изображение целиком, а writer копит строки и кодирует их в finish() —
+// результат тот же, но без экономии памяти. nullptr — формат не поддерживается.
+std::unique_ptr<RowReader> openRowReader(const unsigned char* data, size_t size);
+std::unique_ptr<RowWriter> openRowWriter(int width, int height, const std::string& format,
+                                         const EncodeOptions& options, ByteSink& sink);
+
+struct CodecBenchResult {
+    std::string codec;
+    double decodeMBps = 0.0;   // 0 — кодек не умеет декодировать этот формат
+    double encodeMBps = 0.0;   // 0 — кодек не умеет кодировать этот формат
+    size_t encodedBytes = 0;
+};
+
+// Замер всех кодеков, поддерживающих формат; MB/s считаются по несжатым пикселям
+std::vector<CodecBenchResult> benchmarkCodecs(const Image& sample, const std::string& format, int iterations);
+
+#ifdef LTL_WITH_LIBJPEG
+CodecPtr makeLibJpegCodec();
+#endif
+#ifdef LTL_WITH_LIBPNG
+CodecPtr makeLibPngCodec();
+#endif
@@ -0,0 +1,261 @@
+// Бэкенд libjpeg-turbo (собирается при LTL_WITH_LIBJPEG)
+#ifdef LTL_WITH_LIBJPEG
+
+#include "codec.hpp"
+#include "cancel_token.hpp"
+#include <csetjmp>
+#include <cstdio>
+#include <jpeglib.h>
+#include <jerror.h>
+
+namespace {
+
+struct JpegError {
+    jpeg_error_mgr mgr;
+    std::jmp_buf jump;
+};
+
+void jpegErrorExit(j_common_ptr cinfo) {
+    std::longjmp(reinterpret_cast<JpegError*>(cinfo->err)->jump, 1);
+}
+
+// Выходной буфер libjpeg, сбрасываемый в ByteSink. Отказ приёмника (ошибка записи
+// или отмена) прерывает кодирование через error_exit, как png_error в libpng
+struct SinkDestination {
+    jpeg_destination_mgr pub;
+    ByteSink* sink;
+    JOCTET buffer[64 * 1024];
+};
+
+void sinkInit(j_compress_ptr cinfo) {
+    auto* dest = reinterpret_cast<SinkDestination*>(cinfo->dest);
+    dest->pub.next_output_byte = dest->buffer;
+    dest->pub.free_in_buffer = sizeof(dest->buffer);
+}
+
+boolean sinkEmpty(j_compress_ptr cinfo) {
+    auto* dest = reinterpret_cast<SinkDestination*>(cinfo->dest);
+    if (!dest->sink->write(dest->buffer, sizeof(dest->buffer))) ERREXIT(cinfo, JERR_FILE_WRITE);
+    dest->pub.next_output_byte = dest->buffer;
+    dest->pub.free_in_buffer = sizeof(dest->buffer);
+    return TRUE;
+}
+
+void sinkTerm(j_compress_ptr cinfo) {
+    auto* dest = reinterpret_cast<SinkDestination*>(cinfo->dest);
+    size_t used = sizeof(dest->buffer) - dest->pub.free_in_buffer;
+    if (used && !dest->sink->write(dest->buffer, used)) ERREXIT(cinfo, JERR_FILE_WRITE);
+}
+
+// Таблицы по умолчанию, качество и прореживание яркости (у цветности — 1×1)
+void configure(jpeg_compress_struct& cinfo, const EncodeOptions& options) {
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, options.quality, TRUE);
+    const int subsampling = jpegSubsampling(options);
+    cinfo.comp_info[0].h_samp_factor = subsampling == 444 ? 1 : 2;
+    cinfo.comp_info[0].v_samp_factor = subsampling == 420 ? 2 : 1;
+}
+
+// Построчное чтение: libjpeg и так отдаёт строки по одной
+class LibJpegRowReader : public RowReader {
+public:
+    ~LibJpegRowReader() override {
+        if (created_) jpeg_destroy_decompress(&cinfo_);
+    }
+
+    bool open(const unsigned char* data, size_t size) {
+        cinfo_.err = jpeg_std_error(&err_.mgr);
+        err_.mgr.error_exit = jpegErrorExit;
+        if (setjmp(err_.jump)) return false;
+        jpeg_create_decompress(&cinfo_);
+        created_ = true;
+        jpeg_mem_src(&cinfo_, const_cast<unsigned char*>(data), static_cast<unsigned long>(size));
+        if (jpeg_read_header(&cinfo_, TRUE) != JPEG_HEADER_OK) return false;
+        cinfo_.out_color_space = JCS_RGB;
+        jpeg_start_decompress(&cinfo_);
+        return cinfo_.output_components == 3;
+    }
+
+    int width() const override { return static_cast<int>(cinfo_.output_width); }
+    int height() const override { return static_cast<int>(cinfo_.output_height); }
+
+    bool read(unsigned char* rows, int count) override {
+        if (count < 0 || cinfo_.output_scanline + static_cast<JDIMENSION>(count) > cinfo_.output_height) return false;
+        if (setjmp(err_.jump)) return false;
+        const size_t stride = static_cast<size_t>(cinfo_.output_width) * 3;
+        for (int i = 0; i < count; ++i) {
+            JSAMPROW row = rows + static_cast<size_t>(i) * stride;
+            jpeg_read_scanlines(&cinfo_, &row, 1);
+        }
+        return true;
+    }
+
+private:
+    jpeg_decompress_struct cinfo_;
+    JpegError err_;
+    bool created_ = false;
+};
+
+class LibJpegRowWriter : public RowWriter {
+public:
+    ~LibJpegRowWriter() override {
+        if (created_) jpeg_destroy_compress(&cinfo_);
+    }
+
+    bool open(int width, int height, const EncodeOptions& options, ByteSink& sink) {
+        cinfo_.err = jpeg_std_error(&err_.mgr);
+        err_.mgr.error_exit = jpegErrorExit;
+        if (setjmp(err_.jump)) return false;
+        jpeg_create_compress(&cinfo_);
+        created_ = true;
+        dest_.pub.init_destination = sinkInit;
+        dest_.pub.empty_output_buffer = sinkEmpty;
+        dest_.pub.term_destination = sinkTerm;
+        dest_.sink = &sink;
+        cinfo_.dest = &dest_.pub;
+        cinfo_.image_width = static_cast<JDIMENSION>(width);
+        cinfo_.image_height = static_cast<JDIMENSION>(height);
+        cinfo_.input_components = 3;
+        cinfo_.in_color_space = JCS_RGB;
+        configure(cinfo_, options);
+        jpeg_start_compress(&cinfo_, TRUE);
+        return true;
+    }
+
+    bool write(const unsigned char* rows, int count) override {
+        if (count < 0 || cinfo_.next_scanline + static_cast<JDIMENSION>(count) > cinfo_.image_height) return false;
+        if (setjmp(err_.jump)) return false;
+        const size_t stride = static_cast<size_t>(cinfo_.image_width) * 3;
+        for (int i = 0; i < count; ++i) {
+            JSAMPROW row = const_cast<unsigned char*>(rows) + static_cast<size_t>(i) * stride;
+            jpeg_write_scanlines(&cinfo_, &row, 1);
+        }
+        return true;
+    }
+
+    bool finish() override {
+        if (cinfo_.next_scanline < cinfo_.image_height) return false;
+        if (setjmp(err_.jump)) return false;
+        jpeg_finish_compress(&cinfo_);
+        return true;
+    }
+
+private:
+    jpeg_compress_struct cinfo_;
+    JpegError err_;
+    SinkDestination dest_;
+    bool created_ = false;
+};
+
+class LibJpegCodec : public ImageCodec {
+public:
+    const char* name() const override { return "libjpeg-turbo"; }
+    int priority() const override { return 10; }
+
+    unsigned capabilities(const std::string& format) const override {
+        if (format != "jpg") return 0;
+        return CODEC_CAP_DECODE | CODEC_CAP_ENCODE | CODEC_CAP_SCALED_DECODE | CODEC_CAP_STREAMING;
+    }
+
+    bool decode(const unsigned char* data, size_t size, const DecodeOptions& options, Image& out) const override {
+        jpeg_decompress_struct cinfo;
+        JpegError err;
+        cinfo.err = jpeg_std_error(&err.mgr);
+        err.mgr.error_exit = jpegErrorExit;
+        if (setjmp(err.jump)) {
+            jpeg_destroy_decompress(&cinfo);
+            return false;
+        }
+        jpeg_create_decompress(&cinfo);
+        jpeg_mem_src(&cinfo, const_cast<unsigned char*>(data), static_cast<unsigned long>(size));
+        if (jpeg_read_header(&cinfo, TRUE) != JPEG_HEADER_OK) {
+            jpeg_destroy_decompress(&cinfo);
+            return false;
+        }
+        cinfo.out_color_space = JCS_RGB;
+        if (options.scaleDenom == 2 || options.scaleDenom == 4 || options.scaleDenom == 8) {
+            cinfo.scale_num = 1;
+            cinfo.scale_denom = static_cast<unsigned>(options.scaleDenom);
+        }
+        jpeg_start_decompress(&cinfo);
+        // Пишем прямо в out: между setjmp и longjmp не должно быть локальных объектов с деструкторами
+        out.width = static_cast<int>(cinfo.output_width);
+        out.height = static_cast<int>(cinfo.output_height);
+        out.channels = 3;
+        out.data.allocate(static_cast<size_t>(out.width) * out.height * 3);
+        const size_t stride = static_cast<size_t>(out.width) * 3;
+        while (cinfo.output_scanline < cinfo.output_height) {
+            // Отмена — каждые 64 строки
+            if (options.cancel && cinfo.output_scanline % 64 == 0 && options.cancel->cancelled()) {
+                jpeg_destroy_decompress(&cinfo);
+                out = Image();
+                return false;
+            }
+            JSAMPROW row = out.data.data() + cinfo.output_scanline * stride;
+            jpeg_read_scanlines(&cinfo, &row, 1);
+        }
+        jpeg_finish_decompress(&cinfo);
+        jpeg_destroy_decompress(&cinfo);
+        return true;
+    }
+
+    bool encode(const Image& img, const std::string& format, const EncodeOptions& options, ByteSink& sink) const override {
+        if (format != "jpg") return false;
+        jpeg_compress_struct cinfo;
+        JpegError err;
+        SinkDestination dest;
+        cinfo.err = jpeg_std_error(&err.mgr);
+        err.mgr.error_exit = jpegErrorExit;
+        if (setjmp(err.jump)) {
+            jpeg_destroy_compress(&cinfo);
+            return false;
+        }
+        jpeg_create_compress(&cinfo);
+        dest.pub.init_destination = sinkInit;
+        dest.pub.empty_output_buffer = sinkEmpty;
+        dest.pub.term_destination = sinkTerm;
+        dest.sink = &sink;
+        cinfo.dest = &dest.pub;
+        cinfo.image_width = static_cast<JDIMENSION>(img.width);
+        cinfo.image_height = static_cast<JDIMENSION>(img.height);
+        cinfo.input_components = img.channels;
+        cinfo.in_color_space = JCS_RGB;
+        configure(cinfo, options);
+        jpeg_start_compress(&cinfo, TRUE);
+        const size_t stride = static_cast<size_t>(img.width) * img.channels;
+        while (cinfo.next_scanline < cinfo.image_height) {
+            // Отмена — каждые 64 строки, как при декодировании
+            if (options.cancel && cinfo.next_scanline % 64 == 0 && options.cancel->cancelled()) {
+                jpeg_destroy_compress(&cinfo);
+                return false;
+            }
+            JSAMPROW row = const_cast<unsigned char*>(img.data.data()) + cinfo.next_scanline * stride;
+            jpeg_write_scanlines(&cinfo, &row, 1);
+        }
+        jpeg_finish_compress(&cinfo);
+        jpeg_destroy_compress(&cinfo);
+        return true;
+    }
+
+    std::unique_ptr<RowReader> openReader(const unsigned char* data, size_t size) const override {
+        auto reader = std::make_unique<LibJpegRowReader>();
+        if (!reader->open(data, size)) return nullptr;
+        return reader;
+    }
+
+    std::unique_ptr<RowWriter> openWriter(int width, int height, const std::string& format,
+                                          const EncodeOptions& options, ByteSink& sink) const override {
+        if (format != "jpg" || width > 65535 || height > 65535) return nullptr;
+        auto writer = std::make_unique<LibJpegRowWriter>();
+        if (!writer->open(width, height, options, sink)) return nullptr;
+        return writer;
+    }
+};
+
+} // namespace
+
+CodecPtr makeLibJpegCodec() {
+    return std::make_shared<LibJpegCodec>();
+}
+
+#endif // LTL_WITH_LIBJPEG
@@ -0,0 +1,195 @@
+// Бэкенд libpng (собирается при LTL_WITH_LIBPNG)
+#ifdef LTL_WITH_LIBPNG
+
+#include "codec.hpp"
+#include <algorithm>
+#include <csetjmp>
+#include <cstring>
+#include <png.h>
+
+namespace {
+
+void pngWriteToSink(png_structp png, png_bytep data, png_size_t size) {
+    auto* sink = static_cast<ByteSink*>(png_get_io_ptr(png));
+    if (!sink->write(data, size)) png_error(png, "sink write failed");
+}
+
+void pngFlush(png_structp) {}
+
+struct MemorySource {
+    const unsigned char* data;
+    size_t size;
+    size_t pos;
+};
+
+void pngReadFromMemory(png_structp png, png_bytep out, png_size_t size) {
+    auto* src = static_cast<MemorySource*>(png_get_io_ptr(png));
+    if (size > src->size - src->pos) png_error(png, "unexpected end of data");
+    std::memcpy(out, src->data + src->pos, size);
+    src->pos += size;
+}
+
+// Построчное чтение с приведением к 8-битному RGB. Interlaced-файлы (Adam7)
+// построчно не читаются — для них nullptr и полное декодирование.
+class LibPngRowReader : public RowReader {
+public:
+    ~LibPngRowReader() override {
+        if (png_) png_destroy_read_struct(&png_, &info_, nullptr);
+    }
+
+    bool open(const unsigned char* data, size_t size) {
+        src_ = { data, size, 0 };
+        png_ = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+        if (!png_) return false;
+        info_ = png_create_info_struct(png_);
+        if (!info_ || setjmp(png_jmpbuf(png_))) return false;
+        png_set_read_fn(png_, &src_, pngReadFromMemory);
+        png_read_info(png_, info_);
+        if (png_get_interlace_type(png_, info_) != PNG_INTERLACE_NONE) return false;
+        const int colorType = png_get_color_type(png_, info_);
+        png_set_expand(png_);           // палитра и серый < 8 бит → 8 бит
+        png_set_strip_16(png_);
+        png_set_strip_alpha(png_);
+        if (colorType == PNG_COLOR_TYPE_GRAY || colorType == PNG_COLOR_TYPE_GRAY_ALPHA)
+            png_set_gray_to_rgb(png_);
+        png_read_update_info(png_, info_);
+        width_ = static_cast<int>(png_get_image_width(png_, info_));
+        height_ = static_cast<int>(png_get_image_height(png_, info_));
+        return png_get_rowbytes(png_, info_) == static_cast<size_t>(width_) * 3;
+    }
+
+    int width() const override { return width_; }
+    int height() const override { return height_; }
+
+    bool read(unsigned char* rows, int count) override {
+        if (count < 0 || count > height_ - next_) return false;
+        if (setjmp(png_jmpbuf(png_))) return false;
+        const size_t stride = static_cast<size_t>(width_) * 3;
+        for (int i = 0; i < count; ++i)
+            png_read_row(png_, rows + static_cast<size_t>(i) * stride, nullptr);
+        next_ += count;
+        return true;
+    }
+
+private:
+    png_structp png_ = nullptr;
+    png_infop info_ = nullptr;
+    MemorySource src_{};
+    int width_ = 0, height_ = 0, next_ = 0;
+};
+
+class LibPngRowWriter : public RowWriter {
+public:
+    ~LibPngRowWriter() override {
+        if (png_) png_destroy_write_struct(&png_, &info_);
+    }
+
+    bool open(int width, int height, const EncodeOptions& options, ByteSink& sink) {
+        png_ = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+        if (!png_) return false;
+        info_ = png_create_info_struct(png_);
+        if (!info_ || setjmp(png_jmpbuf(png_))) return false;
+        png_set_write_fn(png_, &sink, pngWriteToSink, pngFlush);
+        png_set_compression_level(png_, std::clamp(options.compressionLevel, 0, 9));
+        png_set_IHDR(png_, info_, static_cast<png_uint_32>(width), static_cast<png_uint_32>(height), 8,
+                     PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+        png_write_info(png_, info_);
+        width_ = width;
+        height_ = height;
+        return true;
+    }
+
+    bool write(const unsigned char* rows, int count) override {
+        if (count < 0 || count > height_ - next_) return false;
+        if (setjmp(png_jmpbuf(png_))) return false;
+        const size_t stride = static_cast<size_t>(width_) * 3;
+        for (int i = 0; i < count; ++i)
+            png_write_row(png_, rows + static_cast<size_t>(i) * stride);
+        next_ += count;
+        return true;
+    }
+
+    bool finish() override {
+        if (next_ != height_) return false;
+        if (setjmp(png_jmpbuf(png_))) return false;
+        png_write_end(png_, nullptr);
+        return true;
+    }
+
+private:
+    png_structp png_ = nullptr;
+    png_infop info_ = nullptr;
+    int width_ = 0, height_ = 0, next_ = 0;
+};
+
+class LibPngCodec : public ImageCodec {
+public:
+    const char* name() const override { return "libpng"; }
+    int priority() const override { return 10; }
+
+    unsigned capabilities(const std::string& format) const override {
+        if (format != "png") return 0;
+        return CODEC_CAP_DECODE | CODEC_CAP_ENCODE | CODEC_CAP_16BIT | CODEC_CAP_STREAMING;
+    }
+
+    bool decode(const unsigned char* data, size_t size, const DecodeOptions&, Image& out) const override {
+        png_image image{};
+        image.version = PNG_IMAGE_VERSION;
+        if (!png_image_begin_read_from_memory(&image, data, size)) return false;
+        image.format = PNG_FORMAT_RGB;
+        out.width = static_cast<int>(image.width);
+        out.height = static_cast<int>(image.height);
+        out.channels = 3;
+        out.data.allocate(PNG_IMAGE_SIZE(image));
+        if (!png_image_finish_read(&image, nullptr, out.data.data(), 0, nullptr)) {
+            png_image_free(&image);
+            return false;
+        }
+        return true;
+    }
+
+    bool encode(const Image& img, const std::string& format, const EncodeOptions& options, ByteSink& sink) const override {
+        if (format != "png") return false;
+        png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+        if (!png) return false;
+        png_infop info = png_create_info_struct(png);
+        if (!info || setjmp(png_jmpbuf(png))) {
+            png_destroy_write_struct(&png, &info);
+            return false;
+        }
+        png_set_write_fn(png, &sink, pngWriteToSink, pngFlush);
+        png_set_compression_level(png, std::clamp(options.compressionLevel, 0, 9));
+        png_set_IHDR(png, info, static_cast<png_uint_32>(img.width), static_cast<png_uint_32>(img.height), 8,
+                     img.channels == 4 ? PNG_COLOR_TYPE_RGB_ALPHA : PNG_COLOR_TYPE_RGB,
+                     PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+        png_write_info(png, info);
+        const size_t stride = static_cast<size_t>(img.width) * img.channels;
+        for (int y = 0; y < img.height; ++y)
+            png_write_row(png, img.data.data() + y * stride);
+        png_write_end(png, nullptr);
+        png_destroy_write_struct(&png, &info);
+        return true;
+    }
+
+    std::unique_ptr<RowReader> openReader(const unsigned char* data, size_t size) const override {
+        auto reader = std::make_unique<LibPngRowReader>();
+        if (!reader->open(data, size)) return nullptr;
+        return reader;
+    }
+
+    std::unique_ptr<RowWriter> openWriter(int width, int height, const std::string& format,
+                                          const EncodeOptions& options, ByteSink& sink) const override {
+        if (format != "png") return nullptr;
+        auto writer = std::make_unique<LibPngRowWriter>();
+        if (!writer->open(width, height, options, sink)) return nullptr;
+        return writer;
+    }
+};
+
+} // namespace
+
+CodecPtr makeLibPngCodec() {
+    return std::make_shared<LibPngCodec>();
+}
+
+#endif // LTL_WITH_LIBPNG
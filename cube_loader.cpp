@@ -1,73 +1,380 @@
 #include "cube_loader.hpp"
-#include <fstream>
-#include <sstream>
+#include "mapped_file.hpp"
+#include "thread_pool.hpp"
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <stdexcept>
 #include <filesystem>
+#include <string_view>
+#include <thread>
 
-LUTFlat loadCubeLUT(const std::string& path, int& lutSizeOut) {
-    if (!std::filesystem::exists(path)) {
-        throw std::runtime_error("Файл не найден: " + path);
-    }
+namespace {
 
-    std::ifstream file(path);
-    if (!file.is_open()) {
-        throw std::runtime_error("Не удалось открыть файл: " + path);
-    }
+// Данные больше этого объёма разбираются кусками на пуле (33³ ≈ 1 МБ)
+const size_t kParallelBytes = 1 << 20;
 
-    std::string line;
-    std::vector<Color> rawColors;
-    int size = 0;
+bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+}
 
-    while (std::getline(file, line))
-    {
-        // 1) обрезаем пробелы в начале/конце
-        line.erase(0, line.find_first_not_of(" \t\r\n"));
-        line.erase(line.find_last_not_of(" \t\r\n") + 1);
+const char* skipBlanks(const char* p, const char* end) {
+    while (p < end && isBlank(*p)) ++p;
+    return p;
+}
 
-        if (line.empty() || line[0] == '#')
-            continue; // комментарий / пустая строка
+// Число с плавающей точкой без аллокаций и без учёта локали; p сдвигается за число
+bool parseFloat(const char*& p, const char* end, float& out) {
+    const char* s = skipBlanks(p, end);
+    if (s < end && *s == '+') ++s;
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    auto res = std::from_chars(s, end, out);
+    if (res.ec != std::errc()) return false;
+    p = res.ptr;
+    return true;
+#else
+    // libc++ без from_chars для float: мантисса копится в double
+    bool negative = s < end && *s == '-';
+    if (negative) ++s;
+    double value = 0.0;
+    int digits = 0;
+    for (; s < end && *s >= '0' && *s <= '9'; ++s, ++digits) value = value * 10.0 + (*s - '0');
+    if (s < end && *s == '.') {
+        double scale = 0.1;
+        for (++s; s < end && *s >= '0' && *s <= '9'; ++s, ++digits, scale *= 0.1) value += (*s - '0') * scale;
+    }
+    if (digits == 0) return false;
+    if (s < end && (*s == 'e' || *s == 'E')) {
+        const char* e = s + 1;
+        bool negExp = e < end && *e == '-';
+        if (e < end && (*e == '-' || *e == '+')) ++e;
+        int exponent = 0;
+        const char* expBegin = e;
+        for (; e < end && *e >= '0' && *e <= '9'; ++e) exponent = std::min(exponent * 10 + (*e - '0'), 400);
+        if (e > expBegin) {
+            value *= std::pow(10.0, negExp ? -exponent : exponent);
+            s = e;
+        }
+    }
+    out = static_cast<float>(negative ? -value : value);
+    p = s;
+    return true;
+#endif
+}
 
-        std::istringstream ss(line);
+struct CubeChunk {
+    std::vector<Color> colors;
+    int size = 0;   // LUT_3D_SIZE, если встретился в куске
+    std::string title;
+    bool hasDomainMin = false, hasDomainMax = false;
+    Color domainMin{ 0.0f, 0.0f, 0.0f }, domainMax{ 1.0f, 1.0f, 1.0f };
+};
 
-        // 2) Пытаемся считать 3 числа (RGB)
-        float r, g, b;
-        if (ss >> r >> g >> b)
-        {
-            rawColors.push_back({ r, g, b });
-            continue;
-        }
+// Одна строка без '\n': тройка чисел, комментарий, ключевое слово или прочий текст
+void parseLine(const char* p, const char* end, CubeChunk& chunk) {
+    p = skipBlanks(p, end);
+    if (p == end || *p == '#') return;   // комментарий / пустая строка
 
-        // 3) Не числа → пытаемся разобрать ключевое слово
-        ss.clear(); ss.str(line);
-        std::string kw; ss >> kw;
+    // Пытаемся считать 3 числа (RGB)
+    Color c;
+    const char* q = p;
+    if (parseFloat(q, end, c.r) && parseFloat(q, end, c.g) && parseFloat(q, end, c.b)) {
+        chunk.colors.push_back(c);
+        return;
+    }
 
-        if (kw == "LUT_3D_SIZE")
-        {
-            if (!(ss >> size) || size <= 0)
-                throw std::runtime_error("Некорректный размер LUT: " + line);
-            continue;
+    // Не числа → ключевое слово; прочий текст игнорируем
+    const char* kwEnd = p;
+    while (kwEnd < end && !isBlank(*kwEnd)) ++kwEnd;
+    const std::string_view kw(p, kwEnd - p);
+    if (kw == "TITLE") {
+        const char* t = skipBlanks(kwEnd, end);
+        const char* tEnd = end;
+        while (tEnd > t && isBlank(tEnd[-1])) --tEnd;
+        if (tEnd - t >= 2 && *t == '"' && tEnd[-1] == '"') { ++t; --tEnd; }
+        chunk.title.assign(t, tEnd);
+        return;
+    }
+    if (kw == "DOMAIN_MIN" || kw == "DOMAIN_MAX") {
+        // Область значений сохраняется в кэш; интерполяция по-прежнему считает её [0, 1]
+        Color d;
+        q = kwEnd;
+        if (parseFloat(q, end, d.r) && parseFloat(q, end, d.g) && parseFloat(q, end, d.b)) {
+            if (kw == "DOMAIN_MIN") { chunk.domainMin = d; chunk.hasDomainMin = true; }
+            else { chunk.domainMax = d; chunk.hasDomainMax = true; }
         }
+        return;
+    }
+    if (kw == "LUT_3D_SIZE") {
+        const char* v = skipBlanks(kwEnd, end);
+        int size = 0;
+        auto res = std::from_chars(v, end, size);
+        if (res.ec != std::errc() || size <= 0) {
+            while (end > p && isBlank(end[-1])) --end;
+            throw std::runtime_error("Некорректный размер LUT: " + std::string(p, end));
+        }
+        chunk.size = size;
+    }
+}
 
-        if (kw == "DOMAIN_MIN" || kw == "DOMAIN_MAX")
-            continue;
+// Строки [p, end); p — начало строки
+void parseLines(const char* p, const char* end, CubeChunk& chunk) {
+    while (p < end) {
+        const char* eol = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+        const char* lineEnd = eol ? eol : end;
+        parseLine(p, lineEnd, chunk);
+        p = eol ? eol + 1 : end;
+    }
+}
 
-        // 4) Прочий текст (например TITLE) игнорируем
+struct CubeDomain {
+    Color min{ 0.0f, 0.0f, 0.0f };
+    Color max{ 1.0f, 1.0f, 1.0f };
+};
+
+// Разбор текста .cube [p, end); ошибки — исключения с сообщением для пользователя
+LUTFlat parseCube(const char* p, const char* end, const std::string& path, int& lutSizeOut, CubeDomain& domain,
+                  std::string& title) {
+    // Заголовок — до первой строки с числами
+    CubeChunk head;
+    while (p < end && head.colors.empty()) {
+        const char* eol = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+        parseLine(p, eol ? eol : end, head);
+        p = eol ? eol + 1 : end;
     }
 
-    if (file.fail() && !file.eof()) {
-        throw std::runtime_error("Ошибка чтения файла: " + path);
+    // Данные режутся на куски по границам строк и разбираются параллельно
+    const size_t bytes = static_cast<size_t>(end - p);
+    auto& pool = ThreadPool::instance();
+    const size_t parts = bytes > kParallelBytes ? (pool.size() + 1) * 4 : 1;
+    std::vector<const char*> bounds(parts + 1, end);
+    bounds[0] = p;
+    for (size_t i = 1; i < parts; ++i) {
+        const char* b = std::max(bounds[i - 1], p + bytes / parts * i);
+        const char* eol = b < end ? static_cast<const char*>(std::memchr(b, '\n', static_cast<size_t>(end - b))) : nullptr;
+        bounds[i] = eol ? eol + 1 : end;
     }
+    std::vector<CubeChunk> chunks(parts);
+    pool.parallelFor(parts, [&](size_t i) {
+        // ~20 байт на строку — чтобы вектор не перевыделялся
+        chunks[i].colors.reserve(static_cast<size_t>(bounds[i + 1] - bounds[i]) / 20 + 1);
+        parseLines(bounds[i], bounds[i + 1], chunks[i]);
+    });
+
+    // Ключевые слова могут стоять где угодно — действует последнее
+    int size = 0;
+    size_t total = 0;
+    auto merge = [&](const CubeChunk& chunk) {
+        if (chunk.size) size = chunk.size;
+        if (chunk.hasDomainMin) domain.min = chunk.domainMin;
+        if (chunk.hasDomainMax) domain.max = chunk.domainMax;
+        total += chunk.colors.size();
+    };
+    merge(head);
+    for (const auto& chunk : chunks) merge(chunk);
 
     if (size == 0) {
         throw std::runtime_error("Размер LUT не указан в файле: " + path);
     }
 
-    if (rawColors.size() != static_cast<size_t>(size * size * size)) {
+    const size_t expected = static_cast<size_t>(size) * size * size;
+    if (total != expected) {
         throw std::runtime_error("Некорректное количество RGB значений: ожидалось " +
-            std::to_string(size * size * size) + ", найдено " +
-            std::to_string(rawColors.size()));
+            std::to_string(expected) + ", найдено " +
+            std::to_string(total));
     }
 
+    std::vector<Color> rawColors;
+    rawColors.reserve(total);
+    rawColors.insert(rawColors.end(), head.colors.begin(), head.colors.end());
+    for (const auto& chunk : chunks)
+        rawColors.insert(rawColors.end(), chunk.colors.begin(), chunk.colors.end());
+
+    lutSizeOut = size;
+    title = std::move(head.title);
+    return LUTFlat(std::move(rawColors));
+}
+
+// ── Бинарный кэш ──
+
+const char kCubeCacheSuffix[] = ".ltlc";
+const char kCacheMagic[4] = { 'L', 'T', 'L', 'C' };
+const uint32_t kCacheVersion = 1;
+const uint32_t kCacheByteOrder = 0x01020304;
+const uint32_t kCacheAlign = 64;         // texel-ы выровнены на 64 байта от начала отображения
+const uint32_t kCacheMaxTitle = 4096;
+
+struct CubeCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t byteOrder;      // кэш другой архитектуры не подходит
+    uint32_t size;           // LUT_3D_SIZE
+    uint32_t texelOffset;
+    uint32_t texelBytes;     // sizeof(Color)
+    float domainMin[3];
+    float domainMax[3];
+    uint64_t sourceSize;
+    uint64_t sourceHash;     // XXH64 исходного .cube
+    uint32_t titleBytes;     // TITLE (UTF-8, без нуля) сразу за заголовком
+};
+static_assert(sizeof(Color) == 3 * sizeof(float), "texels are stored as packed RGB floats");
+
+uint64_t rotl64(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+uint64_t read64(const unsigned char* p) { uint64_t v; std::memcpy(&v, p, 8); return v; }
+uint32_t read32(const unsigned char* p) { uint32_t v; std::memcpy(&v, p, 4); return v; }
+
+// XXH64 (seed 0): ~10 ГБ/с, хэшировать исходник дешевле, чем разбирать
+uint64_t xxh64(const unsigned char* p, size_t size) {
+    const uint64_t P1 = 11400714785074694791ull, P2 = 14029467366897019727ull, P3 = 1609587929392839161ull,
+                   P4 = 9650029242287828579ull, P5 = 2870177450012600261ull;
+    auto round = [&](uint64_t acc, uint64_t input) { return rotl64(acc + input * P2, 31) * P1; };
+    auto merge = [&](uint64_t acc, uint64_t v) { return (acc ^ round(0, v)) * P1 + P4; };
+    const unsigned char* end = p + size;
+    uint64_t h;
+    if (size >= 32) {
+        uint64_t v1 = P1 + P2, v2 = P2, v3 = 0, v4 = 0 - P1;
+        for (; p + 32 <= end; p += 32) {
+            v1 = round(v1, read64(p));
+            v2 = round(v2, read64(p + 8));
+            v3 = round(v3, read64(p + 16));
+            v4 = round(v4, read64(p + 24));
+        }
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = merge(merge(merge(merge(h, v1), v2), v3), v4);
+    } else {
+        h = P5;
+    }
+    h += size;
+    for (; p + 8 <= end; p += 8) h = rotl64(h ^ round(0, read64(p)), 27) * P1 + P4;
+    if (p + 4 <= end) { h = rotl64(h ^ (read32(p) * P1), 23) * P2 + P3; p += 4; }
+    for (; p < end; ++p) h = rotl64(h ^ (*p * P5), 11) * P1;
+    h ^= h >> 33; h *= P2;
+    h ^= h >> 29; h *= P3;
+    h ^= h >> 32;
+    return h;
+}
+
+uint32_t cacheTexelOffset(uint32_t titleBytes) {
+    return (uint32_t(sizeof(CubeCacheHeader)) + titleBytes + kCacheAlign - 1) / kCacheAlign * kCacheAlign;
+}
+
+// Таблица ссылается на отображение кэша и держит его, пока жива сама
+bool readCache(const std::shared_ptr<const MappedFile>& cache, uint64_t sourceSize, uint64_t sourceHash,
+               LUTFlat& lut, int& lutSizeOut, std::string* title) {
+    if (!cache->isOpen() || cache->size() < sizeof(CubeCacheHeader)) return false;
+    CubeCacheHeader h;
+    std::memcpy(&h, cache->data(), sizeof(h));
+    if (std::memcmp(h.magic, kCacheMagic, 4) != 0 || h.version != kCacheVersion || h.byteOrder != kCacheByteOrder
+        || h.texelBytes != sizeof(Color) || h.titleBytes > kCacheMaxTitle || h.texelOffset != cacheTexelOffset(h.titleBytes)
+        || h.sourceSize != sourceSize || h.sourceHash != sourceHash || h.size == 0 || h.size > 1024)
+        return false;
+    const size_t count = size_t(h.size) * h.size * h.size;
+    if (cache->size() != h.texelOffset + count * sizeof(Color)) return false;
+    if (title) title->assign(reinterpret_cast<const char*>(cache->data()) + sizeof(h), h.titleBytes);
+    lut = LUTFlat(cache, reinterpret_cast<const Color*>(cache->data() + h.texelOffset), count);
+    lutSizeOut = static_cast<int>(h.size);
+    return true;
+}
+
+// Пишем во временный файл и переименовываем: параллельный процесс не увидит половину кэша.
+// Ошибки (каталог только для чтения и т. п.) не критичны — в следующий раз снова разбор.
+void writeCache(const std::string& cachePath, int size, const CubeDomain& domain, const std::string& title,
+                uint64_t sourceSize, uint64_t sourceHash, const LUTFlat& lut) {
+    if (title.size() > kCacheMaxTitle) return;
+    CubeCacheHeader h{};
+    std::memcpy(h.magic, kCacheMagic, 4);
+    h.version = kCacheVersion;
+    h.byteOrder = kCacheByteOrder;
+    h.size = static_cast<uint32_t>(size);
+    h.titleBytes = static_cast<uint32_t>(title.size());
+    h.texelOffset = cacheTexelOffset(h.titleBytes);
+    h.texelBytes = sizeof(Color);
+    for (int c = 0; c < 3; ++c) {
+        h.domainMin[c] = domain.min[c];
+        h.domainMax[c] = domain.max[c];
+    }
+    h.sourceSize = sourceSize;
+    h.sourceHash = sourceHash;
+    std::vector<unsigned char> header(h.texelOffset, 0);
+    std::memcpy(header.data(), &h, sizeof(h));
+    std::memcpy(header.data() + sizeof(h), title.data(), title.size());
+
+    const std::string tmpPath = cachePath + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    FILE* f = std::fopen(tmpPath.c_str(), "wb");
+    if (!f) return;
+    bool ok = std::fwrite(header.data(), 1, header.size(), f) == header.size()
+           && std::fwrite(lut.data(), sizeof(Color), lut.size(), f) == lut.size();
+    ok = std::fclose(f) == 0 && ok;
+    std::error_code ec;
+    if (ok) std::filesystem::rename(tmpPath, cachePath, ec);
+    if (!ok || ec) std::filesystem::remove(tmpPath, ec);
+}
+
+} // namespace
+
+LUTFlat loadCubeLUT(const std::string& path, int& lutSizeOut, std::string* title) {
+    if (!std::filesystem::exists(path)) {
+        throw std::runtime_error("Файл не найден: " + path);
+    }
+
+    // Файл отображается в память и разбирается на месте, без копий строк
+    MappedFile file(path);
+    if (!file.isOpen() && std::filesystem::file_size(path) != 0) {
+        throw std::runtime_error("Не удалось открыть файл: " + path);
+    }
+    const char* p = reinterpret_cast<const char*>(file.data());
+    CubeDomain domain;
+    std::string parsedTitle;
+    LUTFlat lut = parseCube(p, p + file.size(), path, lutSizeOut, domain, parsedTitle);
+    if (title) *title = std::move(parsedTitle);
+    return lut;
+}
+
+bool readCubeHeader(const std::string& path, CubeHeader& header) {
+    MappedFile file(path);
+    if (!file.isOpen()) return false;
+    const char* p = reinterpret_cast<const char*>(file.data());
+    const char* end = p + file.size();
+    CubeChunk head;
+    try {
+        while (p < end && head.colors.empty()) {
+            const char* eol = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+            parseLine(p, eol ? eol : end, head);
+            p = eol ? eol + 1 : end;
+        }
+    } catch (const std::exception&) {
+        return false;   // некорректный LUT_3D_SIZE
+    }
+    header.size = head.size;
+    header.title = std::move(head.title);
+    return true;
+}
+
+LUTFlat loadCubeLUTCached(const std::string& path, int& lutSizeOut, std::string* title) {
+    if (!std::filesystem::exists(path)) {
+        throw std::runtime_error("Файл не найден: " + path);
+    }
+    MappedFile file(path);
+    if (!file.isOpen() && std::filesystem::file_size(path) != 0) {
+        throw std::runtime_error("Не удалось открыть файл: " + path);
+    }
+    const uint64_t hash = xxh64(file.data(), file.size());
+    const std::string cachePath = path + kCubeCacheSuffix;
+    {
+        LUTFlat lut;
+        if (readCache(std::make_shared<const MappedFile>(cachePath), file.size(), hash, lut, lutSizeOut, title))
+            return lut;
+    }
+    const char* p = reinterpret_cast<const char*>(file.data());
+    CubeDomain domain;
+    int size = 0;
+    std::string parsedTitle;
+    LUTFlat lut = parseCube(p, p + file.size(), path, size, domain, parsedTitle);
+    writeCache(cachePath, size, domain, parsedTitle, file.size(), hash, lut);
     lutSizeOut = size;
-    return rawColors;
+    if (title) *title = std::move(parsedTitle);
+    return lut;
 }
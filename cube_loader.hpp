@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <vector>
 #include <string>
 
@@ -19,6 +20,48 @@ struct Color {
     }
 };
 
-using LUTFlat = std::vector<Color>;
+// Таблица LUT только для чтения: size³ texel-ов, R — младший индекс. Данные лежат либо
+// в собственном векторе, либо прямо в отображённом кэше .ltlc; копия объекта данных не копирует.
+class LUTFlat {
+public:
+    LUTFlat() = default;
+    explicit LUTFlat(std::vector<Color> colors) {
+        auto owned = std::make_shared<const std::vector<Color>>(std::move(colors));
+        data_ = owned->data();
+        size_ = owned->size();
+        owner_ = std::move(owned);
+    }
+    // owner держит память [data, data + count) (например, отображение файла)
+    LUTFlat(std::shared_ptr<const void> owner, const Color* data, size_t count)
+        : owner_(std::move(owner)), data_(data), size_(count) {}
+
+    const Color* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const Color& operator[](size_t i) const { return data_[i]; }
+    const Color* begin() const { return data_; }
+    const Color* end() const { return data_ + size_; }
+
+private:
+    std::shared_ptr<const void> owner_;
+    const Color* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+struct CubeHeader {
+    int size = 0;          // 0 — LUT_3D_SIZE не встретился до данных
+    std::string title;     // TITLE без кавычек
+};
+
+// title — TITLE из заголовка, если нужен
+LUTFlat loadCubeLUT(const std::string& path, int& lutSizeOut, std::string* title = nullptr);
+
+// То же с бинарным кэшем рядом с файлом (<path>.ltlc): заголовок с размером, DOMAIN_MIN/MAX,
+// XXH64 содержимого .cube и TITLE, затем texel-ы в формате LUTFlat с выравниванием 64 байта.
+// При совпадении хэша таблица ссылается прямо на отображение кэша (без разбора и без копии),
+// отображение живёт, пока жива таблица; иначе .cube разбирается и кэш перезаписывается
+// (если каталог доступен для записи).
+LUTFlat loadCubeLUTCached(const std::string& path, int& lutSizeOut, std::string* title = nullptr);
 
-LUTFlat loadCubeLUT(const std::string& path, int& lutSizeOut);
\ No newline at end of file
+// Только строки до первой строки данных, таблица не разбирается; false — файл не читается
+bool readCubeHeader(const std::string& path, CubeHeader& header);
\ No newline at end of file
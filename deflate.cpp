@@ -0,0 +1,521 @@
+#include "deflate.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const size_t kWindowSize = 32768;
+const size_t kWindowMask = kWindowSize - 1;
+const int kHashBits = 15;
+const int kMinMatch = 3;
+const int kMaxMatch = 258;
+const size_t kBlockSymbols = 16384;   // символов в одном блоке Хаффмана
+
+// Параметры поиска совпадений по уровням (таблица zlib):
+// goodLength — после такого совпадения цепочка сокращается вчетверо;
+// maxLazy — длиннее не ищем ленивое совпадение (на быстрых уровнях — не хешируем его середину);
+// niceLength — достаточно длинное совпадение, поиск прекращается
+struct LevelParams {
+    int goodLength;
+    int maxLazy;
+    int niceLength;
+    int maxChain;
+    bool lazy;
+};
+const LevelParams kLevels[10] = {
+    {  0,   0,   0,    0, false },
+    {  4,   4,   8,    4, false }, {  4,   5,  16,    8, false }, {  4,   6,  32,   32, false },
+    {  4,   4,  16,   16, true  }, {  8,  16,  32,   32, true  }, {  8,  16, 128,  128, true  },
+    {  8,  32, 128,  256, true  }, { 32, 128, 258, 1024, true  }, { 32, 258, 258, 4096, true  }
+};
+
+// Коды длин 257..285 и дистанций 0..29 (RFC 1951, 3.2.5)
+const uint16_t kLengthBase[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+const uint8_t kLengthExtra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+const uint16_t kDistBase[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+const uint8_t kDistExtra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+// Порядок передачи длин кодов алфавита длин кодов
+const uint8_t kCodeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+struct CodeTables {
+    uint8_t lengthCode[kMaxMatch + 1];   // длина → индекс 0..28
+    uint8_t distCode[512];               // см. distIndex()
+    uint32_t crc[256];
+
+    CodeTables() {
+        for (int c = 0; c < 29; ++c) {
+            int end = c + 1 < 29 ? kLengthBase[c + 1] : kMaxMatch + 1;
+            for (int len = kLengthBase[c]; len < end; ++len) lengthCode[len] = static_cast<uint8_t>(c);
+        }
+        lengthCode[kMaxMatch] = 28;
+        for (int c = 0; c < 30; ++c) {
+            for (int d = kDistBase[c]; d < kDistBase[c] + (1 << kDistExtra[c]); ++d) {
+                if (d <= 256) distCode[d - 1] = static_cast<uint8_t>(c);
+                else distCode[256 + ((d - 1) >> 7)] = static_cast<uint8_t>(c);
+            }
+        }
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            crc[n] = c;
+        }
+    }
+
+    int distIndex(int dist) const {
+        return dist <= 256 ? distCode[dist - 1] : distCode[256 + ((dist - 1) >> 7)];
+    }
+};
+
+const CodeTables& tables() {
+    static const CodeTables t;
+    return t;
+}
+
+// Литерал (dist = 0) или пара длина/дистанция
+struct Symbol {
+    uint16_t litLen;
+    uint16_t dist;
+};
+
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<unsigned char>& out) : out_(out) {}
+
+    void put(uint32_t bits, int count) {
+        acc_ |= static_cast<uint64_t>(bits) << used_;
+        used_ += count;
+        while (used_ >= 8) {
+            out_.push_back(static_cast<unsigned char>(acc_));
+            acc_ >>= 8;
+            used_ -= 8;
+        }
+    }
+
+    void alignToByte() {
+        if (used_ > 0) put(0, 8 - used_);
+    }
+
+    void bytes(const unsigned char* data, size_t size) {
+        out_.insert(out_.end(), data, data + size);
+    }
+
+private:
+    std::vector<unsigned char>& out_;
+    uint64_t acc_ = 0;
+    int used_ = 0;
+};
+
+uint32_t reverseBits(uint32_t code, int length) {
+    uint32_t r = 0;
+    for (int i = 0; i < length; ++i) { r = (r << 1) | (code & 1); code >>= 1; }
+    return r;
+}
+
+// Длины кодов Хаффмана, ограниченные maxBits
+void buildLengths(const uint32_t* freq, int count, int maxBits, uint8_t* lengths) {
+    std::fill(lengths, lengths + count, 0);
+    std::vector<int> used;
+    for (int i = 0; i < count; ++i)
+        if (freq[i]) used.push_back(i);
+    if (used.empty()) return;
+    if (used.size() == 1) { lengths[used[0]] = 1; return; }
+
+    std::sort(used.begin(), used.end(), [&](int a, int b) {
+        return freq[a] != freq[b] ? freq[a] < freq[b] : a < b;
+    });
+
+    // Дерево двумя очередями: листья отсортированы, внутренние узлы появляются по неубыванию веса
+    const size_t n = used.size();
+    std::vector<uint64_t> weight(2 * n);
+    std::vector<int> parent(2 * n, -1);
+    for (size_t i = 0; i < n; ++i) weight[i] = freq[used[i]];
+    size_t leaf = 0, node = n, nextNode = n;
+    auto takeMin = [&]() -> size_t {
+        if (leaf < n && (node >= nextNode || weight[leaf] <= weight[node])) return leaf++;
+        return node++;
+    };
+    for (size_t k = 0; k + 1 < n; ++k) {
+        size_t a = takeMin(), b = takeMin();
+        weight[nextNode] = weight[a] + weight[b];
+        parent[a] = parent[b] = static_cast<int>(nextNode);
+        ++nextNode;
+    }
+
+    int numAtLength[64] = {};
+    std::vector<int> depth(2 * n, 0);
+    for (size_t i = nextNode - 1; i-- > 0;) depth[i] = depth[parent[i]] + 1;
+    for (size_t i = 0; i < n; ++i) ++numAtLength[std::min(depth[i], 63)];
+
+    // Слишком длинные коды переносим на maxBits и чиним неравенство Крафта
+    for (int len = maxBits + 1; len < 64; ++len) { numAtLength[maxBits] += numAtLength[len]; numAtLength[len] = 0; }
+    uint64_t total = 0;
+    for (int len = maxBits; len > 0; --len) total += static_cast<uint64_t>(numAtLength[len]) << (maxBits - len);
+    while (total > (1ull << maxBits)) {
+        --numAtLength[maxBits];
+        for (int len = maxBits - 1; len > 0; --len) {
+            if (numAtLength[len]) { --numAtLength[len]; numAtLength[len + 1] += 2; break; }
+        }
+        --total;
+    }
+
+    // Самые редкие символы получают самые длинные коды
+    size_t i = 0;
+    for (int len = maxBits; len > 0; --len)
+        for (int k = 0; k < numAtLength[len]; ++k) lengths[used[i++]] = static_cast<uint8_t>(len);
+}
+
+// Канонические коды (уже развёрнутые для записи младшим битом вперёд)
+void buildCodes(const uint8_t* lengths, int count, uint16_t* codes) {
+    int numAtLength[16] = {};
+    for (int i = 0; i < count; ++i) ++numAtLength[lengths[i]];
+    numAtLength[0] = 0;
+    uint32_t next[16] = {};
+    uint32_t code = 0;
+    for (int len = 1; len < 16; ++len) {
+        code = (code + numAtLength[len - 1]) << 1;
+        next[len] = code;
+    }
+    for (int i = 0; i < count; ++i)
+        if (lengths[i]) codes[i] = static_cast<uint16_t>(reverseBits(next[lengths[i]]++, lengths[i]));
+}
+
+class Deflater {
+public:
+    Deflater(const unsigned char* data, size_t dictSize, size_t size, int level, std::vector<unsigned char>& out)
+        : data_(data), start_(dictSize), end_(dictSize + size), blockStart_(dictSize),
+          params_(kLevels[std::clamp(level, 0, 9)]), bits_(out) {
+        symbols_.reserve(kBlockSymbols);
+    }
+
+    void run(bool last) {
+        if (params_.maxChain == 0) {
+            writeStored(start_, end_, last);
+        } else {
+            head_.assign(size_t(1) << kHashBits, -1);
+            prev_.assign(kWindowSize, -1);
+            const size_t dictStart = start_ > kWindowSize ? start_ - kWindowSize : 0;
+            for (size_t p = dictStart; p < start_; ++p) insert(p);
+            compress(last);
+        }
+        if (!last) {
+            // Sync flush: пустой stored-блок выравнивает поток по байту
+            bits_.put(0, 3);
+            bits_.alignToByte();
+            const unsigned char marker[4] = { 0x00, 0x00, 0xFF, 0xFF };
+            bits_.bytes(marker, 4);
+        } else {
+            bits_.alignToByte();
+        }
+    }
+
+private:
+    uint32_t hashAt(size_t p) const {
+        uint32_t v = data_[p] | (uint32_t(data_[p + 1]) << 8) | (uint32_t(data_[p + 2]) << 16);
+        return (v * 2654435761u) >> (32 - kHashBits);
+    }
+
+    void insert(size_t p) {
+        if (p + kMinMatch > end_) return;
+        uint32_t h = hashAt(p);
+        prev_[p & kWindowMask] = head_[h];
+        head_[h] = static_cast<int64_t>(p);
+    }
+
+    size_t matchLength(size_t a, size_t b, size_t limit) const {
+        size_t len = 0;
+        while (len + 8 <= limit) {
+            uint64_t x, y;
+            std::memcpy(&x, data_ + a + len, 8);
+            std::memcpy(&y, data_ + b + len, 8);
+            if (x != y) {
+                uint64_t diff = x ^ y;
+                int bit = 0;
+                while (!(diff & 0xFF)) { diff >>= 8; ++bit; }
+                return len + bit;
+            }
+            len += 8;
+        }
+        while (len < limit && data_[a + len] == data_[b + len]) ++len;
+        return len;
+    }
+
+    // Лучшее совпадение для позиции p (вызывать до insert(p));
+    // prevLen — совпадение с предыдущей позиции при ленивом поиске
+    void findMatch(size_t p, int& bestLen, int& bestDist, int prevLen = 0) const {
+        bestLen = 0;
+        bestDist = 0;
+        if (p + kMinMatch > end_) return;
+        const size_t limit = std::min<size_t>(kMaxMatch, end_ - p);
+        int64_t cand = head_[hashAt(p)];
+        int chain = prevLen >= params_.goodLength ? params_.maxChain >> 2 : params_.maxChain;
+        while (cand >= 0 && chain-- > 0) {
+            size_t c = static_cast<size_t>(cand);
+            if (p - c >= kWindowSize) break;
+            if (data_[c + bestLen] == data_[p + bestLen] || bestLen == 0) {
+                size_t len = matchLength(c, p, limit);
+                if (static_cast<int>(len) > bestLen) {
+                    bestLen = static_cast<int>(len);
+                    bestDist = static_cast<int>(p - c);
+                    if (bestLen >= params_.niceLength || len == limit) break;
+                }
+            }
+            int64_t next = prev_[c & kWindowMask];
+            if (next >= cand) break;
+            cand = next;
+        }
+        if (bestLen < kMinMatch) bestLen = 0;
+    }
+
+    void emitLiteral(size_t p) {
+        symbols_.push_back({ data_[p], 0 });
+        flushIfFull(p + 1);
+    }
+
+    void emitMatch(int len, int dist, size_t nextPos) {
+        symbols_.push_back({ static_cast<uint16_t>(len), static_cast<uint16_t>(dist) });
+        flushIfFull(nextPos);
+    }
+
+    void flushIfFull(size_t pos) {
+        if (symbols_.size() >= kBlockSymbols) {
+            writeBlock(pos, false);
+        }
+    }
+
+    void compress(bool last) {
+        size_t p = start_;
+        int len = 0, dist = 0;
+        findMatch(p, len, dist);
+        insert(p);
+        while (p < end_) {
+            if (len == 0) {
+                emitLiteral(p);
+                if (++p < end_) { findMatch(p, len, dist); insert(p); }
+                continue;
+            }
+            if (params_.lazy && len < params_.maxLazy && p + 1 < end_) {
+                int nextLen, nextDist;
+                findMatch(p + 1, nextLen, nextDist, len);
+                insert(p + 1);
+                if (nextLen > len) {
+                    emitLiteral(p);
+                    ++p;
+                    len = nextLen;
+                    dist = nextDist;
+                    continue;
+                }
+                for (size_t k = p + 2; k < p + len; ++k) insert(k);
+            } else if (params_.lazy || len <= params_.maxLazy) {
+                for (size_t k = p + 1; k < p + len; ++k) insert(k);
+            }
+            p += len;
+            emitMatch(len, dist, p);
+            len = 0;
+            if (p < end_) { findMatch(p, len, dist); insert(p); }
+        }
+        writeBlock(end_, last);
+    }
+
+    // Выбирает самый короткий из stored / фиксированного / динамического блока
+    void writeBlock(size_t blockEnd, bool final) {
+        const CodeTables& t = tables();
+        uint32_t litFreq[286] = {}, distFreq[30] = {};
+        uint64_t extraBits = 0;
+        for (const Symbol& s : symbols_) {
+            if (s.dist == 0) {
+                ++litFreq[s.litLen];
+            } else {
+                int lc = t.lengthCode[s.litLen], dc = t.distIndex(s.dist);
+                ++litFreq[257 + lc];
+                ++distFreq[dc];
+                extraBits += kLengthExtra[lc] + kDistExtra[dc];
+            }
+        }
+        litFreq[256] = 1;
+
+        uint8_t litLen[286], distLen[30];
+        buildLengths(litFreq, 286, 15, litLen);
+        buildLengths(distFreq, 30, 15, distLen);
+        if (std::all_of(distLen, distLen + 30, [](uint8_t l) { return l == 0; })) distLen[0] = 1;
+
+        // Заголовок динамического блока: длины кодов сжимаются RLE (16/17/18)
+        int numLit = 286, numDist = 30;
+        while (numLit > 257 && litLen[numLit - 1] == 0) --numLit;
+        while (numDist > 1 && distLen[numDist - 1] == 0) --numDist;
+        std::vector<uint8_t> all(litLen, litLen + numLit);
+        all.insert(all.end(), distLen, distLen + numDist);
+        std::vector<std::pair<uint8_t, uint8_t>> rle;   // символ, повтор/доп. биты
+        for (size_t i = 0; i < all.size();) {
+            size_t run = 1;
+            while (i + run < all.size() && all[i + run] == all[i]) ++run;
+            if (all[i] == 0 && run >= 3) {
+                size_t r = std::min<size_t>(run, 138);
+                rle.push_back(r >= 11 ? std::make_pair(uint8_t(18), uint8_t(r - 11)) : std::make_pair(uint8_t(17), uint8_t(r - 3)));
+                i += r;
+            } else if (all[i] != 0 && run >= 4) {
+                rle.push_back({ all[i], 0 });
+                size_t r = std::min<size_t>(run - 1, 6);
+                rle.push_back({ 16, uint8_t(r - 3) });
+                i += 1 + r;
+            } else {
+                rle.push_back({ all[i], 0 });
+                ++i;
+            }
+        }
+        uint32_t clFreq[19] = {};
+        for (const auto& e : rle) ++clFreq[e.first];
+        uint8_t clLen[19];
+        buildLengths(clFreq, 19, 7, clLen);
+        int numCl = 19;
+        while (numCl > 4 && clLen[kCodeLengthOrder[numCl - 1]] == 0) --numCl;
+
+        uint64_t dynamicBits = 3 + 5 + 5 + 4 + 3ull * numCl + extraBits;
+        for (const auto& e : rle)
+            dynamicBits += clLen[e.first] + (e.first == 16 ? 2 : e.first == 17 ? 3 : e.first == 18 ? 7 : 0);
+        uint64_t fixedBits = 3 + extraBits;
+        for (int i = 0; i < 286; ++i) {
+            dynamicBits += uint64_t(litFreq[i]) * litLen[i];
+            fixedBits += uint64_t(litFreq[i]) * (i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8);
+        }
+        for (int i = 0; i < 30; ++i) {
+            dynamicBits += uint64_t(distFreq[i]) * distLen[i];
+            fixedBits += uint64_t(distFreq[i]) * 5;
+        }
+        const size_t rawSize = blockEnd - blockStart_;
+        const uint64_t storedBits = 3 + 7 + (rawSize / 65535 + 1) * 32 + rawSize * 8ull;
+
+        if (storedBits <= fixedBits && storedBits <= dynamicBits) {
+            writeStored(blockStart_, blockEnd, final);
+        } else if (fixedBits <= dynamicBits) {
+            uint8_t fl[288], fd[30];
+            for (int i = 0; i < 288; ++i) fl[i] = static_cast<uint8_t>(i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8);
+            std::fill(fd, fd + 30, uint8_t(5));
+            bits_.put(final ? 1 : 0, 1);
+            bits_.put(1, 2);
+            writeSymbols(fl, 288, fd);
+        } else {
+            bits_.put(final ? 1 : 0, 1);
+            bits_.put(2, 2);
+            bits_.put(static_cast<uint32_t>(numLit - 257), 5);
+            bits_.put(static_cast<uint32_t>(numDist - 1), 5);
+            bits_.put(static_cast<uint32_t>(numCl - 4), 4);
+            for (int i = 0; i < numCl; ++i) bits_.put(clLen[kCodeLengthOrder[i]], 3);
+            uint16_t clCodes[19] = {};
+            buildCodes(clLen, 19, clCodes);
+            for (const auto& e : rle) {
+                bits_.put(clCodes[e.first], clLen[e.first]);
+                if (e.first == 16) bits_.put(e.second, 2);
+                else if (e.first == 17) bits_.put(e.second, 3);
+                else if (e.first == 18) bits_.put(e.second, 7);
+            }
+            writeSymbols(litLen, 286, distLen);
+        }
+        symbols_.clear();
+        blockStart_ = blockEnd;
+    }
+
+    void writeSymbols(const uint8_t* litLen, int litCount, const uint8_t* distLen) {
+        const CodeTables& t = tables();
+        uint16_t litCodes[288] = {}, distCodes[30] = {};
+        buildCodes(litLen, litCount, litCodes);
+        buildCodes(distLen, 30, distCodes);
+        for (const Symbol& s : symbols_) {
+            if (s.dist == 0) {
+                bits_.put(litCodes[s.litLen], litLen[s.litLen]);
+            } else {
+                int lc = t.lengthCode[s.litLen], dc = t.distIndex(s.dist);
+                bits_.put(litCodes[257 + lc], litLen[257 + lc]);
+                bits_.put(s.litLen - kLengthBase[lc], kLengthExtra[lc]);
+                bits_.put(distCodes[dc], distLen[dc]);
+                bits_.put(s.dist - kDistBase[dc], kDistExtra[dc]);
+            }
+        }
+        bits_.put(litCodes[256], litLen[256]);
+    }
+
+    void writeStored(size_t from, size_t to, bool final) {
+        do {
+            size_t len = std::min<size_t>(to - from, 65535);
+            bool lastPart = from + len == to;
+            bits_.put(final && lastPart ? 1 : 0, 1);
+            bits_.put(0, 2);
+            bits_.alignToByte();
+            const unsigned char header[4] = {
+                static_cast<unsigned char>(len), static_cast<unsigned char>(len >> 8),
+                static_cast<unsigned char>(~len), static_cast<unsigned char>(~len >> 8)
+            };
+            bits_.bytes(header, 4);
+            bits_.bytes(data_ + from, len);
+            from += len;
+        } while (from < to);
+    }
+
+    const unsigned char* data_;
+    size_t start_, end_;
+    size_t blockStart_;
+    LevelParams params_;
+    BitWriter bits_;
+    std::vector<int64_t> head_, prev_;
+    std::vector<Symbol> symbols_;
+};
+
+} // namespace
+
+void deflateChunk(const unsigned char* data, size_t dictSize, size_t size,
+                  int level, bool last, std::vector<unsigned char>& out) {
+    Deflater(data, dictSize, size, level, out).run(last);
+}
+
+void zlibHeader(int level, unsigned char header[2]) {
+    // CMF: deflate, окно 32 КБ; FLEVEL — только подсказка декодеру
+    const unsigned cmf = 0x78;
+    const unsigned flevel = level <= 1 ? 0 : level <= 5 ? 1 : level == 6 ? 2 : 3;
+    unsigned flg = flevel << 6;
+    flg += 31 - (cmf * 256 + flg) % 31;
+    header[0] = static_cast<unsigned char>(cmf);
+    header[1] = static_cast<unsigned char>(flg);
+}
+
+uint32_t adler32Update(uint32_t adler, const unsigned char* data, size_t size) {
+    const uint32_t base = 65521;
+    uint32_t a = adler & 0xFFFF, b = adler >> 16;
+    while (size > 0) {
+        size_t n = std::min<size_t>(size, 5552);   // без переполнения 32 бит
+        size -= n;
+        while (n--) { a += *data++; b += a; }
+        a %= base;
+        b %= base;
+    }
+    return (b << 16) | a;
+}
+
+uint32_t adler32Combine(uint32_t adlerA, uint32_t adlerB, uint64_t sizeB) {
+    const uint32_t base = 65521;
+    const uint32_t rem = static_cast<uint32_t>(sizeB % base);
+    uint32_t sum1 = adlerA & 0xFFFF;
+    uint32_t sum2 = static_cast<uint32_t>((uint64_t(rem) * sum1) % base);
+    sum1 += (adlerB & 0xFFFF) + base - 1;
+    sum2 += (adlerA >> 16) + (adlerB >> 16) + base - rem;
+    if (sum1 >= base) sum1 -= base;
+    if (sum1 >= base) sum1 -= base;
+    if (sum2 >= 2 * base) sum2 -= 2 * base;
+    if (sum2 >= base) sum2 -= base;
+    return (sum2 << 16) | sum1;
+}
+
+uint32_t crc32Update(uint32_t crc, const unsigned char* data, size_t size) {
+    const uint32_t* table = tables().crc;
+    crc = ~crc;
+    while (size--) crc = table[(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ─────────────────────────────────────────────────────────────
+//  Deflate (RFC 1951) для параллельного сжатия по схеме pigz:
+//  поток режется на куски, каждый кусок сжимается независимо
+//  (словарь — до 32 КБ предыдущих данных) и заканчивается
+//  sync flush, поэтому куски можно просто склеить.
+// ─────────────────────────────────────────────────────────────
+
+// Сжимает data[dictSize, dictSize + size); data[0, dictSize) — словарь.
+// last = true — финальный кусок (BFINAL), иначе в конце пустой stored-блок.
+// level 0..9: 0 — без сжатия, 9 — самый длинный поиск совпадений.
+void deflateChunk(const unsigned char* data, size_t dictSize, size_t size,
+                  int level, bool last, std::vector<unsigned char>& out);
+
+// Заголовок zlib (RFC 1950) для заданного уровня
+void zlibHeader(int level, unsigned char header[2]);
+
+uint32_t adler32Update(uint32_t adler, const unsigned char* data, size_t size);
+// Adler-32 склейки A‖B по adler(A), adler(B) и длине B
+uint32_t adler32Combine(uint32_t adlerA, uint32_t adlerB, uint64_t sizeB);
+
+uint32_t crc32Update(uint32_t crc, const unsigned char* data, size_t size);
@@ -2,40 +2,211 @@
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #define STB_IMAGE_RESIZE_IMPLEMENTATION
 #include "image_io.hpp"
+#include "cancel_token.hpp"
+#include "progress.hpp"
+#include "stats.hpp"
+#include "trace.hpp"
+#include "codec.hpp"
+#include "thread_pool.hpp"
+#include "mapped_file.hpp"
 #include <algorithm>
 #include <cmath>
-#include <thread>
+#include <cstdint>
+#include <cstring>
 #include <vector>
 
-Image loadImage(const std::string& inputPath) {
+Image loadImage(const std::string& inputPath, const CancelToken* cancel) {
     Image img;
-    int width, height, channels;
-    unsigned char* raw_data = stbi_load(inputPath.c_str(), &width, &height, &channels, 3);
-    if (!raw_data) {
+    DecodeOptions options;
+    options.cancel = cancel;
+    // Декодер читает прямо из отображённого файла, без промежуточного буфера
+    MappedFile file(inputPath);
+    if (!file.isOpen() || !decodeImage(file.data(), file.size(), img, options)) {
+        if (cancel && cancel->cancelled()) return Image();
         std::cerr << "Не удалось загрузить " << inputPath << "\n";
-        return img;
+        return Image();
     }
-    img.width = width;
-    img.height = height;
-    img.channels = channels;
-    img.data.assign(raw_data, raw_data + width * height * channels);
-    stbi_image_free(raw_data);
     return img;
 }
 
 bool saveImage(const Image& img, const std::string& outputPath, const std::string& format) {
+    return saveImage(img, outputPath, format, EncodeOptions());
+}
+
+bool saveImage(const Image& img, const std::string& outputPath, const std::string& format, const EncodeOptions& options) {
     if (!img.valid()) {
         std::cerr << "Некорректное изображение для сохранения " << outputPath << "\n";
         return false;
     }
-    int success = 0;
-    if (format == "jpg") {
-        success = stbi_write_jpg(outputPath.c_str(), img.width, img.height, img.channels, img.data.data(), 95);
-    }
+    FileSink sink(outputPath);
+    bool success = sink.isOpen() && encodeImage(img, format, options, sink);
+    success = sink.close() && success;
     if (!success) {
         std::cerr << "Ошибка при сохранении " << outputPath << "\n";
     }
-    return success != 0;
+    return success;
+}
+
+// ─────────────────────────────────────────────────────────────
+//  QOI
+// ─────────────────────────────────────────────────────────────
+namespace {
+
+const unsigned char QOI_OP_INDEX = 0x00;
+const unsigned char QOI_OP_DIFF  = 0x40;
+const unsigned char QOI_OP_LUMA  = 0x80;
+const unsigned char QOI_OP_RUN   = 0xC0;
+const unsigned char QOI_OP_RGB   = 0xFE;
+const unsigned char QOI_OP_RGBA  = 0xFF;
+const unsigned char QOI_MASK_2   = 0xC0;
+const unsigned char kQoiPadding[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+const size_t kQoiHeaderSize = 14;
+const uint64_t kQoiMaxPixels = 400000000ull;   // как в эталонной реализации
+
+struct QoiPixel {
+    unsigned char r, g, b, a;
+    bool operator==(const QoiPixel& o) const { return r == o.r && g == o.g && b == o.b && a == o.a; }
+    int hash() const { return (r * 3 + g * 5 + b * 7 + a * 11) & 63; }
+};
+
+} // namespace
+
+bool encodeQoi(const Image& img, ByteSink& sink) {
+    if (img.width <= 0 || img.height <= 0 || (img.channels != 3 && img.channels != 4)) return false;
+    const uint64_t pixels = uint64_t(img.width) * img.height;
+    if (pixels > kQoiMaxPixels || img.data.size() < pixels * img.channels) return false;
+
+    // Пишем в sink блоками, чтобы не держать весь файл в памяти
+    std::vector<unsigned char> buf;
+    buf.reserve(64 * 1024 + 16);
+    auto put32 = [&](uint32_t v) {
+        buf.push_back(static_cast<unsigned char>(v >> 24));
+        buf.push_back(static_cast<unsigned char>(v >> 16));
+        buf.push_back(static_cast<unsigned char>(v >> 8));
+        buf.push_back(static_cast<unsigned char>(v));
+    };
+    buf.insert(buf.end(), { 'q', 'o', 'i', 'f' });
+    put32(static_cast<uint32_t>(img.width));
+    put32(static_cast<uint32_t>(img.height));
+    buf.push_back(static_cast<unsigned char>(img.channels));
+    buf.push_back(0);   // sRGB с линейной альфой
+
+    QoiPixel index[64] = {};
+    QoiPixel prev = { 0, 0, 0, 255 };
+    int run = 0;
+    const int ch = img.channels;
+    const unsigned char* src = img.data.data();
+    for (uint64_t i = 0; i < pixels; ++i, src += ch) {
+        QoiPixel px = { src[0], src[1], src[2], ch == 4 ? src[3] : prev.a };
+        if (px == prev) {
+            if (++run == 62 || i + 1 == pixels) {
+                buf.push_back(static_cast<unsigned char>(QOI_OP_RUN | (run - 1)));
+                run = 0;
+            }
+        } else {
+            if (run > 0) {
+                buf.push_back(static_cast<unsigned char>(QOI_OP_RUN | (run - 1)));
+                run = 0;
+            }
+            const int h = px.hash();
+            if (index[h] == px) {
+                buf.push_back(static_cast<unsigned char>(QOI_OP_INDEX | h));
+            } else {
+                index[h] = px;
+                if (px.a == prev.a) {
+                    const signed char vr = static_cast<signed char>(px.r - prev.r);
+                    const signed char vg = static_cast<signed char>(px.g - prev.g);
+                    const signed char vb = static_cast<signed char>(px.b - prev.b);
+                    const signed char vgr = static_cast<signed char>(vr - vg);
+                    const signed char vgb = static_cast<signed char>(vb - vg);
+                    if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+                        buf.push_back(static_cast<unsigned char>(QOI_OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2)));
+                    } else if (vgr > -9 && vgr < 8 && vg > -33 && vg < 32 && vgb > -9 && vgb < 8) {
+                        buf.push_back(static_cast<unsigned char>(QOI_OP_LUMA | (vg + 32)));
+                        buf.push_back(static_cast<unsigned char>((vgr + 8) << 4 | (vgb + 8)));
+                    } else {
+                        buf.insert(buf.end(), { QOI_OP_RGB, px.r, px.g, px.b });
+                    }
+                } else {
+                    buf.insert(buf.end(), { QOI_OP_RGBA, px.r, px.g, px.b, px.a });
+                }
+            }
+        }
+        prev = px;
+        if (buf.size() >= 64 * 1024) {
+            if (!sink.write(buf.data(), buf.size())) return false;
+            buf.clear();
+        }
+    }
+    buf.insert(buf.end(), kQoiPadding, kQoiPadding + sizeof(kQoiPadding));
+    return sink.write(buf.data(), buf.size());
+}
+
+bool decodeQoi(const unsigned char* data, size_t size, Image& out, int desiredChannels) {
+    if (!data || size < kQoiHeaderSize + sizeof(kQoiPadding) || std::memcmp(data, "qoif", 4) != 0) return false;
+    auto get32 = [&](size_t pos) {
+        return uint32_t(data[pos]) << 24 | uint32_t(data[pos + 1]) << 16 | uint32_t(data[pos + 2]) << 8 | data[pos + 3];
+    };
+    const uint32_t width = get32(4), height = get32(8);
+    const int fileChannels = data[12];
+    if (width == 0 || height == 0 || (fileChannels != 3 && fileChannels != 4) || data[13] > 1) return false;
+    if (uint64_t(width) * height > kQoiMaxPixels) return false;
+    const int ch = (desiredChannels == 3 || desiredChannels == 4) ? desiredChannels : fileChannels;
+
+    const uint64_t pixels = uint64_t(width) * height;
+    // Байт потока даёт не больше 62 пикселей (QOI_OP_RUN): размер из заголовка, которого
+    // данные не покрывают, отклоняется до выделения буфера
+    if (pixels > uint64_t(size - kQoiHeaderSize - sizeof(kQoiPadding)) * 62) return false;
+    out.width = static_cast<int>(width);
+    out.height = static_cast<int>(height);
+    out.channels = ch;
+    out.data.allocate(pixels * ch);
+
+    QoiPixel index[64] = {};
+    QoiPixel px = { 0, 0, 0, 255 };
+    int run = 0;
+    size_t p = kQoiHeaderSize;
+    const size_t end = size - sizeof(kQoiPadding);
+    unsigned char* dst = out.data.data();
+    for (uint64_t i = 0; i < pixels; ++i, dst += ch) {
+        if (run > 0) {
+            --run;
+        } else if (p < end) {
+            const unsigned char b1 = data[p++];
+            if (b1 == QOI_OP_RGB) {
+                if (p + 3 > end) return false;
+                px.r = data[p]; px.g = data[p + 1]; px.b = data[p + 2];
+                p += 3;
+            } else if (b1 == QOI_OP_RGBA) {
+                if (p + 4 > end) return false;
+                px.r = data[p]; px.g = data[p + 1]; px.b = data[p + 2]; px.a = data[p + 3];
+                p += 4;
+            } else if ((b1 & QOI_MASK_2) == QOI_OP_INDEX) {
+                px = index[b1];
+            } else if ((b1 & QOI_MASK_2) == QOI_OP_DIFF) {
+                px.r = static_cast<unsigned char>(px.r + ((b1 >> 4) & 3) - 2);
+                px.g = static_cast<unsigned char>(px.g + ((b1 >> 2) & 3) - 2);
+                px.b = static_cast<unsigned char>(px.b + (b1 & 3) - 2);
+            } else if ((b1 & QOI_MASK_2) == QOI_OP_LUMA) {
+                if (p + 1 > end) return false;
+                const unsigned char b2 = data[p++];
+                const int vg = (b1 & 0x3F) - 32;
+                px.r = static_cast<unsigned char>(px.r + vg - 8 + ((b2 >> 4) & 0x0F));
+                px.g = static_cast<unsigned char>(px.g + vg);
+                px.b = static_cast<unsigned char>(px.b + vg - 8 + (b2 & 0x0F));
+            } else {
+                run = b1 & 0x3F;
+            }
+            index[px.hash()] = px;
+        } else {
+            return false;   // поток кончился раньше пикселей
+        }
+        dst[0] = px.r;
+        dst[1] = px.g;
+        dst[2] = px.b;
+        if (ch == 4) dst[3] = px.a;
+    }
+    return true;
 }
 
 Image processImage(const Image& input, const LUTFlat& lut, int lutSize, float blendAmount, float whiteBalance, float tint, float brightness, float contrast, float saturation) {
@@ -46,9 +217,10 @@ Image processImage(const Image& input, const LUTFlat& lut, int lutSize, float bl
     output.width = input.width;
     output.height = input.height;
     output.channels = input.channels;
-    output.data.resize(input.width * input.height * input.channels);
+    output.data.allocate(size_t(input.width) * input.height * input.channels);
 
-    for (int i = 0; i < input.width * input.height; ++i) {
+    const size_t pixels = size_t(input.width) * input.height;
+    for (size_t i = 0; i < pixels; ++i) {
         Color px;
         px.r = input.data[i * 3 + 0] / 255.0f;
         px.g = input.data[i * 3 + 1] / 255.0f;
@@ -142,7 +314,7 @@ void processPixelRange(const Image& input, Image& output, const LUTFlat& lut, in
                       int startRow, int endRow) {
     for (int y = startRow; y < endRow; ++y) {
         for (int x = 0; x < input.width; ++x) {
-            int i = y * input.width + x;
+            size_t i = size_t(y) * input.width + x;
             Color px;
             px.r = input.data[i * 3 + 0] / 255.0f;
             px.g = input.data[i * 3 + 1] / 255.0f;
@@ -230,32 +402,39 @@ void processPixelRange(const Image& input, Image& output, const LUTFlat& lut, in
 }
 
 Image processImageParallel(const Image& input, const LUTFlat& lut, int lutSize, float blendAmount,
-                           float whiteBalance, float tint, float brightness, float contrast, float saturation) {
+                           float whiteBalance, float tint, float brightness, float contrast, float saturation,
+                           const CancelToken* cancel, ProgressTracker* progress, unsigned maxThreads) {
     Image output;
     if (!input.valid()) {
         return output;
     }
+    StatTimer timer(kStatApply);
+    timer.pixels(uint64_t(input.width) * input.height);
+    TraceScope trace("Apply LUT", "image", "height", input.height);
     output.width = input.width;
     output.height = input.height;
     output.channels = input.channels;
-    output.data.resize(input.width * input.height * input.channels);
+    output.data.allocate(size_t(input.width) * input.height * input.channels);
 
+    // Тайлы по kTileRows строк, перед каждым проверяется отмена
+    const int kTileRows = 64;
+    const size_t tiles = (size_t(input.height) + kTileRows - 1) / kTileRows;
+    auto runTile = [&](size_t t) {
+        if (cancel && cancel->cancelled()) return;
+        const int y = int(t) * kTileRows;
+        const int tileEnd = std::min(y + kTileRows, input.height);
+        TraceScope tile("Tile", "image", "row", y);
+        processPixelRange(input, output, lut, lutSize, blendAmount, whiteBalance, tint, brightness, contrast, saturation,
+                          y, tileEnd);
+        if (progress) progress->add(tileEnd - y);
+    };
     // Используем многопоточность только для больших изображений (> 1 МП)
-    int numThreads = (input.width * input.height > 1000000) ? std::thread::hardware_concurrency() : 1;
-    int rowsPerThread = input.height / numThreads;
-    if (rowsPerThread == 0) rowsPerThread = 1;
-
-    std::vector<std::thread> threads;
-    for (int t = 0; t < numThreads; ++t) {
-        int startRow = t * rowsPerThread;
-        int endRow = (t == numThreads - 1) ? input.height : startRow + rowsPerThread;
-        if (startRow >= input.height) break;
-        threads.emplace_back(processPixelRange, std::ref(input), std::ref(output), std::ref(lut), lutSize,
-                             blendAmount, whiteBalance, tint, brightness, contrast, saturation, startRow, endRow);
-    }
-    for (auto& th : threads) {
-        th.join();
+    if (size_t(input.width) * input.height > 1000000) {
+        ThreadPool::instance().parallelFor(tiles, runTile, maxThreads);
+    } else {
+        for (size_t t = 0; t < tiles; ++t) runTile(t);
     }
+    if (cancel && cancel->cancelled()) return Image();
     return output;
 }
 
@@ -265,10 +444,13 @@ Image resizeImage(const Image& input, int newWidth, int newHeight) {
     if (!input.valid()) {
         return output;
     }
+    StatTimer timer(kStatResize);
+    timer.pixels(uint64_t(newWidth) * newHeight);
+    TraceScope trace("Resize", "image", "height", newHeight);
     output.width = newWidth;
     output.height = newHeight;
     output.channels = input.channels;
-    output.data.resize(newWidth * newHeight * input.channels);
+    output.data.allocate(size_t(newWidth) * newHeight * input.channels);
     int success = stbir_resize_uint8(input.data.data(), input.width, input.height, 0,
                                     output.data.data(), newWidth, newHeight, 0, input.channels);
     if (!success) {
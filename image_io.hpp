@@ -5,19 +5,35 @@
 #include "stb_image_resize.h"
 #include "cube_loader.hpp"
 #include "interpolator.hpp"
+#include "pixel_buffer.hpp"
 #include <string>
 #include <vector>
 #include <iostream>
 
+struct EncodeOptions;
+class ByteSink;
+class CancelToken;
+class ProgressTracker;
+
 struct Image {
-    std::vector<unsigned char> data;
+    PixelBuffer data;
     int width, height, channels;
 
     bool valid() const { return !data.empty() && width > 0 && height > 0 && channels == 3; }
 };
 
-Image loadImage(const std::string& inputPath);
+// cancel прерывает декодирование между полосами строк (если кодек умеет)
+Image loadImage(const std::string& inputPath, const CancelToken* cancel = nullptr);
 bool saveImage(const Image& img, const std::string& outputPath, const std::string& format);
+bool saveImage(const Image& img, const std::string& outputPath, const std::string& format, const EncodeOptions& options);
+// QOI (qoiformat.org): быстрый lossless для промежуточных файлов, RGB и RGBA.
+// Каналы файла берутся из img.channels; при чтении desiredChannels = 3 отбрасывает альфу.
+bool encodeQoi(const Image& img, ByteSink& sink);
+bool decodeQoi(const unsigned char* data, size_t size, Image& out, int desiredChannels = 3);
 Image processImage(const Image& input, const LUTFlat& lut, int lutSize, float blendAmount, float whiteBalance, float tint, float brightness, float contrast, float saturation);
-Image processImageParallel(const Image& input, const LUTFlat& lut, int lutSize, float blendAmount, float whiteBalance, float tint, float brightness, float contrast, float saturation);
+// cancel проверяется между тайлами строк; отменённая обработка возвращает пустое изображение.
+// progress получает число строк каждого готового тайла. Тайлы раздаёт общий пул потоков;
+// maxThreads — сколько потоков (с вызывающим) берёт одно изображение, 0 — без ограничения.
+Image processImageParallel(const Image& input, const LUTFlat& lut, int lutSize, float blendAmount, float whiteBalance, float tint, float brightness, float contrast, float saturation,
+                           const CancelToken* cancel = nullptr, ProgressTracker* progress = nullptr, unsigned maxThreads = 0);
 Image resizeImage(const Image& input, int newWidth, int newHeight);
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "codec.hpp"
+
+// ─────────────────────────────────────────────────────────────
+//  Собственный baseline JPEG: кодирование полосами MCU-строк
+//  с restart-маркерами, полосы кодируются параллельно на пуле.
+// ─────────────────────────────────────────────────────────────
+
+// Порядок обхода зигзагом: k-й коэффициент → индекс в блоке 8×8
+// (16 лишних элементов защищают от выхода за границу на битых данных)
+static const unsigned char kJpegNaturalOrder[64 + 16] = {
+     0,  1,  8, 16,  9,  2,  3, 10, 17, 24, 32, 25, 18, 11,  4,  5,
+    12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13,  6,  7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+    63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63
+};
+
+// Параметры берутся из EncodeOptions: quality, subsampling, restartRows
+bool encodeJpeg(const Image& img, const EncodeOptions& options, ByteSink& sink);
+// Построчная запись с памятью в одну полосу MCU-строк; restartRows = -1 — интервал в одну
+// MCU-строку, если у пула есть воркеры. nullptr — размеры вне 1..65535.
+std::unique_ptr<RowWriter> openJpegWriter(int width, int height, const EncodeOptions& options, ByteSink& sink);
+
+// Baseline (SOF0/SOF1), 1 или 3 компонента, один чередующийся скан.
+// При наличии DRI restart-интервалы декодируются параллельно; иначе — последовательно.
+// false — формат не поддерживается (progressive, 12 бит, CMYK…), данные повреждены
+// или cancel сработал между интервалами.
+bool decodeJpeg(const unsigned char* data, size_t size, Image& out, const CancelToken* cancel = nullptr);
+bool jpegHasRestartMarkers(const unsigned char* data, size_t size);
@@ -0,0 +1,516 @@
+#include "jpeg_codec.hpp"
+#include "cancel_token.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// Таблица Хаффмана для декодирования: быстрый поиск по 9 битам + канонический разбор длинных кодов
+struct HuffDecoder {
+    static const int kFastBits = 9;
+    uint8_t fastLen[1 << kFastBits];
+    uint8_t fastSym[1 << kFastBits];
+    int maxCode[18];
+    int valPtr[17];
+    int minCode[17];
+    uint8_t vals[256];
+    bool defined = false;
+
+    bool build(const uint8_t* bits, const uint8_t* symbols, int count) {
+        if (count > 256) return false;
+        std::memcpy(vals, symbols, static_cast<size_t>(count));
+        std::memset(fastLen, 0, sizeof(fastLen));
+        int code = 0, k = 0;
+        for (int len = 1; len <= 16; ++len) {
+            valPtr[len] = k;
+            minCode[len] = code;
+            for (int i = 0; i < bits[len - 1]; ++i, ++k, ++code) {
+                if (len <= kFastBits) {
+                    int shift = kFastBits - len;
+                    for (int j = 0; j < (1 << shift); ++j) {
+                        fastLen[(code << shift) | j] = static_cast<uint8_t>(len);
+                        fastSym[(code << shift) | j] = symbols[k];
+                    }
+                }
+            }
+            maxCode[len] = bits[len - 1] ? code - 1 : -1;
+            if (code > (1 << len)) return false;
+            code <<= 1;
+        }
+        maxCode[17] = 0x7FFFFFFF;
+        defined = true;
+        return true;
+    }
+};
+
+// Чтение энтропийных данных: снимает стаффинг, на маркере подаёт нули
+class BitReader {
+public:
+    BitReader(const uint8_t* p, const uint8_t* end) : p_(p), end_(end) {}
+
+    uint32_t peek16() {
+        fill();
+        return buf_ >> 16;
+    }
+
+    void consume(int n) {
+        buf_ <<= n;
+        bits_ -= n;
+    }
+
+    int receive(int n) {
+        if (n == 0) return 0;
+        fill();
+        int v = static_cast<int>(buf_ >> (32 - n));
+        consume(n);
+        return v;
+    }
+
+    int decode(const HuffDecoder& h) {
+        uint32_t peek = peek16();
+        int fast = static_cast<int>(peek >> (16 - HuffDecoder::kFastBits));
+        if (h.fastLen[fast]) {
+            consume(h.fastLen[fast]);
+            return h.fastSym[fast];
+        }
+        for (int len = HuffDecoder::kFastBits + 1; len <= 16; ++len) {
+            int code = static_cast<int>(peek >> (16 - len));
+            if (code <= h.maxCode[len]) {
+                consume(len);
+                return h.vals[(h.valPtr[len] + code - h.minCode[len]) & 0xFF];
+            }
+        }
+        error_ = true;
+        return 0;
+    }
+
+    bool error() const { return error_; }
+    void fail() { error_ = true; }
+
+private:
+    void fill() {
+        while (bits_ <= 24) {
+            uint32_t b = 0;
+            if (p_ < end_) {
+                b = *p_;
+                if (b == 0xFF) {
+                    uint8_t next = (p_ + 1 < end_) ? p_[1] : 0xD9;
+                    if (next == 0x00) p_ += 2;
+                    else b = 0;          // маркер: дальше не читаем
+                } else {
+                    ++p_;
+                }
+            }
+            buf_ |= b << (24 - bits_);
+            bits_ += 8;
+        }
+    }
+
+    const uint8_t* p_;
+    const uint8_t* end_;
+    uint32_t buf_ = 0;
+    int bits_ = 0;
+    bool error_ = false;
+};
+
+inline int extend(int v, int n) {
+    return v < (1 << (n - 1)) ? v - (1 << n) + 1 : v;
+}
+
+// Обратное DCT по схеме AAN (как jidctflt.c); коэффициенты уже умножены на масштаб AAN
+void inverseDct8(const float* in, int inStride, float* out, int outStride) {
+    float tmp0 = in[0], tmp1 = in[2 * inStride], tmp2 = in[4 * inStride], tmp3 = in[6 * inStride];
+    float tmp10 = tmp0 + tmp2, tmp11 = tmp0 - tmp2;
+    float tmp13 = tmp1 + tmp3, tmp12 = (tmp1 - tmp3) * 1.414213562f - tmp13;
+    tmp0 = tmp10 + tmp13;
+    tmp3 = tmp10 - tmp13;
+    tmp1 = tmp11 + tmp12;
+    tmp2 = tmp11 - tmp12;
+
+    float tmp4 = in[inStride], tmp5 = in[3 * inStride], tmp6 = in[5 * inStride], tmp7 = in[7 * inStride];
+    float z13 = tmp6 + tmp5, z10 = tmp6 - tmp5;
+    float z11 = tmp4 + tmp7, z12 = tmp4 - tmp7;
+    tmp7 = z11 + z13;
+    tmp11 = (z11 - z13) * 1.414213562f;
+    float z5 = (z10 + z12) * 1.847759065f;
+    tmp10 = 1.082392200f * z12 - z5;
+    tmp12 = -2.613125930f * z10 + z5;
+    tmp6 = tmp12 - tmp7;
+    tmp5 = tmp11 - tmp6;
+    tmp4 = tmp10 + tmp5;
+
+    out[0]             = tmp0 + tmp7;
+    out[7 * outStride] = tmp0 - tmp7;
+    out[1 * outStride] = tmp1 + tmp6;
+    out[6 * outStride] = tmp1 - tmp6;
+    out[2 * outStride] = tmp2 + tmp5;
+    out[5 * outStride] = tmp2 - tmp5;
+    out[4 * outStride] = tmp3 + tmp4;
+    out[3 * outStride] = tmp3 - tmp4;
+}
+
+struct Component {
+    int id = 0;
+    int h = 1, v = 1;          // факторы дискретизации
+    int tq = 0, td = 0, ta = 0;
+    float dequant[64];         // естественный порядок, с масштабом AAN
+    int width = 0, height = 0; // реальный размер компонента
+    size_t planeStride = 0;    // ширина плоскости в пикселях (кратна 8)
+    int planeRows = 0;         // высота плоскости в пикселях
+    std::vector<uint8_t> plane;
+};
+
+struct JpegInfo {
+    int width = 0, height = 0;
+    int ncomp = 0;
+    Component comps[3];
+    int hmax = 1, vmax = 1;
+    int mcusX = 0, mcusY = 0;
+    int restartInterval = 0;
+    bool rgb = false;          // Adobe transform = 0: компоненты уже RGB
+    uint16_t quant[4][64];     // зигзаг
+    bool quantSet[4] = { false, false, false, false };
+    HuffDecoder dc[4], ac[4];
+    const uint8_t* scan = nullptr;
+    const uint8_t* end = nullptr;
+};
+
+bool parseHeaders(const uint8_t* data, size_t size, JpegInfo& info) {
+    if (size < 4 || data[0] != 0xFF || data[1] != 0xD8) return false;
+    const uint8_t* p = data + 2;
+    const uint8_t* end = data + size;
+    bool frame = false;
+    while (p + 4 <= end) {
+        if (p[0] != 0xFF) return false;
+        uint8_t marker = p[1];
+        if (marker == 0xFF) { ++p; continue; }   // заполняющие байты
+        p += 2;
+        if (marker == 0xD8 || (marker >= 0xD0 && marker <= 0xD7) || marker == 0x01) continue;
+        if (p + 2 > end) return false;
+        int len = (p[0] << 8) | p[1];
+        if (len < 2 || p + len > end) return false;
+        const uint8_t* seg = p + 2;
+        const uint8_t* segEnd = p + len;
+
+        switch (marker) {
+        case 0xC0: case 0xC1: {                  // baseline / extended, Хаффман
+            if (len < 8 || seg[0] != 8) return false;
+            info.height = (seg[1] << 8) | seg[2];
+            info.width = (seg[3] << 8) | seg[4];
+            info.ncomp = seg[5];
+            if (info.width <= 0 || info.height <= 0) return false;
+            if ((info.ncomp != 1 && info.ncomp != 3) || len < 8 + 3 * info.ncomp) return false;
+            for (int c = 0; c < info.ncomp; ++c) {
+                Component& comp = info.comps[c];
+                comp.id = seg[6 + c * 3];
+                comp.h = seg[7 + c * 3] >> 4;
+                comp.v = seg[7 + c * 3] & 15;
+                comp.tq = seg[8 + c * 3];
+                if (comp.h < 1 || comp.h > 4 || comp.v < 1 || comp.v > 4 || comp.tq > 3) return false;
+                if (info.ncomp == 1) comp.h = comp.v = 1;   // одиночный компонент кодируется без чередования
+                info.hmax = std::max(info.hmax, comp.h);
+                info.vmax = std::max(info.vmax, comp.v);
+            }
+            frame = true;
+            break;
+        }
+        case 0xC4: {                             // DHT
+            const uint8_t* q = seg;
+            while (q + 17 <= segEnd) {
+                int tc = q[0] >> 4, th = q[0] & 15;
+                if (tc > 1 || th > 3) return false;
+                int count = 0;
+                for (int i = 0; i < 16; ++i) count += q[1 + i];
+                if (q + 17 + count > segEnd) return false;
+                HuffDecoder& h = tc ? info.ac[th] : info.dc[th];
+                if (!h.build(q + 1, q + 17, count)) return false;
+                q += 17 + count;
+            }
+            break;
+        }
+        case 0xDB: {                             // DQT
+            const uint8_t* q = seg;
+            while (q + 65 <= segEnd) {
+                int pq = q[0] >> 4, tq = q[0] & 15;
+                if (pq != 0 || tq > 3) return false;   // 16-битные таблицы — не baseline
+                for (int k = 0; k < 64; ++k) info.quant[tq][k] = q[1 + k];
+                info.quantSet[tq] = true;
+                q += 65;
+            }
+            break;
+        }
+        case 0xDD:                               // DRI
+            if (len < 4) return false;
+            info.restartInterval = (seg[0] << 8) | seg[1];
+            break;
+        case 0xEE:                               // Adobe APP14
+            if (len >= 14 && std::memcmp(seg, "Adobe", 5) == 0) info.rgb = (seg[11] == 0);
+            break;
+        case 0xDA: {                             // SOS
+            if (!frame || len < 6) return false;
+            int ns = seg[0];
+            if (ns != info.ncomp || len < 6 + 2 * ns) return false;   // только один чередующийся скан
+            for (int i = 0; i < ns; ++i) {
+                int cid = seg[1 + i * 2];
+                Component* comp = nullptr;
+                for (int c = 0; c < info.ncomp; ++c)
+                    if (info.comps[c].id == cid) comp = &info.comps[c];
+                if (!comp) return false;
+                comp->td = seg[2 + i * 2] >> 4;
+                comp->ta = seg[2 + i * 2] & 15;
+                if (comp->td > 3 || comp->ta > 3) return false;
+            }
+            const uint8_t* spec = seg + 1 + 2 * ns;
+            if (spec[0] != 0 || spec[1] != 63 || spec[2] != 0) return false;
+            info.scan = segEnd;
+            info.end = end;
+            return true;
+        }
+        default:
+            if (marker >= 0xC2 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+                return false;                    // progressive, lossless, арифметика — не наш случай
+            break;
+        }
+        p = segEnd;
+    }
+    return false;
+}
+
+bool prepare(JpegInfo& info) {
+    static const float aan[8] = { 1.0f, 1.387039845f, 1.306562965f, 1.175875602f,
+                                  1.0f, 0.785694958f, 0.541196100f, 0.275899379f };
+    info.mcusX = (info.width + 8 * info.hmax - 1) / (8 * info.hmax);
+    info.mcusY = (info.height + 8 * info.vmax - 1) / (8 * info.vmax);
+    for (int c = 0; c < info.ncomp; ++c) {
+        Component& comp = info.comps[c];
+        if (!info.quantSet[comp.tq] || !info.dc[comp.td].defined || !info.ac[comp.ta].defined) return false;
+        if (info.hmax % comp.h || info.vmax % comp.v) return false;   // дробные коэффициенты не поддерживаем
+        comp.width = (info.width * comp.h + info.hmax - 1) / info.hmax;
+        comp.height = (info.height * comp.v + info.vmax - 1) / info.vmax;
+        for (int k = 0; k < 64; ++k) {
+            int n = kJpegNaturalOrder[k];
+            comp.dequant[n] = info.quant[comp.tq][k] * aan[n >> 3] * aan[n & 7] / 8.0f;
+        }
+        comp.planeStride = static_cast<size_t>(info.mcusX) * comp.h * 8;
+        comp.planeRows = info.mcusY * comp.v * 8;
+    }
+    return true;
+}
+
+void decodeBlock(BitReader& br, const JpegInfo& info, const Component& comp, int& pred, uint8_t* dst, size_t stride) {
+    float coef[64] = {};
+    int t = br.decode(info.dc[comp.td]);
+    // Категории из таблицы файла: больше 11 (DC) и 10 (AC) в baseline не бывает,
+    // а сдвиги на 16+ бит в receive/extend — неопределённое поведение
+    if (t > 11) {
+        br.fail();
+        return;
+    }
+    if (t) pred += extend(br.receive(t), t);
+    coef[0] = pred * comp.dequant[0];
+    const HuffDecoder& ac = info.ac[comp.ta];
+    for (int k = 1; k < 64;) {
+        int rs = br.decode(ac);
+        int r = rs >> 4, s = rs & 15;
+        if (s > 10) {
+            br.fail();
+            return;
+        }
+        if (s) {
+            k += r;
+            if (k > 63) break;
+            int n = kJpegNaturalOrder[k];
+            coef[n] = extend(br.receive(s), s) * comp.dequant[n];
+            ++k;
+        } else {
+            if (r != 15) break;   // EOB
+            k += 16;
+        }
+    }
+    float ws[64];
+    for (int c = 0; c < 8; ++c) inverseDct8(coef + c, 8, ws + c, 8);
+    for (int r = 0; r < 8; ++r) {
+        float row[8];
+        inverseDct8(ws + r * 8, 1, row, 1);
+        for (int c = 0; c < 8; ++c) {
+            int v = static_cast<int>(row[c] + 128.5f);
+            dst[r * stride + c] = static_cast<uint8_t>(std::clamp(v, 0, 255));
+        }
+    }
+}
+
+// MCU [mcuBegin, mcuEnd) в растровом порядке, начиная с позиции p (сразу после RST)
+bool decodeMcus(JpegInfo& info, const uint8_t* p, long long mcuBegin, long long mcuEnd) {
+    BitReader br(p, info.end);
+    int pred[3] = { 0, 0, 0 };
+    for (long long m = mcuBegin; m < mcuEnd; ++m) {
+        int mx = static_cast<int>(m % info.mcusX);
+        int my = static_cast<int>(m / info.mcusX);
+        for (int c = 0; c < info.ncomp; ++c) {
+            Component& comp = info.comps[c];
+            for (int by = 0; by < comp.v; ++by)
+                for (int bx = 0; bx < comp.h; ++bx) {
+                    size_t y = (static_cast<size_t>(my) * comp.v + by) * 8;
+                    size_t x = (static_cast<size_t>(mx) * comp.h + bx) * 8;
+                    decodeBlock(br, info, comp, pred[c], comp.plane.data() + y * comp.planeStride + x, comp.planeStride);
+                }
+        }
+    }
+    return !br.error();
+}
+
+// Позиции начала каждого restart-интервала в энтропийных данных
+std::vector<const uint8_t*> indexIntervals(const JpegInfo& info) {
+    std::vector<const uint8_t*> starts{ info.scan };
+    const uint8_t* p = info.scan;
+    while (p + 1 < info.end) {
+        if (p[0] != 0xFF) { ++p; continue; }
+        uint8_t m = p[1];
+        if (m == 0x00 || m == 0xFF) { ++p; continue; }
+        if (m >= 0xD0 && m <= 0xD7) {
+            starts.push_back(p + 2);
+            p += 2;
+            continue;
+        }
+        break;   // EOI или следующий сегмент
+    }
+    return starts;
+}
+
+// Повышение разрешения цветности (билинейно, центры отсчётов как в libjpeg) и YCbCr → RGB
+void convertRows(const JpegInfo& info, Image& out, int rowBegin, int rowEnd) {
+    const int W = info.width;
+    struct Axis { std::vector<int> i0, i1; std::vector<float> w; };
+    auto makeAxis = [](int n, int factor, int limit) {
+        Axis a;
+        a.i0.resize(n); a.i1.resize(n); a.w.resize(n);
+        for (int x = 0; x < n; ++x) {
+            float c = (x + 0.5f) / factor - 0.5f;
+            int i = static_cast<int>(std::floor(c));
+            float f = c - i;
+            a.i0[x] = std::clamp(i, 0, limit - 1);
+            a.i1[x] = std::clamp(i + 1, 0, limit - 1);
+            a.w[x] = f;
+        }
+        return a;
+    };
+
+    const size_t stride = static_cast<size_t>(W) * 3;
+    if (info.ncomp == 1) {
+        const Component& y = info.comps[0];
+        for (int row = rowBegin; row < rowEnd; ++row) {
+            const uint8_t* src = y.plane.data() + row * y.planeStride;
+            uint8_t* dst = out.data.data() + row * stride;
+            for (int x = 0; x < W; ++x) dst[x * 3] = dst[x * 3 + 1] = dst[x * 3 + 2] = src[x];
+        }
+        return;
+    }
+
+    Axis ax[3];
+    for (int c = 0; c < 3; ++c) {
+        const Component& comp = info.comps[c];
+        ax[c] = makeAxis(W, info.hmax / comp.h, comp.width);
+    }
+    std::vector<float> line[3];
+    for (int c = 0; c < 3; ++c) line[c].resize(W);
+
+    for (int row = rowBegin; row < rowEnd; ++row) {
+        for (int c = 0; c < 3; ++c) {
+            const Component& comp = info.comps[c];
+            int fy = info.vmax / comp.v;
+            if (fy == 1 && info.hmax == comp.h) {
+                const uint8_t* src = comp.plane.data() + row * comp.planeStride;
+                for (int x = 0; x < W; ++x) line[c][x] = src[x];
+                continue;
+            }
+            float cy = (row + 0.5f) / fy - 0.5f;
+            int iy = static_cast<int>(std::floor(cy));
+            float wy = cy - iy;
+            const uint8_t* r0 = comp.plane.data() + std::clamp(iy, 0, comp.height - 1) * comp.planeStride;
+            const uint8_t* r1 = comp.plane.data() + std::clamp(iy + 1, 0, comp.height - 1) * comp.planeStride;
+            const Axis& a = ax[c];
+            for (int x = 0; x < W; ++x) {
+                float top = r0[a.i0[x]] + (r0[a.i1[x]] - r0[a.i0[x]]) * a.w[x];
+                float bot = r1[a.i0[x]] + (r1[a.i1[x]] - r1[a.i0[x]]) * a.w[x];
+                line[c][x] = top + (bot - top) * wy;
+            }
+        }
+        uint8_t* dst = out.data.data() + row * stride;
+        for (int x = 0; x < W; ++x) {
+            float Y = line[0][x], cb = line[1][x], cr = line[2][x];
+            float r, g, b;
+            if (info.rgb) {
+                r = Y; g = cb; b = cr;
+            } else {
+                cb -= 128.0f; cr -= 128.0f;
+                r = Y + 1.402f * cr;
+                g = Y - 0.344136f * cb - 0.714136f * cr;
+                b = Y + 1.772f * cb;
+            }
+            dst[x * 3 + 0] = static_cast<uint8_t>(std::clamp(static_cast<int>(r + 0.5f), 0, 255));
+            dst[x * 3 + 1] = static_cast<uint8_t>(std::clamp(static_cast<int>(g + 0.5f), 0, 255));
+            dst[x * 3 + 2] = static_cast<uint8_t>(std::clamp(static_cast<int>(b + 0.5f), 0, 255));
+        }
+    }
+}
+
+} // namespace
+
+bool jpegHasRestartMarkers(const unsigned char* data, size_t size) {
+    JpegInfo info;
+    return parseHeaders(data, size, info) && info.restartInterval > 0;
+}
+
+bool decodeJpeg(const unsigned char* data, size_t size, Image& out, const CancelToken* cancel) {
+    JpegInfo info;
+    if (!parseHeaders(data, size, info) || !prepare(info)) return false;
+    for (int c = 0; c < info.ncomp; ++c) {
+        Component& comp = info.comps[c];
+        comp.plane.resize(comp.planeStride * comp.planeRows);
+    }
+
+    auto& pool = ThreadPool::instance();
+    const long long totalMcus = static_cast<long long>(info.mcusX) * info.mcusY;
+    bool ok = true;
+    if (info.restartInterval > 0) {
+        // Интервалы независимы: предсказатели DC сбрасываются на каждом RST
+        std::vector<const uint8_t*> starts = indexIntervals(info);
+        const long long intervals = (totalMcus + info.restartInterval - 1) / info.restartInterval;
+        if (static_cast<long long>(starts.size()) < intervals) return false;
+        const size_t tasks = std::min<size_t>(static_cast<size_t>(intervals), (pool.size() + 1) * 4);
+        std::vector<char> results(tasks, 1);
+        pool.parallelFor(tasks, [&](size_t t) {
+            long long first = intervals * static_cast<long long>(t) / static_cast<long long>(tasks);
+            long long last = intervals * static_cast<long long>(t + 1) / static_cast<long long>(tasks);
+            for (long long i = first; i < last && results[t]; ++i) {
+                if (cancel && cancel->cancelled()) {
+                    results[t] = 0;
+                    break;
+                }
+                long long begin = i * info.restartInterval;
+                long long end = std::min(totalMcus, begin + info.restartInterval);
+                results[t] = decodeMcus(info, starts[static_cast<size_t>(i)], begin, end);
+            }
+        });
+        ok = std::all_of(results.begin(), results.end(), [](char r) { return r != 0; });
+    } else {
+        ok = decodeMcus(info, info.scan, 0, totalMcus);
+    }
+    if (!ok) return false;
+
+    out.width = info.width;
+    out.height = info.height;
+    out.channels = 3;
+    out.data.allocate(static_cast<size_t>(info.width) * info.height * 3);
+    const int bands = static_cast<int>(std::min<size_t>(static_cast<size_t>(info.height), (pool.size() + 1) * 4));
+    pool.parallelFor(static_cast<size_t>(bands), [&](size_t b) {
+        int rowBegin = static_cast<int>(static_cast<long long>(info.height) * b / bands);
+        int rowEnd = static_cast<int>(static_cast<long long>(info.height) * (b + 1) / bands);
+        convertRows(info, out, rowBegin, rowEnd);
+    });
+    return true;
+}
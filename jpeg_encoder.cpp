@@ -0,0 +1,536 @@
+#include "jpeg_codec.hpp"
+#include "cancel_token.hpp"
+#include "thread_pool.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+const size_t kBandBytes = 256 * 1024;   // пикселей в полосе скана без restart-маркеров
+
+// Стандартные таблицы квантования (ITU T.81, Annex K), естественный порядок
+const unsigned char kLumaQuant[64] = {
+    16, 11, 10, 16,  24,  40,  51,  61,  12, 12, 14, 19,  26,  58,  60,  55,
+    14, 13, 16, 24,  40,  57,  69,  56,  14, 17, 22, 29,  51,  87,  80,  62,
+    18, 22, 37, 56,  68, 109, 103,  77,  24, 35, 55, 64,  81, 104, 113,  92,
+    49, 64, 78, 87, 103, 121, 120, 101,  72, 92, 95, 98, 112, 100, 103,  99
+};
+const unsigned char kChromaQuant[64] = {
+    17, 18, 24, 47, 99, 99, 99, 99,  18, 21, 26, 66, 99, 99, 99, 99,
+    24, 26, 56, 99, 99, 99, 99, 99,  47, 66, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,  99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,  99, 99, 99, 99, 99, 99, 99, 99
+};
+
+// Стандартные таблицы Хаффмана (Annex K.3): число кодов длины 1..16 и символы
+const unsigned char kDcLumaBits[16]   = { 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 };
+const unsigned char kDcChromaBits[16] = { 0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0 };
+const unsigned char kDcVals[12]       = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+
+const unsigned char kAcLumaBits[16] = { 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d };
+const unsigned char kAcLumaVals[162] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+    0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+    0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+    0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+    0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+    0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa
+};
+
+const unsigned char kAcChromaBits[16] = { 0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77 };
+const unsigned char kAcChromaVals[162] = {
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+    0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+    0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+    0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+    0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+    0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+    0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+    0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+    0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+    0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa
+};
+
+struct HuffCode {
+    uint16_t code = 0;
+    uint8_t length = 0;
+};
+
+struct HuffTable {
+    HuffCode codes[256];
+
+    HuffTable(const unsigned char* bits, const unsigned char* vals) {
+        int code = 0, k = 0;
+        for (int len = 1; len <= 16; ++len) {
+            for (int i = 0; i < bits[len - 1]; ++i, ++k) {
+                codes[vals[k]].code = static_cast<uint16_t>(code++);
+                codes[vals[k]].length = static_cast<uint8_t>(len);
+            }
+            code <<= 1;
+        }
+    }
+};
+
+const HuffTable& dcLuma()   { static const HuffTable t(kDcLumaBits, kDcVals);         return t; }
+const HuffTable& dcChroma() { static const HuffTable t(kDcChromaBits, kDcVals);       return t; }
+const HuffTable& acLuma()   { static const HuffTable t(kAcLumaBits, kAcLumaVals);     return t; }
+const HuffTable& acChroma() { static const HuffTable t(kAcChromaBits, kAcChromaVals); return t; }
+
+// Запись энтропийных данных с байт-стаффингом (0xFF → 0xFF 0x00)
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<unsigned char>& out) : out_(out) {}
+
+    void put(uint32_t bits, int length) {
+        acc_ = (acc_ << length) | bits;
+        count_ += length;
+        while (count_ >= 8) {
+            unsigned char b = static_cast<unsigned char>(acc_ >> (count_ - 8));
+            out_.push_back(b);
+            if (b == 0xFF) out_.push_back(0);
+            count_ -= 8;
+        }
+        acc_ &= (1u << count_) - 1;
+    }
+
+    // Добиваем байт единицами — перед restart-маркером и в конце скана
+    void flush() {
+        if (count_ > 0) put((1u << (8 - count_)) - 1, 8 - count_);
+    }
+
+    void marker(unsigned char code) {
+        out_.push_back(0xFF);
+        out_.push_back(code);
+    }
+
+private:
+    std::vector<unsigned char>& out_;
+    uint32_t acc_ = 0;
+    int count_ = 0;
+};
+
+// Прямое DCT по схеме AAN (как jfdctflt.c); масштаб учтён в таблице квантования
+void forwardDct8(float* d, int stride) {
+    float tmp0 = d[0] + d[7 * stride], tmp7 = d[0] - d[7 * stride];
+    float tmp1 = d[stride] + d[6 * stride], tmp6 = d[stride] - d[6 * stride];
+    float tmp2 = d[2 * stride] + d[5 * stride], tmp5 = d[2 * stride] - d[5 * stride];
+    float tmp3 = d[3 * stride] + d[4 * stride], tmp4 = d[3 * stride] - d[4 * stride];
+
+    float tmp10 = tmp0 + tmp3, tmp13 = tmp0 - tmp3;
+    float tmp11 = tmp1 + tmp2, tmp12 = tmp1 - tmp2;
+    d[0] = tmp10 + tmp11;
+    d[4 * stride] = tmp10 - tmp11;
+    float z1 = (tmp12 + tmp13) * 0.707106781f;
+    d[2 * stride] = tmp13 + z1;
+    d[6 * stride] = tmp13 - z1;
+
+    tmp10 = tmp4 + tmp5;
+    tmp11 = tmp5 + tmp6;
+    tmp12 = tmp6 + tmp7;
+    float z5 = (tmp10 - tmp12) * 0.382683433f;
+    float z2 = 0.541196100f * tmp10 + z5;
+    float z4 = 1.306562965f * tmp12 + z5;
+    float z3 = tmp11 * 0.707106781f;
+    float z11 = tmp7 + z3, z13 = tmp7 - z3;
+    d[5 * stride] = z13 + z2;
+    d[3 * stride] = z13 - z2;
+    d[stride] = z11 + z4;
+    d[7 * stride] = z11 - z4;
+}
+
+struct Component {
+    const HuffTable* dc;
+    const HuffTable* ac;
+    const float* divisors;   // 1 / (q * масштаб AAN), естественный порядок
+};
+
+void encodeBlock(BitWriter& bw, float* block, const Component& comp, int& prevDc) {
+    for (int r = 0; r < 8; ++r) forwardDct8(block + r * 8, 1);
+    for (int c = 0; c < 8; ++c) forwardDct8(block + c, 8);
+
+    int q[64];
+    for (int k = 0; k < 64; ++k) {
+        int n = kJpegNaturalOrder[k];
+        float v = block[n] * comp.divisors[n];
+        q[k] = static_cast<int>(v < 0 ? v - 0.5f : v + 0.5f);
+    }
+    // При quality 100 AC может выйти за категорию 10
+    for (int k = 1; k < 64; ++k) q[k] = std::clamp(q[k], -1023, 1023);
+
+    auto category = [](int v) {
+        unsigned a = static_cast<unsigned>(v < 0 ? -v : v);
+        int n = 0;
+        while (a) { ++n; a >>= 1; }
+        return n;
+    };
+    auto emitValue = [&](int v, int n) {
+        if (n) bw.put(static_cast<uint32_t>(v < 0 ? v - 1 : v) & ((1u << n) - 1), n);
+    };
+
+    int diff = q[0] - prevDc;
+    prevDc = q[0];
+    int n = category(diff);
+    bw.put(comp.dc->codes[n].code, comp.dc->codes[n].length);
+    emitValue(diff, n);
+
+    int run = 0;
+    for (int k = 1; k < 64; ++k) {
+        if (q[k] == 0) { ++run; continue; }
+        while (run > 15) {
+            bw.put(comp.ac->codes[0xF0].code, comp.ac->codes[0xF0].length);
+            run -= 16;
+        }
+        n = category(q[k]);
+        const HuffCode& hc = comp.ac->codes[(run << 4) | n];
+        bw.put(hc.code, hc.length);
+        emitValue(q[k], n);
+        run = 0;
+    }
+    if (run > 0) bw.put(comp.ac->codes[0x00].code, comp.ac->codes[0x00].length);
+}
+
+void scaleQuant(const unsigned char* base, int quality, unsigned char* out) {
+    int scale = quality < 50 ? 5000 / quality : 200 - quality * 2;
+    for (int i = 0; i < 64; ++i)
+        out[i] = static_cast<unsigned char>(std::clamp((base[i] * scale + 50) / 100, 1, 255));
+}
+
+void buildDivisors(const unsigned char* quant, float* out) {
+    static const float aan[8] = { 1.0f, 1.387039845f, 1.306562965f, 1.175875602f,
+                                  1.0f, 0.785694958f, 0.541196100f, 0.275899379f };
+    for (int r = 0; r < 8; ++r)
+        for (int c = 0; c < 8; ++c)
+            out[r * 8 + c] = 1.0f / (quant[r * 8 + c] * aan[r] * aan[c] * 8.0f);
+}
+
+struct EncoderSetup {
+    int width, height;      // пиксели RGB, 3 байта на пиксель
+    int hY, vY;             // факторы дискретизации яркости
+    int mcuW, mcuH;
+    int mcusX, mcusY;
+    int restartRows;        // 0 — без restart-маркеров
+    unsigned char lumaQ[64], chromaQ[64];
+    float lumaDiv[64], chromaDiv[64];
+    Component comps[3];     // ссылаются на собственные таблицы, поэтому не копируется
+
+    EncoderSetup() = default;
+    EncoderSetup(const EncoderSetup&) = delete;
+    EncoderSetup& operator=(const EncoderSetup&) = delete;
+};
+
+// Кодирование MCU-строк [rowBegin, rowEnd); pixels — пиксельная строка rowBegin * mcuH.
+// bw и prevDc продолжают скан между вызовами; с restart-маркерами rowBegin кратен restartRows
+void encodeRows(const EncoderSetup& s, const unsigned char* pixels, int rowBegin, int rowEnd,
+                BitWriter& bw, int prevDc[3]) {
+    const size_t stride = static_cast<size_t>(s.width) * 3;
+    const int firstRow = rowBegin * s.mcuH;
+    std::vector<float> ycc(static_cast<size_t>(s.mcuW) * s.mcuH * 3);
+    float block[64];
+
+    for (int my = rowBegin; my < rowEnd; ++my) {
+        // Маркер перед интервалом m имеет номер RST((m - 1) mod 8); в начале полосы flush ничего не пишет
+        if (s.restartRows && my % s.restartRows == 0 && my > 0) {
+            bw.flush();
+            bw.marker(static_cast<unsigned char>(0xD0 + ((my / s.restartRows - 1) & 7)));
+            prevDc[0] = prevDc[1] = prevDc[2] = 0;
+        }
+        for (int mx = 0; mx < s.mcusX; ++mx) {
+            // RGB → YCbCr со сдвигом уровня; края дублируются
+            for (int py = 0; py < s.mcuH; ++py) {
+                int y = std::min(my * s.mcuH + py, s.height - 1);
+                const unsigned char* row = pixels + static_cast<size_t>(y - firstRow) * stride;
+                for (int px = 0; px < s.mcuW; ++px) {
+                    int x = std::min(mx * s.mcuW + px, s.width - 1);
+                    const unsigned char* p = row + static_cast<size_t>(x) * 3;
+                    float r = p[0], g = p[1], b = p[2];
+                    float* o = &ycc[(static_cast<size_t>(py) * s.mcuW + px) * 3];
+                    o[0] = 0.29900f * r + 0.58700f * g + 0.11400f * b - 128.0f;
+                    o[1] = -0.16874f * r - 0.33126f * g + 0.50000f * b;
+                    o[2] = 0.50000f * r - 0.41869f * g - 0.08131f * b;
+                }
+            }
+            for (int by = 0; by < s.vY; ++by)
+                for (int bx = 0; bx < s.hY; ++bx) {
+                    for (int i = 0; i < 8; ++i)
+                        for (int j = 0; j < 8; ++j)
+                            block[i * 8 + j] = ycc[((static_cast<size_t>(by) * 8 + i) * s.mcuW + bx * 8 + j) * 3];
+                    encodeBlock(bw, block, s.comps[0], prevDc[0]);
+                }
+            // Цветность усредняется по hY×vY пикселям
+            const float norm = 1.0f / (s.hY * s.vY);
+            for (int c = 1; c < 3; ++c) {
+                for (int i = 0; i < 8; ++i)
+                    for (int j = 0; j < 8; ++j) {
+                        float sum = 0.0f;
+                        for (int dy = 0; dy < s.vY; ++dy)
+                            for (int dx = 0; dx < s.hY; ++dx)
+                                sum += ycc[((static_cast<size_t>(i) * s.vY + dy) * s.mcuW + j * s.hY + dx) * 3 + c];
+                        block[i * 8 + j] = sum * norm;
+                    }
+                encodeBlock(bw, block, s.comps[c], prevDc[c]);
+            }
+        }
+    }
+}
+
+void put16(std::vector<unsigned char>& out, int v) {
+    out.push_back(static_cast<unsigned char>(v >> 8));
+    out.push_back(static_cast<unsigned char>(v & 0xFF));
+}
+
+void writeHuffman(std::vector<unsigned char>& out, int classId, const unsigned char* bits, const unsigned char* vals) {
+    out.push_back(static_cast<unsigned char>(classId));
+    int count = 0;
+    for (int i = 0; i < 16; ++i) {
+        out.push_back(bits[i]);
+        count += bits[i];
+    }
+    out.insert(out.end(), vals, vals + count);
+}
+
+// Параметры кодирования: таблицы, MCU, restart-интервал (restartRows < 0 — авто для целого изображения)
+bool setupEncoder(int width, int height, const EncodeOptions& options, EncoderSetup& s) {
+    if (width <= 0 || height <= 0 || width > 65535 || height > 65535) return false;
+
+    const int quality = std::clamp(options.quality, 1, 100);
+    const int subsampling = jpegSubsampling(options);
+
+    s.width = width;
+    s.height = height;
+    s.hY = subsampling == 444 ? 1 : 2;
+    s.vY = subsampling == 420 ? 2 : 1;
+    s.mcuW = 8 * s.hY;
+    s.mcuH = 8 * s.vY;
+    s.mcusX = (width + s.mcuW - 1) / s.mcuW;
+    s.mcusY = (height + s.mcuH - 1) / s.mcuH;
+
+    const int threads = static_cast<int>(ThreadPool::instance().size()) + 1;
+    s.restartRows = options.restartRows;
+    if (s.restartRows < 0) {
+        // Авто: маркеры только там, где есть что распараллеливать (> 1 МП, как в processImageParallel)
+        bool big = static_cast<long long>(width) * height > 1000000;
+        s.restartRows = (big && threads > 1) ? std::max(1, s.mcusY / (threads * 4)) : 0;
+    }
+    // DRI хранит интервал в MCU 16-битным числом
+    if (s.restartRows > 0) s.restartRows = std::min(s.restartRows, std::max(1, 65535 / s.mcusX));
+
+    scaleQuant(kLumaQuant, quality, s.lumaQ);
+    scaleQuant(kChromaQuant, quality, s.chromaQ);
+    buildDivisors(s.lumaQ, s.lumaDiv);
+    buildDivisors(s.chromaQ, s.chromaDiv);
+    s.comps[0] = { &dcLuma(), &acLuma(), s.lumaDiv };
+    s.comps[1] = { &dcChroma(), &acChroma(), s.chromaDiv };
+    s.comps[2] = s.comps[1];
+    return true;
+}
+
+// SOI … SOS
+std::vector<unsigned char> buildHeader(const EncoderSetup& s) {
+    std::vector<unsigned char> header;
+    const unsigned char soiApp0[] = { 0xFF, 0xD8, 0xFF, 0xE0, 0, 16, 'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0 };
+    header.insert(header.end(), soiApp0, soiApp0 + sizeof(soiApp0));
+
+    header.push_back(0xFF); header.push_back(0xDB);
+    put16(header, 2 + 2 * 65);
+    header.push_back(0x00);
+    for (int k = 0; k < 64; ++k) header.push_back(s.lumaQ[kJpegNaturalOrder[k]]);
+    header.push_back(0x01);
+    for (int k = 0; k < 64; ++k) header.push_back(s.chromaQ[kJpegNaturalOrder[k]]);
+
+    header.push_back(0xFF); header.push_back(0xC0);
+    put16(header, 17);
+    header.push_back(8);
+    put16(header, s.height);
+    put16(header, s.width);
+    header.push_back(3);
+    const unsigned char comps[] = { 1, static_cast<unsigned char>((s.hY << 4) | s.vY), 0, 2, 0x11, 1, 3, 0x11, 1 };
+    header.insert(header.end(), comps, comps + sizeof(comps));
+
+    header.push_back(0xFF); header.push_back(0xC4);
+    put16(header, 2 + 4 * 17 + 12 + 162 + 12 + 162);
+    writeHuffman(header, 0x00, kDcLumaBits, kDcVals);
+    writeHuffman(header, 0x10, kAcLumaBits, kAcLumaVals);
+    writeHuffman(header, 0x01, kDcChromaBits, kDcVals);
+    writeHuffman(header, 0x11, kAcChromaBits, kAcChromaVals);
+
+    if (s.restartRows > 0) {
+        header.push_back(0xFF); header.push_back(0xDD);
+        put16(header, 4);
+        put16(header, s.restartRows * s.mcusX);
+    }
+
+    const unsigned char sos[] = { 0xFF, 0xDA, 0, 12, 3, 1, 0x00, 2, 0x11, 3, 0x11, 0, 63, 0 };
+    header.insert(header.end(), sos, sos + sizeof(sos));
+    return header;
+}
+
+// MCU-строки [rowBegin, rowEnd) из целого числа restart-интервалов: pieces полос, пачками
+// по (воркеры + 1) * 2 параллельно; пачка пишется сразу, отмена — перед каждой полосой
+bool encodeIntervals(const EncoderSetup& s, const unsigned char* pixels, int rowBegin, int rowEnd,
+                     int pieces, ByteSink& sink, const CancelToken* cancel) {
+    const size_t stride = static_cast<size_t>(s.width) * 3;
+    const int intervals = (rowEnd - rowBegin + s.restartRows - 1) / s.restartRows;
+    const int perStrip = std::max(1, (intervals + pieces - 1) / pieces);
+    const int strips = (intervals + perStrip - 1) / perStrip;
+    const int batch = static_cast<int>(ThreadPool::instance().size() + 1) * 2;
+    std::vector<std::vector<unsigned char>> parts;
+    for (int first = 0; first < strips; first += batch) {
+        parts.assign(static_cast<size_t>(std::min(batch, strips - first)), {});
+        ThreadPool::instance().parallelFor(parts.size(), [&](size_t i) {
+            if (cancel && cancel->cancelled()) return;
+            const int strip = first + static_cast<int>(i);
+            TraceScope trace("Encode strip", "codec", "strip", strip);
+            int begin = rowBegin + strip * perStrip * s.restartRows;
+            int end = std::min(rowEnd, begin + perStrip * s.restartRows);
+            BitWriter bw(parts[i]);
+            int prevDc[3] = { 0, 0, 0 };
+            encodeRows(s, pixels + static_cast<size_t>(begin - rowBegin) * s.mcuH * stride, begin, end, bw, prevDc);
+            bw.flush();
+        });
+        if (cancel && cancel->cancelled()) return false;
+        for (const auto& part : parts)
+            if (!sink.write(part.data(), part.size())) return false;
+    }
+    return true;
+}
+
+// Скан без restart-маркеров: последовательно, полосами примерно по kBandBytes пикселей;
+// каждая полоса пишется сразу, отмена — между полосами
+bool encodeScan(const EncoderSetup& s, const unsigned char* pixels, ByteSink& sink, const CancelToken* cancel) {
+    const size_t stride = static_cast<size_t>(s.width) * 3;
+    const int bandRows = static_cast<int>(std::max<size_t>(1, kBandBytes / (stride * s.mcuH)));
+    std::vector<unsigned char> scan;
+    BitWriter bw(scan);
+    int prevDc[3] = { 0, 0, 0 };
+    for (int row = 0; row < s.mcusY; row += bandRows) {
+        if (cancel && cancel->cancelled()) return false;
+        TraceScope trace("Encode strip", "codec", "row", row);
+        encodeRows(s, pixels + static_cast<size_t>(row) * s.mcuH * stride, row, std::min(s.mcusY, row + bandRows), bw, prevDc);
+        if (!sink.write(scan.data(), scan.size())) return false;
+        scan.clear();   // неполный байт остаётся в bw
+    }
+    bw.flush();
+    return sink.write(scan.data(), scan.size());
+}
+
+// Потоковая запись: строки копятся до полосы MCU-строк и сразу кодируются,
+// в памяти только одна полоса. С restart-маркерами полоса — несколько интервалов
+// на пул, без них — одна MCU-строка, скан продолжается между полосами.
+class JpegRowWriter : public RowWriter {
+public:
+    explicit JpegRowWriter(ByteSink& sink) : sink_(sink), bw_(scan_) {}
+
+    bool init(int width, int height, const EncodeOptions& options) {
+        EncodeOptions o = options;
+        const int threads = static_cast<int>(ThreadPool::instance().size()) + 1;
+        // Авто-интервал для целого изображения рассчитан на весь кадр в памяти;
+        // здесь — по MCU-строке на интервал, полоса из threads * 2 интервалов
+        if (o.restartRows < 0) o.restartRows = threads > 1 ? 1 : 0;
+        if (!setupEncoder(width, height, o, s_)) return false;
+        cancel_ = options.cancel;
+        pieces_ = threads * 2;
+        bandRows_ = s_.restartRows > 0 ? s_.restartRows * pieces_ : 1;
+        band_.allocate(static_cast<size_t>(bandRows_) * s_.mcuH * s_.width * 3);
+        return true;
+    }
+
+    bool write(const unsigned char* rows, int count) override {
+        if (!started_ && !start()) return false;
+        const size_t stride = static_cast<size_t>(s_.width) * 3;
+        while (count > 0) {
+            const int bandHeight = std::min(bandRows_ * s_.mcuH, s_.height - mcuRow_ * s_.mcuH);
+            if (bandHeight <= 0) return false;   // строк больше, чем height
+            const int n = std::min(count, bandHeight - filled_);
+            std::memcpy(band_.data() + static_cast<size_t>(filled_) * stride, rows, static_cast<size_t>(n) * stride);
+            rows += static_cast<size_t>(n) * stride;
+            count -= n;
+            filled_ += n;
+            if (filled_ == bandHeight && !flushBand()) return false;
+        }
+        return true;
+    }
+
+    bool finish() override {
+        if (!started_ && !start()) return false;
+        if (mcuRow_ < s_.mcusY) return false;
+        if (s_.restartRows == 0) {
+            bw_.flush();
+            if (!sink_.write(scan_.data(), scan_.size())) return false;
+        }
+        const unsigned char eoi[] = { 0xFF, 0xD9 };
+        return sink_.write(eoi, sizeof(eoi));
+    }
+
+private:
+    bool start() {
+        started_ = true;
+        std::vector<unsigned char> header = buildHeader(s_);
+        return sink_.write(header.data(), header.size());
+    }
+
+    bool flushBand() {
+        const int rowEnd = std::min(s_.mcusY, mcuRow_ + bandRows_);
+        bool ok;
+        if (s_.restartRows > 0) {
+            ok = encodeIntervals(s_, band_.data(), mcuRow_, rowEnd, pieces_, sink_, cancel_);
+        } else {
+            if (cancel_ && cancel_->cancelled()) return false;
+            TraceScope trace("Encode strip", "codec", "row", mcuRow_);
+            encodeRows(s_, band_.data(), mcuRow_, rowEnd, bw_, prevDc_);
+            ok = sink_.write(scan_.data(), scan_.size());
+            scan_.clear();   // неполный байт остаётся в bw_
+        }
+        mcuRow_ = rowEnd;
+        filled_ = 0;
+        return ok;
+    }
+
+    ByteSink& sink_;
+    EncoderSetup s_;
+    const CancelToken* cancel_ = nullptr;
+    std::vector<unsigned char> scan_;
+    BitWriter bw_;
+    int prevDc_[3] = { 0, 0, 0 };
+    PixelBuffer band_;
+    int pieces_ = 1;
+    int bandRows_ = 1;       // MCU-строк в полосе
+    int mcuRow_ = 0;         // первая MCU-строка текущей полосы
+    int filled_ = 0;         // пиксельных строк полосы уже получено
+    bool started_ = false;
+};
+
+} // namespace
+
+bool encodeJpeg(const Image& img, const EncodeOptions& options, ByteSink& sink) {
+    EncoderSetup s;
+    if (!img.valid() || !setupEncoder(img.width, img.height, options, s)) return false;
+
+    std::vector<unsigned char> header = buildHeader(s);
+    if (!sink.write(header.data(), header.size())) return false;
+
+    // ── Энтропийные данные: полосы из целого числа restart-интервалов ──
+    if (s.restartRows == 0) {
+        if (!encodeScan(s, img.data.data(), sink, options.cancel)) return false;
+    } else {
+        const int threads = static_cast<int>(ThreadPool::instance().size()) + 1;
+        if (!encodeIntervals(s, img.data.data(), 0, s.mcusY, threads * 4, sink, options.cancel)) return false;
+    }
+
+    const unsigned char eoi[] = { 0xFF, 0xD9 };
+    return sink.write(eoi, sizeof(eoi));
+}
+
+std::unique_ptr<RowWriter> openJpegWriter(int width, int height, const EncodeOptions& options, ByteSink& sink) {
+    auto writer = std::make_unique<JpegRowWriter>(sink);
+    if (!writer->init(width, height, options)) return nullptr;
+    return writer;
+}
@@ -0,0 +1,173 @@
+#include "logger.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace {
+thread_local bool t_loggerThread = false;   // flush из колбэка логгера не ждёт сам себя
+}
+
+AsyncLogger& AsyncLogger::instance() {
+    static AsyncLogger* logger = new AsyncLogger;
+    return *logger;
+}
+
+AsyncLogger::AsyncLogger() : slots_(new Slot[kCapacity]) {
+    for (size_t i = 0; i < kCapacity; ++i) slots_[i].seq.store(i, std::memory_order_relaxed);
+    start();
+}
+
+AsyncLogger::~AsyncLogger() {
+    shutdown();
+}
+
+void AsyncLogger::start() {
+    std::lock_guard<std::mutex> life(lifeMutex_);
+    if (running_.load(std::memory_order_relaxed)) return;
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        stop_ = false;
+    }
+    worker_ = std::thread(&AsyncLogger::run, this);
+    running_.store(true, std::memory_order_release);
+}
+
+void AsyncLogger::shutdown() {
+    std::lock_guard<std::mutex> life(lifeMutex_);
+    if (!running_.load(std::memory_order_relaxed)) return;
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    worker_.join();
+    running_.store(false, std::memory_order_release);
+}
+
+bool AsyncLogger::passRateLimit(int level) {
+    const unsigned limit = rateLimit_.load(std::memory_order_relaxed);
+    if (limit == 0 || level == kLogError) return true;
+    const int64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    int64_t window = rateWindow_.load(std::memory_order_relaxed);
+    if (window != now && rateWindow_.compare_exchange_strong(window, now, std::memory_order_relaxed)) {
+        rateCount_.store(0, std::memory_order_relaxed);
+    }
+    if (rateCount_.fetch_add(1, std::memory_order_relaxed) >= limit) {
+        droppedRate_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+void AsyncLogger::log(int level, const std::string& text, LogSinkFn callback, void* userData) {
+    if (!enabled(level) || !passRateLimit(level)) return;
+    // Захват позиции: слот свободен, когда его seq равен позиции
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    Slot* slot;
+    for (;;) {
+        slot = &slots_[pos & (kCapacity - 1)];
+        const size_t seq = slot->seq.load(std::memory_order_acquire);
+        const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            droppedFull_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            pos = tail_.load(std::memory_order_relaxed);
+        }
+    }
+    slot->level = level;
+    slot->callback = callback;
+    slot->userData = userData;
+    slot->size = static_cast<uint32_t>(std::min(text.size(), kMaxText));
+    std::memcpy(slot->text, text.data(), slot->size);
+    slot->seq.store(pos + 1, std::memory_order_release);
+    if (!running_.load(std::memory_order_acquire)) start();
+    wake_.notify_one();
+}
+
+void AsyncLogger::setFile(const char* path) {
+    std::lock_guard<std::mutex> lock(fileMutex_);
+    if (file_.is_open()) file_.close();
+    if (path && *path) file_.open(path, std::ios::app);
+}
+
+void AsyncLogger::flush() {
+    if (t_loggerThread) return;
+    const size_t target = tail_.load(std::memory_order_acquire);
+    if (head_.load(std::memory_order_acquire) >= target) return;
+    if (!running_.load(std::memory_order_acquire)) start();
+    wake_.notify_one();
+    std::unique_lock<std::mutex> lock(wakeMutex_);
+    drained_.wait(lock, [&] { return head_.load(std::memory_order_acquire) >= target; });
+}
+
+LogStats AsyncLogger::stats() const {
+    LogStats s;
+    s.written = written_.load(std::memory_order_relaxed);
+    s.droppedFull = droppedFull_.load(std::memory_order_relaxed);
+    s.droppedRate = droppedRate_.load(std::memory_order_relaxed);
+    return s;
+}
+
+void AsyncLogger::write(const Slot& slot) {
+    const char* prefix = slot.level == kLogError ? "[ОШИБКА] "
+                       : slot.level == kLogWarning ? "[Предупреждение] "
+                       : slot.level == kLogDebug ? "[Отладка] " : "[Лог] ";
+    std::string line = prefix;
+    line.append(slot.text, slot.size);
+    {
+        std::lock_guard<std::mutex> lock(fileMutex_);
+        if (file_.is_open()) file_ << line << '\n';
+    }
+    if (slot.callback) {
+        try {
+            slot.callback(line.c_str(), slot.level == kLogError, slot.userData);
+        } catch (...) {
+            // Игнорируем исключения в callback
+        }
+    }
+    written_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AsyncLogger::run() {
+    t_loggerThread = true;
+    auto ready = [this] {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        return slots_[head & (kCapacity - 1)].seq.load(std::memory_order_acquire) == head + 1;
+    };
+    for (;;) {
+        bool stopping;
+        {
+            // Производители будят без блокировки, поэтому пробуждение может потеряться —
+            // таймаут ограничивает задержку вывода
+            std::unique_lock<std::mutex> lock(wakeMutex_);
+            wake_.wait_for(lock, std::chrono::milliseconds(50), [&] { return stop_ || ready(); });
+            stopping = stop_;
+        }
+        while (ready()) {
+            const size_t head = head_.load(std::memory_order_relaxed);
+            Slot& slot = slots_[head & (kCapacity - 1)];
+            write(slot);
+            slot.seq.store(head + kCapacity, std::memory_order_release);
+            head_.store(head + 1, std::memory_order_release);
+        }
+        const uint64_t dropped = droppedFull_.load(std::memory_order_relaxed) + droppedRate_.load(std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(fileMutex_);
+            if (dropped != droppedReported_ && file_.is_open()) {
+                file_ << "[Лог] Log dropped " << (dropped - droppedReported_) << " messages (queue full or rate limit)\n";
+            }
+            droppedReported_ = dropped;
+            if (file_.is_open()) file_.flush();
+        }
+        {
+            // flush проверяет head_ под wakeMutex_ — захват исключает потерю уведомления
+            std::lock_guard<std::mutex> lock(wakeMutex_);
+        }
+        drained_.notify_all();
+        if (stopping && !ready()) break;
+    }
+}
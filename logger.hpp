@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// ─────────────────────────────────────────────────────────────
+//  Асинхронный логгер: производители кладут сообщения в кольцевой
+//  буфер без блокировок (MPSC по схеме Вьюкова), фоновый поток
+//  выводит их в файл и в колбэк. При переполнении кольца или
+//  превышении лимита сообщение отбрасывается — вызывающий поток
+//  никогда не ждёт вывода.
+// ─────────────────────────────────────────────────────────────
+
+// Уровни совпадают с LTL_LOG_* в LUToolsLite.h
+enum LogLevel : int {
+    kLogError = 0,
+    kLogWarning = 1,
+    kLogInfo = 2,
+    kLogDebug = 3,
+};
+
+// Самый подробный уровень, который вообще компилируется (-DLTL_LOG_COMPILE_LEVEL=…)
+#ifndef LTL_LOG_COMPILE_LEVEL
+#define LTL_LOG_COMPILE_LEVEL 3
+#endif
+
+using LogSinkFn = void (*)(const char* message, int is_error, void* userData);
+
+struct LogStats {
+    uint64_t written = 0;          // выведено
+    uint64_t droppedFull = 0;      // кольцо переполнено
+    uint64_t droppedRate = 0;      // сверх лимита сообщений в секунду
+};
+
+class AsyncLogger {
+public:
+    // Объект не уничтожается: join в статическом деструкторе DLL под loader lock
+    // Windows зависает. Поток останавливает shutdown (LUTools_Cleanup).
+    static AsyncLogger& instance();
+    ~AsyncLogger();
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+    static constexpr size_t kCapacity = 1024;      // степень двойки
+    static constexpr size_t kMaxText = 480;        // длиннее — обрезается
+
+    // Проверять до форматирования сообщения: отключённые уровни ничего не стоят
+    bool enabled(int level) const {
+        return level <= LTL_LOG_COMPILE_LEVEL && level <= level_.load(std::memory_order_relaxed);
+    }
+
+    // Не блокируется. callback/userData снимаются в момент вызова и вызываются
+    // из фонового потока.
+    void log(int level, const std::string& text, LogSinkFn callback, void* userData);
+
+    void setLevel(int level) { level_.store(level, std::memory_order_relaxed); }
+    // nullptr или "" — без файла
+    void setFile(const char* path);
+    // Не больше perSecond сообщений в секунду (ошибки не ограничиваются); 0 — без лимита
+    void setRateLimit(unsigned perSecond) { rateLimit_.store(perSecond, std::memory_order_relaxed); }
+    // Ждёт, пока фоновый поток выведет всё, что поставлено до вызова
+    void flush();
+    // Выводит очередь и останавливает фоновый поток; следующее сообщение запустит его снова
+    void shutdown();
+    LogStats stats() const;
+
+private:
+    struct Slot {
+        std::atomic<size_t> seq{0};
+        int level = 0;
+        LogSinkFn callback = nullptr;
+        void* userData = nullptr;
+        uint32_t size = 0;
+        char text[kMaxText];
+    };
+
+    AsyncLogger();
+    void start();
+    void run();
+    void write(const Slot& slot);
+    bool passRateLimit(int level);
+
+    std::unique_ptr<Slot[]> slots_;
+    alignas(64) std::atomic<size_t> tail_{0};      // следующая позиция записи
+    alignas(64) std::atomic<size_t> head_{0};      // следующая позиция вывода (только фон)
+    std::atomic<int> level_{kLogInfo};
+    std::atomic<unsigned> rateLimit_{0};
+    std::atomic<int64_t> rateWindow_{0};           // секунда текущего окна
+    std::atomic<unsigned> rateCount_{0};
+    std::atomic<uint64_t> written_{0};
+    std::atomic<uint64_t> droppedFull_{0};
+    std::atomic<uint64_t> droppedRate_{0};
+    uint64_t droppedReported_ = 0;                 // только фон
+
+    std::mutex fileMutex_;                         // файл меняется из API, пишется фоном
+    std::ofstream file_;
+
+    std::mutex wakeMutex_;
+    std::condition_variable wake_;                 // есть сообщения / остановка
+    std::condition_variable drained_;              // для flush
+    bool stop_ = false;
+    std::mutex lifeMutex_;                         // запуск и остановка потока
+    std::atomic<bool> running_{false};
+    std::thread worker_;
+};
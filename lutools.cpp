@@ -2,12 +2,23 @@
 #include "LUToolsLite.h"
 #include "cube_loader.hpp"
 #include "image_io.hpp"
+#include "codec.hpp"
+#include "buffer_pool.hpp"
+#include "mapped_file.hpp"
+#include "thread_pool.hpp"
+#include "logger.hpp"
+#include "cancel_token.hpp"
+#include "progress.hpp"
+#include "stats.hpp"
+#include "trace.hpp"
 #include <vector>
 #include <string>
 #include <mutex>
 #include <atomic>
 #include <future>
+#ifdef _WIN32
 #include <windows.h>
+#endif
 #include <memory>
 #include <thread>
 #include <algorithm>
@@ -20,6 +31,15 @@
 #include <iomanip>
 #include <random>
 #include <numeric>
+#include <set>
+#include <condition_variable>
+#include <unordered_map>
+#include <sstream>
+#include <cstring>
+#include <climits>
+#include <filesystem>
+#include <cctype>
+#include <cstdio>
 
 #include <string>
 using namespace std::string_literals;   // ← добавить один раз в начале файла
@@ -28,164 +48,899 @@ using std::round;
 using Mutex = std::recursive_mutex;
 using LockG = std::lock_guard<Mutex>;
 
-struct LUTData {
-    int id;
+// Неизменяемая таблица LUT. Реестр и идущие вызовы держат её через shared_ptr:
+// выгрузка, очистка или вытеснение не затрагивают уже начатую обработку.
+struct LUTTable {
     LUTFlat lut;
     int size;
+};
+using LUTHandle = std::shared_ptr<const LUTTable>;
+
+struct LUTData {
+    // Не меняется после регистрации
+    std::string path;
+    float blend = 1.0f;
+    // Меняется на месте, читатели не блокируются
+    LUTHandle table;                              // только std::atomic_load/atomic_store; nullptr — не загружен
+    std::shared_ptr<const std::string> title;     // только std::atomic_load/atomic_store
+    std::atomic<int> size{0};                     // из заголовка, известен и без таблицы
+    std::atomic<int> state{LTL_LUT_PENDING};      // LTL_LUT_*
+    std::atomic<uint64_t> lastUse{0};             // такт последнего обращения, для LRU
+};
+using LUTEntry = std::shared_ptr<LUTData>;
+using LUTMap = std::unordered_map<int, LUTEntry>;
+
+// Звено цепочки обработки: ссылка на таблицу без копирования данных
+struct LUTRef {
+    LUTHandle table;
     float blend;
 };
 
-static std::vector<LUTData> g_luts;
-static Mutex g_mutex;
-static LogCallback g_logCallback = nullptr;
-static void* g_logUserData = nullptr;
-static ProgressCallback g_progressCallback = nullptr;
-static void* g_progressUserData = nullptr;
-static int* g_cancelFlag = nullptr;
-static std::string g_lastError;
-static std::atomic<int> g_nextLutId{1};
+using LUTWriteLock = std::lock_guard<std::mutex>;
+
+struct LogTarget {
+    LogCallback callback = nullptr;
+    void* userData = nullptr;
+};
+
+// Всё изменяемое состояние библиотеки. Функции без контекста работают с контекстом
+// по умолчанию; *Ctx-варианты привязывают свой контекст к потоку на время вызова.
+struct LUTools_Context {
+    // Реестр — неизменяемый снимок по id: читатели берут его через std::atomic_load, не
+    // трогая lutWriteMutex и не ожидая писателей; писатели сериализуются на lutWriteMutex,
+    // копируют карту (только указатели) и публикуют новую через std::atomic_store.
+    // Это не lock-free: atomic_load/atomic_store для shared_ptr в libstdc++ и MSVC берут
+    // короткую спин-блокировку по адресу указателя на время копирования и счётчика ссылок
+    std::shared_ptr<const LUTMap> luts = std::make_shared<const LUTMap>();
+    std::mutex lutWriteMutex;
+    std::atomic<int> nextLutId{1};
+    std::atomic<bool> lutCacheEnabled{true};
+    // Бюджет памяти данных LUT (0 — без ограничения) и счётчики. lutTick и hits/misses —
+    // общие атомики: каждый поиск в CollectLUTs пишет в них, и на многих ядрах эти
+    // кэш-линии переходят между потоками
+    std::atomic<uint64_t> lutBudget{0};
+    std::atomic<uint64_t> lutTick{0};
+    std::atomic<uint64_t> lutHits{0};
+    std::atomic<uint64_t> lutMisses{0};
+    std::atomic<uint64_t> lutEvictions{0};
+    // Колбэк журнала читается каждым Log через std::atomic_load/atomic_store, без mutex
+    // контекста (та же короткая блокировка shared_ptr, что и у реестра)
+    std::shared_ptr<const LogTarget> logTarget = std::make_shared<const LogTarget>();
+    // Отмена читается ядрами без блокировок: флаг вызывающего и счётчик LUTools_Cancel
+    std::atomic<int*> cancelFlag{nullptr};
+    std::atomic<uint64_t> cancelEpoch{0};
+    // Остальные колбэки — под mutex
+    Mutex mutex;
+    ProgressCallback progressCallback = nullptr;
+    void* progressUserData = nullptr;
+    ProgressCallbackEx progressCallbackEx = nullptr;
+    void* progressUserDataEx = nullptr;
+    unsigned progressRate = 10;   // отчётов в секунду на операцию; 0 — без ограничения
+    // Доля машины: сколько файлов пакета обрабатывать одновременно; 0 — по числу ядер
+    unsigned maxThreads = 0;
+    // Фоновые задачи (чтение заголовков), которых ждёт LUTools_DestroyContext
+    std::mutex jobsMutex;
+    std::condition_variable jobsDone;
+    int pendingJobs = 0;
+};
+
+static LUTools_Context g_defaultContext;
+static thread_local LUTools_Context* t_context = nullptr;
+// Последняя ошибка — своя у каждого потока: параллельные вызовы не затирают
+// сообщения друг друга, и блокировка для записи не нужна
+static thread_local std::string t_lastError;
+// Колбэк журнала, переданный в сам вызов (logCallback у ProcessFile*): пока вызов идёт,
+// его сообщения уходят туда, а не в колбэк контекста
+static thread_local const LogTarget* t_callLog = nullptr;
+
+// Контекст текущего вызова
+static LUTools_Context& Ctx() {
+    return t_context ? *t_context : g_defaultContext;
+}
+
+// Привязывает контекст к потоку на время *Ctx-вызова или задачи, запущенной из него
+class ContextScope {
+public:
+    explicit ContextScope(LUTools_Context* ctx) : prev_(t_context) {
+        t_context = ctx ? ctx : &g_defaultContext;
+    }
+    ~ContextScope() { t_context = prev_; }
+    ContextScope(const ContextScope&) = delete;
+    ContextScope& operator=(const ContextScope&) = delete;
+private:
+    LUTools_Context* prev_;
+};
+
+// Привязывает logCallback вызова к потоку; без колбэка остаётся колбэк контекста
+class CallLogScope {
+public:
+    CallLogScope(LogCallback callback, void* userData) : target_{callback, userData}, prev_(t_callLog) {
+        if (callback) t_callLog = &target_;
+    }
+    ~CallLogScope() { t_callLog = prev_; }
+    CallLogScope(const CallLogScope&) = delete;
+    CallLogScope& operator=(const CallLogScope&) = delete;
+private:
+    LogTarget target_;
+    const LogTarget* prev_;
+};
+
+static std::shared_ptr<const LUTMap> LUTSnapshot() {
+    return std::atomic_load(&Ctx().luts);
+}
+
+static LUTEntry FindLUT(int id) {
+    auto snapshot = LUTSnapshot();
+    auto it = snapshot->find(id);
+    return it != snapshot->end() ? it->second : nullptr;
+}
+
+// Новый снимок реестра: edit(map) над копией текущего. Вызывать под lutWriteMutex контекста.
+template <class Fn>
+static void UpdateLUTs(Fn&& edit) {
+    auto next = std::make_shared<LUTMap>(*LUTSnapshot());
+    edit(*next);
+    std::atomic_store(&Ctx().luts, std::shared_ptr<const LUTMap>(std::move(next)));
+}
+
+static void ClearLUTRegistry() {
+    LUTWriteLock lock(Ctx().lutWriteMutex);
+    std::atomic_store(&Ctx().luts, std::make_shared<const LUTMap>());
+}
+
+static LUTEntry NewLUTEntry(const std::string& path, float blend, int state) {
+    auto entry = std::make_shared<LUTData>();
+    entry->path = path;
+    entry->blend = std::clamp(blend, 0.0f, 1.0f);
+    entry->title = std::make_shared<const std::string>();
+    entry->state = state;
+    return entry;
+}
+
+// Сообщение уходит в асинхронный логгер вместе с колбэком вызова или текущего контекста;
+// вызывающий поток не ждёт ни файла, ни колбэка
+static void LogAt(int level, const std::string& message) {
+    AsyncLogger& logger = AsyncLogger::instance();
+    if (!logger.enabled(level)) return;
+    if (const LogTarget* call = t_callLog) {
+        logger.log(level, message, call->callback, call->userData);
+        return;
+    }
+    auto target = std::atomic_load(&Ctx().logTarget);
+    logger.log(level, message, target->callback, target->userData);
+}
 
 void Log(const std::string& message, int is_error) {
-    LockG lock(g_mutex);
-    std::string logMessage = (is_error ? "[ОШИБКА] " : "[Лог] ") + message;
-    // Временное логирование в файл для диагностики
-    std::ofstream logFile("D:\\LT\\lutools_log.txt", std::ios::app);
-    if (logFile.is_open()) {
-        logFile << logMessage << std::endl;
-        logFile.close();
-    }
-    if (g_logCallback) {
-        try {
-            g_logCallback(logMessage.c_str(), is_error, g_logUserData);
-        } catch (...) {
-            // Игнорируем исключения в callback
-            std::ofstream logFile("D:\\LT\\lutools_log.txt", std::ios::app);
-            if (logFile.is_open()) {
-                logFile << "[ОШИБКА] Exception in g_logCallback" << std::endl;
-                logFile.close();
+    LogAt(is_error ? kLogError : kLogInfo, message);
+}
+
+// Сообщение собирается, только если уровень включён: строки для отключённых уровней
+// (и для LTL_LOG_COMPILE_LEVEL ниже уровня) не форматируются
+#define LOG_AT(level, ...) \
+    do { if (AsyncLogger::instance().enabled(level)) LogAt(level, __VA_ARGS__); } while (0)
+
+// Токен операции: отменяется флагом вызывающего или LUTools_Cancel, вызванной после её начала
+static CancelToken JobToken() {
+    LUTools_Context& ctx = Ctx();
+    return CancelToken(&ctx.cancelFlag, &ctx.cancelEpoch);
+}
+
+// Прогресс операции: колбэки контекста снимаются при старте, дальше их вызывает только
+// фоновый поток прогресса, а рабочие потоки лишь прибавляют единицы работы
+static ProgressTracker JobProgress(uint64_t total, const char* stage) {
+    LUTools_Context& ctx = Ctx();
+    LockG lock(ctx.mutex);
+    ProgressReportFn report;
+    if (ctx.progressCallback || ctx.progressCallbackEx) {
+        report = [callback = ctx.progressCallback, userData = ctx.progressUserData,
+                  callbackEx = ctx.progressCallbackEx, userDataEx = ctx.progressUserDataEx](const ProgressSnapshot& s) {
+            try {
+                if (callback) callback(s.fraction, userData);
+                if (callbackEx) {
+                    LUTools_Progress p{ s.fraction, s.done, s.total, s.elapsed, s.eta, s.stage };
+                    callbackEx(&p, userDataEx);
+                }
+            } catch (...) {
+                // Игнорируем исключения в callback
             }
-        }
+        };
     }
+    return ProgressTracker(std::move(report), total, stage, ctx.progressRate);
 }
 
 int LUTools_Init() {
+    LUTools_Context& ctx = Ctx();
     try {
-        LockG lock(g_mutex);
-        g_luts.clear();
-        g_nextLutId = 1;
-        g_lastError.clear();
-        Log("Initialized LUToolsLite", 0);
+        ClearLUTRegistry();
+        LockG lock(ctx.mutex);
+        ctx.nextLutId = 1;
+        ctx.lutHits = ctx.lutMisses = ctx.lutEvictions = 0;
+        t_lastError.clear();
+        LOG_AT(kLogInfo, "Initialized LUToolsLite");
         return SUCCESS;
     } catch (const std::exception& e) {
-        g_lastError = "Exception in LUTools_Init: " + std::string(e.what());
-        Log(g_lastError, 1);
+        t_lastError = "Exception in LUTools_Init: " + std::string(e.what());
+        Log(t_lastError, 1);
         return INITIALIZATION_FAILED;
     } catch (...) {
-        g_lastError = "Unknown exception in LUTools_Init";
-        Log(g_lastError, 1);
+        t_lastError = "Unknown exception in LUTools_Init";
+        Log(t_lastError, 1);
         return INITIALIZATION_FAILED;
     }
 }
 
 void LUTools_Cleanup() {
-    LockG lock(g_mutex);
-    g_luts.clear();
-    g_logCallback = nullptr;
-    g_logUserData = nullptr;
-    g_progressCallback = nullptr;
-    g_progressUserData = nullptr;
-    g_cancelFlag = nullptr;
-    g_lastError.clear();
-    Log("Cleaned up LUToolsLite", 0);
+    LUTools_Context& ctx = Ctx();
+    ClearLUTRegistry();
+    std::atomic_store(&ctx.logTarget, std::make_shared<const LogTarget>());
+    AsyncLogger::instance().flush();   // после возврата старый колбэк больше не вызывается
+    {
+        LockG lock(ctx.mutex);
+        ctx.progressCallback = nullptr;
+        ctx.progressUserData = nullptr;
+        ctx.progressCallbackEx = nullptr;
+        ctx.progressUserDataEx = nullptr;
+        ctx.cancelFlag = nullptr;
+    }
+    t_lastError.clear();
+    BufferPool::instance().trim();
+    LOG_AT(kLogInfo, "Cleaned up LUToolsLite");
+    // Фоновые потоки останавливаются здесь, а не в статических деструкторах: join там
+    // зависает под loader lock Windows. Пул — первым: его задачи пишут в журнал.
+    ThreadPool::instance().shutdown();
+    progressShutdown();
+    AsyncLogger::instance().shutdown();
+}
+
+static uint64_t LUTBytes(const LUTData& l) {
+    LUTHandle table = std::atomic_load(&l.table);
+    return table ? uint64_t(table->lut.size()) * sizeof(Color) : 0;
+}
+
+// Выгружает данные давно не использованных LUT, пока сумма больше бюджета; id остаются
+// действительными, данные перечитываются при следующем обращении. Вызывать под lutWriteMutex контекста.
+static void EnforceLUTBudget(const LUTData* keep) {
+    const uint64_t budget = Ctx().lutBudget;
+    if (budget == 0) return;
+    auto snapshot = LUTSnapshot();
+    uint64_t total = 0;
+    for (const auto& [id, l] : *snapshot) total += LUTBytes(*l);
+    while (total > budget) {
+        LUTData* victim = nullptr;
+        for (const auto& [id, l] : *snapshot) {
+            if (l.get() == keep || !std::atomic_load(&l->table)) continue;
+            if (!victim || l->lastUse < victim->lastUse) victim = l.get();
+        }
+        if (!victim) break;
+        total -= LUTBytes(*victim);
+        std::atomic_store(&victim->table, LUTHandle());
+        victim->state = LTL_LUT_REGISTERED;
+        ++Ctx().lutEvictions;
+    }
 }
 
 int LUTools_LoadLUT(const char* filePath, float blend, int* lutId) {
+    LUTools_Context& ctx = Ctx();
     if (!filePath || !lutId) {
-        g_lastError = "Invalid filePath or lutId pointer";
+        t_lastError = "Invalid filePath or lutId pointer";
         return INVALID_LUT;
     }
     int size = 0;
     try {
-        LUTFlat lut = loadCubeLUT(filePath, size);
+        StatTimer timer(kStatLUTLoad);
+        std::string title;
+        LUTFlat lut = ctx.lutCacheEnabled ? loadCubeLUTCached(filePath, size, &title) : loadCubeLUT(filePath, size, &title);
+        timer.bytes(uint64_t(lut.size()) * sizeof(Color));
         if (lut.empty()) {
-            g_lastError = "Failed to load LUT: " + std::string(filePath);
+            t_lastError = "Failed to load LUT: " + std::string(filePath);
             return INVALID_LUT;
         }
-        LockG lock(g_mutex);
-        int id = g_nextLutId++;
-        g_luts.push_back({id, std::move(lut), size, std::clamp(blend, 0.0f, 1.0f)});
+        LUTEntry entry = NewLUTEntry(filePath, blend, LTL_LUT_LOADED);
+        entry->table = std::make_shared<const LUTTable>(LUTTable{std::move(lut), size});
+        entry->title = std::make_shared<const std::string>(std::move(title));
+        entry->size = size;
+        entry->lastUse = ++ctx.lutTick;
+        const int id = ctx.nextLutId++;
+        {
+            LUTWriteLock lock(ctx.lutWriteMutex);
+            UpdateLUTs([&](LUTMap& luts) { luts[id] = entry; });
+            EnforceLUTBudget(entry.get());
+        }
         *lutId = id;
-        Log("Loaded LUT: " + std::string(filePath) + " with blend: " + std::to_string(blend), 0);
+        LOG_AT(kLogInfo, "Loaded LUT: " + std::string(filePath) + " with blend: " + std::to_string(blend));
         return SUCCESS;
     } catch (const std::exception& e) {
-        g_lastError = "Error loading LUT: " + std::string(e.what());
+        t_lastError = "Error loading LUT: " + std::string(e.what());
         return INVALID_LUT;
     }
 }
 
 void LUTools_UnloadLUT(int lutId) {
-    LockG lock(g_mutex);
-    g_luts.erase(std::remove_if(g_luts.begin(), g_luts.end(),
-        [lutId](const LUTData& lut) { return lut.id == lutId; }), g_luts.end());
-    Log("Unloaded LUT ID: " + std::to_string(lutId), 0);
+    {
+        LUTWriteLock lock(Ctx().lutWriteMutex);
+        UpdateLUTs([lutId](LUTMap& luts) { luts.erase(lutId); });
+    }
+    LOG_AT(kLogInfo, "Unloaded LUT ID: " + std::to_string(lutId));
 }
 
 void LUTools_ClearLUTs() {
-    LockG lock(g_mutex);
-    g_luts.clear();
-    Log("Cleared all LUTs", 0);
+    ClearLUTRegistry();
+    LOG_AT(kLogInfo, "Cleared all LUTs");
 }
 
-int LUTools_ProcessFile(const char* inputPath, const char* outputPath, const int* lutIds, int lutCount, float whiteBalance, float tint, float brightness, float contrast, float saturation, LogCallback logCallback, void* userData) {
-    if (!inputPath || !outputPath || !lutIds) {
-        g_lastError = "Invalid input/output paths or LUT IDs";
-        return INVALID_IMAGE;
+void LUTools_SetLUTCacheEnabled(int enabled) {
+    Ctx().lutCacheEnabled = enabled != 0;
+}
+
+void LUTools_SetLUTBudget(unsigned long long bytes) {
+    LUTools_Context& ctx = Ctx();
+    ctx.lutBudget = bytes;
+    LUTWriteLock lock(ctx.lutWriteMutex);
+    EnforceLUTBudget(nullptr);
+}
+
+void LUTools_GetLUTStats(LUTools_LUTStats* stats) {
+    LUTools_Context& ctx = Ctx();
+    if (!stats) return;
+    auto snapshot = LUTSnapshot();
+    stats->budget = ctx.lutBudget;
+    stats->bytesLoaded = 0;
+    stats->loaded = 0;
+    for (const auto& [id, l] : *snapshot) {
+        const uint64_t bytes = LUTBytes(*l);
+        stats->bytesLoaded += bytes;
+        if (bytes) ++stats->loaded;
+    }
+    stats->registered = static_cast<int>(snapshot->size());
+    stats->hits = ctx.lutHits;
+    stats->misses = ctx.lutMisses;
+    stats->evictions = ctx.lutEvictions;
+}
+
+// Загрузка таблицы лениво зарегистрированного или вытесненного LUT; результат
+// публикуется в записи, чтобы следующие вызовы не читали файл повторно
+static int MaterializeLUT(const LUTEntry& entry, LUTHandle& table) {
+    LUTools_Context& ctx = Ctx();
+    int size = 0;
+    LUTFlat lut;
+    StatTimer timer(kStatLUTLoad);
+    try {
+        lut = ctx.lutCacheEnabled ? loadCubeLUTCached(entry->path, size) : loadCubeLUT(entry->path, size);
+        timer.bytes(uint64_t(lut.size()) * sizeof(Color));
+    } catch (const std::exception& e) {
+        if (!std::atomic_load(&entry->table)) entry->state = LTL_LUT_FAILED;
+        t_lastError = "Error loading LUT: " + std::string(e.what());
+        Log(t_lastError, 1);
+        return INVALID_LUT;
+    }
+    table = std::make_shared<const LUTTable>(LUTTable{std::move(lut), size});
+    LUTHandle expected;
+    if (!std::atomic_compare_exchange_strong(&entry->table, &expected, table)) {
+        table = std::move(expected);   // параллельный вызов успел загрузить первым
+        return SUCCESS;
     }
-    std::vector<LUTData> luts;
+    entry->size = size;
+    entry->state = LTL_LUT_LOADED;
+    LOG_AT(kLogDebug, "Loaded LUT on demand: " + entry->path);
+    LUTWriteLock lock(ctx.lutWriteMutex);
+    EnforceLUTBudget(entry.get());
+    return SUCCESS;
+}
+
+// Ссылки на таблицы цепочки из снимка реестра, без lutWriteMutex (атомарные операции
+// над shared_ptr — см. LUTools_Context); незагруженные загружаются после поиска
+static int CollectLUTs(const int* lutIds, int lutCount, std::vector<LUTRef>& luts) {
+    LUTools_Context& ctx = Ctx();
+    std::vector<std::pair<size_t, LUTEntry>> pending;   // индекс в luts, запись
     {
-        LockG lock(g_mutex);
+        // Только поиск; загрузка незагруженных считается отдельно (kStatLUTLoad)
+        StatTimer timer(kStatLUTLookup);
+        auto snapshot = LUTSnapshot();
         for (int i = 0; i < lutCount; ++i) {
-            auto it = std::find_if(g_luts.begin(), g_luts.end(),
-                [lutId = lutIds[i]](const LUTData& lut) { return lut.id == lutId; });
-            if (it == g_luts.end()) {
-                g_lastError = "Invalid LUT ID: " + std::to_string(lutIds[i]);
+            auto it = snapshot->find(lutIds[i]);
+            if (it == snapshot->end()) {
+                t_lastError = "Invalid LUT ID: " + std::to_string(lutIds[i]);
                 return INVALID_LUT;
             }
-            luts.push_back(*it);
+            const LUTEntry& entry = it->second;
+            entry->lastUse = ++ctx.lutTick;
+            LUTHandle table = std::atomic_load(&entry->table);
+            if (!table) {
+                pending.emplace_back(luts.size(), entry);
+                ++ctx.lutMisses;
+            } else {
+                ++ctx.lutHits;
+            }
+            luts.push_back({std::move(table), entry->blend});
         }
     }
-    Image img = loadImage(inputPath);
-    if (!img.valid()) {
-        g_lastError = "Failed to load image: " + std::string(inputPath);
-        Log(g_lastError, 1);
+    for (const auto& [i, entry] : pending) {
+        if (int rc = MaterializeLUT(entry, luts[i].table); rc != SUCCESS) return rc;
+    }
+    return SUCCESS;
+}
+
+// Id выдаются сразу, заголовки читаются задачами пула; прогресс — доля прочитанных
+static void RegisterLUTPaths(const std::vector<std::string>& paths, float blend, int* lutIds) {
+    LUTools_Context& ctx = Ctx();
+    std::vector<LUTEntry> entries;
+    entries.reserve(paths.size());
+    for (size_t i = 0; i < paths.size(); ++i) {
+        entries.push_back(NewLUTEntry(paths[i], blend, LTL_LUT_PENDING));
+        lutIds[i] = ctx.nextLutId++;
+    }
+    {
+        LUTWriteLock lock(ctx.lutWriteMutex);
+        UpdateLUTs([&](LUTMap& luts) {
+            for (size_t i = 0; i < entries.size(); ++i) luts[lutIds[i]] = entries[i];
+        });
+    }
+    LOG_AT(kLogInfo, "Registered " + std::to_string(paths.size()) + " LUTs");
+    auto done = std::make_shared<std::atomic<size_t>>(0);
+    auto progress = std::make_shared<ProgressTracker>(JobProgress(paths.size(), "Reading LUT headers"));
+    {
+        std::lock_guard<std::mutex> lock(ctx.jobsMutex);
+        ctx.pendingJobs += static_cast<int>(entries.size());
+    }
+    for (const LUTEntry& entry : entries) {
+        ThreadPool::instance().submit([ctx = &ctx, entry, done, progress, count = entries.size()] {
+            ContextScope scope(ctx);
+            CubeHeader header;
+            const bool ok = readCubeHeader(entry->path, header) && header.size > 0;
+            if (ok) {
+                entry->size = header.size;
+                std::atomic_store(&entry->title, std::make_shared<const std::string>(std::move(header.title)));
+            }
+            // Запись могла быть уже загружена обработкой — тогда состояние не трогаем
+            int expected = LTL_LUT_PENDING;
+            entry->state.compare_exchange_strong(expected, ok ? LTL_LUT_REGISTERED : LTL_LUT_FAILED);
+            if (!ok) LOG_AT(kLogWarning, "Failed to read LUT header: " + entry->path);
+            progress->add();
+            if (++*done == count) progress->finishInBackground();
+            std::lock_guard<std::mutex> lock(ctx->jobsMutex);
+            if (--ctx->pendingJobs == 0) ctx->jobsDone.notify_all();
+        });
+    }
+}
+
+int LUTools_RegisterLUTs(const char** filePaths, int count, float blend, int* lutIds) {
+    if (!filePaths || !lutIds || count <= 0) {
+        t_lastError = "Invalid LUT paths or count";
+        return INVALID_LUT;
+    }
+    std::vector<std::string> paths;
+    paths.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        if (!filePaths[i]) {
+            t_lastError = "Invalid LUT path at index " + std::to_string(i);
+            return INVALID_LUT;
+        }
+        paths.emplace_back(filePaths[i]);
+    }
+    RegisterLUTPaths(paths, blend, lutIds);
+    return SUCCESS;
+}
+
+int LUTools_RegisterLUTDirectory(const char* directory, float blend, int* lutIds, int maxIds, int* count) {
+    if (!directory || !count) {
+        t_lastError = "Invalid directory or count pointer";
+        return INVALID_LUT;
+    }
+    std::vector<std::string> paths;
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec)) {
+        if (!it->is_regular_file(ec)) continue;
+        std::string ext = it->path().extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(),
+            [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (ext == ".cube") paths.push_back(it->path().string());
+    }
+    if (ec) {
+        t_lastError = "Failed to read LUT directory: " + std::string(directory);
+        Log(t_lastError, 1);
+        return INVALID_LUT;
+    }
+    std::sort(paths.begin(), paths.end());
+    *count = static_cast<int>(paths.size());
+    if (!lutIds || paths.empty()) return SUCCESS;
+    if (maxIds < *count) {
+        t_lastError = "lutIds buffer too small: " + std::to_string(*count) + " LUTs found";
+        return INVALID_LUT;
+    }
+    RegisterLUTPaths(paths, blend, lutIds);
+    return SUCCESS;
+}
+
+int LUTools_GetLUTInfo(int lutId, LUTools_LUTInfo* info) {
+    if (!info) {
+        t_lastError = "Invalid info pointer";
+        return INVALID_LUT;
+    }
+    LUTEntry entry = FindLUT(lutId);
+    if (!entry) {
+        t_lastError = "Invalid LUT ID: " + std::to_string(lutId);
+        return INVALID_LUT;
+    }
+    auto title = std::atomic_load(&entry->title);
+    info->state = entry->state;
+    info->size = entry->size;
+    info->blend = entry->blend;
+    std::snprintf(info->title, sizeof(info->title), "%s", title->c_str());
+    return SUCCESS;
+}
+
+void LUTools_GetDefaultOutputOptions(LUTools_OutputOptions* options) {
+    if (!options) return;
+    EncodeOptions defaults;
+    options->format = LTL_FORMAT_JPEG;
+    options->jpegQuality = defaults.quality;
+    options->jpegSubsampling = defaults.subsampling;
+    options->jpegRestartRows = defaults.restartRows;
+    options->pngCompression = defaults.compressionLevel;
+}
+
+// Проверка и перевод LUTools_OutputOptions во внутренние настройки кодека
+static int ResolveOutputOptions(const LUTools_OutputOptions* output, std::string& format, EncodeOptions& options) {
+    LUTools_OutputOptions o;
+    LUTools_GetDefaultOutputOptions(&o);
+    if (output) o = *output;
+    static const char* const kFormats[] = { "jpg", "png", "bmp", "tga", "qoi" };
+    if (o.format < LTL_FORMAT_JPEG || o.format > LTL_FORMAT_QOI) {
+        t_lastError = "Unsupported output format: " + std::to_string(o.format);
+        return UNSUPPORTED_FORMAT;
+    }
+    if (o.jpegSubsampling != 0 && o.jpegSubsampling != 444 && o.jpegSubsampling != 422 && o.jpegSubsampling != 420) {
+        t_lastError = "Invalid JPEG subsampling: " + std::to_string(o.jpegSubsampling);
+        return UNSUPPORTED_FORMAT;
+    }
+    format = kFormats[o.format];
+    options.quality = std::clamp(o.jpegQuality, 1, 100);
+    options.subsampling = o.jpegSubsampling;
+    options.restartRows = std::max(-1, o.jpegRestartRows);
+    options.compressionLevel = std::clamp(o.pngCompression, 0, 9);
+    if (!CodecRegistry::instance().find(format, CODEC_CAP_ENCODE)) {
+        t_lastError = "No encoder for output format: " + format;
+        return UNSUPPORTED_FORMAT;
+    }
+    return SUCCESS;
+}
+
+int LUTools_ProcessFile(const char* inputPath, const char* outputPath, const int* lutIds, int lutCount, float whiteBalance, float tint, float brightness, float contrast, float saturation, LogCallback logCallback, void* userData) {
+    return LUTools_ProcessFileEx(inputPath, outputPath, lutIds, lutCount, whiteBalance, tint, brightness, contrast, saturation,
+                                 nullptr, logCallback, userData);
+}
+
+int LUTools_ProcessFileEx(const char* inputPath, const char* outputPath, const int* lutIds, int lutCount, float whiteBalance, float tint, float brightness, float contrast, float saturation, const LUTools_OutputOptions* output, LogCallback logCallback, void* userData) {
+    CallLogScope log(logCallback, userData);
+    if (!inputPath || !outputPath || !lutIds) {
+        t_lastError = "Invalid input/output paths or LUT IDs";
         return INVALID_IMAGE;
     }
-    if (LUTools_IsCancelled()) {
-        g_lastError = "Operation cancelled";
-        Log(g_lastError, 1);
+    LatencyTimer latency(kLatProcessFile);
+    TraceScope trace("ProcessFile", "api");
+    CancelToken cancel = JobToken();
+    std::string format;
+    EncodeOptions encodeOptions;
+    if (int rc = ResolveOutputOptions(output, format, encodeOptions); rc != SUCCESS) {
+        Log(t_lastError, 1);
+        return rc;
+    }
+    encodeOptions.cancel = &cancel;
+    std::vector<LUTRef> luts;
+    if (int rc = CollectLUTs(lutIds, lutCount, luts); rc != SUCCESS) return rc;
+    ProgressTracker progress = JobProgress(0, "Decoding");
+    Image img = loadImage(inputPath, &cancel);
+    if (cancel.cancelled()) {
+        t_lastError = "Operation cancelled";
+        Log(t_lastError, 1);
         return CANCELLED;
     }
+    if (!img.valid()) {
+        t_lastError = "Failed to load image: " + std::string(inputPath);
+        Log(t_lastError, 1);
+        return INVALID_IMAGE;
+    }
+    latency.pixels(uint64_t(img.width) * img.height);
+    progress.addTotal(uint64_t(img.height) * luts.size());
+    progress.setStage("Applying LUTs");
     for (const auto& lut : luts) {
-        img = processImageParallel(img, lut.lut, lut.size, lut.blend, whiteBalance, tint, brightness, contrast, saturation);
+        img = processImageParallel(img, lut.table->lut, lut.table->size, lut.blend, whiteBalance, tint, brightness, contrast, saturation, &cancel, &progress, Ctx().maxThreads);
+        if (cancel.cancelled()) {
+            t_lastError = "Operation cancelled";
+            Log(t_lastError, 1);
+            return CANCELLED;
+        }
         if (!img.valid()) {
-            g_lastError = "Failed to process image with LUT";
-            Log(g_lastError, 1);
+            t_lastError = "Failed to process image with LUT";
+            Log(t_lastError, 1);
             return INVALID_IMAGE;
         }
     }
-    bool success = saveImage(img, outputPath, "jpg");
+    progress.setStage("Encoding");
+    bool success = saveImage(img, outputPath, format, encodeOptions);
+    if (!success && cancel.cancelled()) {
+        std::remove(outputPath);   // недописанный файл не оставляем
+        t_lastError = "Operation cancelled";
+        Log(t_lastError, 1);
+        return CANCELLED;
+    }
     if (!success) {
-        g_lastError = "Failed to save image: " + std::string(outputPath);
-        Log(g_lastError, 1);
+        t_lastError = "Failed to save image: " + std::string(outputPath);
+        Log(t_lastError, 1);
         return INVALID_IMAGE;
     }
-    Log("Processed: " + std::string(inputPath) + " -> " + std::string(outputPath), 0);
+    progress.finish();
+    latency.succeeded();
+    LOG_AT(kLogInfo, "Processed: " + std::string(inputPath) + " -> " + std::string(outputPath));
+    return SUCCESS;
+}
+
+namespace {
+
+// Приёмник, передающий байты колбэку вызывающего
+class CallbackSink : public ByteSink {
+public:
+    CallbackSink(LUTools_WriteFn write, void* context) : write_(write), context_(context) {}
+
+    bool write(const void* data, size_t size) override {
+        const char* p = static_cast<const char*>(data);
+        while (size > 0) {
+            int chunk = static_cast<int>(std::min<size_t>(size, INT_MAX));
+            write_(context_, p, chunk);
+            p += chunk;
+            size -= chunk;
+        }
+        return true;
+    }
+
+private:
+    LUTools_WriteFn write_;
+    void* context_;
+};
+
+// Растущий буфер на malloc: отдаётся вызывающему без копирования, освобождается LUTools_FreeMemory
+class MallocSink : public ByteSink {
+public:
+    ~MallocSink() override { free(data_); }
+
+    bool write(const void* data, size_t size) override {
+        if (size_ + size > capacity_) {
+            size_t capacity = std::max(size_ + size, std::max<size_t>(capacity_ * 2, 64 * 1024));
+            auto* grown = static_cast<unsigned char*>(realloc(data_, capacity));
+            if (!grown) return false;
+            data_ = grown;
+            capacity_ = capacity;
+        }
+        std::memcpy(data_ + size_, data, size);
+        size_ += size;
+        return true;
+    }
+
+    size_t size() const { return size_; }
+    unsigned char* release() {
+        unsigned char* p = data_;
+        data_ = nullptr;
+        size_ = capacity_ = 0;
+        return p;
+    }
+
+private:
+    unsigned char* data_ = nullptr;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+};
+
+int ProcessEncodedImpl(const unsigned char* inputData, size_t inputSize, const int* lutIds, int lutCount,
+                       float whiteBalance, float tint, float brightness, float contrast, float saturation,
+                       const LUTools_OutputOptions* output, ByteSink& sink) {
+    if (!inputData || inputSize == 0 || (lutCount > 0 && !lutIds)) {
+        t_lastError = "Invalid input buffer or LUT IDs";
+        return INVALID_IMAGE;
+    }
+    CancelToken cancel = JobToken();
+    std::string format;
+    EncodeOptions encodeOptions;
+    if (int rc = ResolveOutputOptions(output, format, encodeOptions); rc != SUCCESS) {
+        Log(t_lastError, 1);
+        return rc;
+    }
+    encodeOptions.cancel = &cancel;
+    std::vector<LUTRef> luts;
+    if (int rc = CollectLUTs(lutIds, lutCount, luts); rc != SUCCESS) return rc;
+    ProgressTracker progress = JobProgress(0, "Decoding");
+    Image img;
+    DecodeOptions decodeOptions;
+    decodeOptions.cancel = &cancel;
+    const bool decoded = decodeImage(inputData, inputSize, img, decodeOptions);
+    if (cancel.cancelled()) {
+        t_lastError = "Operation cancelled";
+        Log(t_lastError, 1);
+        return CANCELLED;
+    }
+    if (!decoded) {
+        t_lastError = "Failed to decode input buffer";
+        Log(t_lastError, 1);
+        return INVALID_IMAGE;
+    }
+    progress.addTotal(uint64_t(img.height) * luts.size());
+    progress.setStage("Applying LUTs");
+    for (const auto& lut : luts) {
+        img = processImageParallel(img, lut.table->lut, lut.table->size, lut.blend, whiteBalance, tint, brightness, contrast, saturation, &cancel, &progress, Ctx().maxThreads);
+        if (cancel.cancelled()) {
+            t_lastError = "Operation cancelled";
+            Log(t_lastError, 1);
+            return CANCELLED;
+        }
+        if (!img.valid()) {
+            t_lastError = "Failed to process image with LUT";
+            Log(t_lastError, 1);
+            return INVALID_IMAGE;
+        }
+    }
+    progress.setStage("Encoding");
+    if (!encodeImage(img, format, encodeOptions, sink)) {
+        const bool cancelled = cancel.cancelled();
+        t_lastError = cancelled ? "Operation cancelled" : "Failed to encode image as " + format;
+        Log(t_lastError, 1);
+        return cancelled ? CANCELLED : INVALID_IMAGE;
+    }
+    progress.finish();
+    return SUCCESS;
+}
+
+} // namespace
+
+int LUTools_ProcessEncoded(const unsigned char* inputData, size_t inputSize, const int* lutIds, int lutCount,
+                           float whiteBalance, float tint, float brightness, float contrast, float saturation,
+                           const LUTools_OutputOptions* output, unsigned char** outputData, size_t* outputSize) {
+    if (!outputData || !outputSize) {
+        t_lastError = "Invalid output pointers";
+        return INVALID_IMAGE;
+    }
+    *outputData = nullptr;
+    *outputSize = 0;
+    MallocSink sink;
+    int rc = ProcessEncodedImpl(inputData, inputSize, lutIds, lutCount, whiteBalance, tint, brightness, contrast, saturation,
+                                output, sink);
+    if (rc != SUCCESS) return rc;
+    *outputSize = sink.size();
+    *outputData = sink.release();
+    return SUCCESS;
+}
+
+int LUTools_ProcessEncodedToSink(const unsigned char* inputData, size_t inputSize, const int* lutIds, int lutCount,
+                                 float whiteBalance, float tint, float brightness, float contrast, float saturation,
+                                 const LUTools_OutputOptions* output, LUTools_WriteFn write, void* writeContext) {
+    if (!write) {
+        t_lastError = "Invalid write callback";
+        return INVALID_IMAGE;
+    }
+    CallbackSink sink(write, writeContext);
+    return ProcessEncodedImpl(inputData, inputSize, lutIds, lutCount, whiteBalance, tint, brightness, contrast, saturation,
+                              output, sink);
+}
+
+namespace {
+
+// Полосы: чтение → LUT и коррекции → запись; в памяти одна полоса и буферы кодеков
+int ProcessStreamingImpl(const char* inputPath, const std::vector<LUTRef>& luts,
+                         float whiteBalance, float tint, float brightness, float contrast, float saturation,
+                         const std::string& format, const EncodeOptions& encodeOptions, int stripRows, FileSink& sink) {
+    CancelToken cancel = JobToken();
+    EncodeOptions options = encodeOptions;
+    options.cancel = &cancel;
+    MappedFile file(inputPath);
+    std::unique_ptr<RowReader> reader = file.isOpen() ? openRowReader(file.data(), file.size()) : nullptr;
+    if (!reader) {
+        t_lastError = "Failed to load image: " + std::string(inputPath);
+        return INVALID_IMAGE;
+    }
+    const int width = reader->width();
+    const int height = reader->height();
+    std::unique_ptr<RowWriter> writer = openRowWriter(width, height, format, options, sink);
+    if (!writer) {
+        t_lastError = "Failed to encode image as " + format + ": " + std::to_string(width) + "x" + std::to_string(height);
+        return UNSUPPORTED_FORMAT;
+    }
+    LOG_AT(kLogInfo, "Streaming " + std::string(inputPath) + ": " + std::to_string(width) + "x" + std::to_string(height)
+        + ", " + std::to_string(stripRows) + " rows per strip");
+
+    ProgressTracker progress = JobProgress(uint64_t(height), "Streaming");
+    const size_t stride = size_t(width) * 3;
+    PixelBuffer rows;
+    rows.allocate(stride * std::min(stripRows, height));
+    for (int y = 0; y < height; y += stripRows) {
+        if (cancel.cancelled()) {
+            t_lastError = "Operation cancelled";
+            return CANCELLED;
+        }
+        const int n = std::min(stripRows, height - y);
+        if (!reader->read(rows.data(), n)) {
+            t_lastError = "Failed to decode image at row " + std::to_string(y) + ": " + std::string(inputPath);
+            return INVALID_IMAGE;
+        }
+        Image strip;
+        strip.width = width;
+        strip.height = n;
+        strip.channels = 3;
+        strip.data = PixelBuffer::view(rows.data(), stride * n);
+        for (const auto& lut : luts) {
+            strip = processImageParallel(strip, lut.table->lut, lut.table->size, lut.blend, whiteBalance, tint, brightness, contrast, saturation, &cancel, nullptr, Ctx().maxThreads);
+            if (cancel.cancelled()) {
+                t_lastError = "Operation cancelled";
+                return CANCELLED;
+            }
+            if (!strip.valid()) {
+                t_lastError = "Failed to process image with LUT";
+                return INVALID_IMAGE;
+            }
+        }
+        if (!writer->write(strip.data.data(), n)) {
+            t_lastError = "Failed to encode image as " + format;
+            return INVALID_IMAGE;
+        }
+        progress.add(n);
+    }
+    if (!writer->finish()) {
+        const bool cancelled = cancel.cancelled();
+        t_lastError = cancelled ? "Operation cancelled" : "Failed to encode image as " + format;
+        return cancelled ? CANCELLED : INVALID_IMAGE;
+    }
+    progress.finish();
+    return SUCCESS;
+}
+
+} // namespace
+
+int LUTools_ProcessFileStreaming(const char* inputPath, const char* outputPath, const int* lutIds, int lutCount,
+                                 float whiteBalance, float tint, float brightness, float contrast, float saturation,
+                                 const LUTools_OutputOptions* output, int stripRows, LogCallback logCallback, void* userData) {
+    CallLogScope log(logCallback, userData);
+    if (!inputPath || !outputPath || !lutIds) {
+        t_lastError = "Invalid input/output paths or LUT IDs";
+        return INVALID_IMAGE;
+    }
+    std::string format;
+    EncodeOptions encodeOptions;
+    if (int rc = ResolveOutputOptions(output, format, encodeOptions); rc != SUCCESS) {
+        Log(t_lastError, 1);
+        return rc;
+    }
+    std::vector<LUTRef> luts;
+    if (int rc = CollectLUTs(lutIds, lutCount, luts); rc != SUCCESS) return rc;
+    if (stripRows <= 0) stripRows = 256;
+
+    FileSink sink(outputPath);
+    int rc;
+    if (!sink.isOpen()) {
+        t_lastError = "Failed to save image: " + std::string(outputPath);
+        rc = INVALID_IMAGE;
+    } else {
+        try {
+            rc = ProcessStreamingImpl(inputPath, luts, whiteBalance, tint, brightness, contrast, saturation,
+                                      format, encodeOptions, stripRows, sink);
+        } catch (const std::bad_alloc&) {
+            t_lastError = "Out of memory while streaming: " + std::string(inputPath);
+            rc = MEMORY_ALLOCATION_FAILED;
+        }
+        if (!sink.close() && rc == SUCCESS) {
+            t_lastError = "Failed to save image: " + std::string(outputPath);
+            rc = INVALID_IMAGE;
+        }
+        // Недописанный файл не оставляем
+        if (rc != SUCCESS) std::remove(outputPath);
+    }
+    if (rc != SUCCESS) {
+        Log(t_lastError, 1);
+        return rc;
+    }
+    LOG_AT(kLogInfo, "Processed: " + std::string(inputPath) + " -> " + std::string(outputPath));
     return SUCCESS;
 }
 
 int LUTools_ProcessImage(unsigned char* inputData, int width, int height, int channels, const int* lutIds, int lutCount, float whiteBalance, float tint, float brightness, float contrast, float saturation, unsigned char** outputData, int* outWidth, int* outHeight, int* outChannels) {
     if (!inputData || !outputData || !outWidth || !outHeight || !outChannels || channels != 3) {
-        g_lastError = "Invalid input data or parameters";
+        t_lastError = "Invalid input data or parameters";
         return INVALID_IMAGE;
     }
     *outputData = nullptr;
@@ -193,46 +948,44 @@ int LUTools_ProcessImage(unsigned char* inputData, int width, int height, int ch
     img.width = width;
     img.height = height;
     img.channels = channels;
-    img.data.assign(inputData, inputData + width * height * channels);
-    std::vector<LUTData> luts;
-    {
-        LockG lock(g_mutex);
-        for (int i = 0; i < lutCount; ++i) {
-            auto it = std::find_if(g_luts.begin(), g_luts.end(),
-                [lutId = lutIds[i]](const LUTData& lut) { return lut.id == lutId; });
-            if (it == g_luts.end()) {
-                g_lastError = "Invalid LUT ID: " + std::to_string(lutIds[i]);
-                return INVALID_LUT;
-            }
-            luts.push_back(*it);
-        }
-    }
-    if (LUTools_IsCancelled()) {
-        g_lastError = "Operation cancelled";
+    img.data = PixelBuffer::view(inputData, size_t(width) * height * channels);   // буфер вызывающего, без копии
+    CancelToken cancel = JobToken();
+    LatencyTimer latency(kLatProcessImage, uint64_t(width) * height);
+    TraceScope trace("ProcessImage", "api", "height", height);
+    ProgressTracker progress = JobProgress(uint64_t(height) * std::max(lutCount, 0), "Applying LUTs");
+    std::vector<LUTRef> luts;
+    if (int rc = CollectLUTs(lutIds, lutCount, luts); rc != SUCCESS) return rc;
+    if (cancel.cancelled()) {
+        t_lastError = "Operation cancelled";
         return CANCELLED;
     }
     for (const auto& lut : luts) {
-        img = processImageParallel(img, lut.lut, lut.size, lut.blend, whiteBalance, tint, brightness, contrast, saturation);
+        img = processImageParallel(img, lut.table->lut, lut.table->size, lut.blend, whiteBalance, tint, brightness, contrast, saturation, &cancel, &progress, Ctx().maxThreads);
+        if (cancel.cancelled()) {
+            t_lastError = "Operation cancelled";
+            return CANCELLED;
+        }
         if (!img.valid()) {
-            g_lastError = "Failed to process image with LUT";
+            t_lastError = "Failed to process image with LUT";
             return INVALID_IMAGE;
         }
     }
     *outWidth = img.width;
     *outHeight = img.height;
     *outChannels = img.channels;
-    *outputData = (unsigned char*)malloc(img.data.size());
+    *outputData = img.data.release();   // без копии, если буфер свой
     if (!*outputData) {
-        g_lastError = "Memory allocation failed";
+        t_lastError = "Memory allocation failed";
         return MEMORY_ALLOCATION_FAILED;
     }
-    std::copy(img.data.begin(), img.data.end(), *outputData);
+    progress.finish();
+    latency.succeeded();
     return SUCCESS;
 }
 
 int LUTools_GeneratePreview(unsigned char* inputData, int width, int height, int channels, const int* lutIds, int lutCount, float whiteBalance, float tint, float brightness, float contrast, float saturation, int previewWidth, int previewHeight, unsigned char** outputData, int* outWidth, int* outHeight, int* outChannels) {
     if (!inputData || !outputData || !outWidth || !outHeight || !outChannels || channels != 3) {
-        g_lastError = "Invalid input data or parameters";
+        t_lastError = "Invalid input data or parameters";
         return INVALID_IMAGE;
     }
     *outputData = nullptr;
@@ -240,45 +993,41 @@ int LUTools_GeneratePreview(unsigned char* inputData, int width, int height, int
     img.width = width;
     img.height = height;
     img.channels = channels;
-    img.data.assign(inputData, inputData + width * height * channels);
+    img.data = PixelBuffer::view(inputData, size_t(width) * height * channels);
+    CancelToken cancel = JobToken();
+    LatencyTimer latency(kLatPreview, uint64_t(width) * height);
+    TraceScope trace("GeneratePreview", "api", "height", height);
     Image resized = resizeImage(img, previewWidth, previewHeight);
     if (!resized.valid()) {
-        g_lastError = "Failed to resize image for preview";
+        t_lastError = "Failed to resize image for preview";
         return INVALID_IMAGE;
     }
-    std::vector<LUTData> luts;
-    {
-        LockG lock(g_mutex);
-        for (int i = 0; i < lutCount; ++i) {
-            auto it = std::find_if(g_luts.begin(), g_luts.end(),
-                [lutId = lutIds[i]](const LUTData& lut) { return lut.id == lutId; });
-            if (it == g_luts.end()) {
-                g_lastError = "Invalid LUT ID: " + std::to_string(lutIds[i]);
-                return INVALID_LUT;
-            }
-            luts.push_back(*it);
-        }
-    }
-    if (LUTools_IsCancelled()) {
-        g_lastError = "Operation cancelled";
+    std::vector<LUTRef> luts;
+    if (int rc = CollectLUTs(lutIds, lutCount, luts); rc != SUCCESS) return rc;
+    if (cancel.cancelled()) {
+        t_lastError = "Operation cancelled";
         return CANCELLED;
     }
     for (const auto& lut : luts) {
-        resized = processImageParallel(resized, lut.lut, lut.size, lut.blend, whiteBalance, tint, brightness, contrast, saturation);
+        resized = processImageParallel(resized, lut.table->lut, lut.table->size, lut.blend, whiteBalance, tint, brightness, contrast, saturation, &cancel, nullptr, Ctx().maxThreads);
+        if (cancel.cancelled()) {
+            t_lastError = "Operation cancelled";
+            return CANCELLED;
+        }
         if (!resized.valid()) {
-            g_lastError = "Failed to process preview image";
+            t_lastError = "Failed to process preview image";
             return INVALID_IMAGE;
         }
     }
     *outWidth = resized.width;
     *outHeight = resized.height;
     *outChannels = resized.channels;
-    *outputData = (unsigned char*)malloc(resized.data.size());
+    *outputData = resized.data.release();
     if (!*outputData) {
-        g_lastError = "Memory allocation failed";
+        t_lastError = "Memory allocation failed";
         return MEMORY_ALLOCATION_FAILED;
     }
-    std::copy(resized.data.begin(), resized.data.end(), *outputData);
+    latency.succeeded();
     return SUCCESS;
 }
 
@@ -290,13 +1039,13 @@ int LUTools_GeneratePreviewFit(
     unsigned char** outputData, int* outWidth, int* outHeight, int* outChannels)
 {
     if (!inputData || !outputData || !outWidth || !outHeight || !outChannels || channels != 3) {
-        g_lastError = "Invalid input data or parameters";
+        t_lastError = "Invalid input data or parameters";
         return INVALID_IMAGE;
     }
 
     // Расчёт целевого размера с сохранением пропорций
     if (maxWidth <= 0 || maxHeight <= 0) {
-        g_lastError = "maxWidth / maxHeight must be > 0";
+        t_lastError = "maxWidth / maxHeight must be > 0";
         return INVALID_IMAGE;
     }
     float scale = std::min(
@@ -310,37 +1059,33 @@ int LUTools_GeneratePreviewFit(
     img.width = width;
     img.height = height;
     img.channels = channels;
-    img.data.assign(inputData, inputData + width * height * channels);
+    img.data = PixelBuffer::view(inputData, size_t(width) * height * channels);
+    CancelToken cancel = JobToken();
+    LatencyTimer latency(kLatPreviewFit, uint64_t(width) * height);
+    TraceScope trace("GeneratePreviewFit", "api", "height", height);
 
     Image resized = resizeImage(img, targetW, targetH);
     if (!resized.valid()) {
-        g_lastError = "Failed to resize image for preview";
+        t_lastError = "Failed to resize image for preview";
         return INVALID_IMAGE;
     }
 
     // Применяем LUT-цепочку
-    std::vector<LUTData> luts;
-    {
-        LockG lock(g_mutex);
-        for (int i = 0; i < lutCount; ++i) {
-            auto it = std::find_if(g_luts.begin(), g_luts.end(),
-                [id = lutIds[i]](const LUTData& l) { return l.id == id; });
-            if (it == g_luts.end()) {
-                g_lastError = "Invalid LUT ID: " + std::to_string(lutIds[i]);
-                return INVALID_LUT;
-            }
-            luts.push_back(*it);
-        }
-    }
-    if (LUTools_IsCancelled()) {
-        g_lastError = "Operation cancelled";
+    std::vector<LUTRef> luts;
+    if (int rc = CollectLUTs(lutIds, lutCount, luts); rc != SUCCESS) return rc;
+    if (cancel.cancelled()) {
+        t_lastError = "Operation cancelled";
         return CANCELLED;
     }
     for (const auto& lut : luts) {
-        resized = processImageParallel(resized, lut.lut, lut.size, lut.blend,
-                              whiteBalance, tint, brightness, contrast, saturation);
+        resized = processImageParallel(resized, lut.table->lut, lut.table->size, lut.blend,
+                              whiteBalance, tint, brightness, contrast, saturation, &cancel, nullptr, Ctx().maxThreads);
+        if (cancel.cancelled()) {
+            t_lastError = "Operation cancelled";
+            return CANCELLED;
+        }
         if (!resized.valid()) {
-            g_lastError = "Failed to process preview image";
+            t_lastError = "Failed to process preview image";
             return INVALID_IMAGE;
         }
     }
@@ -348,114 +1093,288 @@ int LUTools_GeneratePreviewFit(
     *outWidth = resized.width;
     *outHeight = resized.height;
     *outChannels = resized.channels;
-    *outputData = static_cast<unsigned char*>(malloc(resized.data.size()));
+    *outputData = resized.data.release();
     if (!*outputData) {
-        g_lastError = "Memory allocation failed";
+        t_lastError = "Memory allocation failed";
         return MEMORY_ALLOCATION_FAILED;
     }
-    std::copy(resized.data.begin(), resized.data.end(), *outputData);
+    latency.succeeded();
     return SUCCESS;
 }
 
 
 int LUTools_ProcessFiles(const char** inputPaths, const char** outputPaths, int fileCount, const int* lutIds, int lutCount, float whiteBalance, float tint, float brightness, float contrast, float saturation, LogCallback logCallback, void* userData) {
+    return LUTools_ProcessFilesEx(inputPaths, outputPaths, fileCount, lutIds, lutCount, whiteBalance, tint, brightness, contrast, saturation,
+                                  nullptr, logCallback, userData);
+}
+
+int LUTools_ProcessFilesEx(const char** inputPaths, const char** outputPaths, int fileCount, const int* lutIds, int lutCount, float whiteBalance, float tint, float brightness, float contrast, float saturation, const LUTools_OutputOptions* output, LogCallback logCallback, void* userData) {
+    CallLogScope log(logCallback, userData);
+    LUTools_Context& ctx = Ctx();
     if (!inputPaths || !outputPaths || fileCount <= 0 || !lutIds) {
-        g_lastError = "Invalid input/output paths or file count";
+        t_lastError = "Invalid input/output paths or file count";
         return INVALID_IMAGE;
     }
-    std::vector<LUTData> luts;
-    {
-        LockG lock(g_mutex);
-        for (int i = 0; i < lutCount; ++i) {
-            auto it = std::find_if(g_luts.begin(), g_luts.end(),
-                [lutId = lutIds[i]](const LUTData& lut) { return lut.id == lutId; });
-            if (it == g_luts.end()) {
-                g_lastError = "Invalid LUT ID: " + std::to_string(lutIds[i]);
-                return INVALID_LUT;
-            }
-            luts.push_back(*it);
-        }
+    // Один токен на пакет: задачи проверяют его перед файлом, между тайлами и полосами кодека
+    CancelToken cancel = JobToken();
+    std::string format;
+    EncodeOptions encodeOptions;
+    if (int rc = ResolveOutputOptions(output, format, encodeOptions); rc != SUCCESS) {
+        Log(t_lastError, 1);
+        return rc;
     }
+    encodeOptions.cancel = &cancel;
+    std::vector<LUTRef> luts;
+    if (int rc = CollectLUTs(lutIds, lutCount, luts); rc != SUCCESS) return rc;
     std::vector<std::future<void>> tasks;
-    std::atomic<int> processed{0};
-    unsigned int maxThreads = std::thread::hardware_concurrency();
-    for (int i = 0; i < fileCount; ++i) {
-        if (LUTools_IsCancelled()) {
-            g_lastError = "Operation cancelled";
-            Log(g_lastError, 1);
-            return CANCELLED;
+    // Готовый файл — единица прогресса, в том числе неудачный
+    ProgressTracker progress = JobProgress(uint64_t(fileCount), "Processing files");
+    unsigned int maxThreads = ctx.maxThreads ? ctx.maxThreads : std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 0; i < fileCount && !cancel.cancelled(); ++i) {
+        // Не больше maxThreads файлов одновременно: ждём самую старую задачу
+        if (i >= static_cast<int>(maxThreads)) {
+            StatTimer timer(kStatQueueWait);
+            TraceScope trace("Wait for slot", "batch", "file", i);
+            tasks[i - maxThreads].wait();
         }
-        tasks.push_back(std::async(std::launch::async, [i, inputPaths, outputPaths, &luts, whiteBalance, tint, brightness, contrast, saturation, logCallback, userData, &processed, fileCount]() {
-            Image img = loadImage(inputPaths[i]);
+        tasks.push_back(std::async(std::launch::async, [&ctx, &cancel, &progress, i, inputPaths, outputPaths, &luts, whiteBalance, tint, brightness, contrast, saturation, logCallback, userData, &format, &encodeOptions]() {
+            ContextScope scope(&ctx);
+            CallLogScope log(logCallback, userData);
+            if (cancel.cancelled()) return;
+            TraceScope trace("File", "batch", "file", i);
+            struct Done {
+                ProgressTracker& progress;
+                ~Done() { progress.add(); }
+            } done{progress};
+            Image img = loadImage(inputPaths[i], &cancel);
+            if (cancel.cancelled()) return;
             if (!img.valid()) {
                 Log("Failed to load image: " + std::string(inputPaths[i]), 1);
                 return;
             }
             for (const auto& lut : luts) {
-                img = processImageParallel(img, lut.lut, lut.size, lut.blend, whiteBalance, tint, brightness, contrast, saturation);
+                img = processImageParallel(img, lut.table->lut, lut.table->size, lut.blend, whiteBalance, tint, brightness, contrast, saturation, &cancel, nullptr, ctx.maxThreads);
+                if (cancel.cancelled()) return;
                 if (!img.valid()) {
                     Log("Failed to process image: " + std::string(inputPaths[i]), 1);
                     return;
                 }
             }
-            bool success = saveImage(img, outputPaths[i], "jpg");
+            bool success = saveImage(img, outputPaths[i], format, encodeOptions);
+            if (!success && cancel.cancelled()) {
+                std::remove(outputPaths[i]);
+                return;
+            }
             if (!success) {
                 Log("Failed to save image: " + std::string(outputPaths[i]), 1);
                 return;
             }
-            Log("Processed: " + std::string(inputPaths[i]) + " -> " + std::string(outputPaths[i]), 0);
-            if (g_progressCallback) {
-                float progress = static_cast<float>(++processed) / fileCount;
-                try {
-                    g_progressCallback(progress, g_progressUserData);
-                } catch (...) {
-                    // Игнорируем исключения в callback
-                }
-            }
+            LOG_AT(kLogInfo, "Processed: " + std::string(inputPaths[i]) + " -> " + std::string(outputPaths[i]));
         }));
     }
     for (auto& t : tasks) {
         try {
             t.get();
         } catch (const std::exception& e) {
-            g_lastError = "Exception in task: " + std::string(e.what());
-            Log(g_lastError, 1);
+            t_lastError = "Exception in task: " + std::string(e.what());
+            Log(t_lastError, 1);
         }
     }
+    if (cancel.cancelled()) {
+        t_lastError = "Operation cancelled";
+        Log(t_lastError, 1);
+        return CANCELLED;
+    }
+    progress.finish();
     return SUCCESS;
 }
 
 void LUTools_FreeMemory(unsigned char* data) {
-    if (data) {
+    // Буферы изображений — из пула, закодированные данные (LUTools_ProcessEncoded) — из malloc
+    if (data && !BufferPool::instance().release(data)) {
         free(data);
     }
 }
 
+void LUTools_SetPoolLimit(unsigned long long bytes) {
+    BufferPool::instance().setCacheLimit(bytes);
+}
+
+void LUTools_GetPoolStats(LUTools_PoolStats* stats) {
+    if (!stats) return;
+    BufferPoolStats s = BufferPool::instance().stats();
+    stats->bytesInUse = s.bytesInUse;
+    stats->bytesCached = s.bytesCached;
+    stats->peakBytes = s.peakBytes;
+    stats->acquires = s.acquires;
+    stats->reuses = s.reuses;
+    stats->systemAllocs = s.systemAllocs;
+    stats->systemFrees = s.systemFrees;
+}
+
+void LUTools_TrimPool(void) {
+    BufferPool::instance().trim();
+}
+
+void LUTools_GetStats(LUTools_Stats* stats) {
+    if (!stats) return;
+    static_assert(kStatCount == LTL_STAT_COUNT, "StatStage and LTL_STAT_* differ");
+    StatCounters counters[kStatCount];
+    statSnapshot(counters);
+    for (int s = 0; s < kStatCount; ++s) {
+        stats->stages[s].calls = counters[s].calls;
+        stats->stages[s].pixels = counters[s].pixels;
+        stats->stages[s].bytes = counters[s].bytes;
+        stats->stages[s].nanoseconds = counters[s].nanos;
+    }
+}
+
+void LUTools_ResetStats(void) {
+    statReset();
+}
+
+void LUTools_GetLatency(int op, int sizeBucket, LUTools_LatencyStats* stats) {
+    static_assert(kLatOpCount == LTL_LATENCY_OP_COUNT && kLatSizeCount == LTL_SIZE_COUNT, "LatencyOp and LTL_LATENCY_* differ");
+    if (!stats) return;
+    *stats = LUTools_LatencyStats();
+    if (op < 0 || op >= kLatOpCount || sizeBucket < -1 || sizeBucket >= kLatSizeCount) return;
+    auto snapshot = std::make_unique<LatencySnapshot>();
+    latencySnapshot(*snapshot);
+    LatencyHistogram h;
+    for (int size = 0; size < kLatSizeCount; ++size)
+        if (sizeBucket < 0 || size == sizeBucket) h.merge(snapshot->hist[op][size]);
+    stats->count = h.count;
+    if (h.count == 0) return;
+    stats->p50 = h.quantile(0.5);
+    stats->p95 = h.quantile(0.95);
+    stats->p99 = h.quantile(0.99);
+    stats->max = h.maxSeconds();
+    stats->mean = double(h.sumNanos) * 1e-9 / double(h.count);
+}
+
+void LUTools_WriteLatencyMetrics(LUTools_WriteFn write, void* writeContext) {
+    if (!write) return;
+    const std::string text = latencyMetricsText();
+    CallbackSink sink(write, writeContext);
+    sink.write(text.data(), text.size());
+}
+
+void LUTools_StartTrace(void) {
+    Tracer::instance().start();
+}
+
+void LUTools_StopTrace(void) {
+    Tracer::instance().stop();
+}
+
+void LUTools_WriteTrace(LUTools_WriteFn write, void* writeContext) {
+    if (!write) return;
+    CallbackSink sink(write, writeContext);
+    Tracer::instance().writeJson(sink);
+}
+
+int LUTools_SaveTrace(const char* path) {
+    if (!path) {
+        t_lastError = "Invalid trace path";
+        return WRITE_FAILED;
+    }
+    FileSink sink(path);
+    bool ok = sink.isOpen() && Tracer::instance().writeJson(sink);
+    ok = sink.close() && ok;
+    if (!ok) {
+        t_lastError = "Failed to write trace: " + std::string(path);
+        return WRITE_FAILED;
+    }
+    return SUCCESS;
+}
+
+int LUTools_SaveLatencyMetrics(const char* path) {
+    if (!path) {
+        t_lastError = "Invalid metrics path";
+        return WRITE_FAILED;
+    }
+    // Через временный файл: сборщик метрик не видит недописанный снимок
+    const std::string text = latencyMetricsText();
+    const std::string tmpPath = std::string(path) + ".tmp";
+    FILE* f = std::fopen(tmpPath.c_str(), "wb");
+    bool ok = f && std::fwrite(text.data(), 1, text.size(), f) == text.size();
+    if (f) ok = std::fclose(f) == 0 && ok;
+    std::error_code ec;
+    if (ok) std::filesystem::rename(tmpPath, path, ec);
+    if (!ok || ec) {
+        std::filesystem::remove(tmpPath, ec);
+        t_lastError = "Failed to write metrics: " + std::string(path);
+        return WRITE_FAILED;
+    }
+    return SUCCESS;
+}
+
 void LUTools_SetLogCallback(LogCallback callback, void* userData) {
-    LockG lock(g_mutex);
-    g_logCallback = callback;
-    g_logUserData = userData;
+    std::atomic_store(&Ctx().logTarget, std::make_shared<const LogTarget>(LogTarget{callback, userData}));
+    // Сообщения, поставленные со старым колбэком, выводятся до возврата
+    AsyncLogger::instance().flush();
+}
+
+void LUTools_SetLogLevel(int level) {
+    AsyncLogger::instance().setLevel(std::clamp(level, LTL_LOG_ERROR, LTL_LOG_DEBUG));
+}
+
+void LUTools_SetLogFile(const char* path) {
+    AsyncLogger::instance().setFile(path);
+}
+
+void LUTools_SetLogRateLimit(unsigned perSecond) {
+    AsyncLogger::instance().setRateLimit(perSecond);
+}
+
+void LUTools_FlushLog(void) {
+    AsyncLogger::instance().flush();
+}
+
+void LUTools_GetLogStats(LUTools_LogStats* stats) {
+    if (!stats) return;
+    LogStats s = AsyncLogger::instance().stats();
+    stats->written = s.written;
+    stats->droppedFull = s.droppedFull;
+    stats->droppedRate = s.droppedRate;
 }
 
 void LUTools_SetProgressCallback(ProgressCallback callback, void* userData) {
-    LockG lock(g_mutex);
-    g_progressCallback = callback;
-    g_progressUserData = userData;
+    LUTools_Context& ctx = Ctx();
+    LockG lock(ctx.mutex);
+    ctx.progressCallback = callback;
+    ctx.progressUserData = userData;
+}
+
+void LUTools_SetProgressCallbackEx(ProgressCallbackEx callback, void* userData) {
+    LUTools_Context& ctx = Ctx();
+    LockG lock(ctx.mutex);
+    ctx.progressCallbackEx = callback;
+    ctx.progressUserDataEx = userData;
+}
+
+void LUTools_SetProgressRate(unsigned maxPerSecond) {
+    LUTools_Context& ctx = Ctx();
+    LockG lock(ctx.mutex);
+    ctx.progressRate = maxPerSecond;
 }
 
 void LUTools_SetCancelFlag(int* cancelFlag) {
-    LockG lock(g_mutex);
-    g_cancelFlag = cancelFlag;
+    Ctx().cancelFlag = cancelFlag;
 }
 
 int LUTools_IsCancelled() {
-    LockG lock(g_mutex);
-    return g_cancelFlag && *g_cancelFlag != 0;
+    return JobToken().cancelled() ? 1 : 0;
+}
+
+void LUTools_Cancel(void) {
+    ++Ctx().cancelEpoch;
+    LOG_AT(kLogInfo, "Cancel requested");
 }
 
 void LUTools_GetLastErrorMessage(const char** message) {
-    LockG lock(g_mutex);
-    *message = g_lastError.c_str();
+    if (!message) return;
+    *message = t_lastError.c_str();
 }
 
 int LUTools_ResizeImage(unsigned char* inputData,
@@ -466,7 +1385,7 @@ int LUTools_ResizeImage(unsigned char* inputData,
 {
     if (!inputData || !outputData || !outWidth || !outHeight || !outChannels || channels != 3)
     {
-        g_lastError = "Invalid input data or parameters";
+        t_lastError = "Invalid input data or parameters";
         return INVALID_IMAGE;
     }
 
@@ -474,23 +1393,22 @@ int LUTools_ResizeImage(unsigned char* inputData,
     src.width  = width;
     src.height = height;
     src.channels = channels;
-    src.data.assign(inputData, inputData + width * height * channels);
+    src.data = PixelBuffer::view(inputData, size_t(width) * height * channels);
 
     Image dst  = resizeImage(src, newWidth, newHeight);
     if (!dst.valid()) {
-        g_lastError = "Resize failed";
+        t_lastError = "Resize failed";
         return INVALID_IMAGE;
     }
 
     *outWidth  = dst.width;
     *outHeight = dst.height;
     *outChannels = dst.channels;
-    *outputData = (unsigned char*)malloc(dst.data.size());
+    *outputData = dst.data.release();
     if (!*outputData) {
-        g_lastError = "Memory allocation failed";
+        t_lastError = "Memory allocation failed";
         return MEMORY_ALLOCATION_FAILED;
     }
-    std::copy(dst.data.begin(), dst.data.end(), *outputData);
     return SUCCESS;
 }
 
@@ -512,20 +1430,25 @@ int LUTools_CreateLUTFromImages(const char* before_path,
                                 const int* lut_sizes,
                                 int num_sizes)
 {
-    LockG lock(g_mutex);
+    CancelToken cancel = JobToken();
     auto t0 = std::chrono::high_resolution_clock::now();
 
     // 1️⃣  Загрузка и первичная проверка
-    Image before = loadImage(before_path);
-    Image after  = loadImage(after_path);
+    Image before = loadImage(before_path, &cancel);
+    Image after  = loadImage(after_path, &cancel);
+    if (cancel.cancelled()) {
+        t_lastError = "Operation cancelled";
+        Log(t_lastError, 1);
+        return CANCELLED;
+    }
     if (!before.valid() || !after.valid()) {
-        g_lastError = "Failed to load images: "s + before_path + " / " + after_path;
-        Log(g_lastError, 1);
+        t_lastError = "Failed to load images: "s + before_path + " / " + after_path;
+        Log(t_lastError, 1);
         return INVALID_IMAGE;
     }
     if (before.channels != 3 || after.channels != 3) {
-        g_lastError = "Images must be RGB (3 channels)";
-        Log(g_lastError, 1);
+        t_lastError = "Images must be RGB (3 channels)";
+        Log(t_lastError, 1);
         return INVALID_IMAGE;
     }
 
@@ -537,10 +1460,15 @@ int LUTools_CreateLUTFromImages(const char* before_path,
     before = resizeImage(before, dw, dh);
     after  = resizeImage(after , dw, dh);
     if (!before.valid() || !after.valid()) {
-        g_lastError = "Resize failed";
-        Log(g_lastError, 1);
+        t_lastError = "Resize failed";
+        Log(t_lastError, 1);
         return INVALID_IMAGE;
     }
+    if (cancel.cancelled()) {
+        t_lastError = "Operation cancelled";
+        Log(t_lastError, 1);
+        return CANCELLED;
+    }
 
     // 3️⃣  Переводим в float‑вектора
     int pixels = dw * dh;
@@ -572,17 +1500,22 @@ int LUTools_CreateLUTFromImages(const char* before_path,
         }
         src.swap(s2);  dst.swap(d2);
         pixels = MAX_SAMPLES;
-        Log("Down‑sampled to " + std::to_string(MAX_SAMPLES) + " pixels", 0);
+        LOG_AT(kLogInfo, "Down‑sampled to " + std::to_string(MAX_SAMPLES) + " pixels");
     }
 
     // 4️⃣  Генерируем LUT для каждого размера
     const int K = 15;          // k‑NN
     const float BLEND = 1.0f;  // 1.0 = чистая коррекция
-    unsigned threads = std::thread::hardware_concurrency();
+    const int CHUNK = 64;      // узлов на задачу пула
+    uint64_t nodes = 0;
+    for (int s = 0; s < num_sizes; ++s)
+        if (lut_sizes[s] >= 2) nodes += uint64_t(lut_sizes[s]) * lut_sizes[s] * lut_sizes[s];
+    ProgressTracker progress = JobProgress(nodes, "Building LUT");
 
     for (int s = 0; s < num_sizes; ++s) {
         int N = lut_sizes[s];                   // размер решётки
         if (N < 2) continue;
+        TraceScope trace("Build LUT", "lut", "size", N);
         int total = N*N*N;                      // кол-во узлов
         std::vector<float> lut(total*3, 0.f);
 
@@ -598,10 +1531,15 @@ int LUTools_CreateLUTFromImages(const char* before_path,
                     grid[p*3+2] = b*inv;
                 }
 
-        // ◾️ 4.2  k‑NN (параллельно)
-        std::vector<std::future<void>> pool;
-        for (int n = 0; n < total; ++n) {
-            pool.emplace_back(std::async(std::launch::async,[&,n]{
+        // ◾️ 4.2  k‑NN (параллельно, блоками по CHUNK узлов; отмена — перед каждым узлом)
+        const int chunks = (total + CHUNK - 1) / CHUNK;
+        progress.setStage("Building LUT");
+        const auto buildStart = std::chrono::steady_clock::now();
+        ThreadPool::instance().parallelFor(size_t(chunks), [&](size_t c) {
+            TraceScope trace("kNN chunk", "lut", "chunk", int64_t(c));
+            const int end = std::min(total, int(c + 1) * CHUNK);
+            for (int n = int(c) * CHUNK; n < end; ++n) {
+                if (cancel.cancelled()) return;
                 const float* q = &grid[n*3];
                 // простой O(N) k‑NN (для картинки хватает)
                 std::vector<std::pair<float,int>> best(K,{1e9f,0});
@@ -631,15 +1569,19 @@ int LUTools_CreateLUTFromImages(const char* before_path,
                 lut[n*3+0] = std::clamp( BLEND*r + (1-BLEND)*q[0], 0.f,1.f );
                 lut[n*3+1] = std::clamp( BLEND*g + (1-BLEND)*q[1], 0.f,1.f );
                 lut[n*3+2] = std::clamp( BLEND*b + (1-BLEND)*q[2], 0.f,1.f );
-            }));
-            if (pool.size()>=threads){
-                for(auto& f:pool) f.get();
-                pool.clear();
+                progress.add();
             }
+        });
+        statAdd(kStatLUTBuild, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                   std::chrono::steady_clock::now() - buildStart).count()), uint64_t(total));
+        if (cancel.cancelled()) {
+            t_lastError = "Operation cancelled";
+            Log(t_lastError, 1);
+            return CANCELLED;
         }
-        for(auto& f:pool) f.get();
 
         // ◾️ 4.3  Экспорт *.cube  (B‑outer, G‑mid, R‑inner)
+        progress.setStage("Writing LUT");
         std::string path = std::string(output_path_prefix) + "_" + std::to_string(N)+".cube";
         std::ofstream f(path);
         if(!f){ Log("Can't write "+path,1); continue; }
@@ -657,17 +1599,299 @@ int LUTools_CreateLUTFromImages(const char* before_path,
                     f << lut[id  ] << ' ' << lut[id+1] << ' ' << lut[id+2] << '\n';
                 }
         f.close();
-        Log("Created LUT: "+path,0);
-
-        if (g_progressCallback) {
-            try { g_progressCallback(float(s+1)/num_sizes, g_progressUserData); }
-            catch(...) {}
-        }
+        LOG_AT(kLogInfo, "Created LUT: "+path);
     }
+    progress.finish();
 
     auto t1 = std::chrono::high_resolution_clock::now();
-    Log("LUT creation took "
+    LOG_AT(kLogInfo, "LUT creation took "
         + std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(t1-t0).count())
-        + " ms",0);
+        + " ms");
+    return SUCCESS;
+}
+
+
+
+// ───────────────────────────────────────────────────────────────
+//  Кодеки: регистрация внешних бэкендов и бенчмарк
+// ───────────────────────────────────────────────────────────────
+namespace {
+
+void writeFnToSink(void* context, const void* data, int size) {
+    if (size > 0) static_cast<ByteSink*>(context)->write(data, static_cast<size_t>(size));
+}
+
+class ExternalCodec : public ImageCodec {
+public:
+    explicit ExternalCodec(const LUTools_CodecDesc& desc)
+        : name_(desc.name), caps_(desc.capabilities), priority_(desc.priority),
+          decode_(desc.decode), encode_(desc.encode), userData_(desc.userData) {
+        std::stringstream ss(desc.formats ? desc.formats : "");
+        std::string f;
+        while (std::getline(ss, f, ','))
+            if (!f.empty()) formats_.insert(normalizeFormat(f));
+        if (!decode_) caps_ &= ~(CODEC_CAP_DECODE | CODEC_CAP_SCALED_DECODE);
+        if (!encode_) caps_ &= ~CODEC_CAP_ENCODE;
+    }
+
+    const char* name() const override { return name_.c_str(); }
+    int priority() const override { return priority_; }
+
+    unsigned capabilities(const std::string& format) const override {
+        return formats_.count(format) ? caps_ : 0u;
+    }
+
+    bool decode(const unsigned char* data, size_t size, const DecodeOptions&, Image& out) const override {
+        LUTools_DecodedImage decoded{};
+        if (!decode_ || decode_(data, size, &decoded, userData_) != 0) return false;
+        if (!decoded.pixels || decoded.width <= 0 || decoded.height <= 0) {
+            // Буфер уже принадлежит нам: возвращаем его плагину, не принимая
+            if (decoded.pixels && decoded.release) decoded.release(decoded.pixels, userData_);
+            t_lastError = "Codec " + name_ + " returned an invalid image (" + std::to_string(decoded.width) + "x" +
+                          std::to_string(decoded.height) + (decoded.pixels ? ")" : ", no pixels)");
+            Log(t_lastError, 1);
+            return false;
+        }
+        out.width = decoded.width;
+        out.height = decoded.height;
+        out.channels = 3;
+        // Пиксели внешнего декодера не копируются: release вызовется, когда Image их отпустит
+        auto release = decoded.release;
+        void* userData = userData_;
+        out.data = PixelBuffer::adopt(decoded.pixels, size_t(decoded.width) * decoded.height * 3,
+            [release, userData](unsigned char* p) { if (release) release(p, userData); });
+        return true;
+    }
+
+    bool encode(const Image& img, const std::string& format, const EncodeOptions& options, ByteSink& sink) const override {
+        return encode_ && encode_(img.data.data(), img.width, img.height, format.c_str(), options.quality,
+                                  writeFnToSink, &sink, userData_) == 0;
+    }
+
+private:
+    std::string name_;
+    std::set<std::string> formats_;
+    unsigned caps_;
+    int priority_;
+    LUTools_DecodeFn decode_;
+    LUTools_EncodeFn encode_;
+    void* userData_;
+};
+
+} // namespace
+
+int LUTools_RegisterCodec(const LUTools_CodecDesc* desc) {
+    if (!desc || !desc->name || !*desc->name || !desc->formats || (!desc->decode && !desc->encode)) {
+        t_lastError = "Invalid codec description";
+        return INVALID_CODEC;
+    }
+    if (std::strcmp(desc->name, "stb") == 0) {
+        t_lastError = "Codec name 'stb' is reserved";
+        return INVALID_CODEC;
+    }
+    CodecRegistry::instance().add(std::make_shared<ExternalCodec>(*desc));
+    LOG_AT(kLogInfo, "Registered codec: "s + desc->name + " (" + desc->formats + ")");
+    return SUCCESS;
+}
+
+int LUTools_UnregisterCodec(const char* name) {
+    if (!name || !CodecRegistry::instance().remove(name)) {
+        t_lastError = "Unknown or built-in codec: "s + (name ? name : "(null)");
+        return INVALID_CODEC;
+    }
+    LOG_AT(kLogInfo, "Unregistered codec: "s + name);
     return SUCCESS;
 }
+
+int LUTools_BenchmarkCodecs(const char* imagePath, const char* format, int iterations,
+                            LUTools_CodecBenchResult* results, int maxResults, int* resultCount)
+{
+    if (!imagePath || !format || !results || maxResults <= 0 || !resultCount) {
+        t_lastError = "Invalid benchmark parameters";
+        return INVALID_IMAGE;
+    }
+    *resultCount = 0;
+    Image sample = loadImage(imagePath);
+    if (!sample.valid()) {
+        t_lastError = "Failed to load image: "s + imagePath;
+        return INVALID_IMAGE;
+    }
+    auto bench = benchmarkCodecs(sample, format, iterations);
+    if (bench.empty()) {
+        t_lastError = "No codec supports format: "s + format;
+        return INVALID_CODEC;
+    }
+    int n = std::min(maxResults, static_cast<int>(bench.size()));
+    for (int i = 0; i < n; ++i) {
+        LUTools_CodecBenchResult& r = results[i];
+        std::memset(&r, 0, sizeof(r));
+        std::strncpy(r.codec, bench[i].codec.c_str(), sizeof(r.codec) - 1);
+        r.decodeMBps = bench[i].decodeMBps;
+        r.encodeMBps = bench[i].encodeMBps;
+        r.encodedBytes = bench[i].encodedBytes;
+        LOG_AT(kLogInfo, "Codec " + bench[i].codec + " [" + format + "]: decode " + std::to_string(r.decodeMBps)
+            + " MB/s, encode " + std::to_string(r.encodeMBps) + " MB/s");
+    }
+    *resultCount = n;
+    return SUCCESS;
+}
+
+
+// ───────────────────────────────────────────────────────────────
+//  Контексты: *Ctx-функции привязывают контекст к потоку на время вызова
+// ───────────────────────────────────────────────────────────────
+LUTools_Context* LUTools_CreateContext(int maxThreads) {
+    try {
+        auto* ctx = new LUTools_Context();
+        ctx->maxThreads = maxThreads > 0 ? static_cast<unsigned>(maxThreads) : 0;
+        return ctx;
+    } catch (const std::bad_alloc&) {
+        t_lastError = "Memory allocation failed";
+        return nullptr;
+    }
+}
+
+void LUTools_DestroyContext(LUTools_Context* ctx) {
+    if (!ctx || ctx == &g_defaultContext) return;
+    {
+        std::unique_lock<std::mutex> lock(ctx->jobsMutex);
+        ctx->jobsDone.wait(lock, [ctx] { return ctx->pendingJobs == 0; });
+    }
+    AsyncLogger::instance().flush();
+    delete ctx;
+}
+
+int LUTools_LoadLUTCtx(LUTools_Context* ctx, const char* filePath, float blend, int* lutId) {
+    ContextScope scope(ctx);
+    return LUTools_LoadLUT(filePath, blend, lutId);
+}
+
+void LUTools_UnloadLUTCtx(LUTools_Context* ctx, int lutId) {
+    ContextScope scope(ctx);
+    LUTools_UnloadLUT(lutId);
+}
+
+void LUTools_ClearLUTsCtx(LUTools_Context* ctx) {
+    ContextScope scope(ctx);
+    LUTools_ClearLUTs();
+}
+
+void LUTools_SetLUTCacheEnabledCtx(LUTools_Context* ctx, int enabled) {
+    ContextScope scope(ctx);
+    LUTools_SetLUTCacheEnabled(enabled);
+}
+
+void LUTools_SetLUTBudgetCtx(LUTools_Context* ctx, unsigned long long bytes) {
+    ContextScope scope(ctx);
+    LUTools_SetLUTBudget(bytes);
+}
+
+void LUTools_GetLUTStatsCtx(LUTools_Context* ctx, LUTools_LUTStats* stats) {
+    ContextScope scope(ctx);
+    LUTools_GetLUTStats(stats);
+}
+
+int LUTools_RegisterLUTsCtx(LUTools_Context* ctx, const char** filePaths, int count, float blend, int* lutIds) {
+    ContextScope scope(ctx);
+    return LUTools_RegisterLUTs(filePaths, count, blend, lutIds);
+}
+
+int LUTools_RegisterLUTDirectoryCtx(LUTools_Context* ctx, const char* directory, float blend, int* lutIds, int maxIds, int* count) {
+    ContextScope scope(ctx);
+    return LUTools_RegisterLUTDirectory(directory, blend, lutIds, maxIds, count);
+}
+
+int LUTools_GetLUTInfoCtx(LUTools_Context* ctx, int lutId, LUTools_LUTInfo* info) {
+    ContextScope scope(ctx);
+    return LUTools_GetLUTInfo(lutId, info);
+}
+
+int LUTools_ProcessFileExCtx(LUTools_Context* ctx, const char* inputPath, const char* outputPath, const int* lutIds, int lutCount, float whiteBalance, float tint, float brightness, float contrast, float saturation, const LUTools_OutputOptions* output, LogCallback logCallback, void* userData) {
+    ContextScope scope(ctx);
+    return LUTools_ProcessFileEx(inputPath, outputPath, lutIds, lutCount, whiteBalance, tint, brightness, contrast, saturation, output, logCallback, userData);
+}
+
+int LUTools_ProcessFilesExCtx(LUTools_Context* ctx, const char** inputPaths, const char** outputPaths, int fileCount, const int* lutIds, int lutCount, float whiteBalance, float tint, float brightness, float contrast, float saturation, const LUTools_OutputOptions* output, LogCallback logCallback, void* userData) {
+    ContextScope scope(ctx);
+    return LUTools_ProcessFilesEx(inputPaths, outputPaths, fileCount, lutIds, lutCount, whiteBalance, tint, brightness, contrast, saturation, output, logCallback, userData);
+}
+
+int LUTools_ProcessImageCtx(LUTools_Context* ctx, unsigned char* inputData, int width, int height, int channels, const int* lutIds, int lutCount, float whiteBalance, float tint, float brightness, float contrast, float saturation, unsigned char** outputData, int* outWidth, int* outHeight, int* outChannels) {
+    ContextScope scope(ctx);
+    return LUTools_ProcessImage(inputData, width, height, channels, lutIds, lutCount, whiteBalance, tint, brightness, contrast, saturation, outputData, outWidth, outHeight, outChannels);
+}
+
+int LUTools_GeneratePreviewCtx(LUTools_Context* ctx, unsigned char* inputData, int width, int height, int channels, const int* lutIds, int lutCount, float whiteBalance, float tint, float brightness, float contrast, float saturation, int previewWidth, int previewHeight, unsigned char** outputData, int* outWidth, int* outHeight, int* outChannels) {
+    ContextScope scope(ctx);
+    return LUTools_GeneratePreview(inputData, width, height, channels, lutIds, lutCount, whiteBalance, tint, brightness, contrast, saturation, previewWidth, previewHeight, outputData, outWidth, outHeight, outChannels);
+}
+
+int LUTools_GeneratePreviewFitCtx(LUTools_Context* ctx, unsigned char* inputData, int width, int height, int channels, const int* lutIds, int lutCount, float whiteBalance, float tint, float brightness, float contrast, float saturation, int maxWidth, int maxHeight, unsigned char** outputData, int* outWidth, int* outHeight, int* outChannels) {
+    ContextScope scope(ctx);
+    return LUTools_GeneratePreviewFit(inputData, width, height, channels, lutIds, lutCount, whiteBalance, tint, brightness, contrast, saturation, maxWidth, maxHeight, outputData, outWidth, outHeight, outChannels);
+}
+
+int LUTools_ResizeImageCtx(LUTools_Context* ctx, unsigned char* inputData, int width, int height, int channels, int newWidth, int newHeight, unsigned char** outputData, int* outWidth, int* outHeight, int* outChannels) {
+    ContextScope scope(ctx);
+    return LUTools_ResizeImage(inputData, width, height, channels, newWidth, newHeight, outputData, outWidth, outHeight, outChannels);
+}
+
+void LUTools_SetLogCallbackCtx(LUTools_Context* ctx, LogCallback callback, void* userData) {
+    ContextScope scope(ctx);
+    LUTools_SetLogCallback(callback, userData);
+}
+
+void LUTools_SetProgressCallbackCtx(LUTools_Context* ctx, ProgressCallback callback, void* userData) {
+    ContextScope scope(ctx);
+    LUTools_SetProgressCallback(callback, userData);
+}
+
+void LUTools_SetProgressCallbackExCtx(LUTools_Context* ctx, ProgressCallbackEx callback, void* userData) {
+    ContextScope scope(ctx);
+    LUTools_SetProgressCallbackEx(callback, userData);
+}
+
+void LUTools_SetProgressRateCtx(LUTools_Context* ctx, unsigned maxPerSecond) {
+    ContextScope scope(ctx);
+    LUTools_SetProgressRate(maxPerSecond);
+}
+
+void LUTools_SetCancelFlagCtx(LUTools_Context* ctx, int* cancelFlag) {
+    ContextScope scope(ctx);
+    LUTools_SetCancelFlag(cancelFlag);
+}
+
+int LUTools_IsCancelledCtx(LUTools_Context* ctx) {
+    ContextScope scope(ctx);
+    return LUTools_IsCancelled();
+}
+
+void LUTools_CancelCtx(LUTools_Context* ctx) {
+    ContextScope scope(ctx);
+    LUTools_Cancel();
+}
+
+// Ошибка принадлежит потоку: ctx принимается только для единообразия *Ctx-API
+void LUTools_GetLastErrorMessageCtx(LUTools_Context*, const char** message) {
+    LUTools_GetLastErrorMessage(message);
+}
+
+int LUTools_CreateLUTFromImagesCtx(LUTools_Context* ctx, const char* before_path, const char* after_path, const char* output_path_prefix, const int* lut_sizes, int num_sizes) {
+    ContextScope scope(ctx);
+    return LUTools_CreateLUTFromImages(before_path, after_path, output_path_prefix, lut_sizes, num_sizes);
+}
+
+int LUTools_ProcessEncodedCtx(LUTools_Context* ctx, const unsigned char* inputData, size_t inputSize, const int* lutIds, int lutCount, float whiteBalance, float tint, float brightness, float contrast, float saturation, const LUTools_OutputOptions* output, unsigned char** outputData, size_t* outputSize) {
+    ContextScope scope(ctx);
+    return LUTools_ProcessEncoded(inputData, inputSize, lutIds, lutCount, whiteBalance, tint, brightness, contrast, saturation, output, outputData, outputSize);
+}
+
+int LUTools_ProcessEncodedToSinkCtx(LUTools_Context* ctx, const unsigned char* inputData, size_t inputSize, const int* lutIds, int lutCount, float whiteBalance, float tint, float brightness, float contrast, float saturation, const LUTools_OutputOptions* output, LUTools_WriteFn write, void* writeContext) {
+    ContextScope scope(ctx);
+    return LUTools_ProcessEncodedToSink(inputData, inputSize, lutIds, lutCount, whiteBalance, tint, brightness, contrast, saturation, output, write, writeContext);
+}
+
+int LUTools_ProcessFileStreamingCtx(LUTools_Context* ctx, const char* inputPath, const char* outputPath, const int* lutIds, int lutCount, float whiteBalance, float tint, float brightness, float contrast, float saturation, const LUTools_OutputOptions* output, int stripRows, LogCallback logCallback, void* userData) {
+    ContextScope scope(ctx);
+    return LUTools_ProcessFileStreaming(inputPath, outputPath, lutIds, lutCount, whiteBalance, tint, brightness, contrast, saturation, output, stripRows, logCallback, userData);
+}
@@ -0,0 +1,75 @@
+#include "mapped_file.hpp"
+#include <exception>
+#include <fstream>
+#include <iterator>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file != INVALID_HANDLE_VALUE) {
+        LARGE_INTEGER fileSize;
+        if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+            HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping) {
+                // Вид держит отображение живым, хэндлы можно закрыть сразу
+                void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                CloseHandle(mapping);
+                if (view) {
+                    data_ = static_cast<const unsigned char*>(view);
+                    size_ = static_cast<size_t>(fileSize.QuadPart);
+                    mapped_ = true;
+                }
+            }
+        }
+        CloseHandle(file);
+    }
+#else
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            void* view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (view != MAP_FAILED) {
+                // Декодеры читают файл один раз от начала к концу — просим агрессивный read-ahead
+                madvise(view, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+                data_ = static_cast<const unsigned char*>(view);
+                size_ = static_cast<size_t>(st.st_size);
+                mapped_ = true;
+            }
+        }
+        close(fd);
+    }
+#endif
+    if (mapped_) return;
+
+    std::ifstream file(path, std::ios::binary);
+    try {
+        buffer_.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    } catch (const std::exception&) {
+        // Каталог и т. п.: libstdc++ бросает из underflow — считаем, что файла нет
+        buffer_.clear();
+    }
+    if (!buffer_.empty()) {
+        data_ = buffer_.data();
+        size_ = buffer_.size();
+    }
+}
+
+MappedFile::~MappedFile() {
+    if (!mapped_) return;
+#ifdef _WIN32
+    UnmapViewOfFile(data_);
+#else
+    munmap(const_cast<unsigned char*>(data_), size_);
+#endif
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// ─────────────────────────────────────────────────────────────
+//  Файл, отображённый в память только для чтения (mmap / MapViewOfFile).
+//  Если отобразить не удалось (пустой файл, pipe, сетевой диск без
+//  поддержки), содержимое читается в буфер — data()/size() те же.
+// ─────────────────────────────────────────────────────────────
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool isOpen() const { return data_ != nullptr; }
+    const unsigned char* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool isMapped() const { return mapped_; }
+
+private:
+    const unsigned char* data_ = nullptr;
+    size_t size_ = 0;
+    bool mapped_ = false;
+    std::vector<unsigned char> buffer_;
+};
@@ -0,0 +1,97 @@
+#include "pixel_buffer.hpp"
+#include "buffer_pool.hpp"
+#include <algorithm>
+#include <cstring>
+
+void PixelBuffer::PoolDeleter::operator()(void* p) const {
+    if (active) BufferPool::instance().release(p);
+}
+
+PixelBuffer::PixelBuffer(const PixelBuffer& other) {
+    assign(other.begin(), other.end());
+}
+
+PixelBuffer::PixelBuffer(PixelBuffer&& other) noexcept
+    : data_(other.data_), size_(other.size_), owner_(std::move(other.owner_)) {
+    other.data_ = nullptr;
+    other.size_ = 0;
+}
+
+PixelBuffer& PixelBuffer::operator=(const PixelBuffer& other) {
+    if (this != &other) assign(other.begin(), other.end());
+    return *this;
+}
+
+PixelBuffer& PixelBuffer::operator=(PixelBuffer&& other) noexcept {
+    if (this != &other) {
+        data_ = other.data_;
+        size_ = other.size_;
+        owner_ = std::move(other.owner_);
+        other.data_ = nullptr;
+        other.size_ = 0;
+    }
+    return *this;
+}
+
+PixelBuffer PixelBuffer::view(unsigned char* data, size_t size, std::shared_ptr<void> owner) {
+    PixelBuffer buf;
+    buf.data_ = data;
+    buf.size_ = size;
+    buf.owner_ = std::move(owner);
+    return buf;
+}
+
+void PixelBuffer::reset(unsigned char* data, size_t size) {
+    owner_ = data ? std::shared_ptr<void>(data, PoolDeleter()) : nullptr;
+    data_ = data;
+    size_ = data ? size : 0;
+}
+
+void PixelBuffer::allocate(size_t n) {
+    if (n == 0) { clear(); return; }
+    // Старый буфер вернётся в пул раньше, чем понадобится новый того же класса
+    clear();
+    reset(BufferPool::instance().acquire(n), n);
+}
+
+void PixelBuffer::resize(size_t n) {
+    if (n == size_) return;
+    if (n == 0) { clear(); return; }
+    unsigned char* p = BufferPool::instance().acquire(n);
+    const size_t keep = std::min(size_, n);
+    if (keep) std::memcpy(p, data_, keep);
+    std::memset(p + keep, 0, n - keep);
+    reset(p, n);
+}
+
+void PixelBuffer::assign(const unsigned char* first, const unsigned char* last) {
+    const size_t n = static_cast<size_t>(last - first);
+    if (n == 0) { clear(); return; }
+    unsigned char* p = BufferPool::instance().acquire(n);
+    std::memcpy(p, first, n);
+    reset(p, n);
+}
+
+void PixelBuffer::clear() {
+    owner_.reset();
+    data_ = nullptr;
+    size_ = 0;
+}
+
+unsigned char* PixelBuffer::release() {
+    unsigned char* out = nullptr;
+    auto* deleter = std::get_deleter<PoolDeleter>(owner_);
+    if (deleter && owner_.use_count() == 1 && data_ == owner_.get()) {
+        deleter->active = false;
+        out = data_;
+    } else if (size_ > 0) {
+        try {
+            out = BufferPool::instance().acquire(size_);
+        } catch (const std::bad_alloc&) {
+            return nullptr;
+        }
+        std::memcpy(out, data_, size_);
+    }
+    clear();
+    return out;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+// ─────────────────────────────────────────────────────────────
+//  Пиксели изображения. Интерфейс — подмножество std::vector, но память
+//  может принадлежать кому угодно: буфер декодера (adopt с его deleter),
+//  буфер вызывающего (view) или пул. Владельца держит shared_ptr<void>,
+//  поэтому декодированные данные идут по конвейеру без копирования.
+//  Собственная память берётся из BufferPool (64 байта, без обнуления).
+//  Копирование Image по-прежнему глубокое — как было с vector.
+// ─────────────────────────────────────────────────────────────
+class PixelBuffer {
+public:
+    PixelBuffer() = default;
+    PixelBuffer(const PixelBuffer& other);
+    PixelBuffer(PixelBuffer&& other) noexcept;
+    PixelBuffer& operator=(const PixelBuffer& other);
+    PixelBuffer& operator=(PixelBuffer&& other) noexcept;
+
+    // Забирает память: deleter(data) вызовется, когда последний владелец её отпустит
+    template <class Deleter>
+    static PixelBuffer adopt(unsigned char* data, size_t size, Deleter deleter) {
+        PixelBuffer buf;
+        buf.data_ = data;
+        buf.size_ = size;
+        buf.owner_ = std::shared_ptr<void>(data, [deleter](void* p) { deleter(static_cast<unsigned char*>(p)); });
+        return buf;
+    }
+    // Чужая память без передачи владения; owner держит её живой
+    // (nullptr — вызывающий сам гарантирует, что память переживёт буфер)
+    static PixelBuffer view(unsigned char* data, size_t size, std::shared_ptr<void> owner = nullptr);
+
+    unsigned char* data() { return data_; }
+    const unsigned char* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    unsigned char& operator[](size_t i) { return data_[i]; }
+    const unsigned char& operator[](size_t i) const { return data_[i]; }
+    unsigned char* begin() { return data_; }
+    unsigned char* end() { return data_ + size_; }
+    const unsigned char* begin() const { return data_; }
+    const unsigned char* end() const { return data_ + size_; }
+
+    // Новый буфер из пула без инициализации — для выхода, который будет перезаписан целиком
+    void allocate(size_t n);
+    // Как у vector: сохраняет первые min(size, n) байт, новые — нули
+    void resize(size_t n);
+    void assign(const unsigned char* first, const unsigned char* last);
+    void clear();
+
+    // Отдаёт память вызывающему C API; освобождается LUTools_FreeMemory (обратно в пул).
+    // Без копии, если буфер единолично владеет памятью пула; иначе копирует.
+    // После вызова буфер пуст; nullptr — не хватило памяти.
+    unsigned char* release();
+
+private:
+    // Отключаемый deleter: release() выключает его и забирает указатель
+    struct PoolDeleter {
+        bool active = true;
+        void operator()(void* p) const;
+    };
+    void reset(unsigned char* data, size_t size);
+
+    unsigned char* data_ = nullptr;
+    size_t size_ = 0;
+    std::shared_ptr<void> owner_;
+};
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "codec.hpp"
+
+// ─────────────────────────────────────────────────────────────
+//  Собственный PNG-кодировщик: полосы строк фильтруются и сжимаются
+//  deflate параллельно на пуле, каждая полоса — отдельный IDAT.
+// ─────────────────────────────────────────────────────────────
+
+// 8 бит на канал, 1–4 канала; уровень сжатия — EncodeOptions::compressionLevel
+bool encodePng(const Image& img, const EncodeOptions& options, ByteSink& sink);
+// Построчная запись RGB: в памяти пачка полос и 32 КБ словаря
+std::unique_ptr<RowWriter> openPngWriter(int width, int height, const EncodeOptions& options, ByteSink& sink);
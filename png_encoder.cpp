@@ -0,0 +1,251 @@
+#include "png_codec.hpp"
+#include "cancel_token.hpp"
+#include "deflate.hpp"
+#include "thread_pool.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+namespace {
+
+const size_t kStripBytes = 256 * 1024;   // несжатых байт в одной полосе
+const size_t kDictBytes = 32 * 1024;
+
+void put32(std::vector<unsigned char>& out, uint32_t v) {
+    out.push_back(static_cast<unsigned char>(v >> 24));
+    out.push_back(static_cast<unsigned char>(v >> 16));
+    out.push_back(static_cast<unsigned char>(v >> 8));
+    out.push_back(static_cast<unsigned char>(v));
+}
+
+// Чанк PNG: длина, тип, данные, CRC(тип + данные)
+void appendChunk(std::vector<unsigned char>& out, const char* type, const unsigned char* data, size_t size) {
+    put32(out, static_cast<uint32_t>(size));
+    size_t typePos = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data, data + size);
+    put32(out, crc32Update(0, out.data() + typePos, size + 4));
+}
+
+unsigned char paeth(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) return static_cast<unsigned char>(a);
+    return static_cast<unsigned char>(pb <= pc ? b : c);
+}
+
+// Фильтрует строку cur (up — предыдущая строка или nullptr) в out: байт типа фильтра + данные.
+// adaptive — перебор пяти фильтров по минимуму суммы |байт| (эвристика libpng)
+void filterRow(const unsigned char* cur, const unsigned char* up, size_t rowBytes, int bpp, bool adaptive,
+               unsigned char* out, std::vector<unsigned char>& scratch) {
+    if (!adaptive) {
+        out[0] = 0;
+        std::copy(cur, cur + rowBytes, out + 1);
+        return;
+    }
+
+    scratch.resize(rowBytes);
+    uint64_t bestCost = UINT64_MAX;
+    for (int type = 0; type < 5; ++type) {
+        if (!up && (type == 2 || type == 4)) continue;   // без верхней строки совпадают с None/Sub
+        uint64_t cost = 0;
+        for (size_t i = 0; i < rowBytes; ++i) {
+            int a = i >= size_t(bpp) ? cur[i - bpp] : 0;
+            int b = up ? up[i] : 0;
+            int c = (up && i >= size_t(bpp)) ? up[i - bpp] : 0;
+            int pred = 0;
+            switch (type) {
+                case 1: pred = a; break;
+                case 2: pred = b; break;
+                case 3: pred = (a + b) >> 1; break;
+                case 4: pred = paeth(a, b, c); break;
+                default: break;
+            }
+            unsigned char v = static_cast<unsigned char>(cur[i] - pred);
+            scratch[i] = v;
+            cost += v < 128 ? v : 256 - v;
+        }
+        if (cost < bestCost) {
+            bestCost = cost;
+            out[0] = static_cast<unsigned char>(type);
+            std::copy(scratch.begin(), scratch.end(), out + 1);
+        }
+    }
+}
+
+using RowFn = std::function<const unsigned char*(int)>;
+
+// Общая часть целого и построчного кодирования: заголовок, пачки полос, хвост.
+// Полоса: фильтруем её строки (и хвост предыдущей — словарь deflate),
+// сжимаем и упаковываем в IDAT. Каждая полоса кончается sync flush,
+// поэтому IDAT-ы просто идут подряд.
+class PngStripEncoder {
+public:
+    PngStripEncoder(int width, int height, int channels, const EncodeOptions& options, ByteSink& sink)
+        : width_(width), height_(height), channels_(channels), sink_(sink), cancel_(options.cancel) {
+        level_ = std::clamp(options.compressionLevel, 0, 9);
+        stride_ = size_t(width) * channels + 1;
+        rowsPerStrip_ = static_cast<int>(std::max<size_t>(1, kStripBytes / stride_));
+        dictRows_ = static_cast<int>((kDictBytes + stride_ - 1) / stride_);
+        strips_ = (height + rowsPerStrip_ - 1) / rowsPerStrip_;
+        // Полосы идут пачками, чтобы не держать весь сжатый поток в памяти
+        batch_ = static_cast<int>(ThreadPool::instance().size() + 1) * 2;
+    }
+
+    int rowsPerStrip() const { return rowsPerStrip_; }
+    int dictRows() const { return dictRows_; }
+    int strips() const { return strips_; }
+    int batch() const { return batch_; }
+
+    // Сигнатура и IHDR
+    bool writeHeader() {
+        static const unsigned char kColorType[5] = { 0, 0, 4, 2, 6 };
+        std::vector<unsigned char> header = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        std::vector<unsigned char> ihdr;
+        put32(ihdr, static_cast<uint32_t>(width_));
+        put32(ihdr, static_cast<uint32_t>(height_));
+        ihdr.insert(ihdr.end(), { 8, kColorType[channels_], 0, 0, 0 });
+        appendChunk(header, "IHDR", ihdr.data(), ihdr.size());
+        return sink_.write(header.data(), header.size());
+    }
+
+    // Полосы [first, first + count) параллельно; row(y) нужна начиная со строки
+    // перед словарём первой полосы. Отмена — перед каждой полосой
+    bool encodeStrips(int first, int count, const RowFn& row) {
+        parts_.assign(count, Strip());
+        ThreadPool::instance().parallelFor(static_cast<size_t>(count), [&](size_t i) {
+            if (cancel_ && cancel_->cancelled()) return;
+            encodeStrip(first + static_cast<int>(i), row, parts_[i]);
+        });
+        if (cancel_ && cancel_->cancelled()) return false;
+        for (const Strip& part : parts_) {
+            adler_ = adler32Combine(adler_, part.adler, part.rawSize);
+            if (!sink_.write(part.chunk.data(), part.chunk.size())) return false;
+        }
+        return true;
+    }
+
+    // Adler-32 всего потока известен только в конце — отдельный IDAT, затем IEND
+    bool finish() {
+        std::vector<unsigned char> tail, trailer;
+        put32(trailer, adler_);
+        appendChunk(tail, "IDAT", trailer.data(), trailer.size());
+        appendChunk(tail, "IEND", nullptr, 0);
+        return sink_.write(tail.data(), tail.size());
+    }
+
+private:
+    struct Strip {
+        std::vector<unsigned char> chunk;
+        uint32_t adler = 1;
+        size_t rawSize = 0;
+    };
+
+    void encodeStrip(int index, const RowFn& row, Strip& strip) const {
+        TraceScope trace("Encode strip", "codec", "strip", index);
+        const int rowBegin = index * rowsPerStrip_;
+        const int rowEnd = std::min(height_, rowBegin + rowsPerStrip_);
+        const int dictBegin = std::max(0, rowBegin - dictRows_);
+        std::vector<unsigned char> filtered(size_t(rowEnd - dictBegin) * stride_);
+        std::vector<unsigned char> scratch;
+        for (int y = dictBegin; y < rowEnd; ++y)
+            filterRow(row(y), y > 0 ? row(y - 1) : nullptr, stride_ - 1, channels_, level_ > 0,
+                      filtered.data() + size_t(y - dictBegin) * stride_, scratch);
+
+        const size_t dictSize = size_t(rowBegin - dictBegin) * stride_;
+        const size_t skip = dictSize > kDictBytes ? dictSize - kDictBytes : 0;
+        strip.rawSize = filtered.size() - dictSize;
+        strip.adler = adler32Update(1, filtered.data() + dictSize, strip.rawSize);
+
+        std::vector<unsigned char> data;
+        if (index == 0) {
+            unsigned char zh[2];
+            zlibHeader(level_, zh);
+            data.assign(zh, zh + 2);
+        }
+        deflateChunk(filtered.data() + skip, dictSize - skip, strip.rawSize, level_, index == strips_ - 1, data);
+        appendChunk(strip.chunk, "IDAT", data.data(), data.size());
+    }
+
+    int width_, height_, channels_;
+    ByteSink& sink_;
+    const CancelToken* cancel_;
+    int level_;
+    size_t stride_;          // байт фильтрованной строки (с байтом типа)
+    int rowsPerStrip_, dictRows_, strips_, batch_;
+    uint32_t adler_ = 1;
+    std::vector<Strip> parts_;
+};
+
+// Строки копятся, пока не наберётся пачка полос; после сжатия остаются
+// только строки словаря следующей полосы
+class PngRowWriter : public RowWriter {
+public:
+    PngRowWriter(int width, int height, const EncodeOptions& options, ByteSink& sink)
+        : encoder_(width, height, 3, options, sink), height_(height), rowBytes_(size_t(width) * 3) {}
+
+    bool write(const unsigned char* rows, int count) override {
+        if (!started_ && !start()) return false;
+        if (count < 0 || count > height_ - received_) return false;
+        buffer_.insert(buffer_.end(), rows, rows + size_t(count) * rowBytes_);
+        received_ += count;
+
+        const int ready = received_ == height_ ? encoder_.strips() : received_ / encoder_.rowsPerStrip();
+        while (ready - nextStrip_ >= encoder_.batch() || (received_ == height_ && nextStrip_ < ready)) {
+            const int n = std::min(encoder_.batch(), ready - nextStrip_);
+            auto row = [this](int y) { return buffer_.data() + size_t(y - bufferBegin_) * rowBytes_; };
+            if (!encoder_.encodeStrips(nextStrip_, n, row)) return false;
+            nextStrip_ += n;
+            // Последняя полоса бывает неполной: дальше полученных строк не удаляем
+            const int keepFrom = std::min(received_, std::max(0, nextStrip_ * encoder_.rowsPerStrip() - encoder_.dictRows() - 1));
+            if (keepFrom > bufferBegin_) {
+                buffer_.erase(buffer_.begin(), buffer_.begin() + size_t(keepFrom - bufferBegin_) * rowBytes_);
+                bufferBegin_ = keepFrom;
+            }
+        }
+        return true;
+    }
+
+    bool finish() override {
+        if (!started_ && !start()) return false;
+        return received_ == height_ && nextStrip_ == encoder_.strips() && encoder_.finish();
+    }
+
+private:
+    bool start() {
+        started_ = true;
+        return encoder_.writeHeader();
+    }
+
+    PngStripEncoder encoder_;
+    int height_;
+    size_t rowBytes_;
+    std::vector<unsigned char> buffer_;   // строки [bufferBegin_, received_)
+    int bufferBegin_ = 0;
+    int received_ = 0;
+    int nextStrip_ = 0;
+    bool started_ = false;
+};
+
+} // namespace
+
+bool encodePng(const Image& img, const EncodeOptions& options, ByteSink& sink) {
+    if (img.width <= 0 || img.height <= 0 || img.channels < 1 || img.channels > 4) return false;
+    if (img.data.size() < size_t(img.width) * img.height * img.channels) return false;
+
+    PngStripEncoder encoder(img.width, img.height, img.channels, options, sink);
+    if (!encoder.writeHeader()) return false;
+    const size_t rowBytes = size_t(img.width) * img.channels;
+    auto row = [&](int y) { return img.data.data() + size_t(y) * rowBytes; };
+    for (int first = 0; first < encoder.strips(); first += encoder.batch())
+        if (!encoder.encodeStrips(first, std::min(encoder.batch(), encoder.strips() - first), row)) return false;
+    return encoder.finish();
+}
+
+std::unique_ptr<RowWriter> openPngWriter(int width, int height, const EncodeOptions& options, ByteSink& sink) {
+    if (width <= 0 || height <= 0) return nullptr;
+    return std::make_unique<PngRowWriter>(width, height, options, sink);
+}
@@ -0,0 +1,199 @@
+#include "progress.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+ProgressSnapshot finalSnapshot(const ProgressTracker::State& s) {
+    ProgressSnapshot snap = s.snapshot();
+    snap.done = snap.total;
+    snap.fraction = 1.0f;
+    snap.eta = 0.0;
+    return snap;
+}
+
+// Фоновый поток доставки: спит до ближайшего срока среди идущих операций.
+// Объект не уничтожается (join в статическом деструкторе DLL зависает под loader lock
+// Windows); поток запускается первой операцией и останавливается shutdown.
+class ProgressReporter {
+public:
+    static ProgressReporter& instance() {
+        static ProgressReporter* reporter = new ProgressReporter;
+        return *reporter;
+    }
+
+    void add(const std::shared_ptr<ProgressTracker::State>& state) {
+        ensureRunning();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            active_.push_back(state);
+        }
+        cv_.notify_one();
+    }
+
+    void finishLater(const std::shared_ptr<ProgressTracker::State>& state) {
+        ensureRunning();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            state->finishing = true;
+        }
+        cv_.notify_one();
+    }
+
+    // Отчёты идущих операций приостанавливаются до следующего запуска потока
+    void shutdown() {
+        std::lock_guard<std::mutex> life(lifeMutex_);
+        if (!running_.load(std::memory_order_relaxed)) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        worker_.join();
+        running_.store(false, std::memory_order_release);
+    }
+
+    void remove(const ProgressTracker::State* state) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        active_.erase(std::remove_if(active_.begin(), active_.end(),
+                                     [state](const auto& s) { return s.get() == state; }),
+                      active_.end());
+    }
+
+private:
+    ProgressReporter() = default;
+
+    void ensureRunning() {
+        if (running_.load(std::memory_order_acquire)) return;
+        std::lock_guard<std::mutex> life(lifeMutex_);
+        if (running_.load(std::memory_order_relaxed)) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = false;
+        }
+        worker_ = std::thread(&ProgressReporter::run, this);
+        running_.store(true, std::memory_order_release);
+    }
+
+    void run() {
+        std::vector<std::shared_ptr<ProgressTracker::State>> due, finished;
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            if (active_.empty()) {
+                cv_.wait(lock, [this] { return stop_ || !active_.empty(); });
+            } else {
+                Clock::time_point next = Clock::time_point::max();
+                for (const auto& s : active_) next = std::min(next, s->finishing ? Clock::time_point::min() : s->nextDue);
+                cv_.wait_until(lock, next);
+            }
+            if (stop_) return;
+            const Clock::time_point now = Clock::now();
+            due.clear();
+            finished.clear();
+            for (const auto& s : active_) {
+                if (s->finishing) {
+                    finished.push_back(s);
+                    continue;
+                }
+                if (s->nextDue > now) continue;
+                s->nextDue = now + s->interval;
+                due.push_back(s);
+            }
+            // Колбэки — без mutex_: из них можно запускать новые операции
+            lock.unlock();
+            for (const auto& s : due) deliver(*s);
+            for (const auto& s : finished) deliverFinal(*s);
+            due.clear();
+            lock.lock();
+            for (const auto& s : finished)
+                active_.erase(std::remove(active_.begin(), active_.end(), s), active_.end());
+            finished.clear();
+        }
+    }
+
+    static void deliver(ProgressTracker::State& s) {
+        std::lock_guard<std::mutex> lock(s.deliverMutex);
+        if (!s.alive) return;
+        ProgressSnapshot snap = s.snapshot();
+        if (snap.done == s.lastDone && snap.stage == s.lastStage) return;
+        s.lastDone = snap.done;
+        s.lastStage = snap.stage;
+        s.report(snap);
+    }
+
+    static void deliverFinal(ProgressTracker::State& s) {
+        std::lock_guard<std::mutex> lock(s.deliverMutex);
+        if (!s.alive) return;
+        s.alive = false;
+        s.report(finalSnapshot(s));
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<std::shared_ptr<ProgressTracker::State>> active_;
+    bool stop_ = false;
+    std::mutex lifeMutex_;   // запуск и остановка потока
+    std::atomic<bool> running_{false};
+    std::thread worker_;
+};
+
+} // namespace
+
+ProgressSnapshot ProgressTracker::State::snapshot() const {
+    ProgressSnapshot snap;
+    snap.total = total.load(std::memory_order_relaxed);
+    snap.done = std::min(done.load(std::memory_order_relaxed), snap.total);
+    snap.stage = stage.load(std::memory_order_relaxed);
+    snap.elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    if (snap.total > 0) {
+        snap.fraction = static_cast<float>(double(snap.done) / double(snap.total));
+        if (snap.done > 0) snap.eta = snap.elapsed * double(snap.total - snap.done) / double(snap.done);
+    }
+    return snap;
+}
+
+ProgressTracker::ProgressTracker(ProgressReportFn report, uint64_t total, const char* stage, unsigned maxPerSecond)
+    : state_(std::make_shared<State>()) {
+    state_->total = total;
+    state_->stage = stage;
+    state_->start = Clock::now();
+    if (!report) return;
+    state_->report = std::move(report);
+    // 0 — без ограничения: фоновый поток опрашивает раз в миллисекунду
+    state_->interval = maxPerSecond ? std::chrono::duration_cast<Clock::duration>(std::chrono::seconds(1)) / maxPerSecond
+                                    : std::chrono::duration_cast<Clock::duration>(std::chrono::milliseconds(1));
+    state_->nextDue = state_->start + state_->interval;
+    ProgressReporter::instance().add(state_);
+}
+
+ProgressTracker::~ProgressTracker() {
+    if (state_) stop();
+}
+
+void ProgressTracker::stop() {
+    if (!state_->report) return;
+    ProgressReporter::instance().remove(state_.get());
+    std::lock_guard<std::mutex> lock(state_->deliverMutex);
+    state_->alive = false;
+}
+
+void ProgressTracker::finish() {
+    if (!state_->report) return;
+    stop();
+    state_->report(finalSnapshot(*state_));
+    state_->report = nullptr;
+}
+
+void progressShutdown() {
+    ProgressReporter::instance().shutdown();
+}
+
+void ProgressTracker::finishInBackground() {
+    if (!state_->report) return;
+    ProgressReporter::instance().finishLater(state_);
+    state_.reset();
+}
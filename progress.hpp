@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+// ─────────────────────────────────────────────────────────────
+//  Прогресс операций. Рабочие потоки только прибавляют выполненные
+//  единицы работы (строки, узлы решётки, файлы) к атомарному
+//  счётчику; один фоновый поток собирает счётчики всех идущих
+//  операций и вызывает колбэки не чаще заданной частоты — с оценкой
+//  оставшегося времени и названием этапа.
+// ─────────────────────────────────────────────────────────────
+
+struct ProgressSnapshot {
+    uint64_t done = 0;
+    uint64_t total = 0;
+    float fraction = 0.0f;
+    double elapsed = 0.0;          // секунды с начала операции
+    double eta = -1.0;             // секунды до конца; -1 — пока неизвестно
+    const char* stage = "";
+};
+
+using ProgressReportFn = std::function<void(const ProgressSnapshot&)>;
+
+class ProgressTracker {
+public:
+    // Пустой report — прогресс считается, но никуда не отправляется и фоновый поток
+    // о трекере не знает. stage — строковый литерал.
+    ProgressTracker(ProgressReportFn report, uint64_t total, const char* stage, unsigned maxPerSecond);
+    ~ProgressTracker();
+    ProgressTracker(ProgressTracker&&) noexcept = default;
+    ProgressTracker& operator=(ProgressTracker&&) = delete;
+    ProgressTracker(const ProgressTracker&) = delete;
+    ProgressTracker& operator=(const ProgressTracker&) = delete;
+
+    void add(uint64_t units = 1) { state_->done.fetch_add(units, std::memory_order_relaxed); }
+    // Объём работы, ставший известным по ходу (например, высота после декодирования)
+    void addTotal(uint64_t units) { state_->total.fetch_add(units, std::memory_order_relaxed); }
+    void setStage(const char* stage) { state_->stage.store(stage, std::memory_order_relaxed); }
+
+    // Последний отчёт (100 %) — в вызывающем потоке. После finish и после деструктора
+    // report больше не вызывается.
+    void finish();
+    // Для операций, которые завершают рабочие потоки уже после возврата из API: последний
+    // отчёт доставляет фоновый поток, затем снимает трекер с учёта. Деструктор его не отменяет.
+    void finishInBackground();
+
+    struct State {
+        std::atomic<uint64_t> done{0};
+        std::atomic<uint64_t> total{0};
+        std::atomic<const char*> stage{""};
+        std::chrono::steady_clock::time_point start;
+        std::chrono::steady_clock::duration interval{};
+        ProgressReportFn report;
+        // Доставка и снятие с учёта сериализуются: после alive = false колбэков нет
+        std::mutex deliverMutex;
+        bool alive = true;
+        // Под mutex фонового потока
+        bool finishing = false;
+        // Только фоновый поток
+        std::chrono::steady_clock::time_point nextDue;
+        uint64_t lastDone = UINT64_MAX;
+        const char* lastStage = nullptr;
+
+        ProgressSnapshot snapshot() const;
+    };
+
+private:
+    void stop();
+
+    std::shared_ptr<State> state_;
+};
+
+// Останавливает фоновый поток прогресса (LUTools_Cleanup); следующая операция запустит его снова
+void progressShutdown();
@@ -0,0 +1,220 @@
+#include "stats.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+// Гистограммы одного потока (~140 КБ) — выделяются при первом замере задержки
+struct ThreadLatency {
+    std::atomic<uint64_t> bins[kLatOpCount][kLatSizeCount][kLatBins] = {};
+    std::atomic<uint64_t> sumNanos[kLatOpCount][kLatSizeCount] = {};
+};
+
+// Счётчики одного потока: пишет только владелец, читатели — атомарно
+struct alignas(64) ThreadStats {
+    std::atomic<uint64_t> values[kStatCount][4] = {};
+    std::atomic<ThreadLatency*> latency{nullptr};
+};
+
+struct StatRegistry {
+    std::mutex mutex;
+    std::vector<ThreadStats*> threads;
+    StatCounters retired[kStatCount];   // завершившиеся потоки
+    LatencySnapshot retiredLatency;
+
+    static StatRegistry& instance() {
+        // Не разрушается: потоки могут завершаться после выхода из main
+        static StatRegistry* registry = new StatRegistry;
+        return *registry;
+    }
+};
+
+void fold(const ThreadLatency& t, LatencySnapshot& out) {
+    for (int op = 0; op < kLatOpCount; ++op)
+        for (int size = 0; size < kLatSizeCount; ++size) {
+            LatencyHistogram& h = out.hist[op][size];
+            for (int b = 0; b < kLatBins; ++b) {
+                const uint64_t n = t.bins[op][size][b].load(std::memory_order_relaxed);
+                h.bins[b] += n;
+                h.count += n;
+            }
+            h.sumNanos += t.sumNanos[op][size].load(std::memory_order_relaxed);
+        }
+}
+
+void fold(const ThreadStats& t, StatCounters (&out)[kStatCount]) {
+    for (int s = 0; s < kStatCount; ++s) {
+        out[s].calls += t.values[s][0].load(std::memory_order_relaxed);
+        out[s].pixels += t.values[s][1].load(std::memory_order_relaxed);
+        out[s].bytes += t.values[s][2].load(std::memory_order_relaxed);
+        out[s].nanos += t.values[s][3].load(std::memory_order_relaxed);
+    }
+}
+
+// Регистрирует счётчики потока при первом замере и переносит их в итог при выходе
+class ThreadSlot {
+public:
+    ThreadSlot() {
+        StatRegistry& r = StatRegistry::instance();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.threads.push_back(&stats_);
+    }
+    ~ThreadSlot() {
+        StatRegistry& r = StatRegistry::instance();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        fold(stats_, r.retired);
+        if (ThreadLatency* latency = stats_.latency.load(std::memory_order_relaxed)) {
+            fold(*latency, r.retiredLatency);
+            delete latency;
+        }
+        r.threads.erase(std::find(r.threads.begin(), r.threads.end(), &stats_));
+    }
+    ThreadStats& stats() { return stats_; }
+
+private:
+    ThreadStats stats_;
+};
+
+ThreadStats& localStats() {
+    thread_local ThreadSlot slot;
+    return slot.stats();
+}
+
+// Индекс корзины: до 64 мкс — по одной микросекунде, дальше старшие kLatSubBits+1 бит значения
+int latencyBin(uint64_t micros) {
+    if (micros < (2u << kLatSubBits)) return static_cast<int>(micros);
+    int msb = kLatSubBits + 1;
+    while (msb < 63 && (micros >> (msb + 1))) ++msb;
+    const int shift = msb - kLatSubBits;
+    const int bin = (shift << kLatSubBits) + static_cast<int>(micros >> shift);
+    return std::min(bin, kLatBins - 1);
+}
+
+// Верхняя граница корзины (не включая), микросекунды
+uint64_t latencyBinUpper(int bin) {
+    if (bin < (2 << kLatSubBits)) return uint64_t(bin) + 1;
+    const int shift = (bin >> kLatSubBits) - 1;
+    const uint64_t sub = uint64_t(bin) - (uint64_t(shift) << kLatSubBits);
+    return (sub + 1) << shift;
+}
+
+const char* const kLatOpNames[kLatOpCount] = {"ProcessFile", "ProcessImage", "GeneratePreview", "GeneratePreviewFit"};
+const char* const kLatSizeNames[kLatSizeCount] = {"<0.25MP", "0.25-1MP", "1-4MP", "4-16MP", ">=16MP"};
+
+} // namespace
+
+void statAdd(StatStage stage, uint64_t nanos, uint64_t pixels, uint64_t bytes) {
+    std::atomic<uint64_t>* v = localStats().values[stage];
+    v[0].fetch_add(1, std::memory_order_relaxed);
+    v[1].fetch_add(pixels, std::memory_order_relaxed);
+    v[2].fetch_add(bytes, std::memory_order_relaxed);
+    v[3].fetch_add(nanos, std::memory_order_relaxed);
+}
+
+void statSnapshot(StatCounters (&out)[kStatCount]) {
+    StatRegistry& r = StatRegistry::instance();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    std::copy(std::begin(r.retired), std::end(r.retired), out);
+    for (const ThreadStats* t : r.threads) fold(*t, out);
+}
+
+void statReset() {
+    StatRegistry& r = StatRegistry::instance();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    std::fill(std::begin(r.retired), std::end(r.retired), StatCounters());
+    r.retiredLatency = LatencySnapshot();
+    for (ThreadStats* t : r.threads) {
+        for (auto& stage : t->values)
+            for (auto& v : stage) v.store(0, std::memory_order_relaxed);
+        if (ThreadLatency* latency = t->latency.load(std::memory_order_acquire)) {
+            for (auto& op : latency->bins)
+                for (auto& size : op)
+                    for (auto& v : size) v.store(0, std::memory_order_relaxed);
+            for (auto& op : latency->sumNanos)
+                for (auto& v : op) v.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+// ─────────────────────────────────────────────────────────────
+//  Гистограммы задержек
+// ─────────────────────────────────────────────────────────────
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (int b = 0; b < kLatBins; ++b) bins[b] += other.bins[b];
+    count += other.count;
+    sumNanos += other.sumNanos;
+}
+
+double LatencyHistogram::quantile(double q) const {
+    if (count == 0) return 0.0;
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * double(count))));
+    uint64_t seen = 0;
+    for (int b = 0; b < kLatBins; ++b) {
+        seen += bins[b];
+        if (seen >= rank) return double(latencyBinUpper(b)) * 1e-6;
+    }
+    return double(latencyBinUpper(kLatBins - 1)) * 1e-6;
+}
+
+int latencySizeBucket(uint64_t pixels) {
+    if (pixels < 250000) return 0;
+    if (pixels < 1000000) return 1;
+    if (pixels < 4000000) return 2;
+    if (pixels < 16000000) return 3;
+    return 4;
+}
+
+void latencyRecord(LatencyOp op, uint64_t pixels, uint64_t nanos) {
+    ThreadStats& t = localStats();
+    ThreadLatency* latency = t.latency.load(std::memory_order_relaxed);
+    if (!latency) {
+        latency = new ThreadLatency;
+        t.latency.store(latency, std::memory_order_release);
+    }
+    const int size = latencySizeBucket(pixels);
+    latency->bins[op][size][latencyBin(nanos / 1000)].fetch_add(1, std::memory_order_relaxed);
+    latency->sumNanos[op][size].fetch_add(nanos, std::memory_order_relaxed);
+}
+
+void latencySnapshot(LatencySnapshot& out) {
+    StatRegistry& r = StatRegistry::instance();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    out = r.retiredLatency;
+    for (const ThreadStats* t : r.threads)
+        if (const ThreadLatency* latency = t->latency.load(std::memory_order_acquire)) fold(*latency, out);
+}
+
+std::string latencyMetricsText() {
+    auto snapshot = std::make_unique<LatencySnapshot>();
+    latencySnapshot(*snapshot);
+    std::ostringstream out;
+    out << std::setprecision(9);
+    out << "# HELP lutools_latency_seconds Latency of successful API calls by input image size\n"
+        << "# TYPE lutools_latency_seconds summary\n";
+    for (int op = 0; op < kLatOpCount; ++op)
+        for (int size = 0; size < kLatSizeCount; ++size) {
+            const LatencyHistogram& h = snapshot->hist[op][size];
+            if (h.count == 0) continue;
+            const std::string labels = std::string("op=\"") + kLatOpNames[op] + "\",size=\"" + kLatSizeNames[size] + "\"";
+            for (double q : {0.5, 0.95, 0.99})
+                out << "lutools_latency_seconds{" << labels << ",quantile=\"" << q << "\"} " << h.quantile(q) << "\n";
+            out << "lutools_latency_seconds_sum{" << labels << "} " << double(h.sumNanos) * 1e-9 << "\n"
+                << "lutools_latency_seconds_count{" << labels << "} " << h.count << "\n";
+        }
+    out << "# HELP lutools_latency_max_seconds Slowest successful API call by input image size\n"
+        << "# TYPE lutools_latency_max_seconds gauge\n";
+    for (int op = 0; op < kLatOpCount; ++op)
+        for (int size = 0; size < kLatSizeCount; ++size) {
+            const LatencyHistogram& h = snapshot->hist[op][size];
+            if (h.count == 0) continue;
+            out << "lutools_latency_max_seconds{op=\"" << kLatOpNames[op] << "\",size=\"" << kLatSizeNames[size] << "\"} "
+                << h.maxSeconds() << "\n";
+        }
+    return out.str();
+}
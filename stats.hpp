@@ -0,0 +1,126 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// ─────────────────────────────────────────────────────────────
+//  Счётчики производительности по этапам конвейера: вызовы,
+//  пиксели, байты и наносекунды, и гистограммы задержек вызовов
+//  API по размеру изображения. Каждый поток пишет в свои
+//  счётчики (без общих кеш-линий), чтение суммирует все потоки;
+//  счётчики завершившихся потоков переносятся в общий итог.
+// ─────────────────────────────────────────────────────────────
+
+// Порядок совпадает с LTL_STAT_* в LUToolsLite.h
+enum StatStage : int {
+    kStatDecode = 0,       // декодирование; байты — сжатые входные
+    kStatResize,
+    kStatApply,            // LUT и коррекции — один проход по пикселям
+    kStatEncode,           // кодирование; байты — сжатые выходные
+    kStatLUTLookup,        // поиск цепочки LUT в реестре
+    kStatLUTLoad,          // чтение .cube; байты — размер таблицы
+    kStatLUTBuild,         // k-NN в CreateLUTFromImages; пиксели — узлы решётки
+    kStatQueueWait,        // ожидание в очереди пула и места в пакете
+    kStatCount
+};
+
+struct StatCounters {
+    uint64_t calls = 0;
+    uint64_t pixels = 0;
+    uint64_t bytes = 0;
+    uint64_t nanos = 0;
+};
+
+void statAdd(StatStage stage, uint64_t nanos, uint64_t pixels = 0, uint64_t bytes = 0);
+// Сумма по всем потокам
+void statSnapshot(StatCounters (&out)[kStatCount]);
+void statReset();
+
+// Замер этапа: время от конструктора до деструктора
+class StatTimer {
+public:
+    explicit StatTimer(StatStage stage) : stage_(stage), start_(std::chrono::steady_clock::now()) {}
+    ~StatTimer() {
+        const auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count();
+        statAdd(stage_, static_cast<uint64_t>(nanos), pixels_, bytes_);
+    }
+    StatTimer(const StatTimer&) = delete;
+    StatTimer& operator=(const StatTimer&) = delete;
+
+    void pixels(uint64_t n) { pixels_ = n; }
+    void bytes(uint64_t n) { bytes_ = n; }
+
+private:
+    StatStage stage_;
+    std::chrono::steady_clock::time_point start_;
+    uint64_t pixels_ = 0;
+    uint64_t bytes_ = 0;
+};
+
+// ─────────────────────────────────────────────────────────────
+//  Гистограммы задержек (лог-линейные, как в HdrHistogram):
+//  микросекунды; до 64 мкс — точно, дальше в каждой степени двойки
+//  32 корзины, относительная погрешность не больше 1/32.
+// ─────────────────────────────────────────────────────────────
+
+// Порядок совпадает с LTL_LATENCY_* в LUToolsLite.h
+enum LatencyOp : int {
+    kLatProcessFile = 0,
+    kLatProcessImage,
+    kLatPreview,
+    kLatPreviewFit,
+    kLatOpCount
+};
+
+// Размер входного изображения: <0.25, <1, <4, <16, от 16 мегапикселей (LTL_SIZE_*)
+constexpr int kLatSizeCount = 5;
+constexpr int kLatSubBits = 5;
+// До 2^32 мкс (~71 мин); больше — в последнюю корзину
+constexpr int kLatBins = (32 - kLatSubBits + 1) << kLatSubBits;
+
+struct LatencyHistogram {
+    uint64_t bins[kLatBins] = {};
+    uint64_t count = 0;
+    uint64_t sumNanos = 0;
+
+    void merge(const LatencyHistogram& other);
+    // Верхняя граница корзины, в которую попадает квантиль q, в секундах; 0 — пусто
+    double quantile(double q) const;
+    double maxSeconds() const { return quantile(1.0); }
+};
+
+struct LatencySnapshot {
+    LatencyHistogram hist[kLatOpCount][kLatSizeCount];
+};
+
+int latencySizeBucket(uint64_t pixels);
+void latencyRecord(LatencyOp op, uint64_t pixels, uint64_t nanos);
+// Сумма по всем потокам; statReset обнуляет и гистограммы
+void latencySnapshot(LatencySnapshot& out);
+// Текстовый снимок в формате Prometheus (summary с квантилями 0.5/0.95/0.99)
+std::string latencyMetricsText();
+
+// Замер вызова API: записывается в деструкторе, только если вызван succeeded()
+class LatencyTimer {
+public:
+    explicit LatencyTimer(LatencyOp op, uint64_t pixels = 0)
+        : op_(op), pixels_(pixels), start_(std::chrono::steady_clock::now()) {}
+    ~LatencyTimer() {
+        if (!ok_) return;
+        const auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count();
+        latencyRecord(op_, pixels_, static_cast<uint64_t>(nanos));
+    }
+    LatencyTimer(const LatencyTimer&) = delete;
+    LatencyTimer& operator=(const LatencyTimer&) = delete;
+
+    // Размер становится известен после декодирования
+    void pixels(uint64_t n) { pixels_ = n; }
+    void succeeded() { ok_ = true; }
+
+private:
+    LatencyOp op_;
+    uint64_t pixels_;
+    std::chrono::steady_clock::time_point start_;
+    bool ok_ = false;
+};
@@ -0,0 +1,108 @@
+#include "test_framework.hpp"
+#include "test_util.hpp"
+#include "buffer_pool.hpp"
+#include "LUToolsLite.h"
+#include <cstdint>
+#include <thread>
+
+using namespace ltltest;
+
+TEST_CASE(buffer_pool, buffers_are_aligned) {
+    BufferPool& pool = BufferPool::instance();
+    for (size_t size : { size_t(1), size_t(63), size_t(1000), size_t(100000), size_t(3) * 1024 * 1024 }) {
+        unsigned char* p = pool.acquire(size);
+        CHECK(reinterpret_cast<uintptr_t>(p) % BufferPool::kAlignment == 0);
+        p[size - 1] = 1;   // вся запрошенная длина доступна
+        CHECK(pool.release(p));
+    }
+}
+
+TEST_CASE(buffer_pool, released_buffer_is_reused) {
+    BufferPool& pool = BufferPool::instance();
+    pool.setCacheLimit(1ull << 30);
+    pool.trim();
+    const BufferPoolStats before = pool.stats();
+    unsigned char* a = pool.acquire(50000);
+    CHECK(pool.release(a));
+    // Тот же размерный класс — тот же буфер без обращения к ОС
+    unsigned char* b = pool.acquire(52000);
+    CHECK(b == a);
+    const BufferPoolStats after = pool.stats();
+    CHECK_EQ(after.acquires - before.acquires, uint64_t(2));
+    CHECK_EQ(after.reuses - before.reuses, uint64_t(1));
+    CHECK_EQ(after.systemAllocs - before.systemAllocs, uint64_t(1));
+    CHECK(after.bytesInUse >= 50000);
+    pool.release(b);
+}
+
+TEST_CASE(buffer_pool, foreign_pointer_is_not_released) {
+    int local = 0;
+    CHECK(!BufferPool::instance().release(&local));
+    CHECK(!BufferPool::instance().release(nullptr));
+}
+
+TEST_CASE(buffer_pool, limit_and_trim_return_memory) {
+    BufferPool& pool = BufferPool::instance();
+    pool.setCacheLimit(1ull << 30);
+    pool.trim();
+    unsigned char* a = pool.acquire(200000);
+    unsigned char* b = pool.acquire(400000);
+    pool.release(a);
+    pool.release(b);
+    CHECK(pool.stats().bytesCached >= 600000);
+
+    // Лимит меньше закешированного: лишнее (сначала крупное) уходит ОС
+    uint64_t frees = pool.stats().systemFrees;
+    pool.setCacheLimit(300000);
+    CHECK(pool.stats().bytesCached <= 300000);
+    CHECK(pool.stats().bytesCached > 0);
+    CHECK_EQ(pool.stats().systemFrees - frees, uint64_t(1));
+
+    pool.trim();
+    CHECK_EQ(pool.stats().bytesCached, uint64_t(0));
+
+    // Лимит 0 — ничего не кешируется
+    pool.setCacheLimit(0);
+    frees = pool.stats().systemFrees;
+    pool.release(pool.acquire(1000));
+    CHECK_EQ(pool.stats().bytesCached, uint64_t(0));
+    CHECK_EQ(pool.stats().systemFrees - frees, uint64_t(1));
+    pool.setCacheLimit(1ull << 30);
+}
+
+TEST_CASE(buffer_pool, c_api_reports_pool_stats) {
+    LUTools_SetPoolLimit(1ull << 30);
+    LUTools_TrimPool();
+    unsigned char* p = BufferPool::instance().acquire(10000);
+    LUTools_PoolStats stats{};
+    LUTools_GetPoolStats(&stats);
+    CHECK(stats.bytesInUse >= 10000);
+    CHECK(stats.peakBytes >= stats.bytesInUse);
+    LUTools_FreeMemory(p);
+    LUTools_GetPoolStats(&stats);
+    CHECK(stats.bytesCached >= 10000);
+    LUTools_TrimPool();
+    LUTools_GetPoolStats(&stats);
+    CHECK_EQ(stats.bytesCached, 0ull);
+}
+
+TEST_CASE(buffer_pool, concurrent_acquire_release) {
+    BufferPool& pool = BufferPool::instance();
+    const BufferPoolStats before = pool.stats();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&pool, t] {
+            for (int i = 0; i < 500; ++i) {
+                unsigned char* p = pool.acquire(size_t(1000 + (i % 7) * 3000 + t));
+                p[0] = static_cast<unsigned char>(i);
+                pool.release(p);
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    const BufferPoolStats after = pool.stats();
+    CHECK_EQ(after.acquires - before.acquires, uint64_t(2000));
+    CHECK_EQ(after.bytesInUse, before.bytesInUse);
+    // Почти всё обслужено из пула
+    CHECK(after.reuses - before.reuses > 1900);
+}
@@ -0,0 +1,293 @@
+#include "test_framework.hpp"
+#include "test_util.hpp"
+#include "cancel_token.hpp"
+#include "codec.hpp"
+#include "jpeg_codec.hpp"
+#include "thread_pool.hpp"
+#include "trace.hpp"
+#include "LUToolsLite.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+
+using namespace ltltest;
+
+namespace {
+
+Color invert(float r, float g, float b) { return Color{1 - r, 1 - g, 1 - b}; }
+
+int loadInvert() {
+    const std::string cube = tempPath("invert.cube");
+    writeCube(cube, 33, "Invert", invert);
+    int id = 0;
+    REQUIRE_EQ(LUTools_LoadLUT(cube.c_str(), 1.0f, &id), SUCCESS);
+    return id;
+}
+
+// Приёмник, который отменяет токен на записи номер armAt и дальше, как EncodeSink, отказывает
+class TripwireSink : public ByteSink {
+public:
+    TripwireSink(CancelToken& token, int armAt) : token_(token), armAt_(armAt) {}
+    bool write(const void*, size_t size) override {
+        if (token_.cancelled()) {
+            ++refused;
+            return false;
+        }
+        bytes += size;
+        if (++writes == armAt_) token_.cancel();
+        return true;
+    }
+    size_t bytes = 0;
+    int writes = 0;
+    int refused = 0;   // попытки записи после отмены: кодек должен остановиться на первой
+private:
+    CancelToken& token_;
+    int armAt_;
+};
+
+// Сколько полос кодек закодировал за время fn (по событиям трассировки)
+template <typename Fn>
+int countEncodedStrips(Fn fn) {
+    Tracer::instance().start();
+    fn();
+    Tracer::instance().stop();
+    VectorSink json;
+    REQUIRE(Tracer::instance().writeJson(json));
+    const std::string text(json.bytes.begin(), json.bytes.end());
+    int n = 0;
+    for (size_t p = text.find("\"Encode strip\""); p != std::string::npos; p = text.find("\"Encode strip\"", p + 1)) ++n;
+    return n;
+}
+
+// Внешний кодек: decodeHook/encodeHook вызываются посреди операции
+struct HookCodec {
+    Image source;
+    std::function<void()> decodeHook;
+    std::function<void()> encodeHook;
+
+    HookCodec(const Image& img, const char* formats) : source(img) {
+        LUTools_CodecDesc desc{};
+        desc.name = "cancel_hook";
+        desc.formats = formats;
+        desc.capabilities = LTL_CODEC_CAP_DECODE | LTL_CODEC_CAP_ENCODE;
+        desc.priority = 100;
+        desc.userData = this;
+        desc.decode = [](const unsigned char*, size_t, LUTools_DecodedImage* out, void* userData) {
+            auto* self = static_cast<HookCodec*>(userData);
+            if (self->decodeHook) self->decodeHook();
+            out->width = self->source.width;
+            out->height = self->source.height;
+            out->pixels = static_cast<unsigned char*>(std::malloc(self->source.data.size()));
+            std::memcpy(out->pixels, self->source.data.data(), self->source.data.size());
+            out->release = [](unsigned char* p, void*) { std::free(p); };
+            return 0;
+        };
+        desc.encode = [](const unsigned char* rgb, int width, int height, const char*, int, LUTools_WriteFn write,
+                         void* writeContext, void* userData) {
+            auto* self = static_cast<HookCodec*>(userData);
+            const int rowBytes = width * 3;
+            for (int y = 0; y < height; ++y) {
+                if (y == height / 2 && self->encodeHook) self->encodeHook();
+                write(writeContext, rgb + size_t(y) * rowBytes, rowBytes);
+            }
+            return 0;
+        };
+        REQUIRE_EQ(LUTools_RegisterCodec(&desc), SUCCESS);
+    }
+    ~HookCodec() { LUTools_UnregisterCodec("cancel_hook"); }
+};
+
+} // namespace
+
+TEST_CASE(cancel, flag_cancels_every_entry_point) {
+    REQUIRE_EQ(LUTools_Init(), SUCCESS);
+    const int lut = loadInvert();
+    const Image img = makeImage(64, 48, 4);
+    const std::string input = tempPath("flag_in.png");
+    REQUIRE(saveImage(img, input, "png"));
+
+    int flag = 1;
+    LUTools_SetCancelFlag(&flag);
+    CHECK_EQ(LUTools_IsCancelled(), 1);
+    Image out;
+    CHECK_EQ(applyLUTs(img, { lut }, out), CANCELLED);
+
+    const std::string output = tempPath("flag_out.png");
+    CHECK_EQ(LUTools_ProcessFileEx(input.c_str(), output.c_str(), &lut, 1, 0, 0, 0, 0, 0, nullptr, nullptr, nullptr), CANCELLED);
+    CHECK(!std::filesystem::exists(output));
+
+    const char* inputs[] = { input.c_str(), input.c_str() };
+    const std::string out1 = tempPath("flag_b1.jpg"), out2 = tempPath("flag_b2.jpg");
+    const char* outputs[] = { out1.c_str(), out2.c_str() };
+    CHECK_EQ(LUTools_ProcessFilesEx(inputs, outputs, 2, &lut, 1, 0, 0, 0, 0, 0, nullptr, nullptr, nullptr), CANCELLED);
+    CHECK(!std::filesystem::exists(out1) && !std::filesystem::exists(out2));
+
+    const int sizes[] = { 9 };
+    const std::string prefix = tempPath("flag_lut");
+    CHECK_EQ(LUTools_CreateLUTFromImages(input.c_str(), input.c_str(), prefix.c_str(), sizes, 1), CANCELLED);
+
+    const char* message = nullptr;
+    LUTools_GetLastErrorMessage(&message);
+    CHECK_EQ(std::string(message), std::string("Operation cancelled"));
+
+    // Сброшенный флаг больше ничего не отменяет
+    flag = 0;
+    CHECK_EQ(LUTools_IsCancelled(), 0);
+    CHECK_EQ(applyLUTs(img, { lut }, out), SUCCESS);
+    LUTools_SetCancelFlag(nullptr);
+}
+
+TEST_CASE(cancel, encoders_stop_at_next_strip) {
+    const Image img = makeImage(512, 2048, 20);
+    // Полосы собственных кодеков идут пачками по (воркеры + 1) * 2
+    const int batch = static_cast<int>(ThreadPool::instance().size() + 1) * 2;
+    const struct { const char* codec; const char* format; int restartRows; } cases[] = {
+        { "ltl-jpeg", "jpg", 0 }, { "ltl-jpeg", "jpg", 2 }, { "ltl-png", "png", 0 },
+        { "libjpeg-turbo", "jpg", 0 }, { "libpng", "png", 0 },
+    };
+    for (const auto& c : cases) {
+        CodecPtr codec = CodecRegistry::instance().byName(c.codec);
+        if (!codec) continue;   // бэкенд не собран
+        EncodeOptions options;
+        options.restartRows = c.restartRows;
+        VectorSink full;
+        const int allStrips = countEncodedStrips([&] { REQUIRE(codec->encode(img, c.format, options, full)); });
+
+        // Отмена сразу после первой записи данных (первая — заголовок)
+        CancelToken token;
+        options.cancel = &token;
+        TripwireSink sink(token, 2);
+        bool ok = true;
+        const int strips = countEncodedStrips([&] { ok = codec->encode(img, c.format, options, sink); });
+        CHECK(!ok);
+        CHECK(sink.refused <= 1);
+        CHECK(sink.bytes < full.bytes.size() / 2);
+        CHECK(strips <= batch);
+        if (allStrips > batch) CHECK(strips < allStrips);
+    }
+}
+
+TEST_CASE(cancel, decoders_respect_cancelled_token) {
+    const Image img = makeImage(256, 256, 10);
+    EncodeOptions jpeg;
+    jpeg.restartRows = 1;
+    VectorSink encoded;
+    REQUIRE(encodeImage(img, "jpg", jpeg, encoded));
+    CancelToken token;
+    Image out;
+    REQUIRE(decodeJpeg(encoded.bytes.data(), encoded.bytes.size(), out, &token));
+    token.cancel();
+    out = Image();
+    CHECK(!decodeJpeg(encoded.bytes.data(), encoded.bytes.size(), out, &token));
+
+    const std::string path = tempPath("decode.jpg");
+    REQUIRE(writeFile(path, encoded.bytes));
+    CHECK(!loadImage(path, &token).valid());
+}
+
+TEST_CASE(cancel, cancel_during_encoding_removes_partial_file) {
+    REQUIRE_EQ(LUTools_Init(), SUCCESS);
+    const int lut = loadInvert();
+    const Image img = makeImage(64, 64);
+    HookCodec codec(img, "bmp");
+    codec.encodeHook = [] { LUTools_Cancel(); };
+    const std::string input = tempPath("enc_in.bmp"), output = tempPath("enc_out.bmp");
+    REQUIRE(saveImage(img, input, "png"));   // содержимое не важно: декодирует HookCodec
+    LUTools_OutputOptions o{};
+    LUTools_GetDefaultOutputOptions(&o);
+    o.format = LTL_FORMAT_BMP;
+    CHECK_EQ(LUTools_ProcessFileEx(input.c_str(), output.c_str(), &lut, 1, 0, 0, 0, 0, 0, &o, nullptr, nullptr), CANCELLED);
+    CHECK(!std::filesystem::exists(output));
+
+    // LUTools_Cancel касается только уже идущих операций
+    codec.encodeHook = nullptr;
+    CHECK_EQ(LUTools_ProcessFileEx(input.c_str(), output.c_str(), &lut, 1, 0, 0, 0, 0, 0, &o, nullptr, nullptr), SUCCESS);
+    CHECK_EQ(std::filesystem::file_size(output), uintmax_t(64 * 64 * 3));
+}
+
+TEST_CASE(cancel, cancel_stops_batch_between_files) {
+    REQUIRE_EQ(LUTools_Init(), SUCCESS);
+    LUTools_Context* ctx = LUTools_CreateContext(1);   // файлы пакета по одному
+    const std::string cube = tempPath("batch.cube");
+    writeCube(cube, 17, "", invert);
+    int lut = 0;
+    REQUIRE_EQ(LUTools_LoadLUTCtx(ctx, cube.c_str(), 1.0f, &lut), SUCCESS);
+
+    const Image img = makeImage(32, 32);
+    const std::string input = tempPath("batch_in.png");
+    REQUIRE(saveImage(img, input, "png"));
+    HookCodec codec(img, "png");
+    std::atomic<int> decodes{0};
+    codec.decodeHook = [&] {
+        if (++decodes == 2) LUTools_CancelCtx(ctx);
+    };
+    std::vector<std::string> outNames;
+    std::vector<const char*> inputs, outputs;
+    for (int i = 0; i < 6; ++i) outNames.push_back(tempPath("batch_out" + std::to_string(i) + ".qoi"));
+    for (const auto& n : outNames) {
+        inputs.push_back(input.c_str());
+        outputs.push_back(n.c_str());
+    }
+    LUTools_OutputOptions o{};
+    LUTools_GetDefaultOutputOptions(&o);
+    o.format = LTL_FORMAT_QOI;
+    CHECK_EQ(LUTools_ProcessFilesExCtx(ctx, inputs.data(), outputs.data(), 6, &lut, 1, 0, 0, 0, 0, 0, &o, nullptr, nullptr), CANCELLED);
+    CHECK(std::filesystem::exists(outNames[0]));
+    for (int i = 1; i < 6; ++i) CHECK(!std::filesystem::exists(outNames[i]));
+    CHECK(decodes.load() == 2);
+    LUTools_DestroyContext(ctx);
+}
+
+TEST_CASE(cancel, cancel_from_another_thread_interrupts_kernel) {
+    REQUIRE_EQ(LUTools_Init(), SUCCESS);
+    const int lut = loadInvert();
+    const Image img = makeImage(2000, 1500);
+    const std::vector<int> chain(8, lut);
+
+    // Отмена из фонового потока прогресса, как только ядро обработало первые строки;
+    // событие "Cancelled" отмечает момент на той же шкале, что и тайлы
+    struct Trip {
+        std::atomic<bool> flipped{false};
+        static void callback(const LUTools_Progress* p, void* userData) {
+            auto* self = static_cast<Trip*>(userData);
+            if (p->done == 0 || p->done == p->total || self->flipped) return;
+            LUTools_Cancel();
+            TraceScope mark("Cancelled", "test");
+            self->flipped = true;
+        }
+    } trip;
+    LUTools_SetProgressRate(0);
+    LUTools_SetProgressCallbackEx(Trip::callback, &trip);
+    Tracer::instance().start();
+    Image out;
+    const int rc = applyLUTs(img, chain, out);
+    Tracer::instance().stop();
+    LUTools_SetProgressCallbackEx(nullptr, nullptr);
+    LUTools_SetProgressRate(10);
+    REQUIRE(trip.flipped);
+    CHECK_EQ(rc, CANCELLED);
+
+    // Время начала событий по имени, по строке JSON на событие
+    VectorSink json;
+    REQUIRE(Tracer::instance().writeJson(json));
+    const std::string text(json.bytes.begin(), json.bytes.end());
+    auto starts = [&text](const std::string& name) {
+        std::vector<double> ts;
+        const std::string tag = "{\"name\":\"" + name + "\"";
+        for (size_t p = text.find(tag); p != std::string::npos; p = text.find(tag, p + 1))
+            ts.push_back(std::atof(text.c_str() + text.find("\"ts\":", p) + 5));
+        return ts;
+    };
+    const std::vector<double> mark = starts("Cancelled");
+    const std::vector<double> tiles = starts("Tile");
+    REQUIRE_EQ(mark.size(), size_t(1));
+    // Тайл проверяет отмену перед стартом: после неё мог начаться разве что тайл,
+    // уже прошедший проверку, — не больше одного на поток ядра
+    const int threads = static_cast<int>(ThreadPool::instance().size() + 1);
+    CHECK(std::count_if(tiles.begin(), tiles.end(), [&](double t) { return t > mark[0]; }) <= threads);
+    const int tilesPerPass = (img.height + 63) / 64;
+    CHECK(int(tiles.size()) < tilesPerPass * int(chain.size()));
+}
@@ -0,0 +1,161 @@
+#include "test_framework.hpp"
+#include "test_util.hpp"
+#include "codec.hpp"
+#include "LUToolsLite.h"
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using namespace ltltest;
+
+namespace {
+
+// Внешний декодер из теста: отдаёт заданный размер, считает освобождения
+struct FakeDecoder {
+    int width = 2;
+    int height = 1;
+    bool pixels = true;
+    int decodes = 0;
+    int releases = 0;
+};
+
+int fakeDecode(const unsigned char*, size_t, LUTools_DecodedImage* out, void* userData) {
+    auto* fake = static_cast<FakeDecoder*>(userData);
+    ++fake->decodes;
+    const int w = std::max(fake->width, 1), h = std::max(fake->height, 1);
+    out->width = fake->width;
+    out->height = fake->height;
+    out->pixels = nullptr;
+    if (fake->pixels) {
+        out->pixels = static_cast<unsigned char*>(std::malloc(size_t(w) * h * 3));
+        std::memset(out->pixels, 200, size_t(w) * h * 3);
+    }
+    out->release = [](unsigned char* p, void* u) {
+        ++static_cast<FakeDecoder*>(u)->releases;
+        std::free(p);
+    };
+    return 0;
+}
+
+LUTools_CodecDesc fakeDesc(FakeDecoder& fake) {
+    LUTools_CodecDesc desc{};
+    desc.name = "fake";
+    desc.formats = "png";
+    desc.capabilities = LTL_CODEC_CAP_DECODE;
+    desc.priority = 100;
+    desc.decode = fakeDecode;
+    desc.userData = &fake;
+    return desc;
+}
+
+std::vector<unsigned char> samplePng() {
+    VectorSink sink;
+    Image img = makeImage(5, 4);
+    REQUIRE(encodeImage(img, "png", EncodeOptions(), sink));
+    return sink.bytes;
+}
+
+} // namespace
+
+TEST_CASE(codec_registry, formats_and_signatures) {
+    CHECK_EQ(normalizeFormat(".JPEG"), std::string("jpg"));
+    CHECK_EQ(normalizeFormat("Png"), std::string("png"));
+    const unsigned char jpg[] = { 0xFF, 0xD8, 0xFF, 0xE0 };
+    const unsigned char png[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    const unsigned char qoi[] = { 'q', 'o', 'i', 'f' };
+    CHECK_EQ(detectFormat(jpg, sizeof(jpg)), std::string("jpg"));
+    CHECK_EQ(detectFormat(png, sizeof(png)), std::string("png"));
+    CHECK_EQ(detectFormat(qoi, sizeof(qoi)), std::string("qoi"));
+    CHECK_EQ(detectFormat(jpg, 2), std::string(""));
+}
+
+TEST_CASE(codec_registry, builtin_codecs) {
+    auto& registry = CodecRegistry::instance();
+    CHECK(registry.byName("stb") != nullptr);
+    for (const char* format : { "jpg", "png", "bmp", "tga", "qoi" }) {
+        CHECK(registry.find(format, CODEC_CAP_DECODE | CODEC_CAP_ENCODE) != nullptr);
+    }
+    // Лучшие первыми
+    auto all = registry.findAll("jpg", CODEC_CAP_DECODE);
+    REQUIRE(!all.empty());
+    for (size_t i = 1; i < all.size(); ++i) CHECK(all[i - 1]->priority() >= all[i]->priority());
+}
+
+TEST_CASE(codec_registry, external_decoder_is_adopted_without_copy) {
+    FakeDecoder fake;
+    LUTools_CodecDesc desc = fakeDesc(fake);
+    REQUIRE_EQ(LUTools_RegisterCodec(&desc), SUCCESS);
+    REQUIRE(CodecRegistry::instance().find("png", CODEC_CAP_DECODE)->name() == std::string("fake"));
+    const auto png = samplePng();
+    {
+        Image img;
+        REQUIRE(decodeImage(png.data(), png.size(), img));
+        CHECK_EQ(fake.decodes, 1);
+        CHECK_EQ(img.width, 2);
+        CHECK_EQ(img.height, 1);
+        CHECK_EQ(int(img.data[0]), 200);
+        CHECK_EQ(fake.releases, 0);
+    }
+    // Буфер плагина освобождается его release, когда Image его отпускает
+    CHECK_EQ(fake.releases, 1);
+    CHECK_EQ(LUTools_UnregisterCodec("fake"), SUCCESS);
+    CHECK(CodecRegistry::instance().byName("fake") == nullptr);
+}
+
+TEST_CASE(codec_registry, external_decoder_invalid_size_is_rejected) {
+    FakeDecoder fake;
+    fake.width = 0;
+    LUTools_CodecDesc desc = fakeDesc(fake);
+    REQUIRE_EQ(LUTools_RegisterCodec(&desc), SUCCESS);
+    const auto png = samplePng();
+    Image img;
+    // Плагин отклонён, изображение декодирует следующий кодек
+    REQUIRE(decodeImage(png.data(), png.size(), img));
+    CHECK_EQ(fake.decodes, 1);
+    CHECK_EQ(img.width, 5);
+    CHECK_EQ(img.height, 4);
+    // Буфер плагина возвращён ему, а не потерян
+    CHECK_EQ(fake.releases, 1);
+    const char* message = nullptr;
+    LUTools_GetLastErrorMessage(&message);
+    REQUIRE(message != nullptr);
+    CHECK(std::strstr(message, "fake") != nullptr);
+    CHECK(std::strstr(message, "0x1") != nullptr);
+
+    fake.width = 3;
+    fake.height = -2;
+    img = Image();
+    REQUIRE(decodeImage(png.data(), png.size(), img));
+    CHECK_EQ(img.width, 5);
+    CHECK_EQ(fake.releases, 2);
+    LUTools_UnregisterCodec("fake");
+}
+
+TEST_CASE(codec_registry, external_decoder_without_pixels_is_rejected) {
+    FakeDecoder fake;
+    fake.pixels = false;
+    LUTools_CodecDesc desc = fakeDesc(fake);
+    REQUIRE_EQ(LUTools_RegisterCodec(&desc), SUCCESS);
+    const auto png = samplePng();
+    Image img;
+    REQUIRE(decodeImage(png.data(), png.size(), img));
+    CHECK_EQ(img.width, 5);
+    CHECK_EQ(fake.releases, 0);
+    const char* message = nullptr;
+    LUTools_GetLastErrorMessage(&message);
+    REQUIRE(message != nullptr);
+    CHECK(std::strstr(message, "no pixels") != nullptr);
+    LUTools_UnregisterCodec("fake");
+}
+
+TEST_CASE(codec_registry, register_validation) {
+    LUTools_CodecDesc desc{};
+    CHECK_EQ(LUTools_RegisterCodec(nullptr), INVALID_CODEC);
+    CHECK_EQ(LUTools_RegisterCodec(&desc), INVALID_CODEC);
+    FakeDecoder fake;
+    desc = fakeDesc(fake);
+    desc.name = "stb";
+    CHECK_EQ(LUTools_RegisterCodec(&desc), INVALID_CODEC);
+    CHECK_EQ(LUTools_UnregisterCodec("stb"), INVALID_CODEC);
+    CHECK_EQ(LUTools_UnregisterCodec("missing"), INVALID_CODEC);
+}
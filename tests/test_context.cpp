@@ -0,0 +1,326 @@
+#include "test_framework.hpp"
+#include "test_util.hpp"
+#include "codec.hpp"
+#include "thread_pool.hpp"
+#include "trace.hpp"
+#include "LUToolsLite.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+using namespace ltltest;
+
+namespace {
+
+Color invert(float r, float g, float b) { return Color{1 - r, 1 - g, 1 - b}; }
+
+int applyCtx(LUTools_Context* ctx, const Image& img, const std::vector<int>& ids, Image& out) {
+    std::vector<unsigned char> input(img.data.begin(), img.data.end());
+    unsigned char* data = nullptr;
+    int w = 0, h = 0, c = 0;
+    const int rc = LUTools_ProcessImageCtx(ctx, input.data(), img.width, img.height, 3, ids.data(), int(ids.size()),
+                                           0, 0, 0, 0, 0, &data, &w, &h, &c);
+    out = Image{};
+    if (rc == SUCCESS) {
+        out.width = w;
+        out.height = h;
+        out.channels = c;
+        out.data.assign(data, data + size_t(w) * h * c);
+    }
+    LUTools_FreeMemory(data);
+    return rc;
+}
+
+std::string lastError(LUTools_Context* ctx) {
+    const char* message = nullptr;
+    LUTools_GetLastErrorMessageCtx(ctx, &message);
+    return message ? message : "";
+}
+
+// Декодер PNG, вызывающий hook посреди обработки (цепочка LUT уже собрана)
+struct HookCodec {
+    Image source;
+    std::function<void()> hook;
+
+    explicit HookCodec(const Image& img) : source(img) {
+        LUTools_CodecDesc desc{};
+        desc.name = "context_hook";
+        desc.formats = "png";
+        desc.capabilities = LTL_CODEC_CAP_DECODE;
+        desc.priority = 100;
+        desc.userData = this;
+        desc.decode = [](const unsigned char*, size_t, LUTools_DecodedImage* out, void* userData) {
+            auto* self = static_cast<HookCodec*>(userData);
+            if (self->hook) self->hook();
+            out->width = self->source.width;
+            out->height = self->source.height;
+            out->pixels = static_cast<unsigned char*>(std::malloc(self->source.data.size()));
+            std::memcpy(out->pixels, self->source.data.data(), self->source.data.size());
+            out->release = [](unsigned char* p, void*) { std::free(p); };
+            return 0;
+        };
+        REQUIRE_EQ(LUTools_RegisterCodec(&desc), SUCCESS);
+    }
+    ~HookCodec() { LUTools_UnregisterCodec("context_hook"); }
+};
+
+struct Contexts {
+    LUTools_Context* a = LUTools_CreateContext(0);
+    LUTools_Context* b = LUTools_CreateContext(1);
+    ~Contexts() {
+        LUTools_DestroyContext(a);
+        LUTools_DestroyContext(b);
+    }
+};
+
+struct LogCapture {
+    std::mutex mutex;
+    std::vector<std::string> messages;
+
+    static void callback(const char* message, int, void* userData) {
+        auto* self = static_cast<LogCapture*>(userData);
+        std::lock_guard<std::mutex> lock(self->mutex);
+        self->messages.emplace_back(message);
+    }
+    bool contains(const std::string& text) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& m : messages)
+            if (m.find(text) != std::string::npos) return true;
+        return false;
+    }
+};
+
+} // namespace
+
+TEST_CASE(context, lut_ids_are_per_context) {
+    REQUIRE_EQ(LUTools_Init(), SUCCESS);
+    Contexts c;
+    REQUIRE(c.a && c.b);
+    const std::string inv = tempPath("invert.cube"), ident = tempPath("identity.cube");
+    writeCube(inv, 17, "Invert", invert);
+    writeCube(ident, 17, "Identity");
+
+    int idA = 0, idB = 0;
+    REQUIRE_EQ(LUTools_LoadLUTCtx(c.a, inv.c_str(), 1.0f, &idA), SUCCESS);
+    REQUIRE_EQ(LUTools_LoadLUTCtx(c.b, ident.c_str(), 1.0f, &idB), SUCCESS);
+    CHECK_EQ(idA, idB);   // свои счётчики id
+
+    const Image img = makeImage(32, 24, 6);
+    Image outA, outB;
+    REQUIRE_EQ(applyCtx(c.a, img, { idA }, outA), SUCCESS);
+    REQUIRE_EQ(applyCtx(c.b, img, { idB }, outB), SUCCESS);
+    CHECK(maxDifference(outB, img) <= 1);
+    CHECK(maxDifference(outA, img) > 100);
+
+    LUTools_LUTInfo info{};
+    REQUIRE_EQ(LUTools_GetLUTInfoCtx(c.a, idA, &info), SUCCESS);
+    CHECK_EQ(std::string(info.title), std::string("Invert"));
+    REQUIRE_EQ(LUTools_GetLUTInfoCtx(c.b, idB, &info), SUCCESS);
+    CHECK_EQ(std::string(info.title), std::string("Identity"));
+
+    // Контекст по умолчанию (и ctx = NULL) о них не знает
+    LUTools_LUTStats stats{};
+    LUTools_GetLUTStatsCtx(nullptr, &stats);
+    CHECK_EQ(stats.registered, 0);
+    Image out;
+    CHECK_EQ(applyLUTs(img, { idA }, out), INVALID_LUT);
+
+    // Очистка одного контекста не трогает другой
+    LUTools_ClearLUTsCtx(c.a);
+    CHECK_EQ(applyCtx(c.a, img, { idA }, out), INVALID_LUT);
+    CHECK_EQ(applyCtx(c.b, img, { idB }, out), SUCCESS);
+}
+
+TEST_CASE(context, budget_and_stats_are_per_context) {
+    Contexts c;
+    const std::string cube = tempPath("budget.cube");
+    writeCube(cube, 17, "", invert);
+    int ids[2] = {};
+    for (LUTools_Context* ctx : { c.a, c.b }) {
+        REQUIRE_EQ(LUTools_LoadLUTCtx(ctx, cube.c_str(), 1.0f, &ids[0]), SUCCESS);
+        REQUIRE_EQ(LUTools_LoadLUTCtx(ctx, cube.c_str(), 1.0f, &ids[1]), SUCCESS);
+    }
+    LUTools_SetLUTBudgetCtx(c.a, 17ull * 17 * 17 * sizeof(Color));
+    LUTools_LUTStats sa{}, sb{};
+    LUTools_GetLUTStatsCtx(c.a, &sa);
+    LUTools_GetLUTStatsCtx(c.b, &sb);
+    CHECK_EQ(sa.loaded, 1);
+    CHECK_EQ(sa.evictions, 1ull);
+    CHECK_EQ(sb.loaded, 2);
+    CHECK_EQ(sb.budget, 0ull);
+    CHECK_EQ(sb.evictions, 0ull);
+}
+
+TEST_CASE(context, cancel_flag_and_cancel_are_per_context) {
+    Contexts c;
+    const std::string cube = tempPath("cancel.cube");
+    writeCube(cube, 17, "", invert);
+    int idA = 0, idB = 0;
+    REQUIRE_EQ(LUTools_LoadLUTCtx(c.a, cube.c_str(), 1.0f, &idA), SUCCESS);
+    REQUIRE_EQ(LUTools_LoadLUTCtx(c.b, cube.c_str(), 1.0f, &idB), SUCCESS);
+    const Image img = makeImage(64, 64);
+
+    int flag = 1;
+    LUTools_SetCancelFlagCtx(c.a, &flag);
+    CHECK_EQ(LUTools_IsCancelledCtx(c.a), 1);
+    CHECK_EQ(LUTools_IsCancelledCtx(c.b), 0);
+    Image out;
+    CHECK_EQ(applyCtx(c.a, img, { idA }, out), CANCELLED);
+    CHECK_EQ(applyCtx(c.b, img, { idB }, out), SUCCESS);
+    LUTools_SetCancelFlagCtx(c.a, nullptr);
+    CHECK_EQ(applyCtx(c.a, img, { idA }, out), SUCCESS);
+
+    // LUTools_CancelCtx(a) посреди операции контекста b её не отменяет, а посреди
+    // операции контекста a — отменяет
+    const std::string input = tempPath("in.png"), output = tempPath("out.png");
+    REQUIRE(saveImage(img, input, "png"));
+    HookCodec codec(img);
+    codec.hook = [&] { LUTools_CancelCtx(c.a); };
+    CHECK_EQ(LUTools_ProcessFileExCtx(c.b, input.c_str(), output.c_str(), &idB, 1, 0, 0, 0, 0, 0, nullptr, nullptr, nullptr), SUCCESS);
+    CHECK_EQ(LUTools_ProcessFileExCtx(c.a, input.c_str(), output.c_str(), &idA, 1, 0, 0, 0, 0, 0, nullptr, nullptr, nullptr), CANCELLED);
+    // Отмена касается только уже идущих операций
+    codec.hook = nullptr;
+    CHECK_EQ(LUTools_ProcessFileExCtx(c.a, input.c_str(), output.c_str(), &idA, 1, 0, 0, 0, 0, 0, nullptr, nullptr, nullptr), SUCCESS);
+}
+
+TEST_CASE(context, log_callbacks_are_per_context) {
+    Contexts c;
+    LogCapture logA, logB;
+    LUTools_SetLogCallbackCtx(c.a, LogCapture::callback, &logA);
+    LUTools_SetLogCallbackCtx(c.b, LogCapture::callback, &logB);
+    const std::string cubeA = tempPath("log_a.cube"), cubeB = tempPath("log_b.cube");
+    writeCube(cubeA, 5);
+    writeCube(cubeB, 5);
+    int id = 0;
+    REQUIRE_EQ(LUTools_LoadLUTCtx(c.a, cubeA.c_str(), 1.0f, &id), SUCCESS);
+    REQUIRE_EQ(LUTools_LoadLUTCtx(c.b, cubeB.c_str(), 1.0f, &id), SUCCESS);
+    LUTools_FlushLog();
+    CHECK(logA.contains("log_a.cube"));
+    CHECK(!logA.contains("log_b.cube"));
+    CHECK(logB.contains("log_b.cube"));
+    CHECK(!logB.contains("log_a.cube"));
+    LUTools_SetLogCallbackCtx(c.a, nullptr, nullptr);
+    LUTools_SetLogCallbackCtx(c.b, nullptr, nullptr);
+}
+
+TEST_CASE(context, concurrent_contexts_on_threads) {
+    const std::string cube = tempPath("threads.cube");
+    writeCube(cube, 17, "", invert);
+    const Image img = makeImage(64, 48, 4);
+    std::vector<int> results(4, -1);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            LUTools_Context* ctx = LUTools_CreateContext(1);
+            int id = 0;
+            int rc = LUTools_LoadLUTCtx(ctx, cube.c_str(), 1.0f, &id);
+            for (int i = 0; i < 10 && rc == SUCCESS; ++i) {
+                Image out;
+                rc = applyCtx(ctx, img, { id }, out);
+                if (rc == SUCCESS && maxDifference(out, img) <= 100) rc = -100;
+                if (rc == SUCCESS && i == 5) {
+                    LUTools_ClearLUTsCtx(ctx);
+                    rc = LUTools_LoadLUTCtx(ctx, cube.c_str(), 1.0f, &id);
+                }
+            }
+            results[t] = rc;
+            LUTools_DestroyContext(ctx);
+        });
+    }
+    for (auto& t : threads) t.join();
+    for (int rc : results) CHECK_EQ(rc, SUCCESS);
+}
+
+TEST_CASE(context, errors_and_destroy) {
+    Contexts c;
+    int id = 0;
+    CHECK_EQ(LUTools_LoadLUTCtx(c.a, tempPath("nope.cube").c_str(), 1.0f, &id), INVALID_LUT);
+    CHECK(lastError(c.a).find("nope.cube") != std::string::npos);
+
+    // Уничтожение ждёт фонового чтения заголовков
+    LUTools_Context* ctx = LUTools_CreateContext(0);
+    std::vector<std::string> names;
+    for (int i = 0; i < 20; ++i) {
+        names.push_back(tempPath("reg" + std::to_string(i) + ".cube"));
+        writeCube(names.back(), 9);
+    }
+    std::vector<const char*> paths;
+    for (const auto& n : names) paths.push_back(n.c_str());
+    std::vector<int> ids(names.size());
+    REQUIRE_EQ(LUTools_RegisterLUTsCtx(ctx, paths.data(), int(paths.size()), 1.0f, ids.data()), SUCCESS);
+    LUTools_DestroyContext(ctx);
+
+    LUTools_DestroyContext(nullptr);   // контекст по умолчанию не уничтожается
+    REQUIRE_EQ(LUTools_Init(), SUCCESS);
+}
+
+TEST_CASE(context, parallel_for_respects_thread_limit) {
+    ThreadPool pool(4);
+    for (unsigned limit : { 1u, 2u, 3u }) {
+        std::mutex mutex;
+        std::set<std::thread::id> used;
+        pool.parallelFor(64, [&](size_t) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                used.insert(std::this_thread::get_id());
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }, limit);
+        CHECK(!used.empty());
+        CHECK(used.size() <= limit);
+        if (limit == 1) CHECK(used.count(std::this_thread::get_id()) == 1);
+    }
+}
+
+TEST_CASE(context, kernel_uses_context_thread_share) {
+    const std::string cube = tempPath("share.cube");
+    writeCube(cube, 17, "", invert);
+    LUTools_Context* ctx = LUTools_CreateContext(1);
+    int id = 0;
+    REQUIRE_EQ(LUTools_LoadLUTCtx(ctx, cube.c_str(), 1.0f, &id), SUCCESS);
+    const Image img = makeImage(1200, 1000, 4);   // > 1 МП — многопоточный путь ядра
+    Tracer::instance().start();
+    Image out;
+    const int rc = applyCtx(ctx, img, { id }, out);
+    Tracer::instance().stop();
+    LUTools_DestroyContext(ctx);
+    REQUIRE_EQ(rc, SUCCESS);
+
+    // Доля в один поток: все тайлы — в потоке вызова
+    VectorSink json;
+    REQUIRE(Tracer::instance().writeJson(json));
+    const std::string text(json.bytes.begin(), json.bytes.end());
+    std::set<int> tids;
+    int tiles = 0;
+    for (size_t p = text.find("{\"name\":\"Tile\""); p != std::string::npos; p = text.find("{\"name\":\"Tile\"", p + 1)) {
+        tids.insert(std::atoi(text.c_str() + text.find("\"tid\":", p) + 6));
+        ++tiles;
+    }
+    CHECK_EQ(tiles, (img.height + 63) / 64);
+    CHECK_EQ(tids.size(), size_t(1));
+}
+
+TEST_CASE(context, pool_restarts_after_shutdown) {
+    ThreadPool pool(3);
+    std::atomic<int> ran{0};
+    pool.parallelFor(32, [&](size_t) { ++ran; });
+    pool.shutdown();
+    pool.shutdown();   // повторно — безвредно
+    CHECK_EQ(pool.size(), 3u);
+    std::mutex mutex;
+    std::set<std::thread::id> used;
+    pool.parallelFor(32, [&](size_t) {
+        ++ran;
+        std::lock_guard<std::mutex> lock(mutex);
+        used.insert(std::this_thread::get_id());
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    });
+    CHECK_EQ(ran.load(), 64);
+    CHECK(used.size() > 1);   // воркеры снова запущены
+}
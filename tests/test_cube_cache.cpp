@@ -0,0 +1,177 @@
+#include "test_framework.hpp"
+#include "test_util.hpp"
+#include "cube_loader.hpp"
+#include "LUToolsLite.h"
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+
+using namespace ltltest;
+
+namespace {
+
+Color warm(float r, float g, float b) { return Color{r * 0.9f + 0.1f, g, b * 0.8f}; }
+Color cool(float r, float g, float b) { return Color{r * 0.8f, g, b * 0.9f + 0.1f}; }
+
+// Смещение texel-ов — пятое поле заголовка .ltlc
+uint32_t texelOffset(const std::vector<unsigned char>& cache) {
+    uint32_t offset = 0;
+    std::memcpy(&offset, cache.data() + 16, 4);
+    return offset;
+}
+
+// Подменяет первый texel прямо в кэше: если загрузка вернула его, данные пришли из кэша
+void patchFirstTexel(const std::string& cachePath, float value) {
+    std::vector<unsigned char> cache = readFile(cachePath);
+    REQUIRE(cache.size() > 64);
+    std::memcpy(cache.data() + texelOffset(cache), &value, sizeof(value));
+    REQUIRE(writeFile(cachePath, cache));
+}
+
+LUTFlat load(const std::string& path, int& size, std::string* title = nullptr) {
+    return loadCubeLUTCached(path, size, title);
+}
+
+} // namespace
+
+TEST_CASE(cube_cache, first_load_writes_cache_second_hits_it) {
+    const std::string cube = tempPath("hit.cube");
+    const std::string cache = cube + ".ltlc";
+    writeCube(cube, 17, "Warm look", warm);
+    CHECK(!std::filesystem::exists(cache));
+
+    int size = 0;
+    std::string title;
+    const LUTFlat parsed = load(cube, size, &title);
+    REQUIRE(std::filesystem::exists(cache));
+    CHECK_EQ(size, 17);
+    CHECK_EQ(title, std::string("Warm look"));
+    // Выравнивание texel-ов в файле: 64 байта
+    CHECK_EQ(texelOffset(readFile(cache)) % 64, uint32_t(0));
+    CHECK_EQ(std::filesystem::file_size(cache), uintmax_t(texelOffset(readFile(cache)) + parsed.size() * sizeof(Color)));
+
+    patchFirstTexel(cache, 42.0f);
+    int cachedSize = 0;
+    std::string cachedTitle;
+    const LUTFlat cached = load(cube, cachedSize, &cachedTitle);
+    CHECK_EQ(cachedSize, 17);
+    CHECK_EQ(cachedTitle, std::string("Warm look"));
+    REQUIRE_EQ(cached.size(), parsed.size());
+    CHECK_EQ(cached[0].r, 42.0f);
+    CHECK(std::memcmp(cached.data() + 1, parsed.data() + 1, (parsed.size() - 1) * sizeof(Color)) == 0);
+}
+
+TEST_CASE(cube_cache, hit_references_mapping_without_copy) {
+    const std::string cube = tempPath("mapped.cube");
+    writeCube(cube, 65, "", warm);
+    int size = 0;
+    load(cube, size);   // создаёт кэш
+
+    const size_t tableBytes = size_t(65) * 65 * 65 * sizeof(Color);
+    const size_t before = heapLiveBytes();
+    LUTFlat lut = load(cube, size);
+    // Таблица ~3.3 МБ на куче не появилась: данные в отображении
+    CHECK(heapLiveBytes() - before < tableBytes / 8);
+    CHECK(reinterpret_cast<uintptr_t>(lut.data()) % 64 == 0);
+
+    // Копия таблицы разделяет данные и держит отображение
+    const LUTFlat copy = lut;
+    CHECK(copy.data() == lut.data());
+    lut = LUTFlat();
+    CHECK_EQ(copy[0].r, warm(0, 0, 0).r);
+    CHECK_EQ(copy[copy.size() - 1].b, warm(1, 1, 1).b);
+}
+
+TEST_CASE(cube_cache, stale_hash_reparses_and_rewrites) {
+    const std::string cube = tempPath("stale.cube");
+    const std::string cache = cube + ".ltlc";
+    writeCube(cube, 9, "Before", warm);
+    int size = 0;
+    load(cube, size);
+    const auto oldCache = readFile(cache);
+    const auto warmBytes = readFile(cube);
+
+    // Тот же размер файла, другое содержимое: совпадёт только sourceSize, но не хэш
+    writeCube(cube, 9, "After_", cool);
+    REQUIRE_EQ(readFile(cube).size(), warmBytes.size());
+    std::string title;
+    const LUTFlat lut = load(cube, size, &title);
+    CHECK_EQ(title, std::string("After_"));
+    CHECK_EQ(lut[1].r, cool(1.0f / 8, 0, 0).r);
+    CHECK(readFile(cache) != oldCache);
+
+    // Новый кэш соответствует новому файлу
+    patchFirstTexel(cache, -7.0f);
+    CHECK_EQ(load(cube, size)[0].r, -7.0f);
+}
+
+TEST_CASE(cube_cache, damaged_cache_is_ignored) {
+    const std::string cube = tempPath("damaged.cube");
+    const std::string cache = cube + ".ltlc";
+    writeCube(cube, 9, "Damaged", warm);
+    int size = 0;
+    const LUTFlat reference = load(cube, size);
+    const auto good = readFile(cache);
+
+    auto expectReparsed = [&](std::vector<unsigned char> bytes) {
+        REQUIRE(writeFile(cache, bytes));
+        int loadedSize = 0;
+        std::string title;
+        const LUTFlat lut = load(cube, loadedSize, &title);
+        CHECK_EQ(loadedSize, 9);
+        CHECK_EQ(title, std::string("Damaged"));
+        REQUIRE_EQ(lut.size(), reference.size());
+        CHECK(std::memcmp(lut.data(), reference.data(), lut.size() * sizeof(Color)) == 0);
+        CHECK(readFile(cache) == good);   // кэш перезаписан
+    };
+
+    expectReparsed(std::vector<unsigned char>(good.begin(), good.end() - 12));   // обрезан
+    expectReparsed(std::vector<unsigned char>(good.begin(), good.begin() + 20)); // короче заголовка
+    std::vector<unsigned char> bad = good;
+    bad[0] = 'X';                                                                  // чужая сигнатура
+    expectReparsed(bad);
+    bad = good;
+    bad[4] = 1;                                                                    // старая версия
+    expectReparsed(bad);
+    expectReparsed({});
+}
+
+TEST_CASE(cube_cache, load_lut_uses_cache_and_title) {
+    REQUIRE_EQ(LUTools_Init(), SUCCESS);
+    const std::string cube = tempPath("api.cube");
+    const std::string cache = cube + ".ltlc";
+    writeCube(cube, 17, "Api title", warm);
+
+    int first = 0, second = 0;
+    REQUIRE_EQ(LUTools_LoadLUT(cube.c_str(), 1.0f, &first), SUCCESS);
+    REQUIRE(std::filesystem::exists(cache));
+    REQUIRE_EQ(LUTools_LoadLUT(cube.c_str(), 1.0f, &second), SUCCESS);
+    LUTools_LUTInfo info{};
+    REQUIRE_EQ(LUTools_GetLUTInfo(second, &info), SUCCESS);
+    CHECK_EQ(info.size, 17);
+    CHECK_EQ(std::string(info.title), std::string("Api title"));
+
+    // Кэш выключен: .cube разбирается, новый .ltlc не пишется
+    const std::string plain = tempPath("plain.cube");
+    writeCube(plain, 9, "Plain", warm);
+    LUTools_SetLUTCacheEnabled(0);
+    int third = 0;
+    REQUIRE_EQ(LUTools_LoadLUT(plain.c_str(), 1.0f, &third), SUCCESS);
+    CHECK(!std::filesystem::exists(plain + ".ltlc"));
+    REQUIRE_EQ(LUTools_GetLUTInfo(third, &info), SUCCESS);
+    CHECK_EQ(std::string(info.title), std::string("Plain"));
+    LUTools_SetLUTCacheEnabled(1);
+}
+
+TEST_CASE(cube_cache, read_only_directory_still_loads) {
+    // Кэш некуда писать — загрузка всё равно успешна
+    const std::string cube = tempPath("nodir.cube");
+    writeCube(cube, 5, "", warm);
+    std::filesystem::create_directory(cube + ".ltlc");   // каталог на месте кэша: rename не пройдёт
+    int size = 0;
+    const LUTFlat lut = load(cube, size);
+    CHECK_EQ(size, 5);
+    CHECK_EQ(lut.size(), size_t(125));
+    CHECK(std::filesystem::is_directory(cube + ".ltlc"));
+    std::filesystem::remove(cube + ".ltlc");
+}
@@ -0,0 +1,127 @@
+#include "test_framework.hpp"
+#include "test_util.hpp"
+#include "cube_loader.hpp"
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+using namespace ltltest;
+
+namespace {
+
+void writeText(const std::string& path, const std::string& text) {
+    REQUIRE(writeFile(path, std::vector<unsigned char>(text.begin(), text.end())));
+}
+
+bool near(const Color& a, const Color& b, float eps = 1e-6f) {
+    return std::fabs(a.r - b.r) <= eps && std::fabs(a.g - b.g) <= eps && std::fabs(a.b - b.b) <= eps;
+}
+
+bool throwsOnLoad(const std::string& path) {
+    try {
+        int size = 0;
+        loadCubeLUT(path, size);
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+TEST_CASE(cube_parser, syntax_variants) {
+    const std::string path = tempPath("syntax.cube");
+    writeText(path,
+              "# comment\r\n"
+              "TITLE \"Hand made\"\r\n"
+              "\r\n"
+              "DOMAIN_MIN 0 0 0\r\n"
+              "DOMAIN_MAX 1 1 1\r\n"
+              "LUT_3D_SIZE 2\r\n"
+              "0 0 0\r\n"
+              "\t1.0\t0\t0\r\n"
+              "  0 +1 0  \r\n"
+              "1 1 0\r\n"
+              "# comment between data\r\n"
+              "0 0 1e0\r\n"
+              "1.0E+0 0 1\r\n"
+              "0 1 1\r\n"
+              "0.5 2.5e-1 -0.125");   // без перевода строки в конце
+    int size = 0;
+    LUTFlat lut = loadCubeLUT(path, size);
+    CHECK_EQ(size, 2);
+    CubeHeader header;
+    REQUIRE(readCubeHeader(path, header));
+    CHECK_EQ(header.title, std::string("Hand made"));
+    REQUIRE_EQ(lut.size(), size_t(8));
+    CHECK(near(lut[1], Color{1, 0, 0}));
+    CHECK(near(lut[2], Color{0, 1, 0}));
+    CHECK(near(lut[4], Color{0, 0, 1}));
+    CHECK(near(lut[5], Color{1, 0, 1}));
+    CHECK(near(lut[7], Color{0.5f, 0.25f, -0.125f}));
+}
+
+TEST_CASE(cube_parser, size_keyword_after_data) {
+    const std::string path = tempPath("late.cube");
+    std::string text = "TITLE Unquoted title\n";
+    for (int i = 0; i < 8; ++i) text += std::to_string(i / 8.0) + " 0 0\n";
+    text += "LUT_3D_SIZE 2\n";
+    writeText(path, text);
+    int size = 0;
+    LUTFlat lut = loadCubeLUT(path, size);
+    CHECK_EQ(size, 2);
+    CubeHeader header;
+    REQUIRE(readCubeHeader(path, header));
+    CHECK_EQ(header.title, std::string("Unquoted title"));
+    CHECK(near(lut[7], Color{7 / 8.0f, 0, 0}));
+}
+
+TEST_CASE(cube_parser, large_table_parsed_in_order) {
+    // 65³ строк — больше порога параллельного разбора (1 МБ)
+    const std::string path = tempPath("large.cube");
+    auto fn = [](float r, float g, float b) { return Color{r * r, std::sqrt(g), 1 - b}; };
+    writeCube(path, 65, "Large", fn);
+    int size = 0;
+    LUTFlat lut = loadCubeLUT(path, size);
+    REQUIRE_EQ(size, 65);
+    REQUIRE_EQ(lut.size(), size_t(65 * 65 * 65));
+    bool ok = true;
+    const float step = 1.0f / 64;
+    for (int b = 0; b < 65 && ok; ++b)
+        for (int g = 0; g < 65 && ok; ++g)
+            for (int r = 0; r < 65 && ok; ++r)
+                ok = near(lut[(size_t(b) * 65 + g) * 65 + r], fn(r * step, g * step, b * step), 2e-6f);
+    CHECK(ok);
+}
+
+TEST_CASE(cube_parser, header_only_read) {
+    const std::string path = tempPath("header.cube");
+    writeCube(path, 17, "Header title");
+    CubeHeader header;
+    REQUIRE(readCubeHeader(path, header));
+    CHECK_EQ(header.size, 17);
+    CHECK_EQ(header.title, std::string("Header title"));
+    CHECK(!readCubeHeader(tempPath("missing.cube"), header));
+}
+
+TEST_CASE(cube_parser, malformed_files_throw) {
+    const std::string noSize = tempPath("nosize.cube");
+    writeText(noSize, "0 0 0\n1 1 1\n");
+    CHECK(throwsOnLoad(noSize));
+
+    const std::string count = tempPath("count.cube");
+    writeText(count, "LUT_3D_SIZE 2\n0 0 0\n1 1 1\n");
+    CHECK(throwsOnLoad(count));
+
+    const std::string badSize = tempPath("badsize.cube");
+    writeText(badSize, "LUT_3D_SIZE abc\n0 0 0\n");
+    CHECK(throwsOnLoad(badSize));
+    CubeHeader header;
+    CHECK(!readCubeHeader(badSize, header));
+
+    const std::string empty = tempPath("empty.cube");
+    writeText(empty, "");
+    CHECK(throwsOnLoad(empty));
+
+    CHECK(throwsOnLoad(tempPath("missing.cube")));
+}
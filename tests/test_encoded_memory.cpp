@@ -0,0 +1,105 @@
+#include "test_framework.hpp"
+#include "test_util.hpp"
+#include "codec.hpp"
+#include "LUToolsLite.h"
+
+using namespace ltltest;
+
+namespace {
+
+std::vector<unsigned char> encode(const Image& img, const char* format) {
+    VectorSink sink;
+    REQUIRE(encodeImage(img, format, EncodeOptions(), sink));
+    return sink.bytes;
+}
+
+Image decode(const unsigned char* data, size_t size) {
+    Image img{};
+    decodeImage(data, size, img);
+    return img;
+}
+
+void appendBytes(void* context, const void* data, int size) {
+    auto* out = static_cast<std::vector<unsigned char>*>(context);
+    out->insert(out->end(), static_cast<const unsigned char*>(data), static_cast<const unsigned char*>(data) + size);
+}
+
+int loadInvertLUT() {
+    const std::string cube = tempPath("invert.cube");
+    writeCube(cube, 33, "Invert", [](float r, float g, float b) { return Color{1 - r, 1 - g, 1 - b}; });
+    int id = 0;
+    REQUIRE_EQ(LUTools_LoadLUT(cube.c_str(), 1.0f, &id), SUCCESS);
+    return id;
+}
+
+} // namespace
+
+TEST_CASE(encoded_memory, applies_lut_without_files) {
+    REQUIRE_EQ(LUTools_Init(), SUCCESS);
+    const int lut = loadInvertLUT();
+    const Image source = makeImage(80, 60, 10);
+    const auto input = encode(source, "png");
+    LUTools_OutputOptions o{};
+    LUTools_GetDefaultOutputOptions(&o);
+    o.format = LTL_FORMAT_PNG;
+    unsigned char* output = nullptr;
+    size_t outputSize = 0;
+    REQUIRE_EQ(LUTools_ProcessEncoded(input.data(), input.size(), &lut, 1, 0, 0, 0, 0, 0, &o, &output, &outputSize), SUCCESS);
+    REQUIRE(output != nullptr);
+    CHECK_EQ(detectFormat(output, outputSize), std::string("png"));
+    const Image result = decode(output, outputSize);
+    LUTools_FreeMemory(output);
+    REQUIRE(result.valid());
+    Image expected = source;
+    for (auto& v : expected.data) v = static_cast<unsigned char>(255 - v);
+    CHECK(maxDifference(expected, result) <= 1);
+}
+
+TEST_CASE(encoded_memory, sink_receives_same_bytes) {
+    REQUIRE_EQ(LUTools_Init(), SUCCESS);
+    const int lut = loadInvertLUT();
+    const auto input = encode(makeImage(300, 200, 4), "jpg");
+    for (int format : { LTL_FORMAT_JPEG, LTL_FORMAT_PNG, LTL_FORMAT_QOI }) {
+        LUTools_OutputOptions o{};
+        LUTools_GetDefaultOutputOptions(&o);
+        o.format = format;
+        unsigned char* output = nullptr;
+        size_t outputSize = 0;
+        REQUIRE_EQ(LUTools_ProcessEncoded(input.data(), input.size(), &lut, 1, 0, 0, 0, 0, 0, &o, &output, &outputSize), SUCCESS);
+        std::vector<unsigned char> streamed;
+        REQUIRE_EQ(LUTools_ProcessEncodedToSink(input.data(), input.size(), &lut, 1, 0, 0, 0, 0, 0, &o, appendBytes, &streamed), SUCCESS);
+        CHECK(streamed == std::vector<unsigned char>(output, output + outputSize));
+        LUTools_FreeMemory(output);
+    }
+}
+
+TEST_CASE(encoded_memory, no_luts_passes_pixels_through) {
+    REQUIRE_EQ(LUTools_Init(), SUCCESS);
+    const Image source = makeImage(33, 21, 15);
+    const auto input = encode(source, "qoi");
+    LUTools_OutputOptions o{};
+    LUTools_GetDefaultOutputOptions(&o);
+    o.format = LTL_FORMAT_QOI;
+    unsigned char* output = nullptr;
+    size_t outputSize = 0;
+    REQUIRE_EQ(LUTools_ProcessEncoded(input.data(), input.size(), nullptr, 0, 0, 0, 0, 0, 0, &o, &output, &outputSize), SUCCESS);
+    CHECK(samePixels(source, decode(output, outputSize)));
+    LUTools_FreeMemory(output);
+}
+
+TEST_CASE(encoded_memory, invalid_arguments) {
+    REQUIRE_EQ(LUTools_Init(), SUCCESS);
+    const int lut = loadInvertLUT();
+    const std::vector<unsigned char> garbage(500, 0x42);
+    unsigned char* output = reinterpret_cast<unsigned char*>(1);
+    size_t outputSize = 1;
+    CHECK_EQ(LUTools_ProcessEncoded(garbage.data(), garbage.size(), &lut, 1, 0, 0, 0, 0, 0, nullptr, &output, &outputSize), INVALID_IMAGE);
+    CHECK(output == nullptr);
+    CHECK_EQ(outputSize, size_t(0));
+    CHECK_EQ(LUTools_ProcessEncoded(nullptr, 10, &lut, 1, 0, 0, 0, 0, 0, nullptr, &output, &outputSize), INVALID_IMAGE);
+    CHECK_EQ(LUTools_ProcessEncoded(garbage.data(), garbage.size(), &lut, 1, 0, 0, 0, 0, 0, nullptr, nullptr, &outputSize), INVALID_IMAGE);
+    CHECK_EQ(LUTools_ProcessEncodedToSink(garbage.data(), garbage.size(), &lut, 1, 0, 0, 0, 0, 0, nullptr, nullptr, nullptr), INVALID_IMAGE);
+    const auto input = encode(makeImage(8, 8), "png");
+    const int missing = 12345;
+    CHECK_EQ(LUTools_ProcessEncoded(input.data(), input.size(), &missing, 1, 0, 0, 0, 0, 0, nullptr, &output, &outputSize), INVALID_LUT);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+// ─────────────────────────────────────────────────────────────
+//  Минимальный каркас тестов без зависимостей. TEST_CASE(набор, имя)
+//  регистрирует функцию; CHECK отмечает провал и продолжает тест,
+//  REQUIRE прерывает его. LUToolsLiteTests <набор> запускает один
+//  набор: ctest гоняет каждый отдельным процессом, потому что у
+//  библиотеки глобальное состояние (контекст по умолчанию, пул
+//  потоков, логгер, счётчики).
+// ─────────────────────────────────────────────────────────────
+
+namespace ltltest {
+
+using TestFn = void (*)();
+
+struct TestCase {
+    const char* suite;
+    const char* name;
+    TestFn fn;
+};
+
+std::vector<TestCase>& registry();
+void fail(const char* file, int line, const std::string& what);
+
+struct Registrar {
+    Registrar(const char* suite, const char* name, TestFn fn) { registry().push_back({suite, name, fn}); }
+};
+
+// Бросается REQUIRE: остаток теста не выполняется
+struct Abort {};
+
+template <class A, class B>
+bool checkEqual(const A& a, const B& b, const char* file, int line, const char* exprA, const char* exprB) {
+    if (a == b) return true;
+    std::ostringstream os;
+    os << exprA << " == " << exprB << " (" << a << " vs " << b << ")";
+    fail(file, line, os.str());
+    return false;
+}
+
+} // namespace ltltest
+
+#define TEST_CASE(suite, name)                                                                   \
+    static void suite##_##name();                                                                \
+    static ltltest::Registrar suite##_##name##_registrar(#suite, #name, &suite##_##name);        \
+    static void suite##_##name()
+
+#define CHECK(expr) \
+    do { if (!(expr)) ltltest::fail(__FILE__, __LINE__, #expr); } while (0)
+
+#define REQUIRE(expr) \
+    do { if (!(expr)) { ltltest::fail(__FILE__, __LINE__, #expr); throw ltltest::Abort{}; } } while (0)
+
+#define CHECK_EQ(a, b) \
+    do { ltltest::checkEqual((a), (b), __FILE__, __LINE__, #a, #b); } while (0)
+
+#define REQUIRE_EQ(a, b) \
+    do { if (!ltltest::checkEqual((a), (b), __FILE__, __LINE__, #a, #b)) throw ltltest::Abort{}; } while (0)
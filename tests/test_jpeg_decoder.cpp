@@ -0,0 +1,127 @@
+#include "test_framework.hpp"
+#include "test_util.hpp"
+#include "cancel_token.hpp"
+#include "jpeg_codec.hpp"
+
+using namespace ltltest;
+
+namespace {
+
+std::vector<unsigned char> encode(const Image& img, int subsampling, int restartRows) {
+    EncodeOptions options;
+    options.quality = 90;
+    options.subsampling = subsampling;
+    options.restartRows = restartRows;
+    VectorSink sink;
+    REQUIRE(encodeJpeg(img, options, sink));
+    return sink.bytes;
+}
+
+Image decode(const std::vector<unsigned char>& bytes) {
+    Image img{};
+    if (!decodeJpeg(bytes.data(), bytes.size(), img)) return Image{};
+    return img;
+}
+
+// Переписывает символы всех таблиц Хаффмана класса tableClass (0 — DC, 1 — AC)
+std::vector<unsigned char> patchHuffmanSymbols(std::vector<unsigned char> jpeg, int tableClass, unsigned char symbol) {
+    size_t pos = 2;
+    while (pos + 4 <= jpeg.size() && jpeg[pos] == 0xFF) {
+        const unsigned char marker = jpeg[pos + 1];
+        const size_t length = (size_t(jpeg[pos + 2]) << 8) | jpeg[pos + 3];
+        if (marker == 0xDA) break;
+        if (marker == 0xC4) {
+            size_t p = pos + 4;
+            while (p < pos + 2 + length) {
+                const int tc = jpeg[p] >> 4;
+                size_t count = 0;
+                for (int i = 1; i <= 16; ++i) count += jpeg[p + i];
+                if (tc == tableClass)
+                    for (size_t i = 0; i < count; ++i) jpeg[p + 17 + i] = symbol;
+                p += 17 + count;
+            }
+        }
+        pos += 2 + length;
+    }
+    return jpeg;
+}
+
+} // namespace
+
+TEST_CASE(jpeg_decoder, matches_reference_decoder) {
+    const Image img = makeImage(123, 77, 3);
+    for (int subsampling : { 444, 422, 420 }) {
+        const auto bytes = encode(img, subsampling, 0);
+        const Image ours = decode(bytes);
+        const Image reference = decodeWithStb(bytes);
+        REQUIRE(ours.valid());
+        REQUIRE(reference.valid());
+        CHECK_EQ(ours.width, 123);
+        CHECK_EQ(ours.height, 77);
+        // Разные IDCT и апсемплинг хромы: допускаем небольшие расхождения
+        CHECK(psnr(ours, reference) > 40.0);
+        CHECK(psnr(img, ours) > 30.0);
+    }
+}
+
+TEST_CASE(jpeg_decoder, restart_intervals_decode_like_sequential) {
+    const Image img = makeImage(200, 150, 5);
+    const auto plain = encode(img, 420, 0);
+    const auto restart = encode(img, 420, 1);
+    REQUIRE(jpegHasRestartMarkers(restart.data(), restart.size()));
+    const Image a = decode(plain);
+    const Image b = decode(restart);
+    REQUIRE(a.valid());
+    REQUIRE(b.valid());
+    CHECK(samePixels(a, b));
+}
+
+TEST_CASE(jpeg_decoder, out_of_range_dc_category_is_an_error) {
+    const Image img = makeImage(32, 32, 2);
+    for (int restartRows : { 0, 1 }) {
+        const auto bytes = encode(img, 444, restartRows);
+        REQUIRE(decode(bytes).valid());
+        // Категория DC 12 и больше в baseline невозможна
+        for (unsigned char symbol : { 12, 15 }) {
+            const auto bad = patchHuffmanSymbols(bytes, 0, symbol);
+            Image out{};
+            CHECK(!decodeJpeg(bad.data(), bad.size(), out));
+        }
+    }
+}
+
+TEST_CASE(jpeg_decoder, out_of_range_ac_size_is_an_error) {
+    const Image img = makeImage(32, 32, 2);
+    for (int restartRows : { 0, 1 }) {
+        const auto bytes = encode(img, 444, restartRows);
+        // Размер AC 11..15 в baseline невозможен
+        for (unsigned char symbol : { 0x0B, 0x1F }) {
+            const auto bad = patchHuffmanSymbols(bytes, 1, symbol);
+            Image out{};
+            CHECK(!decodeJpeg(bad.data(), bad.size(), out));
+        }
+    }
+}
+
+TEST_CASE(jpeg_decoder, truncated_and_garbage_input) {
+    const auto bytes = encode(makeImage(64, 48, 3), 420, 1);
+    Image out{};
+    CHECK(!decodeJpeg(bytes.data(), 100, out));
+    std::vector<unsigned char> garbage(bytes.begin(), bytes.begin() + bytes.size() / 2);
+    uint32_t state = 7;
+    for (size_t i = garbage.size() / 2; i < garbage.size(); ++i) {
+        state = state * 1664525u + 1013904223u;
+        garbage[i] = static_cast<unsigned char>(state >> 24);
+    }
+    // Главное — не упасть; результат может быть любым
+    decodeJpeg(garbage.data(), garbage.size(), out);
+    CHECK(!decodeJpeg(nullptr, 0, out));
+}
+
+TEST_CASE(jpeg_decoder, cancelled_token_stops_decode) {
+    const auto bytes = encode(makeImage(64, 64), 420, 1);
+    CancelToken cancel;
+    cancel.cancel();
+    Image out{};
+    CHECK(!decodeJpeg(bytes.data(), bytes.size(), out, &cancel));
+}
@@ -0,0 +1,81 @@
+#include "test_framework.hpp"
+#include "test_util.hpp"
+#include "jpeg_codec.hpp"
+
+using namespace ltltest;
+
+namespace {
+
+std::vector<unsigned char> encode(const Image& img, int quality, int subsampling, int restartRows) {
+    EncodeOptions options;
+    options.quality = quality;
+    options.subsampling = subsampling;
+    options.restartRows = restartRows;
+    VectorSink sink;
+    REQUIRE(encodeJpeg(img, options, sink));
+    return sink.bytes;
+}
+
+} // namespace
+
+TEST_CASE(jpeg_encoder, round_trip_psnr) {
+    const Image img = makeImage(97, 61, 4);
+    const Image hi = decodeWithStb(encode(img, 95, 444, 0));
+    REQUIRE(hi.valid());
+    CHECK_EQ(hi.width, 97);
+    CHECK_EQ(hi.height, 61);
+    CHECK(psnr(img, hi) > 38.0);
+
+    const auto lowBytes = encode(img, 50, 420, 0);
+    const Image lo = decodeWithStb(lowBytes);
+    REQUIRE(lo.valid());
+    CHECK(psnr(img, lo) > 28.0);
+    CHECK(lowBytes.size() < encode(img, 95, 444, 0).size());
+}
+
+TEST_CASE(jpeg_encoder, subsampling_modes) {
+    const Image img = makeImage(50, 35, 2);
+    for (int subsampling : { 444, 422, 420 }) {
+        const Image out = decodeWithStb(encode(img, 90, subsampling, 0));
+        REQUIRE(out.valid());
+        CHECK_EQ(out.width, 50);
+        CHECK_EQ(out.height, 35);
+        CHECK(psnr(img, out) > 30.0);
+    }
+}
+
+TEST_CASE(jpeg_encoder, odd_sizes) {
+    for (auto [w, h] : { std::pair<int, int>{1, 1}, {17, 9}, {8, 8}, {3, 130} }) {
+        const Image img = makeImage(w, h);
+        const Image out = decodeWithStb(encode(img, 95, 0, 1));
+        REQUIRE(out.valid());
+        CHECK_EQ(out.width, w);
+        CHECK_EQ(out.height, h);
+        CHECK(maxDifference(img, out) <= 12);
+    }
+}
+
+TEST_CASE(jpeg_encoder, restart_intervals_do_not_change_pixels) {
+    const Image img = makeImage(160, 120, 3);
+    const auto plain = encode(img, 90, 420, 0);
+    const auto restart = encode(img, 90, 420, 1);
+    const auto wide = encode(img, 90, 420, 3);
+    CHECK(!jpegHasRestartMarkers(plain.data(), plain.size()));
+    CHECK(jpegHasRestartMarkers(restart.data(), restart.size()));
+    CHECK(jpegHasRestartMarkers(wide.data(), wide.size()));
+    // Restart-маркер лишь сбрасывает предсказание DC: коэффициенты, а значит и пиксели, те же
+    const Image a = decodeWithStb(plain);
+    const Image b = decodeWithStb(restart);
+    const Image c = decodeWithStb(wide);
+    REQUIRE(a.valid());
+    CHECK(samePixels(a, b));
+    CHECK(samePixels(a, c));
+}
+
+TEST_CASE(jpeg_encoder, invalid_input) {
+    Image empty{};
+    VectorSink sink;
+    CHECK(!encodeJpeg(empty, EncodeOptions(), sink));
+    CHECK(openJpegWriter(0, 10, EncodeOptions(), sink) == nullptr);
+    CHECK(openJpegWriter(70000, 10, EncodeOptions(), sink) == nullptr);
+}
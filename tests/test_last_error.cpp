@@ -0,0 +1,87 @@
+#include "test_framework.hpp"
+#include "test_util.hpp"
+#include "LUToolsLite.h"
+#include <atomic>
+#include <string>
+#include <thread>
+
+using namespace ltltest;
+
+namespace {
+
+std::string lastError() {
+    const char* message = nullptr;
+    LUTools_GetLastErrorMessage(&message);
+    return message ? message : "";
+}
+
+// Ошибка с id в тексте: "Invalid LUT ID: <id>"
+int failWithId(int id) {
+    Image out;
+    return applyLUTs(makeImage(2, 2), { id }, out);
+}
+
+} // namespace
+
+TEST_CASE(last_error, message_describes_last_failure) {
+    REQUIRE_EQ(LUTools_Init(), SUCCESS);
+    CHECK_EQ(lastError(), std::string(""));
+    CHECK_EQ(failWithId(777), INVALID_LUT);
+    CHECK(lastError().find("777") != std::string::npos);
+    int id = 0;
+    CHECK_EQ(LUTools_LoadLUT(tempPath("absent.cube").c_str(), 1.0f, &id), INVALID_LUT);
+    CHECK(lastError().find("absent.cube") != std::string::npos);
+    LUTools_GetLastErrorMessage(nullptr);   // безвредно
+}
+
+TEST_CASE(last_error, threads_keep_their_own_message) {
+    REQUIRE_EQ(LUTools_Init(), SUCCESS);
+    CHECK_EQ(failWithId(1000), INVALID_LUT);
+    const char* mainMessage = nullptr;
+    LUTools_GetLastErrorMessage(&mainMessage);
+
+    std::atomic<int> ready{0};
+    std::atomic<int> wrong{0};
+    std::vector<std::thread> threads;
+    for (int t = 1; t <= 4; ++t) {
+        threads.emplace_back([&, t] {
+            const std::string own = std::to_string(1000 + t);
+            // Все потоки сначала ставят свою ошибку, потом много раз перечитывают её,
+            // пока остальные продолжают ошибаться
+            failWithId(1000 + t);
+            ++ready;
+            while (ready < 4) std::this_thread::yield();
+            for (int i = 0; i < 200; ++i) {
+                if (lastError().find(own) == std::string::npos) ++wrong;
+                failWithId(1000 + t);
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    CHECK_EQ(wrong.load(), 0);
+    // Сообщение вызывающего потока и указатель на него не тронуты
+    CHECK(std::string(mainMessage).find("1000") != std::string::npos);
+    CHECK(lastError().find("1000") != std::string::npos);
+}
+
+TEST_CASE(last_error, new_thread_starts_empty) {
+    CHECK_EQ(failWithId(5), INVALID_LUT);
+    std::string seen = "unset";
+    std::thread([&seen] { seen = lastError(); }).join();
+    CHECK_EQ(seen, std::string(""));
+}
+
+TEST_CASE(last_error, context_variant_reads_calling_thread) {
+    LUTools_Context* ctx = LUTools_CreateContext(0);
+    int id = 0;
+    CHECK_EQ(LUTools_LoadLUTCtx(ctx, tempPath("ctx_absent.cube").c_str(), 1.0f, &id), INVALID_LUT);
+    const char* message = nullptr;
+    LUTools_GetLastErrorMessageCtx(ctx, &message);
+    REQUIRE(message != nullptr);
+    CHECK(std::string(message).find("ctx_absent.cube") != std::string::npos);
+    // Сообщение принадлежит потоку, а не контексту
+    CHECK(lastError().find("ctx_absent.cube") != std::string::npos);
+    LUTools_GetLastErrorMessageCtx(nullptr, &message);   // псевдоним: ctx не важен
+    CHECK(std::string(message).find("ctx_absent.cube") != std::string::npos);
+    LUTools_DestroyContext(ctx);
+}
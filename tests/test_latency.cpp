@@ -0,0 +1,185 @@
+#include "test_framework.hpp"
+#include "test_util.hpp"
+#include "stats.hpp"
+#include "LUToolsLite.h"
+#include <filesystem>
+#include <memory>
+#include <sstream>
+#include <string>
+
+using namespace ltltest;
+
+namespace {
+
+LatencyHistogram recorded(LatencyOp op, int size) {
+    auto snapshot = std::make_unique<LatencySnapshot>();
+    latencySnapshot(*snapshot);
+    return snapshot->hist[op][size];
+}
+
+void append(void* context, const void* data, int size) {
+    static_cast<std::string*>(context)->append(static_cast<const char*>(data), size_t(size));
+}
+
+std::string metricsText() {
+    std::string text;
+    LUTools_WriteLatencyMetrics(append, &text);
+    return text;
+}
+
+bool contains(const std::string& text, const std::string& part) { return text.find(part) != std::string::npos; }
+
+} // namespace
+
+TEST_CASE(latency, single_values_within_one_bin) {
+    // До 64 мкс — корзина в 1 мкс, дальше — не шире 1/32 значения
+    for (uint64_t micros : { 0ull, 1ull, 17ull, 63ull, 64ull, 65ull, 100ull, 1000ull, 4095ull, 4096ull,
+                             123457ull, 9999999ull, 600000000ull }) {
+        statReset();
+        latencyRecord(kLatPreview, 0, micros * 1000 + 999);   // доли микросекунды не меняют корзину
+        const LatencyHistogram h = recorded(kLatPreview, 0);
+        REQUIRE_EQ(h.count, uint64_t(1));
+        CHECK_EQ(h.sumNanos, micros * 1000 + 999);
+        const double upper = h.maxSeconds() * 1e6;
+        CHECK(upper > double(micros));
+        if (micros < 64) CHECK_EQ(upper, double(micros + 1));
+        else CHECK(upper <= double(micros) * (1.0 + 1.0 / 32) + 1e-6);
+        CHECK_EQ(h.quantile(0.5), h.maxSeconds());
+    }
+    // Больше 2^32 мкс — в последнюю корзину
+    statReset();
+    latencyRecord(kLatPreview, 0, (1ull << 40) * 1000);
+    CHECK(recorded(kLatPreview, 0).maxSeconds() > 4000.0);
+    statReset();
+}
+
+TEST_CASE(latency, quantiles_of_a_known_distribution) {
+    statReset();
+    // 1000 значений: 100, 200, … 100000 мкс
+    for (int i = 1; i <= 1000; ++i) latencyRecord(kLatProcessImage, 640 * 480, uint64_t(i) * 100 * 1000);
+    const LatencyHistogram h = recorded(kLatProcessImage, LTL_SIZE_025_1MP);
+    REQUIRE_EQ(h.count, uint64_t(1000));
+    const struct { double q; double exact; } cases[] = { {0.5, 0.05}, {0.95, 0.095}, {0.99, 0.099}, {1.0, 0.1}, {0.001, 0.0001} };
+    for (const auto& c : cases) {
+        const double v = h.quantile(c.q);
+        CHECK(v > c.exact);
+        CHECK(v <= c.exact * (1.0 + 1.0 / 32));
+    }
+    CHECK_EQ(recorded(kLatProcessImage, LTL_SIZE_UNDER_025MP).count, uint64_t(0));
+
+    LUTools_LatencyStats s{};
+    LUTools_GetLatency(LTL_LATENCY_PROCESS_IMAGE, LTL_SIZE_025_1MP, &s);
+    CHECK_EQ(s.count, 1000ull);
+    CHECK_EQ(s.p50, h.quantile(0.5));
+    CHECK_EQ(s.p99, h.quantile(0.99));
+    CHECK_EQ(s.max, h.maxSeconds());
+    CHECK(s.mean > 0.050049 && s.mean < 0.050051);   // точное среднее, не по корзинам
+    statReset();
+}
+
+TEST_CASE(latency, size_bucket_boundaries) {
+    CHECK_EQ(latencySizeBucket(0), LTL_SIZE_UNDER_025MP);
+    CHECK_EQ(latencySizeBucket(249999), LTL_SIZE_UNDER_025MP);
+    CHECK_EQ(latencySizeBucket(250000), LTL_SIZE_025_1MP);
+    CHECK_EQ(latencySizeBucket(999999), LTL_SIZE_025_1MP);
+    CHECK_EQ(latencySizeBucket(1000000), LTL_SIZE_1_4MP);
+    CHECK_EQ(latencySizeBucket(3999999), LTL_SIZE_1_4MP);
+    CHECK_EQ(latencySizeBucket(4000000), LTL_SIZE_4_16MP);
+    CHECK_EQ(latencySizeBucket(15999999), LTL_SIZE_4_16MP);
+    CHECK_EQ(latencySizeBucket(16000000), LTL_SIZE_16MP_AND_UP);
+    CHECK_EQ(latencySizeBucket(uint64_t(1) << 40), LTL_SIZE_16MP_AND_UP);
+}
+
+TEST_CASE(latency, api_records_only_successful_calls) {
+    REQUIRE_EQ(LUTools_Init(), SUCCESS);
+    const std::string cube = tempPath("lat.cube");
+    writeCube(cube, 17);
+    int lut = 0;
+    REQUIRE_EQ(LUTools_LoadLUT(cube.c_str(), 1.0f, &lut), SUCCESS);
+    LUTools_ResetStats();
+
+    const Image img = makeImage(640, 480, 3);
+    Image out;
+    CHECK_EQ(applyLUTs(img, { lut + 1000 }, out), INVALID_LUT);
+    LUTools_LatencyStats s{};
+    LUTools_GetLatency(LTL_LATENCY_PROCESS_IMAGE, -1, &s);
+    CHECK_EQ(s.count, 0ull);
+    CHECK_EQ(s.max, 0.0);
+
+    for (int i = 0; i < 3; ++i) REQUIRE_EQ(applyLUTs(img, { lut }, out), SUCCESS);
+    LUTools_GetLatency(LTL_LATENCY_PROCESS_IMAGE, -1, &s);
+    CHECK_EQ(s.count, 3ull);
+    CHECK(s.p50 > 0 && s.p50 <= s.p95 && s.p95 <= s.p99 && s.p99 <= s.max);
+    CHECK(s.mean > 0 && s.mean <= s.max);
+    LUTools_GetLatency(LTL_LATENCY_PROCESS_IMAGE, LTL_SIZE_025_1MP, &s);
+    CHECK_EQ(s.count, 3ull);
+    LUTools_GetLatency(LTL_LATENCY_PROCESS_IMAGE, LTL_SIZE_UNDER_025MP, &s);
+    CHECK_EQ(s.count, 0ull);
+
+    // ProcessFile: размер известен после декодирования
+    const std::string input = tempPath("lat_in.png"), output = tempPath("lat_out.png");
+    REQUIRE(saveImage(makeImage(1200, 1000, 3), input, "png"));
+    CHECK(LUTools_ProcessFileEx(tempPath("lat_absent.png").c_str(), output.c_str(), &lut, 1, 0, 0, 0, 0, 0, nullptr, nullptr, nullptr) != SUCCESS);
+    REQUIRE_EQ(LUTools_ProcessFileEx(input.c_str(), output.c_str(), &lut, 1, 0, 0, 0, 0, 0, nullptr, nullptr, nullptr), SUCCESS);
+    LUTools_GetLatency(LTL_LATENCY_PROCESS_FILE, -1, &s);
+    CHECK_EQ(s.count, 1ull);
+    LUTools_GetLatency(LTL_LATENCY_PROCESS_FILE, LTL_SIZE_1_4MP, &s);
+    CHECK_EQ(s.count, 1ull);
+
+    // Неверные аргументы — пустой результат
+    s.count = 99;
+    LUTools_GetLatency(LTL_LATENCY_OP_COUNT, -1, &s);
+    CHECK_EQ(s.count, 0ull);
+    s.count = 99;
+    LUTools_GetLatency(LTL_LATENCY_PROCESS_IMAGE, LTL_SIZE_COUNT, &s);
+    CHECK_EQ(s.count, 0ull);
+    LUTools_GetLatency(LTL_LATENCY_PROCESS_IMAGE, -1, nullptr);   // безвредно
+
+    LUTools_ResetStats();
+    LUTools_GetLatency(LTL_LATENCY_PROCESS_IMAGE, -1, &s);
+    CHECK_EQ(s.count, 0ull);
+}
+
+TEST_CASE(latency, prometheus_text_and_file) {
+    statReset();
+    latencyRecord(kLatProcessImage, 640 * 480, 2000000);   // 2 мс
+    latencyRecord(kLatProcessImage, 640 * 480, 4000000);
+    const std::string text = metricsText();
+    CHECK(contains(text, "# TYPE lutools_latency_seconds summary\n"));
+    CHECK(contains(text, "lutools_latency_seconds{op=\"ProcessImage\",size=\"0.25-1MP\",quantile=\"0.5\"} "));
+    CHECK(contains(text, "lutools_latency_seconds{op=\"ProcessImage\",size=\"0.25-1MP\",quantile=\"0.99\"} "));
+    CHECK(contains(text, "lutools_latency_seconds_sum{op=\"ProcessImage\",size=\"0.25-1MP\"} 0.006\n"));
+    CHECK(contains(text, "lutools_latency_seconds_count{op=\"ProcessImage\",size=\"0.25-1MP\"} 2\n"));
+    CHECK(contains(text, "lutools_latency_max_seconds{op=\"ProcessImage\",size=\"0.25-1MP\"} "));
+    // Пустые серии не выводятся
+    CHECK(!contains(text, "GeneratePreviewFit"));
+    CHECK(!contains(text, "<0.25MP"));
+
+    // Каждая строка — комментарий или «имя{метки} число»
+    std::istringstream lines(text);
+    std::string line;
+    int samples = 0;
+    while (std::getline(lines, line)) {
+        if (line.rfind("# ", 0) == 0) continue;
+        const size_t close = line.find("} ");
+        REQUIRE(close != std::string::npos);
+        CHECK(line.rfind("lutools_latency_", 0) == 0);
+        size_t used = 0;
+        const double value = std::stod(line.substr(close + 2), &used);
+        CHECK_EQ(close + 2 + used, line.size());
+        CHECK(value > 0);
+        ++samples;
+    }
+    CHECK_EQ(samples, 6);   // 3 квантиля, _sum, _count, max
+
+    const std::string path = tempPath("latency.prom");
+    REQUIRE_EQ(LUTools_SaveLatencyMetrics(path.c_str()), SUCCESS);
+    const auto bytes = readFile(path);
+    CHECK_EQ(std::string(bytes.begin(), bytes.end()), text);
+    CHECK(!std::filesystem::exists(path + ".tmp"));
+    CHECK_EQ(LUTools_SaveLatencyMetrics(tempPath("no_such_dir/latency.prom").c_str()), WRITE_FAILED);
+    CHECK_EQ(LUTools_SaveLatencyMetrics(nullptr), WRITE_FAILED);
+
+    LUTools_ResetStats();
+    CHECK(!contains(metricsText(), "ProcessImage"));
+}
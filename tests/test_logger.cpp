@@ -0,0 +1,313 @@
+#include "test_framework.hpp"
+#include "test_util.hpp"
+#include "logger.hpp"
+#include "LUToolsLite.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+using namespace ltltest;
+
+namespace {
+
+struct Capture {
+    std::mutex mutex;
+    std::vector<std::string> lines;
+    std::vector<int> errors;
+    std::thread::id thread;
+
+    static void callback(const char* message, int isError, void* userData) {
+        auto* self = static_cast<Capture*>(userData);
+        std::lock_guard<std::mutex> lock(self->mutex);
+        self->lines.emplace_back(message);
+        self->errors.push_back(isError);
+        self->thread = std::this_thread::get_id();
+    }
+};
+
+// Колбэк, который держит фоновый поток логгера, пока его не отпустят
+struct Gate {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool open = false;
+    std::atomic<bool> entered{false};
+
+    static void callback(const char*, int, void* userData) {
+        auto* self = static_cast<Gate*>(userData);
+        self->entered = true;
+        std::unique_lock<std::mutex> lock(self->mutex);
+        self->cv.wait(lock, [self] { return self->open; });
+    }
+    void release() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            open = true;
+        }
+        cv.notify_all();
+    }
+};
+
+size_t countLines(const std::string& path, const std::string& text) {
+    const auto bytes = readFile(path);
+    const std::string content(bytes.begin(), bytes.end());
+    size_t n = 0;
+    for (size_t p = content.find(text); p != std::string::npos; p = content.find(text, p + 1)) ++n;
+    return n;
+}
+
+struct LoggerReset {
+    ~LoggerReset() {
+        AsyncLogger& logger = AsyncLogger::instance();
+        logger.setLevel(kLogInfo);
+        logger.setRateLimit(0);
+        logger.setFile(nullptr);
+        logger.flush();
+    }
+};
+
+} // namespace
+
+TEST_CASE(logger, callback_gets_prefixed_lines_in_order_on_background_thread) {
+    LoggerReset reset;
+    AsyncLogger& logger = AsyncLogger::instance();
+    Capture capture;
+    for (int i = 0; i < 100; ++i) logger.log(kLogInfo, "message " + std::to_string(i), Capture::callback, &capture);
+    logger.log(kLogError, "broken", Capture::callback, &capture);
+    logger.log(kLogWarning, "careful", Capture::callback, &capture);
+    logger.flush();
+    REQUIRE_EQ(capture.lines.size(), size_t(102));
+    for (int i = 0; i < 100; ++i) CHECK_EQ(capture.lines[i], "[Лог] message " + std::to_string(i));
+    CHECK_EQ(capture.lines[100], std::string("[ОШИБКА] broken"));
+    CHECK_EQ(capture.errors[100], 1);
+    CHECK_EQ(capture.lines[101], std::string("[Предупреждение] careful"));
+    CHECK_EQ(capture.errors[101], 0);
+    CHECK(capture.thread != std::this_thread::get_id());
+}
+
+TEST_CASE(logger, level_filter) {
+    LoggerReset reset;
+    AsyncLogger& logger = AsyncLogger::instance();
+    Capture capture;
+    logger.setLevel(kLogWarning);
+    CHECK(!logger.enabled(kLogInfo));
+    CHECK(logger.enabled(kLogError));
+    const LogStats before = logger.stats();
+    logger.log(kLogInfo, "hidden", Capture::callback, &capture);
+    logger.log(kLogDebug, "hidden", Capture::callback, &capture);
+    logger.log(kLogWarning, "shown", Capture::callback, &capture);
+    logger.flush();
+    REQUIRE_EQ(capture.lines.size(), size_t(1));
+    CHECK_EQ(capture.lines[0], std::string("[Предупреждение] shown"));
+    // Отфильтрованные не считаются отброшенными
+    const LogStats after = logger.stats();
+    CHECK_EQ(after.droppedRate - before.droppedRate, uint64_t(0));
+    CHECK_EQ(after.droppedFull - before.droppedFull, uint64_t(0));
+
+    LUTools_SetLogLevel(LTL_LOG_DEBUG);
+    CHECK_EQ(logger.enabled(kLogDebug), LTL_LOG_COMPILE_LEVEL >= 3);
+    LUTools_SetLogLevel(99);   // обрезается до DEBUG
+    CHECK(logger.enabled(kLogWarning));
+}
+
+TEST_CASE(logger, long_messages_are_truncated) {
+    LoggerReset reset;
+    Capture capture;
+    AsyncLogger::instance().log(kLogInfo, std::string(5000, 'x'), Capture::callback, &capture);
+    AsyncLogger::instance().flush();
+    REQUIRE_EQ(capture.lines.size(), size_t(1));
+    CHECK_EQ(capture.lines[0], "[Лог] " + std::string(AsyncLogger::kMaxText, 'x'));
+}
+
+TEST_CASE(logger, file_sink_appends) {
+    LoggerReset reset;
+    const std::string path = tempPath("lutools.log");
+    LUTools_SetLogFile(path.c_str());
+    AsyncLogger::instance().log(kLogInfo, "to file one", nullptr, nullptr);
+    LUTools_FlushLog();
+    LUTools_SetLogFile(nullptr);
+    AsyncLogger::instance().log(kLogInfo, "not in file", nullptr, nullptr);
+    LUTools_FlushLog();
+    LUTools_SetLogFile(path.c_str());
+    AsyncLogger::instance().log(kLogError, "to file two", nullptr, nullptr);
+    LUTools_FlushLog();
+    CHECK_EQ(countLines(path, "[Лог] to file one\n"), size_t(1));
+    CHECK_EQ(countLines(path, "[ОШИБКА] to file two\n"), size_t(1));
+    CHECK_EQ(countLines(path, "not in file"), size_t(0));
+}
+
+TEST_CASE(logger, rate_limit_drops_and_counts) {
+    LoggerReset reset;
+    const std::string path = tempPath("rate.log");
+    LUTools_SetLogFile(path.c_str());
+    LUTools_SetLogRateLimit(10);
+    LUTools_LogStats before{};
+    LUTools_GetLogStats(&before);
+    Capture capture;
+    for (int i = 0; i < 200; ++i) AsyncLogger::instance().log(kLogInfo, "flood", Capture::callback, &capture);
+    for (int i = 0; i < 5; ++i) AsyncLogger::instance().log(kLogError, "error", Capture::callback, &capture);
+    LUTools_FlushLog();
+    LUTools_LogStats after{};
+    LUTools_GetLogStats(&after);
+
+    size_t floods = 0, errors = 0;
+    for (const auto& l : capture.lines) (l.find("flood") != std::string::npos ? floods : errors)++;
+    // Окно секунды могло смениться посреди цикла: не больше двух окон по 10
+    CHECK(floods >= 10 && floods <= 20);
+    CHECK_EQ(errors, size_t(5));   // ошибки не ограничиваются
+    CHECK_EQ(after.droppedRate - before.droppedRate, 200ull - floods);
+    CHECK_EQ(after.written - before.written, static_cast<unsigned long long>(floods + 5));
+    CHECK(countLines(path, "Log dropped") >= 1);
+}
+
+TEST_CASE(logger, full_queue_drops_without_blocking) {
+    LoggerReset reset;
+    AsyncLogger& logger = AsyncLogger::instance();
+    Gate gate;
+    const LogStats before = logger.stats();
+    logger.log(kLogInfo, "hold", Gate::callback, &gate);
+    while (!gate.entered) std::this_thread::yield();
+    // Фоновый поток занят: кольцо заполняется, лишнее отбрасывается сразу
+    const int total = int(AsyncLogger::kCapacity) * 3;
+    for (int i = 0; i < total; ++i) logger.log(kLogInfo, "fill", nullptr, nullptr);
+    const LogStats blocked = logger.stats();
+    CHECK(blocked.droppedFull - before.droppedFull >= uint64_t(total) - AsyncLogger::kCapacity);
+    gate.release();
+    logger.flush();
+    const LogStats after = logger.stats();
+    CHECK_EQ((after.written - before.written) + (after.droppedFull - before.droppedFull), uint64_t(total) + 1);
+}
+
+TEST_CASE(logger, api_callback_replacement_is_synchronous) {
+    LoggerReset reset;
+    REQUIRE_EQ(LUTools_Init(), SUCCESS);
+    Capture first, second;
+    LUTools_SetLogCallback(Capture::callback, &first);
+    int id = 0;
+    const std::string cube = tempPath("logged.cube");
+    writeCube(cube, 5);
+    REQUIRE_EQ(LUTools_LoadLUT(cube.c_str(), 1.0f, &id), SUCCESS);
+    LUTools_SetLogCallback(Capture::callback, &second);
+    // Всё, что поставлено со старым колбэком, выведено до возврата
+    const size_t seen = first.lines.size();
+    CHECK(seen >= 1);
+    bool found = false;
+    for (const auto& l : first.lines) found = found || l.find("logged.cube") != std::string::npos;
+    CHECK(found);
+    LUTools_UnloadLUT(id);
+    LUTools_FlushLog();
+    CHECK_EQ(first.lines.size(), seen);
+    CHECK(!second.lines.empty());
+    LUTools_SetLogCallback(nullptr, nullptr);
+}
+
+TEST_CASE(logger, call_callback_overrides_context_callback) {
+    LoggerReset reset;
+    REQUIRE_EQ(LUTools_Init(), SUCCESS);
+    Capture context, call;
+    LUTools_SetLogCallback(Capture::callback, &context);
+    int id = 0;
+    const std::string cube = tempPath("call_log.cube");
+    writeCube(cube, 5);
+    REQUIRE_EQ(LUTools_LoadLUT(cube.c_str(), 1.0f, &id), SUCCESS);
+    LUTools_FlushLog();
+    const size_t before = context.lines.size();
+
+    const std::string missing = tempPath("call_log_missing.png");
+    CHECK(LUTools_ProcessFileStreaming(missing.c_str(), tempPath("call_log_out.png").c_str(), &id, 1, 0, 0, 0, 0, 0,
+                                       nullptr, 0, Capture::callback, &call) != SUCCESS);
+    LUTools_FlushLog();
+    REQUIRE(!call.lines.empty());
+    CHECK(call.lines.back().find("call_log_missing.png") != std::string::npos);
+    CHECK_EQ(call.errors.back(), 1);
+    CHECK_EQ(context.lines.size(), before);
+
+    // После возврата — снова колбэк контекста
+    LUTools_UnloadLUT(id);
+    LUTools_FlushLog();
+    const size_t seen = call.lines.size();
+    CHECK(context.lines.size() > before);
+    CHECK_EQ(call.lines.size(), seen);
+    LUTools_SetLogCallback(nullptr, nullptr);
+}
+
+TEST_CASE(logger, process_file_ex_and_batch_use_call_callback) {
+    LoggerReset reset;
+    REQUIRE_EQ(LUTools_Init(), SUCCESS);
+    Capture context, single, batch;
+    LUTools_SetLogCallback(Capture::callback, &context);
+    int id = 0;
+    const std::string cube = tempPath("call_log_ex.cube");
+    writeCube(cube, 5);
+    REQUIRE_EQ(LUTools_LoadLUT(cube.c_str(), 1.0f, &id), SUCCESS);
+    LUTools_FlushLog();
+    const size_t before = context.lines.size();
+
+    const std::string missing = tempPath("call_log_ex_missing.png");
+    CHECK(LUTools_ProcessFileEx(missing.c_str(), tempPath("call_log_ex_out.png").c_str(), &id, 1, 0, 0, 0, 0, 0,
+                                nullptr, Capture::callback, &single) != SUCCESS);
+    // Задачи пакета идут в других потоках, но пишут в колбэк своего вызова
+    const std::string input = tempPath("call_log_ex_in.png");
+    REQUIRE(saveImage(makeImage(16, 16), input, "png"));
+    const std::string out1 = tempPath("call_log_ex_1.png"), out2 = tempPath("call_log_ex_2.png");
+    const char* inputs[] = { input.c_str(), missing.c_str() };
+    const char* outputs[] = { out1.c_str(), out2.c_str() };
+    LUTools_ProcessFilesEx(inputs, outputs, 2, &id, 1, 0, 0, 0, 0, 0, nullptr, Capture::callback, &batch);
+    LUTools_FlushLog();
+
+    REQUIRE(!single.lines.empty());
+    CHECK(single.lines.back().find("call_log_ex_missing.png") != std::string::npos);
+    CHECK_EQ(single.errors.back(), 1);
+    bool processed = false, failed = false;
+    for (const auto& l : batch.lines) {
+        processed = processed || l.find("call_log_ex_1.png") != std::string::npos;
+        failed = failed || l.find("call_log_ex_missing.png") != std::string::npos;
+    }
+    CHECK(processed);
+    CHECK(failed);
+    CHECK_EQ(context.lines.size(), before);
+    LUTools_UnloadLUT(id);
+    LUTools_SetLogCallback(nullptr, nullptr);
+}
+
+TEST_CASE(logger, shutdown_drains_and_next_message_restarts) {
+    LoggerReset reset;
+    AsyncLogger& logger = AsyncLogger::instance();
+    Capture capture;
+    for (int i = 0; i < 10; ++i) logger.log(kLogInfo, "before " + std::to_string(i), Capture::callback, &capture);
+    logger.shutdown();   // очередь выведена до возврата
+    CHECK_EQ(capture.lines.size(), size_t(10));
+    logger.shutdown();   // повторно — безвредно
+    logger.flush();      // пустая очередь: поток не нужен
+    logger.log(kLogInfo, "after", Capture::callback, &capture);
+    logger.flush();
+    REQUIRE_EQ(capture.lines.size(), size_t(11));
+    CHECK(capture.lines.back().find("after") != std::string::npos);
+    CHECK(capture.thread != std::this_thread::get_id());
+}
+
+TEST_CASE(logger, cleanup_stops_threads_and_library_keeps_working) {
+    LoggerReset reset;
+    REQUIRE_EQ(LUTools_Init(), SUCCESS);
+    LUTools_Cleanup();
+    REQUIRE_EQ(LUTools_Init(), SUCCESS);
+    Capture capture;
+    LUTools_SetLogCallback(Capture::callback, &capture);
+    std::vector<std::string> names;
+    for (int i = 0; i < 4; ++i) {
+        names.push_back(tempPath("cleanup" + std::to_string(i) + ".cube"));
+        writeCube(names.back(), 5);
+    }
+    std::vector<const char*> paths;
+    for (const auto& n : names) paths.push_back(n.c_str());
+    std::vector<int> ids(names.size());
+    REQUIRE_EQ(LUTools_RegisterLUTs(paths.data(), int(paths.size()), 1.0f, ids.data()), SUCCESS);
+    Image out;
+    REQUIRE_EQ(applyLUTs(makeImage(1200, 1000, 2), { ids[0] }, out), SUCCESS);   // ядро на пуле
+    LUTools_FlushLog();
+    CHECK(!capture.lines.empty());
+    LUTools_SetLogCallback(nullptr, nullptr);
+    LUTools_Cleanup();
+    REQUIRE_EQ(LUTools_Init(), SUCCESS);
+}
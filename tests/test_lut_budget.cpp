@@ -0,0 +1,129 @@
+#include "test_framework.hpp"
+#include "test_util.hpp"
+#include "LUToolsLite.h"
+#include <filesystem>
+
+using namespace ltltest;
+
+namespace {
+
+const unsigned long long kLUTBytes = 17ull * 17 * 17 * sizeof(Color);
+
+int state(int id) {
+    LUTools_LUTInfo info{};
+    REQUIRE_EQ(LUTools_GetLUTInfo(id, &info), SUCCESS);
+    return info.state;
+}
+
+LUTools_LUTStats stats() {
+    LUTools_LUTStats s{};
+    LUTools_GetLUTStats(&s);
+    return s;
+}
+
+// Три LUT по 17³ с разными таблицами, загружены в порядке A, B, C
+struct Library {
+    int a = 0, b = 0, c = 0;
+
+    Library() {
+        REQUIRE_EQ(LUTools_Init(), SUCCESS);
+        LUTools_SetLUTBudget(0);
+        int* ids[] = { &a, &b, &c };
+        for (int i = 0; i < 3; ++i) {
+            const std::string path = tempPath("lut" + std::to_string(i) + ".cube");
+            const float k = 0.5f + 0.2f * i;
+            writeCube(path, 17, "", [k](float r, float g, float bl) { return Color{r * k, g, 1 - bl * k}; });
+            REQUIRE_EQ(LUTools_LoadLUT(path.c_str(), 1.0f, ids[i]), SUCCESS);
+        }
+    }
+    ~Library() { LUTools_SetLUTBudget(0); }
+
+    void use(int id) {
+        Image out;
+        REQUIRE_EQ(applyLUTs(makeImage(4, 4), { id }, out), SUCCESS);
+    }
+};
+
+} // namespace
+
+TEST_CASE(lut_budget, unlimited_by_default) {
+    Library lib;
+    const LUTools_LUTStats s = stats();
+    CHECK_EQ(s.budget, 0ull);
+    CHECK_EQ(s.loaded, 3);
+    CHECK_EQ(s.bytesLoaded, 3 * kLUTBytes);
+    CHECK_EQ(s.evictions, 0ull);
+}
+
+TEST_CASE(lut_budget, evicts_least_recently_used) {
+    Library lib;
+    lib.use(lib.a);   // порядок давности: B, C, A
+
+    LUTools_SetLUTBudget(2 * kLUTBytes);
+    CHECK_EQ(state(lib.b), LTL_LUT_REGISTERED);
+    CHECK_EQ(state(lib.a), LTL_LUT_LOADED);
+    CHECK_EQ(state(lib.c), LTL_LUT_LOADED);
+    LUTools_LUTStats s = stats();
+    CHECK_EQ(s.evictions, 1ull);
+    CHECK_EQ(s.loaded, 2);
+    CHECK_EQ(s.bytesLoaded, 2 * kLUTBytes);
+
+    // B снова нужен: загружается, вытесняя C — теперь самый давний
+    lib.use(lib.b);
+    CHECK_EQ(state(lib.b), LTL_LUT_LOADED);
+    CHECK_EQ(state(lib.c), LTL_LUT_REGISTERED);
+    CHECK_EQ(state(lib.a), LTL_LUT_LOADED);
+    s = stats();
+    CHECK_EQ(s.evictions, 2ull);
+    CHECK(s.bytesLoaded <= s.budget);
+
+    // Бюджет на один LUT: остаётся только последний использованный
+    LUTools_SetLUTBudget(kLUTBytes);
+    CHECK_EQ(state(lib.b), LTL_LUT_LOADED);
+    CHECK_EQ(state(lib.a), LTL_LUT_REGISTERED);
+    CHECK_EQ(stats().evictions, 3ull);
+}
+
+TEST_CASE(lut_budget, hits_and_misses) {
+    Library lib;
+    LUTools_SetLUTBudget(kLUTBytes);   // A и B вытеснены, C — последний загруженный
+    CHECK_EQ(stats().loaded, 1);
+    const LUTools_LUTStats before = stats();
+    lib.use(lib.c);                    // попадание
+    lib.use(lib.a);                    // промах, C вытесняется
+    lib.use(lib.a);                    // попадание
+    lib.use(lib.c);                    // промах
+    const LUTools_LUTStats after = stats();
+    CHECK_EQ(after.hits - before.hits, 2ull);
+    CHECK_EQ(after.misses - before.misses, 2ull);
+    CHECK_EQ(after.evictions - before.evictions, 2ull);
+    CHECK_EQ(after.loaded, 1);
+}
+
+TEST_CASE(lut_budget, chain_larger_than_budget_still_runs) {
+    Library lib;
+    const Image img = makeImage(16, 16, 5);
+    Image expected;
+    REQUIRE_EQ(applyLUTs(img, { lib.a, lib.b, lib.c }, expected), SUCCESS);
+
+    // Бюджет меньше одной таблицы: каждая перечитывается, результат тот же
+    LUTools_SetLUTBudget(1);
+    Image actual;
+    REQUIRE_EQ(applyLUTs(img, { lib.a, lib.b, lib.c }, actual), SUCCESS);
+    CHECK(samePixels(expected, actual));
+    REQUIRE_EQ(applyLUTs(img, { lib.a, lib.b, lib.c }, actual), SUCCESS);
+    CHECK(samePixels(expected, actual));
+    CHECK(stats().loaded <= 1);
+}
+
+TEST_CASE(lut_budget, evicted_lut_with_missing_source_fails) {
+    Library lib;
+    LUTools_SetLUTBudget(kLUTBytes);
+    CHECK_EQ(state(lib.a), LTL_LUT_REGISTERED);
+    std::filesystem::remove(tempPath("lut0.cube"));
+    Image out;
+    CHECK_EQ(applyLUTs(makeImage(4, 4), { lib.a }, out), INVALID_LUT);
+    CHECK_EQ(state(lib.a), LTL_LUT_FAILED);
+    // Остальные не затронуты
+    CHECK_EQ(applyLUTs(makeImage(4, 4), { lib.b }, out), SUCCESS);
+}
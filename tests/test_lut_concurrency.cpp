@@ -0,0 +1,126 @@
+#include "test_framework.hpp"
+#include "test_util.hpp"
+#include "LUToolsLite.h"
+#include <atomic>
+#include <set>
+#include <thread>
+
+using namespace ltltest;
+
+namespace {
+
+Color invert(float r, float g, float b) { return Color{1 - r, 1 - g, 1 - b}; }
+Color swap(float r, float g, float b) { return Color{b, r, g}; }
+
+int loadLUT(const std::string& name, const CubeFn& fn) {
+    const std::string path = tempPath(name);
+    writeCube(path, 17, "", fn);
+    int id = 0;
+    REQUIRE_EQ(LUTools_LoadLUT(path.c_str(), 1.0f, &id), SUCCESS);
+    return id;
+}
+
+} // namespace
+
+TEST_CASE(lut_concurrency, readers_see_stable_luts_while_registry_changes) {
+    REQUIRE_EQ(LUTools_Init(), SUCCESS);
+    const int a = loadLUT("a.cube", invert);
+    const int b = loadLUT("b.cube", swap);
+    const std::string extra = tempPath("extra.cube");
+    writeCube(extra, 9, "Extra");
+
+    const Image img = makeImage(48, 32, 8);
+    Image expected;
+    REQUIRE_EQ(applyLUTs(img, { a, b }, expected), SUCCESS);
+
+    std::atomic<bool> stop{false};
+    std::atomic<int> mismatches{0}, failures{0}, reads{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 3; ++t) {
+        readers.emplace_back([&] {
+            while (!stop) {
+                Image out;
+                if (applyLUTs(img, { a, b }, out) != SUCCESS) ++failures;
+                else if (!samePixels(out, expected)) ++mismatches;
+                LUTools_LUTInfo info{};
+                if (LUTools_GetLUTInfo(a, &info) != SUCCESS || info.size != 17) ++failures;
+                ++reads;
+            }
+        });
+    }
+
+    // Писатель: загрузки, выгрузки, регистрация и вытеснение по бюджету
+    std::set<int> ids;
+    for (int i = 0; i < 60; ++i) {
+        int id = 0;
+        REQUIRE_EQ(LUTools_LoadLUT(extra.c_str(), 1.0f, &id), SUCCESS);
+        CHECK(ids.insert(id).second);
+        const char* paths[] = { extra.c_str(), extra.c_str() };
+        int registered[2] = {};
+        REQUIRE_EQ(LUTools_RegisterLUTs(paths, 2, 1.0f, registered), SUCCESS);
+        LUTools_UnloadLUT(id);
+        LUTools_UnloadLUT(registered[0]);
+        LUTools_SetLUTBudget(i % 3 == 0 ? 1 : 0);   // a и b тоже вытесняются и перечитываются
+        std::this_thread::yield();
+    }
+    LUTools_SetLUTBudget(0);
+    while (reads < 20) std::this_thread::yield();
+    stop = true;
+    for (auto& t : readers) t.join();
+
+    CHECK_EQ(failures.load(), 0);
+    CHECK_EQ(mismatches.load(), 0);
+    CHECK_EQ(ids.size(), size_t(60));
+}
+
+TEST_CASE(lut_concurrency, snapshots_are_never_partial) {
+    REQUIRE_EQ(LUTools_Init(), SUCCESS);
+    LUTools_ClearLUTs();
+    const std::string path = tempPath("batch.cube");
+    writeCube(path, 5, "Batch");
+    std::vector<std::string> names(5, path);
+    std::vector<const char*> paths;
+    for (const auto& n : names) paths.push_back(n.c_str());
+
+    std::atomic<bool> stop{false};
+    std::atomic<int> torn{0};
+    std::thread reader([&] {
+        while (!stop) {
+            LUTools_LUTStats stats{};
+            LUTools_GetLUTStats(&stats);
+            if (stats.registered % 5 != 0) ++torn;   // пакет публикуется одним снимком
+        }
+    });
+    for (int i = 0; i < 100; ++i) {
+        int ids[5] = {};
+        REQUIRE_EQ(LUTools_RegisterLUTs(paths.data(), 5, 1.0f, ids), SUCCESS);
+        if (i % 10 == 9) LUTools_ClearLUTs();
+    }
+    stop = true;
+    reader.join();
+    CHECK_EQ(torn.load(), 0);
+}
+
+TEST_CASE(lut_concurrency, parallel_loads_get_unique_ids) {
+    REQUIRE_EQ(LUTools_Init(), SUCCESS);
+    LUTools_ClearLUTs();
+    const std::string path = tempPath("shared.cube");
+    writeCube(path, 9, "Shared", invert);
+    std::vector<std::vector<int>> perThread(4);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < 25; ++i) {
+                int id = 0;
+                if (LUTools_LoadLUT(path.c_str(), 1.0f, &id) == SUCCESS) perThread[t].push_back(id);
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    std::set<int> ids;
+    for (const auto& v : perThread) ids.insert(v.begin(), v.end());
+    CHECK_EQ(ids.size(), size_t(100));
+    LUTools_LUTStats stats{};
+    LUTools_GetLUTStats(&stats);
+    CHECK_EQ(stats.registered, 100);
+}
@@ -0,0 +1,148 @@
+#include "test_framework.hpp"
+#include "test_util.hpp"
+#include "LUToolsLite.h"
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+
+using namespace ltltest;
+
+namespace {
+
+Color invert(float r, float g, float b) { return Color{1 - r, 1 - g, 1 - b}; }
+
+// Декодер PNG из теста: отдаёт source и по пути вызывает hook. Цепочка LUT к этому
+// моменту уже собрана, так что hook меняет реестр посреди обработки.
+struct HookDecoder {
+    Image source;
+    std::function<void()> hook;
+};
+
+int hookDecode(const unsigned char*, size_t, LUTools_DecodedImage* out, void* userData) {
+    auto* decoder = static_cast<HookDecoder*>(userData);
+    if (decoder->hook) decoder->hook();
+    const size_t bytes = decoder->source.data.size();
+    out->width = decoder->source.width;
+    out->height = decoder->source.height;
+    out->pixels = static_cast<unsigned char*>(std::malloc(bytes));
+    std::memcpy(out->pixels, decoder->source.data.data(), bytes);
+    out->release = [](unsigned char* p, void*) { std::free(p); };
+    return 0;
+}
+
+struct HookCodec {
+    HookDecoder decoder;
+
+    explicit HookCodec(const Image& source) {
+        decoder.source = source;
+        LUTools_CodecDesc desc{};
+        desc.name = "hook";
+        desc.formats = "png";
+        desc.capabilities = LTL_CODEC_CAP_DECODE;
+        desc.priority = 100;
+        desc.decode = hookDecode;
+        desc.userData = &decoder;
+        REQUIRE_EQ(LUTools_RegisterCodec(&desc), SUCCESS);
+    }
+    ~HookCodec() { LUTools_UnregisterCodec("hook"); }
+};
+
+int processFile(const std::string& in, const std::string& out, const std::vector<int>& ids) {
+    LUTools_OutputOptions o{};
+    LUTools_GetDefaultOutputOptions(&o);
+    o.format = LTL_FORMAT_QOI;
+    return LUTools_ProcessFileEx(in.c_str(), out.c_str(), ids.data(), int(ids.size()), 0, 0, 0, 0, 0, &o, nullptr, nullptr);
+}
+
+Image decodeFile(const std::string& path) {
+    const auto bytes = readFile(path);
+    Image img{};
+    decodeQoi(bytes.data(), bytes.size(), img);
+    return img;
+}
+
+struct Fixture {
+    Image source = makeImage(96, 64, 10);
+    std::string input = tempPath("in.png");
+    int lut = 0;
+    Image expected;
+
+    Fixture() {
+        REQUIRE_EQ(LUTools_Init(), SUCCESS);
+        REQUIRE(saveImage(source, input, "png"));
+        const std::string cube = tempPath("invert.cube");
+        writeCube(cube, 33, "Invert", invert);
+        REQUIRE_EQ(LUTools_LoadLUT(cube.c_str(), 1.0f, &lut), SUCCESS);
+        REQUIRE_EQ(applyLUTs(source, { lut }, expected), SUCCESS);
+    }
+};
+
+} // namespace
+
+TEST_CASE(lut_handles, unload_during_processing) {
+    Fixture f;
+    HookCodec codec(f.source);
+    codec.decoder.hook = [&f] { LUTools_UnloadLUT(f.lut); };
+    const std::string output = tempPath("unload.qoi");
+    REQUIRE_EQ(processFile(f.input, output, { f.lut }), SUCCESS);
+    CHECK(samePixels(decodeFile(output), f.expected));
+
+    // Начатый вызов доработал со своей ссылкой; новые id не видят
+    codec.decoder.hook = nullptr;
+    CHECK_EQ(processFile(f.input, output, { f.lut }), INVALID_LUT);
+}
+
+TEST_CASE(lut_handles, clear_and_reload_during_processing) {
+    Fixture f;
+    HookCodec codec(f.source);
+    int replacement = 0;
+    codec.decoder.hook = [&] {
+        LUTools_ClearLUTs();
+        // Тот же путь с другим содержимым: старая таблица у вызова не меняется
+        const std::string cube = tempPath("invert.cube");
+        writeCube(cube, 33, "Identity");
+        REQUIRE_EQ(LUTools_LoadLUT(cube.c_str(), 1.0f, &replacement), SUCCESS);
+    };
+    const std::string output = tempPath("clear.qoi");
+    REQUIRE_EQ(processFile(f.input, output, { f.lut }), SUCCESS);
+    CHECK(samePixels(decodeFile(output), f.expected));
+    CHECK(replacement != f.lut);   // id не переиспользуются
+
+    codec.decoder.hook = nullptr;
+    Image identity;
+    REQUIRE_EQ(applyLUTs(f.source, { replacement }, identity), SUCCESS);
+    CHECK(maxDifference(identity, f.source) <= 1);
+}
+
+TEST_CASE(lut_handles, calls_do_not_copy_tables) {
+    REQUIRE_EQ(LUTools_Init(), SUCCESS);
+    LUTools_SetLUTCacheEnabled(0);   // таблица в куче, а не в отображении кэша
+    const std::string cube = tempPath("large.cube");
+    writeCube(cube, 65, "", invert);
+    int lut = 0;
+    REQUIRE_EQ(LUTools_LoadLUT(cube.c_str(), 1.0f, &lut), SUCCESS);
+    LUTools_SetLUTCacheEnabled(1);
+
+    const size_t tableBytes = size_t(65) * 65 * 65 * sizeof(Color);
+    const Image img = makeImage(16, 16);
+    Image out;
+    resetHeapPeak();
+    const size_t base = heapLiveBytes();
+    for (int i = 0; i < 4; ++i) REQUIRE_EQ(applyLUTs(img, { lut, lut, lut }, out), SUCCESS);
+    CHECK(heapPeakBytes() - base < tableBytes / 8);
+}
+
+TEST_CASE(lut_handles, invalid_ids_in_chain) {
+    Fixture f;
+    Image out;
+    CHECK_EQ(applyLUTs(f.source, { f.lut, 424242 }, out), INVALID_LUT);
+    const char* message = nullptr;
+    LUTools_GetLastErrorMessage(&message);
+    REQUIRE(message != nullptr);
+    CHECK(std::string(message).find("424242") != std::string::npos);
+    CHECK_EQ(applyLUTs(f.source, { 0 }, out), INVALID_LUT);
+    CHECK_EQ(applyLUTs(f.source, { -1 }, out), INVALID_LUT);
+    // Выгрузка несуществующего id безвредна
+    LUTools_UnloadLUT(424242);
+    CHECK_EQ(applyLUTs(f.source, { f.lut }, out), SUCCESS);
+}
@@ -0,0 +1,156 @@
+#include "test_framework.hpp"
+#include "test_util.hpp"
+#include "LUToolsLite.h"
+#include <chrono>
+#include <filesystem>
+#include <thread>
+
+using namespace ltltest;
+
+namespace {
+
+Color invert(float r, float g, float b) { return Color{1 - r, 1 - g, 1 - b}; }
+
+// Заголовки читаются задачами пула: ждём выхода из LTL_LUT_PENDING
+LUTools_LUTInfo waitInfo(int id) {
+    LUTools_LUTInfo info{};
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    do {
+        REQUIRE_EQ(LUTools_GetLUTInfo(id, &info), SUCCESS);
+        if (info.state != LTL_LUT_PENDING) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    } while (std::chrono::steady_clock::now() < deadline);
+    return info;
+}
+
+std::string lastError() {
+    const char* message = nullptr;
+    LUTools_GetLastErrorMessage(&message);
+    return message ? message : "";
+}
+
+} // namespace
+
+TEST_CASE(lut_registry, register_reads_headers_without_tables) {
+    REQUIRE_EQ(LUTools_Init(), SUCCESS);
+    LUTools_ClearLUTs();
+    const std::string a = tempPath("a.cube"), b = tempPath("b.cube");
+    writeCube(a, 17, "First", invert);
+    writeCube(b, 9, "Second");
+    const char* paths[] = { a.c_str(), b.c_str() };
+    int ids[2] = {};
+    REQUIRE_EQ(LUTools_RegisterLUTs(paths, 2, 0.5f, ids), SUCCESS);
+    CHECK(ids[0] != ids[1]);
+
+    const LUTools_LUTInfo first = waitInfo(ids[0]);
+    CHECK_EQ(first.state, LTL_LUT_REGISTERED);
+    CHECK_EQ(first.size, 17);
+    CHECK_EQ(first.blend, 0.5f);
+    CHECK_EQ(std::string(first.title), std::string("First"));
+    const LUTools_LUTInfo second = waitInfo(ids[1]);
+    CHECK_EQ(second.state, LTL_LUT_REGISTERED);
+    CHECK_EQ(second.size, 9);
+
+    // Регистрация не загружает таблицы
+    LUTools_LUTStats stats{};
+    LUTools_GetLUTStats(&stats);
+    CHECK_EQ(stats.registered, 2);
+    CHECK_EQ(stats.loaded, 0);
+    CHECK_EQ(stats.bytesLoaded, 0ull);
+}
+
+TEST_CASE(lut_registry, first_use_loads_table) {
+    REQUIRE_EQ(LUTools_Init(), SUCCESS);
+    LUTools_ClearLUTs();
+    const std::string path = tempPath("lazy.cube");
+    writeCube(path, 17, "Lazy", invert);
+    const char* paths[] = { path.c_str() };
+    int lazy = 0, eager = 0;
+    REQUIRE_EQ(LUTools_RegisterLUTs(paths, 1, 1.0f, &lazy), SUCCESS);
+    REQUIRE_EQ(LUTools_LoadLUT(path.c_str(), 1.0f, &eager), SUCCESS);
+    waitInfo(lazy);
+
+    const Image img = makeImage(40, 30, 10);
+    Image viaLazy, viaEager;
+    REQUIRE_EQ(applyLUTs(img, { lazy }, viaLazy), SUCCESS);
+    REQUIRE_EQ(applyLUTs(img, { eager }, viaEager), SUCCESS);
+    CHECK(samePixels(viaLazy, viaEager));
+    CHECK(!samePixels(viaLazy, img));
+    CHECK_EQ(waitInfo(lazy).state, LTL_LUT_LOADED);
+
+    LUTools_LUTStats stats{};
+    LUTools_GetLUTStats(&stats);
+    CHECK_EQ(stats.loaded, 2);
+    CHECK_EQ(stats.bytesLoaded, 2ull * 17 * 17 * 17 * sizeof(Color));
+}
+
+TEST_CASE(lut_registry, unreadable_files_fail_on_use) {
+    REQUIRE_EQ(LUTools_Init(), SUCCESS);
+    LUTools_ClearLUTs();
+    const std::string missing = tempPath("missing.cube");
+    const std::string badHeader = tempPath("bad_header.cube");
+    REQUIRE(writeFile(badHeader, { 'L', 'U', 'T', '_', '3', 'D', '_', 'S', 'I', 'Z', 'E', ' ', 'x', '\n' }));
+    // Заголовок в порядке, данные обрезаны: ошибка видна только при загрузке
+    const std::string truncated = tempPath("truncated.cube");
+    writeCube(truncated, 9, "Truncated");
+    auto bytes = readFile(truncated);
+    bytes.resize(bytes.size() / 2);
+    REQUIRE(writeFile(truncated, bytes));
+
+    const char* paths[] = { missing.c_str(), badHeader.c_str(), truncated.c_str() };
+    int ids[3] = {};
+    REQUIRE_EQ(LUTools_RegisterLUTs(paths, 3, 1.0f, ids), SUCCESS);
+    CHECK_EQ(waitInfo(ids[0]).state, LTL_LUT_FAILED);
+    CHECK_EQ(waitInfo(ids[1]).state, LTL_LUT_FAILED);
+    CHECK_EQ(waitInfo(ids[2]).state, LTL_LUT_REGISTERED);
+
+    const Image img = makeImage(8, 8);
+    Image out;
+    CHECK_EQ(applyLUTs(img, { ids[0] }, out), INVALID_LUT);
+    CHECK(lastError().find("missing.cube") != std::string::npos);
+    CHECK_EQ(applyLUTs(img, { ids[2] }, out), INVALID_LUT);
+    CHECK_EQ(waitInfo(ids[2]).state, LTL_LUT_FAILED);
+}
+
+TEST_CASE(lut_registry, directory_registration) {
+    REQUIRE_EQ(LUTools_Init(), SUCCESS);
+    LUTools_ClearLUTs();
+    const std::string dir = tempPath("library");
+    std::filesystem::create_directories(dir + "/nested");
+    writeCube(dir + "/b.cube", 5, "B");
+    writeCube(dir + "/a.CUBE", 5, "A");
+    writeCube(dir + "/c.txt", 5, "C");
+    writeCube(dir + "/nested/d.cube", 5, "D");
+
+    int count = 0;
+    REQUIRE_EQ(LUTools_RegisterLUTDirectory(dir.c_str(), 1.0f, nullptr, 0, &count), SUCCESS);
+    CHECK_EQ(count, 2);
+    LUTools_LUTStats stats{};
+    LUTools_GetLUTStats(&stats);
+    CHECK_EQ(stats.registered, 0);   // только подсчёт
+
+    int small[1] = {};
+    CHECK_EQ(LUTools_RegisterLUTDirectory(dir.c_str(), 1.0f, small, 1, &count), INVALID_LUT);
+
+    int ids[4] = {};
+    REQUIRE_EQ(LUTools_RegisterLUTDirectory(dir.c_str(), 1.0f, ids, 4, &count), SUCCESS);
+    REQUIRE_EQ(count, 2);
+    // Порядок имён: "a.CUBE" < "b.cube"
+    CHECK_EQ(std::string(waitInfo(ids[0]).title), std::string("A"));
+    CHECK_EQ(std::string(waitInfo(ids[1]).title), std::string("B"));
+
+    CHECK_EQ(LUTools_RegisterLUTDirectory(tempPath("no_such_dir").c_str(), 1.0f, ids, 4, &count), INVALID_LUT);
+}
+
+TEST_CASE(lut_registry, invalid_arguments) {
+    REQUIRE_EQ(LUTools_Init(), SUCCESS);
+    int ids[2] = {};
+    const char* paths[] = { "x.cube", nullptr };
+    CHECK_EQ(LUTools_RegisterLUTs(nullptr, 1, 1.0f, ids), INVALID_LUT);
+    CHECK_EQ(LUTools_RegisterLUTs(paths, 0, 1.0f, ids), INVALID_LUT);
+    CHECK_EQ(LUTools_RegisterLUTs(paths, 2, 1.0f, ids), INVALID_LUT);
+    CHECK_EQ(LUTools_RegisterLUTDirectory(nullptr, 1.0f, ids, 2, nullptr), INVALID_LUT);
+    LUTools_LUTInfo info{};
+    CHECK_EQ(LUTools_GetLUTInfo(987654, &info), INVALID_LUT);
+    CHECK_EQ(LUTools_GetLUTInfo(ids[0], nullptr), INVALID_LUT);
+}
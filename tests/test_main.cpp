@@ -0,0 +1,54 @@
+#include "test_framework.hpp"
+#include "test_util.hpp"
+#include <cstdio>
+#include <cstring>
+#include <exception>
+
+namespace ltltest {
+
+namespace {
+int g_failures = 0;
+}
+
+std::vector<TestCase>& registry() {
+    static std::vector<TestCase> cases;
+    return cases;
+}
+
+void fail(const char* file, int line, const std::string& what) {
+    ++g_failures;
+    std::fprintf(stderr, "  %s:%d: FAILED: %s\n", file, line, what.c_str());
+}
+
+} // namespace ltltest
+
+// LUToolsLiteTests [набор]: без аргумента — все наборы в одном процессе
+int main(int argc, char** argv) {
+    const char* suite = argc > 1 ? argv[1] : nullptr;
+    int run = 0, failedCases = 0;
+    for (const ltltest::TestCase& test : ltltest::registry()) {
+        if (suite && std::strcmp(suite, test.suite) != 0) continue;
+        ltltest::setSuite(test.suite);
+        const int before = ltltest::g_failures;
+        try {
+            test.fn();
+        } catch (const ltltest::Abort&) {
+            // Провал уже записан REQUIRE
+        } catch (const std::exception& e) {
+            ltltest::fail(__FILE__, __LINE__, std::string("unexpected exception: ") + e.what());
+        } catch (...) {
+            ltltest::fail(__FILE__, __LINE__, "unexpected exception");
+        }
+        const bool ok = ltltest::g_failures == before;
+        std::printf("[%s] %s.%s\n", ok ? "  OK  " : " FAIL ", test.suite, test.name);
+        std::fflush(stdout);
+        ++run;
+        if (!ok) ++failedCases;
+    }
+    if (run == 0) {
+        std::fprintf(stderr, "No tests in suite '%s'\n", suite ? suite : "");
+        return 1;
+    }
+    std::printf("%d tests, %d failed\n", run, failedCases);
+    return failedCases == 0 ? 0 : 1;
+}
@@ -0,0 +1,62 @@
+#include "test_framework.hpp"
+#include "test_util.hpp"
+#include "codec.hpp"
+#include "mapped_file.hpp"
+#include <cstdio>
+#include <cstring>
+
+using namespace ltltest;
+
+TEST_CASE(mapped_file, maps_file_contents) {
+    std::vector<unsigned char> bytes(3 * 4096 + 17);
+    for (size_t i = 0; i < bytes.size(); ++i) bytes[i] = static_cast<unsigned char>(i * 31 + 7);
+    const std::string path = tempPath("data.bin");
+    REQUIRE(writeFile(path, bytes));
+    MappedFile file(path);
+    REQUIRE(file.isOpen());
+    CHECK(file.isMapped());
+    REQUIRE_EQ(file.size(), bytes.size());
+    CHECK(std::memcmp(file.data(), bytes.data(), bytes.size()) == 0);
+}
+
+TEST_CASE(mapped_file, missing_empty_and_directory) {
+    MappedFile missing(tempPath("missing.bin"));
+    CHECK(!missing.isOpen());
+    CHECK_EQ(missing.size(), size_t(0));
+
+    const std::string empty = tempPath("empty.bin");
+    REQUIRE(writeFile(empty, {}));
+    MappedFile emptyFile(empty);
+    CHECK(!emptyFile.isOpen());
+    CHECK(!emptyFile.isMapped());
+
+    MappedFile directory(tempPath(""));
+    CHECK(!directory.isOpen());
+}
+
+#ifndef _WIN32
+TEST_CASE(mapped_file, mapping_outlives_unlink) {
+    const std::vector<unsigned char> bytes(10000, 0x5A);
+    const std::string path = tempPath("unlinked.bin");
+    REQUIRE(writeFile(path, bytes));
+    MappedFile file(path);
+    REQUIRE(file.isMapped());
+    std::remove(path.c_str());
+    CHECK(file.data()[0] == 0x5A && file.data()[bytes.size() - 1] == 0x5A);
+}
+#endif
+
+TEST_CASE(mapped_file, load_image_matches_in_memory_decode) {
+    const Image img = makeImage(90, 70, 8);
+    for (const char* format : { "png", "jpg", "bmp", "qoi" }) {
+        const std::string path = tempPath(std::string("image.") + format);
+        REQUIRE(saveImage(img, path, format));
+        const Image fromFile = loadImage(path);
+        const auto bytes = readFile(path);
+        Image fromMemory{};
+        REQUIRE(decodeImage(bytes.data(), bytes.size(), fromMemory));
+        REQUIRE(fromFile.valid());
+        CHECK(samePixels(fromFile, fromMemory));
+    }
+    CHECK(!loadImage(tempPath("missing.png")).valid());
+}
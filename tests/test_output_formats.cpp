@@ -0,0 +1,166 @@
+#include "test_framework.hpp"
+#include "test_util.hpp"
+#include "codec.hpp"
+#include "LUToolsLite.h"
+
+using namespace ltltest;
+
+namespace {
+
+struct Fixture {
+    std::string input = tempPath("input.png");
+    int lutId = 0;
+    Image source = makeImage(64, 40, 6);
+
+    Fixture() {
+        REQUIRE(LUTools_Init() == SUCCESS);
+        REQUIRE(saveImage(source, input, "png"));
+        const std::string cube = tempPath("identity.cube");
+        writeCube(cube, 17);
+        REQUIRE_EQ(LUTools_LoadLUT(cube.c_str(), 1.0f, &lutId), SUCCESS);
+    }
+
+    int process(const std::string& output, const LUTools_OutputOptions* options) {
+        return LUTools_ProcessFileEx(input.c_str(), output.c_str(), &lutId, 1, 0, 0, 0, 0, 0, options, nullptr, nullptr);
+    }
+};
+
+// Прореживание яркости из SOF0/SOF1/SOF2 как 444/422/420; 0 — кадр не найден или другое
+int lumaSampling(const std::vector<unsigned char>& jpeg) {
+    size_t p = 2;
+    while (p + 4 <= jpeg.size() && jpeg[p] == 0xFF) {
+        const int marker = jpeg[p + 1];
+        const size_t length = size_t(jpeg[p + 2]) << 8 | jpeg[p + 3];
+        if (marker >= 0xC0 && marker <= 0xC2) {
+            if (p + 12 > jpeg.size()) return 0;
+            switch (jpeg[p + 11]) {   // первая компонента: H << 4 | V
+                case 0x11: return 444;
+                case 0x21: return 422;
+                case 0x22: return 420;
+                default: return 0;
+            }
+        }
+        p += 2 + length;
+    }
+    return 0;
+}
+
+} // namespace
+
+TEST_CASE(output_formats, defaults_are_jpeg_95) {
+    LUTools_OutputOptions o{};
+    LUTools_GetDefaultOutputOptions(&o);
+    CHECK_EQ(o.format, LTL_FORMAT_JPEG);
+    CHECK_EQ(o.jpegQuality, 95);
+}
+
+TEST_CASE(output_formats, every_format_round_trips) {
+    Fixture f;
+    const struct { int format; const char* name; const char* signature; } formats[] = {
+        { LTL_FORMAT_JPEG, "out.jpg", "jpg" },
+        { LTL_FORMAT_PNG,  "out.png", "png" },
+        { LTL_FORMAT_BMP,  "out.bmp", "bmp" },
+        { LTL_FORMAT_TGA,  "out.tga", "" },
+        { LTL_FORMAT_QOI,  "out.qoi", "qoi" },
+    };
+    for (const auto& fmt : formats) {
+        LUTools_OutputOptions o{};
+        LUTools_GetDefaultOutputOptions(&o);
+        o.format = fmt.format;
+        const std::string out = tempPath(fmt.name);
+        REQUIRE_EQ(f.process(out, &o), SUCCESS);
+        const auto bytes = readFile(out);
+        CHECK_EQ(detectFormat(bytes.data(), bytes.size()), std::string(fmt.signature));
+        Image decoded = loadImage(out);
+        REQUIRE(decoded.valid());
+        if (fmt.format == LTL_FORMAT_JPEG) {
+            CHECK(psnr(f.source, decoded) > 35.0);
+        } else {
+            // Тождественная LUT без потерь: расхождение — только округление интерполяции
+            CHECK(maxDifference(f.source, decoded) <= 1);
+        }
+    }
+}
+
+TEST_CASE(output_formats, jpeg_quality_and_png_level_apply) {
+    Fixture f;
+    LUTools_OutputOptions o{};
+    LUTools_GetDefaultOutputOptions(&o);
+    const std::string high = tempPath("q95.jpg"), low = tempPath("q30.jpg");
+    REQUIRE_EQ(f.process(high, &o), SUCCESS);
+    o.jpegQuality = 30;
+    o.jpegSubsampling = 420;
+    REQUIRE_EQ(f.process(low, &o), SUCCESS);
+    CHECK(readFile(low).size() < readFile(high).size());
+
+    o.format = LTL_FORMAT_PNG;
+    o.pngCompression = 0;
+    const std::string stored = tempPath("l0.png"), packed = tempPath("l9.png");
+    REQUIRE_EQ(f.process(stored, &o), SUCCESS);
+    o.pngCompression = 9;
+    REQUIRE_EQ(f.process(packed, &o), SUCCESS);
+    CHECK(readFile(packed).size() < readFile(stored).size());
+    CHECK(samePixels(loadImage(stored), loadImage(packed)));
+}
+
+TEST_CASE(output_formats, jpeg_subsampling_reaches_the_file) {
+    Fixture f;
+    f.source = makeImage(200, 200, 6);
+    REQUIRE(saveImage(f.source, f.input, "png"));
+    LUTools_OutputOptions o{};
+    LUTools_GetDefaultOutputOptions(&o);
+    const std::string out = tempPath("sampling.jpg");
+    // По умолчанию quality 95 — 4:4:4, как писал stb в ProcessFile
+    REQUIRE_EQ(f.process(out, &o), SUCCESS);
+    CHECK_EQ(lumaSampling(readFile(out)), 444);
+    o.jpegQuality = 50;
+    REQUIRE_EQ(f.process(out, &o), SUCCESS);
+    CHECK_EQ(lumaSampling(readFile(out)), 420);
+    for (int restartRows : { -1, 0, 2 })
+        for (int subsampling : { 444, 422, 420 }) {
+            o.jpegSubsampling = subsampling;
+            o.jpegRestartRows = restartRows;
+            REQUIRE_EQ(f.process(out, &o), SUCCESS);
+            CHECK_EQ(lumaSampling(readFile(out)), subsampling);
+        }
+
+    // Каждый кодек — целиком и построчно — пишет запрошенное или отказывается
+    for (const auto& codec : CodecRegistry::instance().findAll("jpg", CODEC_CAP_ENCODE)) {
+        for (int quality : { 50, 90, 95 })
+            for (int subsampling : { 0, 444, 422, 420 }) {
+                EncodeOptions options;
+                options.quality = quality;
+                options.subsampling = subsampling;
+                VectorSink whole;
+                if (codec->encode(f.source, "jpg", options, whole)) {
+                    CHECK_EQ(lumaSampling(whole.bytes), jpegSubsampling(options));
+                } else {
+                    CHECK_EQ(std::string(codec->name()), std::string("stb"));
+                }
+                VectorSink rows;
+                auto writer = codec->openWriter(f.source.width, f.source.height, "jpg", options, rows);
+                if (!writer) continue;
+                REQUIRE(writer->write(f.source.data.data(), f.source.height));
+                REQUIRE(writer->finish());
+                CHECK_EQ(lumaSampling(rows.bytes), jpegSubsampling(options));
+            }
+    }
+    // stb не умеет 4:2:2 и выбирает прореживание сам
+    EncodeOptions options;
+    options.subsampling = 422;
+    VectorSink sink;
+    CHECK(!CodecRegistry::instance().byName("stb")->encode(f.source, "jpg", options, sink));
+}
+
+TEST_CASE(output_formats, invalid_options_are_rejected) {
+    Fixture f;
+    LUTools_OutputOptions o{};
+    LUTools_GetDefaultOutputOptions(&o);
+    o.format = 42;
+    CHECK_EQ(f.process(tempPath("bad.out"), &o), UNSUPPORTED_FORMAT);
+    LUTools_GetDefaultOutputOptions(&o);
+    o.jpegSubsampling = 411;
+    CHECK_EQ(f.process(tempPath("bad.jpg"), &o), UNSUPPORTED_FORMAT);
+    // NULL — настройки по умолчанию
+    CHECK_EQ(f.process(tempPath("default.jpg"), nullptr), SUCCESS);
+}
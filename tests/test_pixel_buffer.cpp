@@ -0,0 +1,118 @@
+#include "test_framework.hpp"
+#include "test_util.hpp"
+#include "buffer_pool.hpp"
+#include "pixel_buffer.hpp"
+#include "LUToolsLite.h"
+#include <cstdlib>
+#include <cstring>
+
+using namespace ltltest;
+
+namespace {
+
+unsigned char* mallocFilled(size_t size, unsigned char value) {
+    auto* p = static_cast<unsigned char*>(std::malloc(size));
+    std::memset(p, value, size);
+    return p;
+}
+
+} // namespace
+
+TEST_CASE(pixel_buffer, adopt_frees_once_after_last_owner) {
+    int frees = 0;
+    unsigned char* raw = mallocFilled(64, 7);
+    {
+        PixelBuffer a = PixelBuffer::adopt(raw, 64, [&frees](unsigned char* p) { ++frees; std::free(p); });
+        CHECK(a.data() == raw);
+        PixelBuffer b = std::move(a);
+        CHECK(a.empty());
+        CHECK(b.data() == raw);
+        PixelBuffer c;
+        c = std::move(b);
+        CHECK_EQ(frees, 0);
+        CHECK_EQ(int(c[63]), 7);
+    }
+    CHECK_EQ(frees, 1);
+}
+
+TEST_CASE(pixel_buffer, copy_is_deep) {
+    int frees = 0;
+    PixelBuffer a = PixelBuffer::adopt(mallocFilled(16, 1), 16, [&frees](unsigned char* p) { ++frees; std::free(p); });
+    PixelBuffer b = a;
+    CHECK(b.data() != a.data());
+    b[0] = 99;
+    CHECK_EQ(int(a[0]), 1);
+    a.clear();
+    CHECK_EQ(frees, 1);
+    CHECK_EQ(int(b[1]), 1);
+}
+
+TEST_CASE(pixel_buffer, view_keeps_owner_alive) {
+    bool ownerFreed = false;
+    unsigned char storage[32] = {};
+    {
+        std::shared_ptr<void> owner(storage, [&ownerFreed](void*) { ownerFreed = true; });
+        PixelBuffer v = PixelBuffer::view(storage, sizeof(storage), owner);
+        owner.reset();
+        CHECK(!ownerFreed);
+        CHECK(v.data() == storage);
+    }
+    CHECK(ownerFreed);
+    // Без владельца — просто чужая память
+    PixelBuffer v = PixelBuffer::view(storage, sizeof(storage));
+    v.clear();
+    CHECK_EQ(int(storage[0]), 0);
+}
+
+TEST_CASE(pixel_buffer, release_hands_over_sole_pool_buffer) {
+    PixelBuffer a;
+    a.allocate(1000);
+    unsigned char* p = a.data();
+    unsigned char* out = a.release();
+    // Единственный владелец памяти пула: без копии
+    CHECK(out == p);
+    CHECK(a.empty());
+    LUTools_FreeMemory(out);
+
+    // Чужая память копируется в буфер пула, а своя освобождается
+    int frees = 0;
+    PixelBuffer b = PixelBuffer::adopt(mallocFilled(100, 3), 100, [&frees](unsigned char* q) { ++frees; std::free(q); });
+    unsigned char* adopted = b.data();
+    out = b.release();
+    CHECK(out != adopted);
+    CHECK_EQ(frees, 1);
+    CHECK_EQ(int(out[99]), 3);
+    LUTools_FreeMemory(out);
+}
+
+TEST_CASE(pixel_buffer, resize_keeps_prefix_and_zero_fills) {
+    PixelBuffer a;
+    const unsigned char bytes[4] = { 1, 2, 3, 4 };
+    a.assign(bytes, bytes + 4);
+    a.resize(8);
+    REQUIRE_EQ(a.size(), size_t(8));
+    CHECK(a[0] == 1 && a[3] == 4);
+    CHECK(a[4] == 0 && a[7] == 0);
+    a.resize(2);
+    CHECK(a.size() == 2 && a[1] == 2);
+    a.resize(0);
+    CHECK(a.empty());
+}
+
+TEST_CASE(pixel_buffer, processed_image_is_returned_without_copy) {
+    REQUIRE_EQ(LUTools_Init(), SUCCESS);
+    const std::string cube = tempPath("identity.cube");
+    writeCube(cube, 9);
+    int lut = 0;
+    REQUIRE_EQ(LUTools_LoadLUT(cube.c_str(), 1.0f, &lut), SUCCESS);
+    Image img = makeImage(64, 64);
+    const BufferPoolStats before = BufferPool::instance().stats();
+    unsigned char* out = nullptr;
+    int w = 0, h = 0, c = 0;
+    REQUIRE_EQ(LUTools_ProcessImage(img.data.data(), 64, 64, 3, &lut, 1, 0, 0, 0, 0, 0, &out, &w, &h, &c), SUCCESS);
+    const BufferPoolStats after = BufferPool::instance().stats();
+    // Один выходной буфер: release() не понадобилось копировать его во второй
+    CHECK_EQ(after.acquires - before.acquires, uint64_t(1));
+    CHECK(after.bytesInUse - before.bytesInUse >= uint64_t(64 * 64 * 3));
+    LUTools_FreeMemory(out);
+}
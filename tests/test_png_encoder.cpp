@@ -0,0 +1,151 @@
+#include "test_framework.hpp"
+#include "test_util.hpp"
+#include "codec.hpp"
+#include "deflate.hpp"
+#include "png_codec.hpp"
+#include <cstdlib>
+#include <cstring>
+
+using namespace ltltest;
+
+namespace {
+
+std::vector<unsigned char> randomBytes(size_t size, uint32_t seed, int alphabet) {
+    std::vector<unsigned char> data(size);
+    uint32_t state = seed;
+    for (auto& b : data) {
+        state = state * 1664525u + 1013904223u;
+        b = static_cast<unsigned char>((state >> 16) % uint32_t(alphabet));
+    }
+    return data;
+}
+
+uint32_t get32(const unsigned char* p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+}
+
+// Проверка контейнера независимо от декодера: CRC всех чанков и Adler-32 потока zlib
+void checkPngIntegrity(const std::vector<unsigned char>& png) {
+    REQUIRE(png.size() > 8);
+    std::vector<unsigned char> zlib;
+    size_t pos = 8;
+    bool sawEnd = false;
+    while (pos + 12 <= png.size()) {
+        const uint32_t length = get32(&png[pos]);
+        REQUIRE(pos + 12 + length <= png.size());
+        const unsigned char* type = &png[pos + 4];
+        CHECK_EQ(crc32Update(0, type, length + 4), get32(type + 4 + length));
+        if (std::memcmp(type, "IDAT", 4) == 0) zlib.insert(zlib.end(), type + 4, type + 4 + length);
+        if (std::memcmp(type, "IEND", 4) == 0) sawEnd = true;
+        pos += 12 + length;
+    }
+    CHECK(sawEnd);
+    REQUIRE(zlib.size() > 6);
+    int rawSize = 0;
+    char* raw = stbi_zlib_decode_malloc(reinterpret_cast<const char*>(zlib.data()), int(zlib.size()), &rawSize);
+    REQUIRE(raw != nullptr);
+    const uint32_t adler = adler32Update(1, reinterpret_cast<const unsigned char*>(raw), size_t(rawSize));
+    std::free(raw);
+    CHECK_EQ(adler, get32(&zlib[zlib.size() - 4]));
+}
+
+Image decodeChannels(const std::vector<unsigned char>& png, int& channels) {
+    Image img{};
+    int w = 0, h = 0;
+    unsigned char* pixels = stbi_load_from_memory(png.data(), int(png.size()), &w, &h, &channels, 0);
+    if (!pixels) return img;
+    img.width = w;
+    img.height = h;
+    img.channels = channels;
+    img.data = PixelBuffer::adopt(pixels, size_t(w) * h * channels, [](unsigned char* p) { stbi_image_free(p); });
+    return img;
+}
+
+} // namespace
+
+TEST_CASE(png_encoder, checksums_known_values) {
+    const char* text = "Wikipedia";
+    CHECK_EQ(adler32Update(1, reinterpret_cast<const unsigned char*>(text), 9), 0x11E60398u);
+    const char* digits = "123456789";
+    CHECK_EQ(crc32Update(0, reinterpret_cast<const unsigned char*>(digits), 9), 0xCBF43926u);
+}
+
+TEST_CASE(png_encoder, adler32_combine_matches_concatenation) {
+    const auto data = randomBytes(300000, 11, 256);
+    for (size_t split : { size_t(0), size_t(1), size_t(5552), size_t(65521), size_t(65522), size_t(150000), data.size() }) {
+        const uint32_t a = adler32Update(1, data.data(), split);
+        const uint32_t b = adler32Update(1, data.data() + split, data.size() - split);
+        CHECK_EQ(adler32Combine(a, b, data.size() - split), adler32Update(1, data.data(), data.size()));
+    }
+    // Все байты 0xFF — суммы у верхней границы модуля
+    std::vector<unsigned char> ones(200000, 0xFF);
+    const uint32_t a = adler32Update(1, ones.data(), 70000);
+    const uint32_t b = adler32Update(1, ones.data() + 70000, 130000);
+    CHECK_EQ(adler32Combine(a, b, 130000), adler32Update(1, ones.data(), ones.size()));
+}
+
+TEST_CASE(png_encoder, deflate_chunks_concatenate) {
+    // Мало символов — много совпадений, в том числе через границу кусков (словарь)
+    const auto data = randomBytes(200000, 5, 4);
+    const size_t chunk = 48 * 1024, dict = 32 * 1024;
+    for (int level : { 0, 1, 6, 9 }) {
+        std::vector<unsigned char> stream;
+        for (size_t begin = 0; begin < data.size(); begin += chunk) {
+            const size_t dictSize = std::min(begin, dict);
+            const size_t size = std::min(chunk, data.size() - begin);
+            deflateChunk(data.data() + begin - dictSize, dictSize, size, level, begin + size == data.size(), stream);
+        }
+        if (level > 0) CHECK(stream.size() < data.size() / 2);
+        int outSize = 0;
+        char* out = stbi_zlib_decode_noheader_malloc(reinterpret_cast<const char*>(stream.data()), int(stream.size()), &outSize);
+        REQUIRE(out != nullptr);
+        CHECK_EQ(size_t(outSize), data.size());
+        CHECK(outSize == int(data.size()) && std::memcmp(out, data.data(), data.size()) == 0);
+        std::free(out);
+    }
+}
+
+TEST_CASE(png_encoder, round_trip_is_exact) {
+    // 600×500×3 — несколько полос по 256 КБ, склеенных через словарь
+    for (int channels = 1; channels <= 4; ++channels) {
+        const Image img = makeImage(600, 500, channels, 9, uint32_t(channels));
+        EncodeOptions options;
+        VectorSink sink;
+        REQUIRE(encodePng(img, options, sink));
+        checkPngIntegrity(sink.bytes);
+        int decodedChannels = 0;
+        const Image out = decodeChannels(sink.bytes, decodedChannels);
+        REQUIRE(out.width == 600 && out.height == 500);
+        CHECK_EQ(decodedChannels, channels);
+        CHECK(samePixels(img, out));
+    }
+}
+
+TEST_CASE(png_encoder, every_compression_level_is_lossless) {
+    const Image img = makeImage(301, 257, 3, 20, 3);
+    size_t stored = 0;
+    for (int level = 0; level <= 9; ++level) {
+        EncodeOptions options;
+        options.compressionLevel = level;
+        VectorSink sink;
+        REQUIRE(encodePng(img, options, sink));
+        checkPngIntegrity(sink.bytes);
+        CHECK(samePixels(img, decodeWithStb(sink.bytes)));
+        // Тот же поток через декодер библиотеки (libpng, если собран, проверяет CRC и Adler-32 сам)
+        Image viaRegistry{};
+        REQUIRE(decodeImage(sink.bytes.data(), sink.bytes.size(), viaRegistry));
+        CHECK(samePixels(img, viaRegistry));
+        if (level == 0) stored = sink.bytes.size();
+        else CHECK(sink.bytes.size() < stored);
+    }
+}
+
+TEST_CASE(png_encoder, tiny_images) {
+    for (auto [w, h] : { std::pair<int, int>{1, 1}, {1, 300}, {300, 1}, {2, 2} }) {
+        const Image img = makeImage(w, h, 5);
+        VectorSink sink;
+        REQUIRE(encodePng(img, EncodeOptions(), sink));
+        checkPngIntegrity(sink.bytes);
+        CHECK(samePixels(img, decodeWithStb(sink.bytes)));
+    }
+}
@@ -0,0 +1,254 @@
+#include "test_framework.hpp"
+#include "test_util.hpp"
+#include "progress.hpp"
+#include "LUToolsLite.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+using namespace ltltest;
+
+namespace {
+
+struct Report {
+    float fraction;
+    uint64_t done, total;
+    double eta;
+    std::string stage;
+    std::thread::id thread;
+};
+
+struct Recorder {
+    std::mutex mutex;
+    std::vector<Report> reports;
+
+    ProgressReportFn fn() {
+        return [this](const ProgressSnapshot& s) {
+            std::lock_guard<std::mutex> lock(mutex);
+            reports.push_back({ s.fraction, s.done, s.total, s.eta, s.stage, std::this_thread::get_id() });
+        };
+    }
+    size_t count() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return reports.size();
+    }
+
+    static void callbackEx(const LUTools_Progress* p, void* userData) {
+        auto* self = static_cast<Recorder*>(userData);
+        std::lock_guard<std::mutex> lock(self->mutex);
+        self->reports.push_back({ p->progress, p->done, p->total, p->etaSeconds, p->stage, std::this_thread::get_id() });
+    }
+    static void callback(float progress, void* userData) {
+        auto* self = static_cast<Recorder*>(userData);
+        std::lock_guard<std::mutex> lock(self->mutex);
+        self->reports.push_back({ progress, 0, 0, -1, "", std::this_thread::get_id() });
+    }
+};
+
+bool monotonic(const std::vector<Report>& reports) {
+    for (size_t i = 1; i < reports.size(); ++i)
+        if (reports[i].fraction < reports[i - 1].fraction) return false;
+    return true;
+}
+
+} // namespace
+
+TEST_CASE(progress, tracker_reports_from_background_and_finishes_in_caller) {
+    Recorder rec;
+    {
+        ProgressTracker tracker(rec.fn(), 1000, "Working", 0);
+        std::vector<std::thread> workers;
+        for (int t = 0; t < 4; ++t) {
+            workers.emplace_back([&tracker] {
+                for (int i = 0; i < 250; ++i) {
+                    tracker.add();
+                    if (i % 25 == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            });
+        }
+        for (auto& w : workers) w.join();
+        tracker.finish();
+        const size_t atFinish = rec.count();
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        CHECK_EQ(rec.count(), atFinish);   // после finish колбэков нет
+    }
+    REQUIRE(!rec.reports.empty());
+    const Report& last = rec.reports.back();
+    CHECK_EQ(last.fraction, 1.0f);
+    CHECK_EQ(last.done, uint64_t(1000));
+    CHECK_EQ(last.eta, 0.0);
+    CHECK(last.thread == std::this_thread::get_id());
+    CHECK(monotonic(rec.reports));
+    for (size_t i = 0; i + 1 < rec.reports.size(); ++i) {
+        CHECK(rec.reports[i].thread != std::this_thread::get_id());
+        CHECK(rec.reports[i].done <= rec.reports[i].total);
+        CHECK_EQ(rec.reports[i].stage, std::string("Working"));
+    }
+}
+
+TEST_CASE(progress, rate_limit_and_stage_changes) {
+    Recorder rec;
+    ProgressTracker tracker(rec.fn(), 200, "First", 20);
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 200; ++i) {
+        if (i == 100) tracker.setStage("Second");
+        tracker.add();
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    tracker.finish();
+    // 20 в секунду плюс финальный; небольшой запас на границы интервалов
+    CHECK(rec.reports.size() <= size_t(seconds * 20) + 3);
+    CHECK(rec.reports.size() >= 2);
+    std::set<std::string> stages;
+    for (const auto& r : rec.reports) stages.insert(r.stage);
+    CHECK(stages.count("Second") == 1);
+}
+
+TEST_CASE(progress, total_can_grow_and_overshoot_is_clamped) {
+    Recorder rec;
+    ProgressTracker tracker(rec.fn(), 0, "Decoding", 0);
+    tracker.addTotal(10);
+    tracker.add(25);   // больше total — доля не превышает 1
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    tracker.finish();
+    for (const auto& r : rec.reports) {
+        CHECK(r.fraction <= 1.0f);
+        CHECK(r.done <= r.total);
+    }
+}
+
+TEST_CASE(progress, destroyed_tracker_stops_reporting) {
+    Recorder rec;
+    auto tracker = std::make_unique<ProgressTracker>(rec.fn(), 100, "Abandoned", 0);
+    tracker->add(10);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    tracker.reset();   // без finish — например, ошибка
+    const size_t n = rec.count();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CHECK_EQ(rec.count(), n);
+    for (const auto& r : rec.reports) CHECK(r.fraction < 1.0f);
+}
+
+TEST_CASE(progress, api_reports_end_before_return) {
+    REQUIRE_EQ(LUTools_Init(), SUCCESS);
+    const std::string cube = tempPath("p.cube");
+    writeCube(cube, 17);
+    int lut = 0;
+    REQUIRE_EQ(LUTools_LoadLUT(cube.c_str(), 1.0f, &lut), SUCCESS);
+    const std::string input = tempPath("p_in.png"), output = tempPath("p_out.jpg");
+    REQUIRE(saveImage(makeImage(1500, 1000, 5), input, "png"));
+
+    Recorder ex, simple;
+    LUTools_SetProgressRate(0);
+    LUTools_SetProgressCallbackEx(Recorder::callbackEx, &ex);
+    LUTools_SetProgressCallback(Recorder::callback, &simple);
+    const int luts[] = { lut, lut, lut };
+    REQUIRE_EQ(LUTools_ProcessFileEx(input.c_str(), output.c_str(), luts, 3, 0, 0, 0, 0, 0, nullptr, nullptr, nullptr), SUCCESS);
+    const size_t exCount = ex.count(), simpleCount = simple.count();
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    CHECK_EQ(ex.count(), exCount);
+    CHECK_EQ(simple.count(), simpleCount);
+
+    REQUIRE(!ex.reports.empty());
+    CHECK_EQ(ex.reports.back().fraction, 1.0f);
+    CHECK_EQ(simple.reports.back().fraction, 1.0f);
+    CHECK(monotonic(ex.reports));
+    CHECK(monotonic(simple.reports));
+    const std::set<std::string> known = { "Decoding", "Applying LUTs", "Encoding" };
+    for (const auto& r : ex.reports) CHECK(known.count(r.stage) == 1);
+    // Единицы — строки изображения на каждый LUT
+    CHECK_EQ(ex.reports.back().total, uint64_t(1000 * 3));
+
+    // Пакет: единицы — файлы
+    Recorder batch;
+    LUTools_SetProgressCallback(nullptr, nullptr);
+    LUTools_SetProgressCallbackEx(Recorder::callbackEx, &batch);
+    const std::string o1 = tempPath("b1.qoi"), o2 = tempPath("b2.qoi"), o3 = tempPath("b3.qoi");
+    const char* inputs[] = { input.c_str(), input.c_str(), input.c_str() };
+    const char* outputs[] = { o1.c_str(), o2.c_str(), o3.c_str() };
+    LUTools_OutputOptions o{};
+    LUTools_GetDefaultOutputOptions(&o);
+    o.format = LTL_FORMAT_QOI;
+    REQUIRE_EQ(LUTools_ProcessFilesEx(inputs, outputs, 3, &lut, 1, 0, 0, 0, 0, 0, &o, nullptr, nullptr), SUCCESS);
+    REQUIRE(!batch.reports.empty());
+    CHECK_EQ(batch.reports.back().fraction, 1.0f);
+    CHECK_EQ(batch.reports.back().total, uint64_t(3));
+    CHECK(monotonic(batch.reports));
+
+    LUTools_SetProgressCallbackEx(nullptr, nullptr);
+    LUTools_SetProgressRate(10);
+}
+
+TEST_CASE(progress, finish_in_background_delivers_last_report) {
+    Recorder rec;
+    std::thread::id worker;
+    {
+        ProgressTracker tracker(rec.fn(), 10, "Reading", 1);   // по расписанию — не раньше чем через секунду
+        std::thread([&] {
+            worker = std::this_thread::get_id();
+            tracker.add(10);
+            tracker.finishInBackground();
+        }).join();
+    }   // деструктор не отменяет отложенный отчёт
+    for (int i = 0; i < 200 && rec.count() == 0; ++i) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    REQUIRE_EQ(rec.count(), size_t(1));
+    const Report& last = rec.reports.back();
+    CHECK_EQ(last.fraction, 1.0f);
+    CHECK_EQ(last.done, uint64_t(10));
+    CHECK_EQ(last.eta, 0.0);
+    CHECK(last.thread != worker);
+    CHECK(last.thread != std::this_thread::get_id());
+}
+
+TEST_CASE(progress, register_luts_reports_end_from_background) {
+    REQUIRE_EQ(LUTools_Init(), SUCCESS);
+    std::vector<std::string> names;
+    for (int i = 0; i < 8; ++i) {
+        names.push_back(tempPath("pr" + std::to_string(i) + ".cube"));
+        writeCube(names.back(), 5);
+    }
+    std::vector<const char*> paths;
+    for (const auto& n : names) paths.push_back(n.c_str());
+    std::vector<int> ids(names.size());
+
+    Recorder rec;
+    LUTools_SetProgressRate(1);
+    LUTools_SetProgressCallbackEx(Recorder::callbackEx, &rec);
+    REQUIRE_EQ(LUTools_RegisterLUTs(paths.data(), int(paths.size()), 1.0f, ids.data()), SUCCESS);
+    // Заголовки читаются после возврата: последний отчёт — из фонового потока
+    for (int i = 0; i < 400; ++i) {
+        {
+            std::lock_guard<std::mutex> lock(rec.mutex);
+            if (!rec.reports.empty() && rec.reports.back().fraction == 1.0f) break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    LUTools_SetProgressCallbackEx(nullptr, nullptr);
+    LUTools_SetProgressRate(10);
+    std::lock_guard<std::mutex> lock(rec.mutex);
+    REQUIRE(!rec.reports.empty());
+    const Report& last = rec.reports.back();
+    CHECK_EQ(last.fraction, 1.0f);
+    CHECK_EQ(last.total, uint64_t(names.size()));
+    CHECK_EQ(last.stage, std::string("Reading LUT headers"));
+    CHECK(last.thread != std::this_thread::get_id());
+    for (int id : ids) LUTools_UnloadLUT(id);
+}
+
+TEST_CASE(progress, reporter_restarts_after_shutdown) {
+    progressShutdown();
+    progressShutdown();   // повторно — безвредно
+    Recorder rec;
+    ProgressTracker tracker(rec.fn(), 10, "Restarted", 0);
+    tracker.add(5);
+    for (int i = 0; i < 200 && rec.count() == 0; ++i) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    tracker.finish();
+    REQUIRE(rec.count() >= 2);
+    CHECK(rec.reports.front().thread != std::this_thread::get_id());
+    CHECK_EQ(rec.reports.back().fraction, 1.0f);
+}
@@ -0,0 +1,128 @@
+#include "test_framework.hpp"
+#include "test_util.hpp"
+#include "codec.hpp"
+#include "LUToolsLite.h"
+
+using namespace ltltest;
+
+namespace {
+
+std::vector<unsigned char> encode(const Image& img) {
+    VectorSink sink;
+    REQUIRE(encodeQoi(img, sink));
+    return sink.bytes;
+}
+
+} // namespace
+
+TEST_CASE(qoi, known_encoding) {
+    // Два чёрных пикселя (совпадают с начальным — один OP_RUN) и один OP_RGB
+    Image img = makeImage(3, 1);
+    const unsigned char pixels[9] = { 0, 0, 0, 0, 0, 0, 10, 20, 30 };
+    img.data.assign(pixels, pixels + 9);
+    const std::vector<unsigned char> expected = {
+        'q', 'o', 'i', 'f', 0, 0, 0, 3, 0, 0, 0, 1, 3, 0,
+        0xC1,
+        0xFE, 10, 20, 30,
+        0, 0, 0, 0, 0, 0, 0, 1,
+    };
+    const auto bytes = encode(img);
+    CHECK(bytes == expected);
+    Image out{};
+    REQUIRE(decodeQoi(expected.data(), expected.size(), out));
+    CHECK(samePixels(img, out));
+}
+
+TEST_CASE(qoi, rgb_round_trip_is_exact) {
+    // Шум — OP_RGB/LUMA/DIFF, градиент — DIFF, ровные полосы — RUN и INDEX
+    Image noisy = makeImage(257, 129, 40, 3);
+    Image smooth = makeImage(300, 200);
+    Image flat = makeImage(100, 100);
+    for (size_t i = 0; i < flat.data.size(); ++i) flat.data[i] = static_cast<unsigned char>((i / 3 / 700) * 60);
+    for (const Image* img : { &noisy, &smooth, &flat }) {
+        const auto bytes = encode(*img);
+        Image out{};
+        REQUIRE(decodeQoi(bytes.data(), bytes.size(), out));
+        CHECK(samePixels(*img, out));
+    }
+    CHECK(encode(flat).size() < flat.data.size() / 20);
+}
+
+TEST_CASE(qoi, rgba_round_trip_and_alpha_drop) {
+    const Image rgba = makeImage(97, 55, 4, 30, 8);
+    const auto bytes = encode(rgba);
+    CHECK_EQ(int(bytes[12]), 4);
+    Image out{};
+    REQUIRE(decodeQoi(bytes.data(), bytes.size(), out, 4));
+    CHECK(samePixels(rgba, out));
+
+    // desiredChannels = 3 — альфа отбрасывается, RGB те же
+    Image rgb{};
+    REQUIRE(decodeQoi(bytes.data(), bytes.size(), rgb, 3));
+    REQUIRE_EQ(rgb.channels, 3);
+    bool same = true;
+    for (size_t i = 0; i < size_t(97) * 55; ++i)
+        for (int c = 0; c < 3; ++c) same = same && rgb.data[i * 3 + c] == rgba.data[i * 4 + c];
+    CHECK(same);
+}
+
+TEST_CASE(qoi, registry_and_signature) {
+    const Image img = makeImage(40, 30, 10);
+    VectorSink sink;
+    REQUIRE(encodeImage(img, "qoi", EncodeOptions(), sink));
+    CHECK_EQ(detectFormat(sink.bytes.data(), sink.bytes.size()), std::string("qoi"));
+    Image out{};
+    REQUIRE(decodeImage(sink.bytes.data(), sink.bytes.size(), out));
+    CHECK(samePixels(img, out));
+}
+
+TEST_CASE(qoi, malformed_input_is_rejected) {
+    const auto bytes = encode(makeImage(20, 20, 30));
+    Image out{};
+    CHECK(!decodeQoi(bytes.data(), 10, out));
+    // Обрезанные данные пикселей
+    std::vector<unsigned char> truncated(bytes.begin(), bytes.begin() + bytes.size() / 2);
+    truncated.insert(truncated.end(), { 0, 0, 0, 0, 0, 0, 0, 1 });
+    CHECK(!decodeQoi(truncated.data(), truncated.size(), out));
+    // Неверное число каналов и нулевой размер
+    auto bad = bytes;
+    bad[12] = 5;
+    CHECK(!decodeQoi(bad.data(), bad.size(), out));
+    bad = bytes;
+    bad[4] = bad[5] = bad[6] = bad[7] = 0;
+    CHECK(!decodeQoi(bad.data(), bad.size(), out));
+    // Размер больше допустимого не выделяется
+    bad = bytes;
+    bad[4] = bad[8] = 0x7F;
+    CHECK(!decodeQoi(bad.data(), bad.size(), out));
+}
+
+TEST_CASE(qoi, header_size_is_bounded_by_stream_length) {
+    // Заголовок + count байт QOI_OP_RUN по 62 пикселя + завершение
+    auto runs = [](uint32_t width, uint32_t height, size_t count) {
+        std::vector<unsigned char> bytes = { 'q', 'o', 'i', 'f' };
+        for (uint32_t v : { width, height })
+            for (int s = 24; s >= 0; s -= 8) bytes.push_back(static_cast<unsigned char>(v >> s));
+        bytes.push_back(3);
+        bytes.push_back(0);
+        bytes.insert(bytes.end(), count, 0xFD);
+        bytes.insert(bytes.end(), { 0, 0, 0, 0, 0, 0, 0, 1 });
+        return bytes;
+    };
+    Image out{};
+    auto exact = runs(62 * 4, 1, 4);
+    REQUIRE(decodeQoi(exact.data(), exact.size(), out));
+    CHECK_EQ(out.width, 62 * 4);
+    CHECK_EQ(out.data[0], 0);
+
+    auto over = runs(62 * 4 + 1, 1, 4);
+    CHECK(!decodeQoi(over.data(), over.size(), out));
+
+    // 16000x16000 из 30 байт: отказ без запроса буфера
+    LUTools_PoolStats before{}, after{};
+    LUTools_GetPoolStats(&before);
+    auto huge = runs(16000, 16000, 8);
+    CHECK(!decodeQoi(huge.data(), huge.size(), out));
+    LUTools_GetPoolStats(&after);
+    CHECK_EQ(after.acquires, before.acquires);
+}
@@ -0,0 +1,127 @@
+#include "test_framework.hpp"
+#include "test_util.hpp"
+#include "stats.hpp"
+#include "LUToolsLite.h"
+#include <filesystem>
+#include <thread>
+
+using namespace ltltest;
+
+namespace {
+
+LUTools_Stats stats() {
+    LUTools_Stats s{};
+    LUTools_GetStats(&s);
+    return s;
+}
+
+} // namespace
+
+TEST_CASE(stats, counters_sum_all_threads_including_finished) {
+    statReset();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([] {
+            for (int i = 0; i < 1000; ++i) statAdd(kStatResize, 10, 2, 3);
+        });
+    }
+    for (auto& t : threads) t.join();   // счётчики завершившихся потоков не теряются
+    statAdd(kStatResize, 1, 1, 1);
+    StatCounters counters[kStatCount];
+    statSnapshot(counters);
+    CHECK_EQ(counters[kStatResize].calls, uint64_t(4001));
+    CHECK_EQ(counters[kStatResize].nanos, uint64_t(40001));
+    CHECK_EQ(counters[kStatResize].pixels, uint64_t(8001));
+    CHECK_EQ(counters[kStatResize].bytes, uint64_t(12001));
+    CHECK_EQ(counters[kStatApply].calls, uint64_t(0));
+
+    {
+        StatTimer timer(kStatQueueWait);
+        timer.pixels(5);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    statSnapshot(counters);
+    CHECK_EQ(counters[kStatQueueWait].calls, uint64_t(1));
+    CHECK_EQ(counters[kStatQueueWait].pixels, uint64_t(5));
+    CHECK(counters[kStatQueueWait].nanos >= uint64_t(2000000));
+}
+
+TEST_CASE(stats, pipeline_stages_are_counted) {
+    REQUIRE_EQ(LUTools_Init(), SUCCESS);
+    LUTools_SetLUTCacheEnabled(0);
+    const std::string cube = tempPath("s.cube");
+    writeCube(cube, 17);
+    LUTools_ResetStats();
+    int lut = 0;
+    REQUIRE_EQ(LUTools_LoadLUT(cube.c_str(), 1.0f, &lut), SUCCESS);
+    LUTools_Stats s = stats();
+    CHECK_EQ(s.stages[LTL_STAT_LUT_LOAD].calls, 1ull);
+    CHECK_EQ(s.stages[LTL_STAT_LUT_LOAD].bytes, 17ull * 17 * 17 * sizeof(Color));
+
+    const int w = 320, h = 200;
+    const std::string input = tempPath("s_in.png"), output = tempPath("s_out.png");
+    REQUIRE(saveImage(makeImage(w, h, 5), input, "png"));
+    LUTools_ResetStats();
+    LUTools_OutputOptions o{};
+    LUTools_GetDefaultOutputOptions(&o);
+    o.format = LTL_FORMAT_PNG;
+    const int luts[] = { lut, lut };
+    REQUIRE_EQ(LUTools_ProcessFileEx(input.c_str(), output.c_str(), luts, 2, 0, 0, 0, 0, 0, &o, nullptr, nullptr), SUCCESS);
+    s = stats();
+    const auto& decode = s.stages[LTL_STAT_DECODE];
+    CHECK_EQ(decode.calls, 1ull);
+    CHECK_EQ(decode.pixels, 1ull * w * h);
+    CHECK_EQ(decode.bytes, static_cast<unsigned long long>(std::filesystem::file_size(input)));
+    const auto& apply = s.stages[LTL_STAT_APPLY];
+    CHECK_EQ(apply.calls, 2ull);
+    CHECK_EQ(apply.pixels, 2ull * w * h);
+    CHECK(apply.nanoseconds > 0);
+    const auto& encode = s.stages[LTL_STAT_ENCODE];
+    CHECK_EQ(encode.calls, 1ull);
+    CHECK_EQ(encode.pixels, 1ull * w * h);
+    CHECK_EQ(encode.bytes, static_cast<unsigned long long>(std::filesystem::file_size(output)));
+    CHECK_EQ(s.stages[LTL_STAT_LUT_LOOKUP].calls, 1ull);
+    CHECK_EQ(s.stages[LTL_STAT_LUT_LOAD].calls, 0ull);
+
+    // Превью: уменьшение тоже учитывается
+    std::vector<unsigned char> pixels(size_t(w) * h * 3, 100);
+    unsigned char* preview = nullptr;
+    int pw = 0, ph = 0, pc = 0;
+    REQUIRE_EQ(LUTools_GeneratePreview(pixels.data(), w, h, 3, luts, 1, 0, 0, 0, 0, 0, 64, 40, &preview, &pw, &ph, &pc), SUCCESS);
+    LUTools_FreeMemory(preview);
+    s = stats();
+    CHECK(s.stages[LTL_STAT_RESIZE].calls >= 1ull);
+    CHECK_EQ(s.stages[LTL_STAT_APPLY].calls, 3ull);
+    LUTools_SetLUTCacheEnabled(1);
+}
+
+TEST_CASE(stats, lut_build_counts_grid_nodes) {
+    REQUIRE_EQ(LUTools_Init(), SUCCESS);
+    const std::string before = tempPath("before.png"), after = tempPath("after.png");
+    Image img = makeImage(32, 24, 10);   // k-NN по всем пикселям: держим тест быстрым
+    REQUIRE(saveImage(img, before, "png"));
+    for (auto& v : img.data) v = static_cast<unsigned char>(255 - v);
+    REQUIRE(saveImage(img, after, "png"));
+    LUTools_ResetStats();
+    const int sizes[] = { 5, 9 };
+    REQUIRE_EQ(LUTools_CreateLUTFromImages(before.c_str(), after.c_str(), tempPath("built").c_str(), sizes, 2), SUCCESS);
+    const LUTools_Stats s = stats();
+    CHECK_EQ(s.stages[LTL_STAT_LUT_BUILD].calls, 2ull);
+    CHECK_EQ(s.stages[LTL_STAT_LUT_BUILD].pixels, 5ull * 5 * 5 + 9ull * 9 * 9);
+    CHECK_EQ(s.stages[LTL_STAT_DECODE].calls, 2ull);
+}
+
+TEST_CASE(stats, reset_clears_everything) {
+    statAdd(kStatDecode, 100, 10, 10);
+    latencyRecord(kLatProcessImage, 100, 1000);
+    LUTools_ResetStats();
+    const LUTools_Stats s = stats();
+    for (int i = 0; i < LTL_STAT_COUNT; ++i) {
+        CHECK_EQ(s.stages[i].calls, 0ull);
+        CHECK_EQ(s.stages[i].nanoseconds, 0ull);
+    }
+    LUTools_LatencyStats latency{};
+    LUTools_GetLatency(LTL_LATENCY_PROCESS_IMAGE, -1, &latency);
+    CHECK_EQ(latency.count, 0ull);
+    LUTools_GetStats(nullptr);   // безвредно
+}
@@ -0,0 +1,220 @@
+#include "test_framework.hpp"
+#include "test_util.hpp"
+#include "codec.hpp"
+#include "jpeg_codec.hpp"
+#include "png_codec.hpp"
+#include "thread_pool.hpp"
+#include "LUToolsLite.h"
+#include <cstdio>
+#include <filesystem>
+
+using namespace ltltest;
+
+namespace {
+
+// Как в png_encoder.cpp: полоса — 256 КБ несжатых строк (с байтом фильтра)
+int pngRowsPerStrip(int width) {
+    return std::max(1, int((256 * 1024) / (size_t(width) * 3 + 1)));
+}
+
+// Пишет изображение в writer кусками по chunk строк
+bool writeRows(RowWriter& writer, const Image& img, int chunk) {
+    const size_t stride = size_t(img.width) * 3;
+    for (int y = 0; y < img.height; y += chunk) {
+        const int n = std::min(chunk, img.height - y);
+        if (!writer.write(img.data.data() + size_t(y) * stride, n)) return false;
+    }
+    return writer.finish();
+}
+
+// Считает байты, ничего не храня
+class CountingSink : public ByteSink {
+public:
+    bool write(const void*, size_t size) override {
+        bytes += size;
+        return true;
+    }
+    size_t bytes = 0;
+};
+
+Image decode(const std::vector<unsigned char>& bytes) {
+    Image img{};
+    decodeImage(bytes.data(), bytes.size(), img);
+    return img;
+}
+
+struct Pipeline {
+    int lutId = 0;
+
+    Pipeline() {
+        REQUIRE_EQ(LUTools_Init(), SUCCESS);
+        const std::string cube = tempPath("warm.cube");
+        writeCube(cube, 17, "Warm", [](float r, float g, float b) { return Color{r * 0.9f + 0.1f, g, b * 0.8f}; });
+        REQUIRE_EQ(LUTools_LoadLUT(cube.c_str(), 0.8f, &lutId), SUCCESS);
+    }
+
+    int streaming(const std::string& in, const std::string& out, int format, int stripRows) {
+        LUTools_OutputOptions o{};
+        LUTools_GetDefaultOutputOptions(&o);
+        o.format = format;
+        return LUTools_ProcessFileStreaming(in.c_str(), out.c_str(), &lutId, 1, 0.1f, 0, 0.05f, 0.1f, 0.1f, &o, stripRows,
+                                            nullptr, nullptr);
+    }
+
+    int buffered(const std::string& in, const std::string& out, int format) {
+        LUTools_OutputOptions o{};
+        LUTools_GetDefaultOutputOptions(&o);
+        o.format = format;
+        return LUTools_ProcessFileEx(in.c_str(), out.c_str(), &lutId, 1, 0.1f, 0, 0.05f, 0.1f, 0.1f, &o, nullptr, nullptr);
+    }
+};
+
+} // namespace
+
+// Регрессия: высота не кратна rowsPerStrip(), последняя полоса неполная — буфер строк
+// не должен обрезаться дальше полученных строк
+TEST_CASE(streaming, png_writer_partial_last_strip) {
+    const int width = 64;
+    const int rps = pngRowsPerStrip(width);
+    for (int height : { 1, 7, rps - 1, rps, rps + 1, rps + 5, 2 * rps + 5, 5 * rps + 3 }) {
+        const Image img = makeImage(width, height, 12, uint32_t(height));
+        for (int chunk : { 1, 97, height }) {
+            VectorSink sink;
+            auto writer = openPngWriter(width, height, EncodeOptions(), sink);
+            REQUIRE(writer != nullptr);
+            REQUIRE(writeRows(*writer, img, chunk));
+            const Image out = decodeWithStb(sink.bytes);
+            REQUIRE(out.valid());
+            CHECK(samePixels(img, out));
+        }
+    }
+}
+
+TEST_CASE(streaming, png_writer_matches_buffered_encoder) {
+    const int width = 301;
+    const int height = 3 * pngRowsPerStrip(width) + 11;
+    const Image img = makeImage(width, height, 20, 5);
+    VectorSink buffered;
+    REQUIRE(encodePng(img, EncodeOptions(), buffered));
+    VectorSink streamed;
+    auto writer = openPngWriter(width, height, EncodeOptions(), streamed);
+    REQUIRE(writeRows(*writer, img, 50));
+    // Те же полосы с теми же словарями: поток байт совпадает
+    CHECK(streamed.bytes == buffered.bytes);
+    CHECK(samePixels(img, decodeWithStb(streamed.bytes)));
+}
+
+TEST_CASE(streaming, jpeg_writer_matches_buffered_encoder) {
+    for (int restartRows : { 0, 1, 2 }) {
+        for (auto [width, height] : { std::pair<int, int>{1, 1}, {37, 9}, {120, 33}, {250, 301} }) {
+            const Image img = makeImage(width, height, 6, uint32_t(width));
+            EncodeOptions options;
+            options.quality = 90;
+            options.subsampling = 420;
+            options.restartRows = restartRows;
+            VectorSink buffered;
+            REQUIRE(encodeJpeg(img, options, buffered));
+            VectorSink streamed;
+            auto writer = openJpegWriter(width, height, options, streamed);
+            REQUIRE(writer != nullptr);
+            REQUIRE(writeRows(*writer, img, 7));
+            const Image a = decodeWithStb(buffered.bytes);
+            const Image b = decodeWithStb(streamed.bytes);
+            REQUIRE(b.valid());
+            CHECK(samePixels(a, b));
+        }
+    }
+}
+
+TEST_CASE(streaming, qoi_writer_matches_buffered_encoder) {
+    // Потокового QOI нет: openRowWriter копит строки и кодирует целиком — результат тот же
+    for (int height : { 1, 13, 256, 301 }) {
+        const Image img = makeImage(77, height, 9, uint32_t(height));
+        VectorSink buffered;
+        REQUIRE(encodeQoi(img, buffered));
+        VectorSink streamed;
+        auto writer = openRowWriter(77, height, "qoi", EncodeOptions(), streamed);
+        REQUIRE(writer != nullptr);
+        REQUIRE(writeRows(*writer, img, 10));
+        CHECK(streamed.bytes == buffered.bytes);
+    }
+}
+
+TEST_CASE(streaming, writers_memory_is_bounded) {
+    // Полная копия изображения в памяти превысила бы лимит в несколько раз
+    const int batchStrips = int(ThreadPool::instance().size() + 1) * 2;
+    const size_t limit = 8u * 1024 * 1024 + size_t(batchStrips) * 512 * 1024;
+    const int width = 2000;
+    const int height = int(4 * limit / (size_t(width) * 3));
+    const Image strip = makeImage(width, 64, 10, 3);
+
+    EncodeOptions options;
+    options.compressionLevel = 1;
+    options.quality = 80;
+    for (const char* format : { "png", "jpg" }) {
+        CountingSink sink;
+        resetHeapPeak();
+        const size_t base = heapLiveBytes();
+        auto writer = std::string(format) == "png" ? openPngWriter(width, height, options, sink)
+                                                   : openJpegWriter(width, height, options, sink);
+        REQUIRE(writer != nullptr);
+        for (int y = 0; y < height; y += 64) REQUIRE(writer->write(strip.data.data(), std::min(64, height - y)));
+        REQUIRE(writer->finish());
+        writer.reset();
+        CHECK(sink.bytes > 0);
+        CHECK(heapPeakBytes() - base < limit);
+    }
+}
+
+TEST_CASE(streaming, file_pipeline_matches_buffered) {
+    Pipeline p;
+    const Image source = makeImage(211, 301, 8, 4);
+    const struct { const char* in; const char* format; } inputs[] = { { "in.png", "png" }, { "in.jpg", "jpg" }, { "in.qoi", "qoi" } };
+    const struct { int format; const char* ext; bool lossless; } outputs[] = {
+        { LTL_FORMAT_PNG, "png", true }, { LTL_FORMAT_QOI, "qoi", true }, { LTL_FORMAT_JPEG, "jpg", false },
+    };
+    for (const auto& in : inputs) {
+        const std::string input = tempPath(in.in);
+        REQUIRE(saveImage(source, input, in.format));
+        for (const auto& out : outputs) {
+            const std::string reference = tempPath(std::string("ref_") + in.format + "." + out.ext);
+            REQUIRE_EQ(p.buffered(input, reference, out.format), SUCCESS);
+            const Image expected = decode(readFile(reference));
+            REQUIRE(expected.valid());
+            // 300 строк и больше — одна полоса; 7 и 64 не делят высоту 301
+            for (int stripRows : { 1, 7, 64, 300, 0 }) {
+                const std::string output = tempPath(std::string("stream_") + in.format + "." + out.ext);
+                REQUIRE_EQ(p.streaming(input, output, out.format, stripRows), SUCCESS);
+                const Image actual = decode(readFile(output));
+                REQUIRE(actual.valid());
+                if (out.lossless) CHECK(samePixels(expected, actual));
+                else CHECK(psnr(expected, actual) > 45.0);
+            }
+        }
+    }
+}
+
+TEST_CASE(streaming, single_pixel_image) {
+    Pipeline p;
+    const Image source = makeImage(1, 1);
+    const std::string input = tempPath("one.png");
+    REQUIRE(saveImage(source, input, "png"));
+    const std::string streamed = tempPath("one_stream.png"), buffered = tempPath("one_buffered.png");
+    REQUIRE_EQ(p.streaming(input, streamed, LTL_FORMAT_PNG, 256), SUCCESS);
+    REQUIRE_EQ(p.buffered(input, buffered, LTL_FORMAT_PNG), SUCCESS);
+    CHECK(samePixels(decode(readFile(streamed)), decode(readFile(buffered))));
+}
+
+TEST_CASE(streaming, failure_leaves_no_output) {
+    Pipeline p;
+    const std::string output = tempPath("never.png");
+    CHECK_EQ(p.streaming(tempPath("missing.png"), output, LTL_FORMAT_PNG, 16), INVALID_IMAGE);
+    CHECK(!std::filesystem::exists(output));
+
+    const std::string garbage = tempPath("garbage.png");
+    std::vector<unsigned char> bytes = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    bytes.resize(400, 0x33);
+    REQUIRE(writeFile(garbage, bytes));
+    CHECK(p.streaming(garbage, output, LTL_FORMAT_PNG, 16) != SUCCESS);
+    CHECK(!std::filesystem::exists(output));
+}
@@ -0,0 +1,267 @@
+#include "test_framework.hpp"
+#include "test_util.hpp"
+#include "trace.hpp"
+#include "LUToolsLite.h"
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <thread>
+
+using namespace ltltest;
+
+namespace {
+
+// Минимальная проверка синтаксиса JSON: объекты, массивы, строки без экранирования, числа
+class JsonChecker {
+public:
+    explicit JsonChecker(const std::string& text) : s_(text) {}
+    bool valid() {
+        skip();
+        if (!value()) return false;
+        skip();
+        return p_ == s_.size();
+    }
+
+private:
+    void skip() { while (p_ < s_.size() && std::isspace(static_cast<unsigned char>(s_[p_]))) ++p_; }
+    bool eat(char c) {
+        skip();
+        if (p_ < s_.size() && s_[p_] == c) { ++p_; return true; }
+        return false;
+    }
+    bool string() {
+        if (!eat('"')) return false;
+        while (p_ < s_.size() && s_[p_] != '"') {
+            if (s_[p_] == '\\' || static_cast<unsigned char>(s_[p_]) < 0x20) return false;
+            ++p_;
+        }
+        return eat('"');
+    }
+    bool number() {
+        const char* begin = s_.c_str() + p_;
+        char* end = nullptr;
+        std::strtod(begin, &end);
+        if (end == begin) return false;
+        p_ += size_t(end - begin);
+        return true;
+    }
+    bool value() {
+        skip();
+        if (p_ >= s_.size()) return false;
+        const char c = s_[p_];
+        if (c == '"') return string();
+        if (c == '{') {
+            ++p_;
+            if (eat('}')) return true;
+            do {
+                skip();
+                if (!string() || !eat(':') || !value()) return false;
+            } while (eat(','));
+            return eat('}');
+        }
+        if (c == '[') {
+            ++p_;
+            if (eat(']')) return true;
+            do {
+                if (!value()) return false;
+            } while (eat(','));
+            return eat(']');
+        }
+        return number();
+    }
+
+    const std::string& s_;
+    size_t p_ = 0;
+};
+
+struct Event {
+    std::string name, cat, ph;
+    int tid = 0;
+    double ts = 0, dur = 0;
+};
+
+std::string field(const std::string& line, const std::string& key) {
+    const std::string tag = "\"" + key + "\":";
+    const size_t p = line.find(tag);
+    if (p == std::string::npos) return "";
+    size_t begin = p + tag.size(), end;
+    if (line[begin] == '"') end = line.find('"', ++begin);
+    else end = line.find_first_of(",}", begin);
+    return line.substr(begin, end - begin);
+}
+
+// Вывод пишет по событию в строке; метаданные (имена потоков пула) пропускаются
+std::vector<Event> events(const std::string& json) {
+    std::vector<Event> out;
+    size_t p = 0;
+    while ((p = json.find("{\"name\":", p)) != std::string::npos) {
+        const std::string line = json.substr(p, json.find('\n', p) - p);
+        Event e;
+        e.name = field(line, "name");
+        e.cat = field(line, "cat");
+        e.ph = field(line, "ph");
+        e.tid = std::atoi(field(line, "tid").c_str());
+        e.ts = std::atof(field(line, "ts").c_str());
+        e.dur = std::atof(field(line, "dur").c_str());
+        if (e.ph != "M") out.push_back(e);
+        p += line.size();
+    }
+    return out;
+}
+
+void append(void* context, const void* data, int size) {
+    static_cast<std::string*>(context)->append(static_cast<const char*>(data), size_t(size));
+}
+
+std::string traceJson() {
+    std::string json;
+    LUTools_WriteTrace(append, &json);
+    return json;
+}
+
+int count(const std::vector<Event>& list, const std::string& name) {
+    int n = 0;
+    for (const auto& e : list) n += e.name == name;
+    return n;
+}
+
+const Event* find(const std::vector<Event>& list, const std::string& name) {
+    for (const auto& e : list)
+        if (e.name == name) return &e;
+    return nullptr;
+}
+
+struct Fixture {
+    int lut = 0;
+    std::string input = tempPath("trace_in.png");
+    std::string output = tempPath("trace_out.jpg");
+
+    Fixture() {
+        REQUIRE_EQ(LUTools_Init(), SUCCESS);
+        const std::string cube = tempPath("trace.cube");
+        writeCube(cube, 17);
+        REQUIRE_EQ(LUTools_LoadLUT(cube.c_str(), 1.0f, &lut), SUCCESS);
+        REQUIRE(saveImage(makeImage(600, 400, 7), input, "png"));
+    }
+    int process(int lutCount = 2) {
+        const std::vector<int> luts(size_t(lutCount), lut);
+        return LUTools_ProcessFileEx(input.c_str(), output.c_str(), luts.data(), lutCount, 0, 0, 0, 0, 0, nullptr, nullptr, nullptr);
+    }
+};
+
+} // namespace
+
+TEST_CASE(trace, process_file_timeline_is_valid_json) {
+    Fixture f;
+    LUTools_StartTrace();
+    REQUIRE_EQ(f.process(), SUCCESS);
+    LUTools_StopTrace();
+    const std::string json = traceJson();
+
+    CHECK(JsonChecker(json).valid());
+    CHECK(json.rfind("{\"traceEvents\":[", 0) == 0);
+    CHECK(json.find("\"droppedEvents\":0}") != std::string::npos);
+    const std::vector<Event> list = events(json);
+    CHECK_EQ(count(list, "ProcessFile"), 1);
+    CHECK_EQ(count(list, "Decode"), 1);
+    CHECK_EQ(count(list, "Encode"), 1);
+    CHECK_EQ(count(list, "Apply LUT"), 2);
+    CHECK(count(list, "Tile") >= 2);
+    for (const auto& e : list) {
+        CHECK_EQ(e.ph, std::string("X"));
+        CHECK(e.ts >= 0 && e.dur >= 0);
+        CHECK(e.tid > 0);
+    }
+
+    // Этапы вложены в вызов API своего потока; ts/dur в микросекундах с точностью до 0.001
+    const Event* api = find(list, "ProcessFile");
+    REQUIRE(api != nullptr);
+    CHECK_EQ(api->cat, std::string("api"));
+    for (const char* name : { "Decode", "Apply LUT", "Encode" }) {
+        const Event* e = find(list, name);
+        REQUIRE(e != nullptr);
+        CHECK_EQ(e->tid, api->tid);
+        CHECK(e->ts >= api->ts);
+        CHECK(e->ts + e->dur <= api->ts + api->dur + 0.002);
+    }
+    CHECK(find(list, "Decode")->ts + find(list, "Decode")->dur <= find(list, "Apply LUT")->ts + 0.002);
+    CHECK(find(list, "Apply LUT")->ts <= find(list, "Encode")->ts);
+    CHECK(json.find("\"name\":\"Decode\",\"cat\":\"codec\"") != std::string::npos);
+    CHECK(json.find("\"args\":{\"bytes\":" + std::to_string(std::filesystem::file_size(f.input)) + "}") != std::string::npos);
+}
+
+TEST_CASE(trace, nothing_is_recorded_while_disabled) {
+    Fixture f;
+    LUTools_StartTrace();
+    LUTools_StopTrace();
+    CHECK(!Tracer::enabled());
+    REQUIRE_EQ(f.process(), SUCCESS);
+    std::string json = traceJson();
+    CHECK(JsonChecker(json).valid());
+    CHECK(events(json).empty());
+
+    // После остановки записанное остаётся, новое не добавляется
+    LUTools_StartTrace();
+    REQUIRE_EQ(f.process(1), SUCCESS);
+    LUTools_StopTrace();
+    const size_t recorded = events(traceJson()).size();
+    CHECK(recorded > 0);
+    REQUIRE_EQ(f.process(1), SUCCESS);
+    CHECK_EQ(events(traceJson()).size(), recorded);
+}
+
+TEST_CASE(trace, start_clears_previous_events) {
+    Fixture f;
+    LUTools_StartTrace();
+    REQUIRE_EQ(f.process(), SUCCESS);
+    LUTools_StartTrace();
+    std::string json = traceJson();
+    CHECK(events(json).empty());
+    REQUIRE_EQ(f.process(1), SUCCESS);
+    LUTools_StopTrace();
+    const std::vector<Event> list = events(traceJson());
+    CHECK_EQ(count(list, "ProcessFile"), 1);
+    CHECK_EQ(count(list, "Apply LUT"), 1);
+}
+
+TEST_CASE(trace, finished_threads_keep_their_events) {
+    Fixture f;
+    LUTools_StartTrace();
+    std::thread([&f] { REQUIRE_EQ(f.process(1), SUCCESS); }).join();
+    REQUIRE_EQ(f.process(1), SUCCESS);
+    LUTools_StopTrace();
+    const std::vector<Event> list = events(traceJson());
+    REQUIRE_EQ(count(list, "ProcessFile"), 2);
+    int tids[2] = {}, n = 0;
+    for (const auto& e : list)
+        if (e.name == "ProcessFile") tids[n++] = e.tid;
+    CHECK(tids[0] != tids[1]);
+}
+
+TEST_CASE(trace, per_thread_limit_counts_dropped_events) {
+    LUTools_StartTrace();
+    std::thread([] {
+        for (size_t i = 0; i < Tracer::kMaxEventsPerThread + 25; ++i) TraceScope scope("Flood", "test");
+    }).join();
+    LUTools_StopTrace();
+    const std::string json = traceJson();
+    CHECK(json.find("\"droppedEvents\":25}") != std::string::npos);
+    CHECK_EQ(size_t(count(events(json), "Flood")), Tracer::kMaxEventsPerThread);
+    LUTools_StartTrace();   // освобождаем буферы
+    LUTools_StopTrace();
+}
+
+TEST_CASE(trace, save_trace_writes_file) {
+    Fixture f;
+    LUTools_StartTrace();
+    REQUIRE_EQ(f.process(1), SUCCESS);
+    LUTools_StopTrace();
+    const std::string path = tempPath("trace.json");
+    REQUIRE_EQ(LUTools_SaveTrace(path.c_str()), SUCCESS);
+    const auto bytes = readFile(path);
+    CHECK_EQ(std::string(bytes.begin(), bytes.end()), traceJson());
+    CHECK_EQ(LUTools_SaveTrace(tempPath("no_such_dir/trace.json").c_str()), WRITE_FAILED);
+    CHECK_EQ(LUTools_SaveTrace(nullptr), WRITE_FAILED);
+    LUTools_WriteTrace(nullptr, nullptr);   // безвредно
+}
@@ -0,0 +1,190 @@
+#include "test_util.hpp"
+#include "LUToolsLite.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <new>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Учёт памяти operator new: перед блоком — его размер (16 байт сохраняют выравнивание)
+constexpr size_t kHeapHeader = 16;
+std::atomic<size_t> g_heapLive{0};
+std::atomic<size_t> g_heapPeak{0};
+
+void* trackedAlloc(size_t size) {
+    void* raw = std::malloc(size + kHeapHeader);
+    if (!raw) return nullptr;
+    *static_cast<size_t*>(raw) = size;
+    const size_t live = g_heapLive.fetch_add(size, std::memory_order_relaxed) + size;
+    size_t peak = g_heapPeak.load(std::memory_order_relaxed);
+    while (live > peak && !g_heapPeak.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+    return static_cast<unsigned char*>(raw) + kHeapHeader;
+}
+
+void trackedFree(void* p) {
+    if (!p) return;
+    void* raw = static_cast<unsigned char*>(p) - kHeapHeader;
+    g_heapLive.fetch_sub(*static_cast<size_t*>(raw), std::memory_order_relaxed);
+    std::free(raw);
+}
+
+} // namespace
+
+void* operator new(size_t size) {
+    if (void* p = trackedAlloc(size)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { trackedFree(p); }
+void operator delete(void* p, size_t) noexcept { trackedFree(p); }
+
+namespace ltltest {
+
+namespace {
+std::string g_suite = "all";
+bool g_cleaned = false;
+}
+
+void setSuite(const char* suite) {
+    if (g_suite != suite) g_cleaned = false;
+    g_suite = suite;
+}
+
+std::string tempPath(const std::string& name) {
+    const fs::path dir = fs::temp_directory_path() / ("lutools_tests_" + g_suite);
+    if (!g_cleaned) {
+        std::error_code ec;
+        fs::remove_all(dir, ec);
+        fs::create_directories(dir);
+        g_cleaned = true;
+    }
+    return (dir / name).string();
+}
+
+size_t heapLiveBytes() { return g_heapLive.load(std::memory_order_relaxed); }
+size_t heapPeakBytes() { return g_heapPeak.load(std::memory_order_relaxed); }
+void resetHeapPeak() { g_heapPeak.store(g_heapLive.load(std::memory_order_relaxed), std::memory_order_relaxed); }
+
+std::vector<unsigned char> readFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<unsigned char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+bool writeFile(const std::string& path, const std::vector<unsigned char>& bytes) {
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(bytes.data()), std::streamsize(bytes.size()));
+    return bool(out);
+}
+
+Image makeImage(int width, int height, int noise, uint32_t seed) {
+    return makeImage(width, height, 3, noise, seed);
+}
+
+Image makeImage(int width, int height, int channels, int noise, uint32_t seed) {
+    Image img;
+    img.width = width;
+    img.height = height;
+    img.channels = channels;
+    img.data.allocate(size_t(width) * height * channels);
+    uint32_t state = seed * 2654435761u + 1;
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            unsigned char* p = img.data.data() + (size_t(y) * width + x) * channels;
+            const int base[4] = {
+                width > 1 ? x * 255 / (width - 1) : 128,
+                height > 1 ? y * 255 / (height - 1) : 128,
+                (x + y) * 255 / std::max(1, width + height - 2),
+                255 - (x * 3 + y) % 256,
+            };
+            for (int c = 0; c < channels; ++c) {
+                int v = base[c];
+                if (noise > 0) {
+                    state = state * 1664525u + 1013904223u;
+                    v += int((state >> 16) % uint32_t(2 * noise + 1)) - noise;
+                }
+                p[c] = static_cast<unsigned char>(std::clamp(v, 0, 255));
+            }
+        }
+    }
+    return img;
+}
+
+Image decodeWithStb(const std::vector<unsigned char>& bytes) {
+    Image img{};
+    int w = 0, h = 0, n = 0;
+    unsigned char* pixels = stbi_load_from_memory(bytes.data(), int(bytes.size()), &w, &h, &n, 3);
+    if (!pixels) return img;
+    img.width = w;
+    img.height = h;
+    img.channels = 3;
+    img.data = PixelBuffer::adopt(pixels, size_t(w) * h * 3, [](unsigned char* p) { stbi_image_free(p); });
+    return img;
+}
+
+bool samePixels(const Image& a, const Image& b) {
+    return a.width == b.width && a.height == b.height && a.channels == b.channels &&
+           a.data.size() == b.data.size() && std::equal(a.data.begin(), a.data.end(), b.data.begin());
+}
+
+int maxDifference(const Image& a, const Image& b) {
+    if (a.width != b.width || a.height != b.height || a.channels != b.channels || a.data.size() != b.data.size())
+        return 256;
+    int diff = 0;
+    for (size_t i = 0; i < a.data.size(); ++i) diff = std::max(diff, std::abs(int(a.data[i]) - int(b.data[i])));
+    return diff;
+}
+
+double psnr(const Image& a, const Image& b) {
+    if (a.width != b.width || a.height != b.height || a.channels != b.channels || a.data.size() != b.data.size() ||
+        a.data.empty())
+        return 0.0;
+    double sum = 0.0;
+    for (size_t i = 0; i < a.data.size(); ++i) {
+        const double d = double(a.data[i]) - double(b.data[i]);
+        sum += d * d;
+    }
+    if (sum == 0.0) return std::numeric_limits<double>::infinity();
+    return 10.0 * std::log10(255.0 * 255.0 / (sum / double(a.data.size())));
+}
+
+void writeCube(const std::string& path, int size, const std::string& title, const CubeFn& fn) {
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return;
+    if (!title.empty()) std::fprintf(f, "TITLE \"%s\"\n", title.c_str());
+    std::fprintf(f, "LUT_3D_SIZE %d\n", size);
+    const float step = size > 1 ? 1.0f / float(size - 1) : 0.0f;
+    for (int b = 0; b < size; ++b)
+        for (int g = 0; g < size; ++g)
+            for (int r = 0; r < size; ++r) {
+                Color c = fn ? fn(r * step, g * step, b * step) : Color{r * step, g * step, b * step};
+                std::fprintf(f, "%.6f %.6f %.6f\n", c.r, c.g, c.b);
+            }
+    std::fclose(f);
+}
+
+int applyLUTs(const Image& img, const std::vector<int>& lutIds, Image& out) {
+    std::vector<unsigned char> input(img.data.begin(), img.data.end());
+    unsigned char* data = nullptr;
+    int w = 0, h = 0, c = 0;
+    const int rc = LUTools_ProcessImage(input.data(), img.width, img.height, img.channels, lutIds.data(),
+                                        static_cast<int>(lutIds.size()), 0, 0, 0, 0, 0, &data, &w, &h, &c);
+    out = Image{};
+    if (rc == 0 && data) {
+        out.width = w;
+        out.height = h;
+        out.channels = c;
+        out.data.assign(data, data + size_t(w) * h * c);
+    }
+    LUTools_FreeMemory(data);
+    return rc;
+}
+
+} // namespace ltltest
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "image_io.hpp"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// ─────────────────────────────────────────────────────────────
+//  Общие помощники тестов: временные файлы набора, синтетические
+//  изображения и .cube, сравнение изображений.
+// ─────────────────────────────────────────────────────────────
+
+namespace ltltest {
+
+// Каталог набора во временном каталоге ОС; очищается при первом обращении
+void setSuite(const char* suite);
+std::string tempPath(const std::string& name);
+
+std::vector<unsigned char> readFile(const std::string& path);
+bool writeFile(const std::string& path, const std::vector<unsigned char>& bytes);
+
+// RGB: плавные градиенты по x и y плюс шум ±noise (детерминированный по seed)
+Image makeImage(int width, int height, int noise = 0, uint32_t seed = 1);
+Image makeImage(int width, int height, int channels, int noise, uint32_t seed);
+
+// Независимый от библиотеки декодер (stb_image) — для проверки собственных кодировщиков
+Image decodeWithStb(const std::vector<unsigned char>& bytes);
+
+bool samePixels(const Image& a, const Image& b);
+int maxDifference(const Image& a, const Image& b);
+// Пиковое отношение сигнал/шум в дБ; бесконечность — изображения совпадают
+double psnr(const Image& a, const Image& b);
+
+// Байты, выделенные через operator new и ещё не освобождённые, по всему процессу,
+// и их максимум с последнего resetHeapPeak(). Память пула буферов (posix_memalign)
+// и malloc сторонних библиотек сюда не входят.
+size_t heapLiveBytes();
+size_t heapPeakBytes();
+void resetHeapPeak();
+
+using CubeFn = std::function<Color(float r, float g, float b)>;
+// LUT_3D_SIZE size, R — самый быстрый индекс; fn = nullptr — тождественная таблица
+void writeCube(const std::string& path, int size, const std::string& title = "", const CubeFn& fn = nullptr);
+
+// LUTools_ProcessImage без коррекций; код возврата, результат — в out
+int applyLUTs(const Image& img, const std::vector<int>& lutIds, Image& out);
+
+} // namespace ltltest
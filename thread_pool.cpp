@@ -0,0 +1,126 @@
+#include "thread_pool.hpp"
+#include "stats.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+ThreadPool& ThreadPool::instance() {
+    static ThreadPool* pool = new ThreadPool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return *pool;
+}
+
+ThreadPool::ThreadPool(unsigned threads) : threads_(threads) {
+    ensureRunning();
+}
+
+ThreadPool::~ThreadPool() {
+    shutdown();
+}
+
+void ThreadPool::ensureRunning() {
+    if (threads_ == 0 || running_.load(std::memory_order_acquire)) return;
+    std::lock_guard<std::mutex> life(lifeMutex_);
+    if (running_.load(std::memory_order_relaxed)) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = false;
+    }
+    for (unsigned i = 0; i < threads_; ++i)
+        workers_.emplace_back(&ThreadPool::workerLoop, this);
+    running_.store(true, std::memory_order_release);
+}
+
+void ThreadPool::shutdown() {
+    std::lock_guard<std::mutex> life(lifeMutex_);
+    if (!running_.load(std::memory_order_relaxed)) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    for (auto& t : workers_) t.join();
+    workers_.clear();
+    running_.store(false, std::memory_order_release);
+}
+
+void ThreadPool::submit(std::function<void()> job) {
+    if (threads_ == 0) {
+        job();
+        return;
+    }
+    ensureRunning();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back({std::move(job), std::chrono::steady_clock::now()});
+    }
+    cv_.notify_one();
+}
+
+void ThreadPool::workerLoop() {
+    Tracer::instance().nameThread("LUTools pool");
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+            if (stop_ && queue_.empty()) return;
+            QueuedJob& front = queue_.front();
+            job = std::move(front.job);
+            statAdd(kStatQueueWait, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                        std::chrono::steady_clock::now() - front.queued).count()));
+            queue_.pop_front();
+        }
+        job();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& fn, unsigned maxThreads) {
+    if (count == 0) return;
+    if (count == 1 || threads_ == 0 || maxThreads == 1) {
+        for (size_t i = 0; i < count; ++i) fn(i);
+        return;
+    }
+
+    struct State {
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> done{0};
+        size_t count = 0;
+        const std::function<void(size_t)>* fn = nullptr;
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::exception_ptr error;
+    };
+    auto state = std::make_shared<State>();
+    state->count = count;
+    state->fn = &fn;
+
+    // Забираем индексы, пока они есть; fn жив, пока done < count
+    auto drain = [](const std::shared_ptr<State>& s) {
+        for (;;) {
+            size_t i = s->next.fetch_add(1);
+            if (i >= s->count) return;
+            try {
+                (*s->fn)(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(s->mutex);
+                if (!s->error) s->error = std::current_exception();
+            }
+            if (s->done.fetch_add(1) + 1 == s->count) {
+                std::lock_guard<std::mutex> lock(s->mutex);
+                s->cv.notify_all();
+            }
+        }
+    };
+
+    size_t helpers = std::min<size_t>(threads_, count - 1);
+    if (maxThreads) helpers = std::min<size_t>(helpers, maxThreads - 1);
+    for (size_t h = 0; h < helpers; ++h)
+        submit([state, drain] { drain(state); });
+    drain(state);
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->cv.wait(lock, [&] { return state->done.load() == state->count; });
+    if (state->error) std::rethrow_exception(state->error);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ─────────────────────────────────────────────────────────────
+//  Общий пул потоков библиотеки.
+//  parallelFor можно вызывать из задач пула: вызывающий поток сам
+//  забирает индексы, поэтому вложенный вызов не блокируется,
+//  даже если все воркеры заняты.
+// ─────────────────────────────────────────────────────────────
+class ThreadPool {
+public:
+    // Общий пул не уничтожается: join в статическом деструкторе DLL зависает под
+    // loader lock Windows. Воркеры останавливает shutdown (LUTools_Cleanup).
+    static ThreadPool& instance();
+
+    explicit ThreadPool(unsigned threads);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Число воркеров (без учёта вызывающего потока)
+    unsigned size() const { return threads_; }
+
+    // Без воркеров (одно ядро) задача выполняется сразу в вызывающем потоке
+    void submit(std::function<void()> job);
+
+    // fn(i) для i в [0, count); исключение из fn пробрасывается вызывающему.
+    // maxThreads — сколько потоков вместе с вызывающим, 0 — все воркеры
+    void parallelFor(size_t count, const std::function<void(size_t)>& fn, unsigned maxThreads = 0);
+
+    // Выполняет очередь и останавливает воркеры; следующая задача запустит их снова
+    void shutdown();
+
+private:
+    void ensureRunning();
+    void workerLoop();
+
+    const unsigned threads_;
+    std::mutex lifeMutex_;   // запуск и остановка воркеров
+    std::atomic<bool> running_{false};
+    std::vector<std::thread> workers_;
+    // Время постановки — для статистики ожидания в очереди
+    struct QueuedJob {
+        std::function<void()> job;
+        std::chrono::steady_clock::time_point queued;
+    };
+    std::deque<QueuedJob> queue_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+};
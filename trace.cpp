@@ -0,0 +1,143 @@
+#include "trace.hpp"
+#include "codec.hpp"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <string>
+
+struct Tracer::ThreadBuffer {
+    std::mutex mutex;          // владелец и writeJson; без трассировки не берётся
+    std::vector<TraceEvent> events;
+    uint64_t dropped = 0;
+    uint32_t tid = 0;
+    const char* name = nullptr;
+};
+
+Tracer& Tracer::instance() {
+    // Не разрушается: потоки пула могут писать события после выхода из main
+    static Tracer* tracer = new Tracer;
+    return *tracer;
+}
+
+Tracer::ThreadBuffer& Tracer::local() {
+    // Буфер переживает поток: его события нужны до следующего start()
+    thread_local std::shared_ptr<ThreadBuffer> buffer = [this] {
+        auto b = std::make_shared<ThreadBuffer>();
+        std::lock_guard<std::mutex> lock(mutex_);
+        b->tid = nextTid_++;
+        threads_.push_back(b);
+        return b;
+    }();
+    return *buffer;
+}
+
+void Tracer::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Буферы завершившихся потоков больше не нужны
+    threads_.erase(std::remove_if(threads_.begin(), threads_.end(),
+                                  [](const auto& b) { return b.use_count() == 1; }),
+                   threads_.end());
+    for (const auto& b : threads_) {
+        std::lock_guard<std::mutex> bufferLock(b->mutex);
+        b->events.clear();
+        b->dropped = 0;
+    }
+    origin_.store(clock(), std::memory_order_relaxed);
+    enabled_.store(true, std::memory_order_release);
+}
+
+void Tracer::stop() {
+    enabled_.store(false, std::memory_order_release);
+}
+
+void Tracer::record(const TraceEvent& event) {
+    ThreadBuffer& b = local();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    if (b.events.size() >= kMaxEventsPerThread) {
+        ++b.dropped;
+        return;
+    }
+    b.events.push_back(event);
+}
+
+void Tracer::nameThread(const char* name) {
+    ThreadBuffer& b = local();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    b.name = name;
+}
+
+namespace {
+
+// Накопление JSON кусками, чтобы не держать весь текст в памяти
+class JsonWriter {
+public:
+    explicit JsonWriter(ByteSink& sink) : sink_(sink) {}
+    ~JsonWriter() { flush(); }
+
+    void put(const char* text, int length) {
+        if (length > 0) buffer_.append(text, size_t(length));
+        if (buffer_.size() >= 64 * 1024) flush();
+    }
+    bool flush() {
+        ok_ = ok_ && (buffer_.empty() || sink_.write(buffer_.data(), buffer_.size()));
+        buffer_.clear();
+        return ok_;
+    }
+
+private:
+    ByteSink& sink_;
+    std::string buffer_;
+    bool ok_ = true;
+};
+
+} // namespace
+
+bool Tracer::writeJson(ByteSink& sink) {
+    std::vector<std::shared_ptr<ThreadBuffer>> threads;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        threads = threads_;
+    }
+    const int64_t origin = origin_.load(std::memory_order_relaxed);
+    JsonWriter out(sink);
+    char line[256];
+    uint64_t dropped = 0;
+    bool first = true;
+    out.put("{\"traceEvents\":[\n", 17);
+    std::vector<TraceEvent> events;
+    for (const auto& b : threads) {
+        const char* name = nullptr;
+        {
+            // Копия под замком: владелец продолжает писать, пока формируется JSON
+            std::lock_guard<std::mutex> lock(b->mutex);
+            events = b->events;
+            dropped += b->dropped;
+            name = b->name;
+        }
+        if (name) {
+            int n = std::snprintf(line, sizeof(line),
+                                  "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                                  first ? "" : ",\n", b->tid, name);
+            out.put(line, n);
+            first = false;
+        }
+        for (const TraceEvent& e : events) {
+            // Событие, начатое до start(), обрезается по началу трассировки
+            const int64_t start = std::max(e.start, origin);
+            const int64_t end = std::max(e.start + e.duration, start);
+            int n = std::snprintf(line, sizeof(line),
+                                  "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f",
+                                  first ? "" : ",\n", e.name, e.category, b->tid,
+                                  double(start - origin) / 1000.0, double(end - start) / 1000.0);
+            out.put(line, n);
+            n = e.argName ? std::snprintf(line, sizeof(line), ",\"args\":{\"%s\":%" PRId64 "}}", e.argName, e.arg)
+                          : std::snprintf(line, sizeof(line), "}");
+            out.put(line, n);
+            first = false;
+        }
+    }
+    int n = std::snprintf(line, sizeof(line),
+                          "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEvents\":%" PRIu64 "}}\n", dropped);
+    out.put(line, n);
+    return out.flush();
+}
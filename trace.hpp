@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class ByteSink;
+
+// ─────────────────────────────────────────────────────────────
+//  Трассировка конвейера в формате Chrome Trace Event
+//  (chrome://tracing, ui.perfetto.dev). Включается явно; пока
+//  выключена, замер стоит одного атомарного чтения. Каждый поток
+//  пишет события в свой буфер, JSON собирается из всех буферов
+//  по запросу, в том числе во время записи.
+// ─────────────────────────────────────────────────────────────
+
+struct TraceEvent {
+    const char* name;          // строковые литералы: хранятся указатели
+    const char* category;
+    const char* argName;       // nullptr — без аргумента
+    int64_t arg;
+    int64_t start;             // нс steady_clock
+    int64_t duration;
+};
+
+class Tracer {
+public:
+    static Tracer& instance();
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    // Не больше стольких событий на поток между start(); остальные отбрасываются
+    static constexpr size_t kMaxEventsPerThread = 1u << 18;
+
+    static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+    static int64_t clock() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Очищает буферы и начинает запись
+    void start();
+    void stop();
+    // В буфер вызывающего потока
+    void record(const TraceEvent& event);
+    // Имя потока на временной шкале; строковый литерал
+    void nameThread(const char* name);
+    // {"traceEvents":[...]}: события с последнего start()
+    bool writeJson(ByteSink& sink);
+
+    struct ThreadBuffer;
+
+private:
+    Tracer() = default;
+    ThreadBuffer& local();
+
+    static inline std::atomic<bool> enabled_{false};
+    std::atomic<int64_t> origin_{0};
+    std::mutex mutex_;
+    std::vector<std::shared_ptr<ThreadBuffer>> threads_;
+    uint32_t nextTid_ = 1;
+};
+
+// Событие от конструктора до деструктора; аргумент — номер строки, тайла, файла и т. п.
+class TraceScope {
+public:
+    explicit TraceScope(const char* name, const char* category, const char* argName = nullptr, int64_t arg = 0)
+        : event_{name, category, argName, arg, Tracer::enabled() ? Tracer::clock() : 0, 0} {}
+    ~TraceScope() {
+        if (!event_.start) return;
+        event_.duration = Tracer::clock() - event_.start;
+        Tracer::instance().record(event_);
+    }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    TraceEvent event_;
+};